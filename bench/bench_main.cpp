@@ -0,0 +1,76 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "./benchmark.hpp"
+
+static void printUsage() {
+    std::cerr << "Usage: minidb_bench [--suite micro|macro|all] [--scale FACTOR] [--seed N]\n"
+              << "                    [--filter TEXT] [--dir DIR] [--output FILE]\n"
+              << "\n"
+              << "Runs the benchmarks and writes the results as JSON to FILE (default:\n"
+              << "stdout). A summary table is printed to stderr.\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    std::string suite = "all";
+    std::string outputFile;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        try {
+            if (arg == "--suite" && hasValue) {
+                suite = argv[++i];
+            } else if (arg == "--scale" && hasValue) {
+                config.scale = std::stod(argv[++i]);
+            } else if (arg == "--seed" && hasValue) {
+                config.seed = std::stoull(argv[++i]);
+            } else if (arg == "--filter" && hasValue) {
+                config.filter = argv[++i];
+            } else if (arg == "--dir" && hasValue) {
+                config.workDir = argv[++i];
+            } else if (arg == "--output" && hasValue) {
+                outputFile = argv[++i];
+            } else {
+                printUsage();
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+    if ((suite != "micro" && suite != "macro" && suite != "all") || config.scale <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    BenchmarkRunner runner(config);
+    try {
+        if (suite != "macro") {
+            runMicroBenchmarks(runner);
+        }
+        if (suite != "micro") {
+            runMacroBenchmarks(runner);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    runner.writeSummary(std::cerr);
+
+    if (outputFile.empty()) {
+        runner.writeJson(std::cout);
+    } else {
+        std::ofstream out(outputFile);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open output file: " << outputFile << std::endl;
+            return 1;
+        }
+        runner.writeJson(out);
+    }
+    return 0;
+}
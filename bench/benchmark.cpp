@@ -0,0 +1,136 @@
+#include "./benchmark.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+
+static volatile uint64_t consumed;
+
+void consume(uint64_t value) {
+    consumed = consumed + value;
+}
+
+size_t BenchmarkConfig::scaled(size_t base) const {
+    double count = std::round(static_cast<double>(base) * scale);
+    return count < 1.0 ? 1 : static_cast<size_t>(count);
+}
+
+BenchmarkRunner::BenchmarkRunner(const BenchmarkConfig& config) : config(config) {}
+
+bool BenchmarkRunner::enabled(const std::string& name) const {
+    return config.filter.empty() || name.find(config.filter) != std::string::npos;
+}
+
+void BenchmarkRunner::run(const std::string& name, const std::string& kind, size_t operations,
+                          const std::function<uint64_t(size_t)>& operation,
+                          const std::function<void(size_t)>& reset) {
+    if (!enabled(name)) {
+        return;
+    }
+
+    std::vector<uint64_t> samples;
+    samples.reserve(operations);
+
+    BenchmarkResult result;
+    result.name = name;
+    result.kind = kind;
+    result.operations = operations;
+
+    for (size_t i = 0; i < operations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        result.items += operation(i);
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        if (reset) {
+            reset(i);
+        }
+    }
+
+    // Latency distribution
+    std::sort(samples.begin(), samples.end());
+    uint64_t total = 0;
+    for (uint64_t sample : samples) {
+        total += sample;
+    }
+    auto percentile = [&samples](double p) {
+        size_t index = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+        return samples[index];
+    };
+    if (!samples.empty()) {
+        result.seconds = static_cast<double>(total) / 1e9;
+        result.minNs = samples.front();
+        result.meanNs = total / samples.size();
+        result.p50Ns = percentile(0.50);
+        result.p95Ns = percentile(0.95);
+        result.p99Ns = percentile(0.99);
+        result.maxNs = samples.back();
+    }
+
+    results.push_back(result);
+}
+
+// Benchmark names are plain identifiers, but escape anyway
+static std::string jsonString(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+void BenchmarkRunner::writeJson(std::ostream& out) const {
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out << "{\n"
+        << "  \"suite\": \"minidb_bench\",\n"
+        << "  \"timestamp\": " << jsonString(timestamp) << ",\n"
+        << "  \"scale\": " << config.scale << ",\n"
+        << "  \"seed\": " << config.seed << ",\n"
+        << "  \"results\": [";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& r = results[i];
+        double opsPerSecond = r.seconds > 0 ? static_cast<double>(r.operations) / r.seconds : 0.0;
+        double itemsPerSecond = r.seconds > 0 ? static_cast<double>(r.items) / r.seconds : 0.0;
+
+        out << (i > 0 ? ",\n" : "\n")
+            << "    {\"name\": " << jsonString(r.name)
+            << ", \"kind\": " << jsonString(r.kind)
+            << ", \"operations\": " << r.operations
+            << ", \"items\": " << r.items
+            << ", \"seconds\": " << std::setprecision(6) << std::fixed << r.seconds
+            << ", \"ops_per_sec\": " << std::setprecision(1) << opsPerSecond
+            << ", \"items_per_sec\": " << itemsPerSecond
+            << std::defaultfloat
+            << ", \"latency_ns\": {\"min\": " << r.minNs
+            << ", \"mean\": " << r.meanNs
+            << ", \"p50\": " << r.p50Ns
+            << ", \"p95\": " << r.p95Ns
+            << ", \"p99\": " << r.p99Ns
+            << ", \"max\": " << r.maxNs << "}}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void BenchmarkRunner::writeSummary(std::ostream& out) const {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-36s %10s %14s %12s %12s\n",
+                  "benchmark", "ops", "ops/sec", "p50 (us)", "p99 (us)");
+    out << line;
+
+    for (const BenchmarkResult& r : results) {
+        double opsPerSecond = r.seconds > 0 ? static_cast<double>(r.operations) / r.seconds : 0.0;
+        std::snprintf(line, sizeof(line), "%-36s %10llu %14.1f %12.2f %12.2f\n",
+                      r.name.c_str(), static_cast<unsigned long long>(r.operations), opsPerSecond,
+                      static_cast<double>(r.p50Ns) / 1000.0, static_cast<double>(r.p99Ns) / 1000.0);
+        out << line;
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "./data_generator.hpp"
+
+// Settings shared by all benchmarks
+struct BenchmarkConfig {
+    double scale = 1.0;          // Multiplies every data set and iteration count
+    uint64_t seed = 42;          // Seed of the data generator
+    std::string filter;          // Only run benchmarks whose name contains this
+    std::string workDir = ".";   // Where database files are created
+
+    // A base count adjusted by the scale factor, at least 1
+    size_t scaled(size_t base) const;
+};
+
+// Measurements of one benchmark
+struct BenchmarkResult {
+    std::string name;
+    std::string kind;            // "micro" or "macro"
+    uint64_t operations = 0;
+    uint64_t items = 0;          // Rows or tokens handled by all operations
+    double seconds = 0.0;        // Total time of all timed operations
+    uint64_t minNs = 0;
+    uint64_t meanNs = 0;
+    uint64_t p50Ns = 0;
+    uint64_t p95Ns = 0;
+    uint64_t p99Ns = 0;
+    uint64_t maxNs = 0;
+};
+
+/**
+ * Runs benchmarks and collects their results. Each operation is timed on
+ * its own, so results carry a latency distribution besides throughput;
+ * setup work belongs outside the timed callback.
+ */
+class BenchmarkRunner {
+public:
+    explicit BenchmarkRunner(const BenchmarkConfig& config);
+
+    const BenchmarkConfig& getConfig() const { return config; }
+
+    // Whether a benchmark passes the name filter
+    bool enabled(const std::string& name) const;
+
+    // Time `operations` calls of `operation(i)`. The callback returns the
+    // number of items (rows, tokens) it handled. `reset(i)`, if given, runs
+    // untimed after each operation, e.g. to roll its changes back.
+    void run(const std::string& name, const std::string& kind, size_t operations,
+             const std::function<uint64_t(size_t)>& operation,
+             const std::function<void(size_t)>& reset = nullptr);
+
+    const std::vector<BenchmarkResult>& getResults() const { return results; }
+
+    // Write all results as one JSON document
+    void writeJson(std::ostream& out) const;
+
+    // Write a short human-readable table
+    void writeSummary(std::ostream& out) const;
+
+private:
+    BenchmarkConfig config;
+    std::vector<BenchmarkResult> results;
+};
+
+// Keep the compiler from optimizing away a computed value
+void consume(uint64_t value);
+
+// Benchmark suites, in bench/micro_benchmarks.cpp and bench/macro_benchmarks.cpp
+void runMicroBenchmarks(BenchmarkRunner& runner);
+void runMacroBenchmarks(BenchmarkRunner& runner);
+
+#endif // BENCHMARK_HPP
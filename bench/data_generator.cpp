@@ -0,0 +1,80 @@
+#include "./data_generator.hpp"
+#include <cstdio>
+
+// SplitMix64 finalizer; cheap and well mixed
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static const char* const CITIES[] = {
+    "Amsterdam", "Berlin", "Chicago", "Delhi", "Edinburgh", "Florence",
+    "Geneva", "Hanoi", "Istanbul", "Jakarta", "Kyoto", "Lima",
+    "Madrid", "Nairobi", "Oslo", "Porto", "Quito", "Riga",
+    "Seoul", "Tokyo", "Utrecht", "Vienna", "Warsaw", "Xiamen",
+    "Yerevan", "Zurich", "Austin", "Bogota", "Cairo", "Dublin",
+    "Essen", "Fukuoka"
+};
+static const uint64_t CITY_COUNT = sizeof(CITIES) / sizeof(CITIES[0]);
+
+DataGenerator::DataGenerator(uint64_t seed) : seed(seed), state(mix(seed)) {}
+
+std::vector<ColumnDefinition> DataGenerator::columns() {
+    return {
+        ColumnDefinition("id", TokenType::INTEGER),
+        ColumnDefinition("name", TokenType::TEXT),
+        ColumnDefinition("age", TokenType::INTEGER),
+        ColumnDefinition("city", TokenType::TEXT),
+        ColumnDefinition("score", TokenType::REAL)
+    };
+}
+
+std::string DataGenerator::createTableSql(const std::string& table) {
+    return "CREATE TABLE " + table +
+           " (id INTEGER, name TEXT, age INTEGER, city TEXT, score REAL);";
+}
+
+uint64_t DataGenerator::hash(uint64_t id, uint64_t field) const {
+    return mix(seed ^ mix(id * 8 + field));
+}
+
+std::vector<Value> DataGenerator::row(uint64_t id) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "user_%08llx",
+                  static_cast<unsigned long long>(hash(id, 0) & 0xffffffffULL));
+
+    return {
+        Value::integer(static_cast<int64_t>(id)),
+        Value::text(name),
+        Value::integer(static_cast<int64_t>(18 + hash(id, 1) % 73)),
+        Value::text(CITIES[hash(id, 2) % CITY_COUNT]),
+        Value::real(static_cast<double>(hash(id, 3) % 100000) / 100.0)
+    };
+}
+
+std::string DataGenerator::insertSql(const std::string& table, uint64_t first, uint64_t count) const {
+    std::string sql = "INSERT INTO " + table + " VALUES ";
+    for (uint64_t id = first; id < first + count; id++) {
+        if (id > first) {
+            sql += ", ";
+        }
+        sql += '(';
+        std::vector<Value> values = row(id);
+        for (size_t i = 0; i < values.size(); i++) {
+            if (i > 0) {
+                sql += ", ";
+            }
+            sql += values[i].toLiteral();
+        }
+        sql += ')';
+    }
+    sql += ';';
+    return sql;
+}
+
+uint64_t DataGenerator::uniform(uint64_t bound) {
+    state = mix(state);
+    return bound == 0 ? 0 : state % bound;
+}
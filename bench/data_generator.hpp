@@ -0,0 +1,41 @@
+#ifndef DATA_GENERATOR_HPP
+#define DATA_GENERATOR_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../sql/parser.hpp"
+
+// Deterministic synthetic data for the benchmarks. Every row is derived
+// from the seed and its id alone, so any row can be produced on its own and
+// the same seed always yields the same data set on every platform.
+//
+// Schema: id INTEGER, name TEXT, age INTEGER, city TEXT, score REAL
+class DataGenerator {
+public:
+    explicit DataGenerator(uint64_t seed);
+
+    // Column definitions of the synthetic table
+    static std::vector<ColumnDefinition> columns();
+
+    // CREATE TABLE statement for the synthetic table
+    static std::string createTableSql(const std::string& table);
+
+    // Values of row `id`
+    std::vector<Value> row(uint64_t id) const;
+
+    // INSERT statement for rows [first, first + count)
+    std::string insertSql(const std::string& table, uint64_t first, uint64_t count) const;
+
+    // Next number of the generator's own random stream, in [0, bound)
+    uint64_t uniform(uint64_t bound);
+
+private:
+    uint64_t seed;
+    uint64_t state;
+
+    // Bits of row `id`, field `field`
+    uint64_t hash(uint64_t id, uint64_t field) const;
+};
+
+#endif // DATA_GENERATOR_HPP
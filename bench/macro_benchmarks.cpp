@@ -0,0 +1,228 @@
+#include "./benchmark.hpp"
+#include "../include/db_engine.hpp"
+#include "../executor/result_sink.hpp"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+static const char* const TABLE_NAME = "bench_users";
+
+// Rows per INSERT statement of the bulk load
+static const size_t INSERT_BATCH = 1000;
+
+// Run a query whose rows are only counted; failures abort the suite
+static uint64_t execute(DBEngine& db, const std::string& query) {
+    CountingSink sink;
+    ExecutionResult result = db.executeQuery(query, sink);
+    if (!result.success) {
+        throw std::runtime_error(result.errorMessage + " in: " + query.substr(0, 80));
+    }
+    return result.rowCount;
+}
+
+static void removeDatabase(const std::string& path) {
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + ".tmp").c_str());
+    std::remove((path + "-wal.1").c_str());
+    std::remove((path + ".new").c_str());
+}
+
+void runMacroBenchmarks(BenchmarkRunner& runner) {
+    const BenchmarkConfig& config = runner.getConfig();
+    DataGenerator generator(config.seed);
+    DataGenerator keys(config.seed + 1);
+
+    // Every write below is a committed, logged transaction on a real file
+    std::string path = config.workDir + "/minidb_bench.db";
+    removeDatabase(path);
+
+    auto db = std::make_unique<DBEngine>();
+    if (!db->openDatabase(path)) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    execute(*db, DataGenerator::createTableSql(TABLE_NAME));
+
+    // Bulk load in multi-row INSERT statements, one transaction each
+    size_t batches = (config.scaled(100000) + INSERT_BATCH - 1) / INSERT_BATCH;
+    size_t rowCount = batches * INSERT_BATCH;
+    std::vector<std::string> inserts;
+    for (size_t b = 0; b < batches; b++) {
+        inserts.push_back(generator.insertSql(TABLE_NAME, b * INSERT_BATCH, INSERT_BATCH));
+    }
+    runner.run("macro.bulk_insert", "macro", batches, [&](size_t i) {
+        return execute(*db, inserts[i]);
+    });
+    if (!runner.enabled("macro.bulk_insert")) {
+        // Later workloads still need the data
+        for (const std::string& insert : inserts) {
+            execute(*db, insert);
+        }
+    }
+    inserts.clear();
+
+    // The same rows through an Appender, typed values instead of SQL text,
+    // in transactions of INSERT_BATCH rows like macro.bulk_insert
+    if (runner.enabled("macro.bulk_append")) {
+        execute(*db, DataGenerator::createTableSql("bench_users_appended"));
+        std::vector<std::vector<Value>> rows;
+        for (size_t id = 0; id < rowCount; id++) {
+            rows.push_back(generator.row(id));
+        }
+        std::unique_ptr<Appender> appender = db->createAppender("bench_users_appended");
+        runner.run("macro.bulk_append", "macro", batches, [&](size_t i) {
+            for (size_t id = i * INSERT_BATCH; id < (i + 1) * INSERT_BATCH; id++) {
+                appender->appendRow(std::move(rows[id]));
+            }
+            if (!appender->flush()) {
+                throw std::runtime_error(appender->error());
+            }
+            return static_cast<uint64_t>(INSERT_BATCH);
+        });
+    }
+
+    runner.run("macro.point_lookup", "macro", config.scaled(200), [&](size_t) {
+        return execute(*db, "SELECT * FROM bench_users WHERE id = " +
+                           std::to_string(keys.uniform(rowCount)) + ";");
+    });
+
+    // Ages are uniform in [18, 90]; each scan returns 10 to 20% of the rows
+    runner.run("macro.range_scan", "macro", config.scaled(50), [&](size_t) {
+        uint64_t low = 76 + keys.uniform(8);
+        return execute(*db, "SELECT id, score FROM bench_users WHERE age > " +
+                           std::to_string(low) + ";");
+    });
+
+    // 80% point lookups, 15% single-row inserts and 5% deletes by key
+    uint64_t nextId = rowCount;
+    runner.run("macro.mixed_read_write", "macro", config.scaled(500), [&](size_t) {
+        uint64_t dice = keys.uniform(100);
+        if (dice < 80) {
+            return execute(*db, "SELECT * FROM bench_users WHERE id = " +
+                               std::to_string(keys.uniform(nextId)) + ";");
+        }
+        if (dice < 95) {
+            return execute(*db, generator.insertSql(TABLE_NAME, nextId++, 1));
+        }
+        return execute(*db, "DELETE FROM bench_users WHERE id = " +
+                           std::to_string(keys.uniform(nextId)) + ";");
+    });
+
+    // Counter increments by key, rewritten in place
+    runner.run("macro.counter_update", "macro", config.scaled(500), [&](size_t) {
+        return execute(*db, "UPDATE bench_users SET score = score + 1 WHERE id = " +
+                           std::to_string(keys.uniform(rowCount)) + ";");
+    });
+
+    runner.run("macro.checkpoint", "macro", config.scaled(3), [&](size_t) {
+        if (!db->saveDatabase()) {
+            throw std::runtime_error("Checkpoint failed");
+        }
+        return static_cast<uint64_t>(rowCount);
+    });
+
+    // Counter updates while checkpoints run back to back on another
+    // thread; only taking the snapshot pauses commits, so the tail should
+    // stay close to macro.counter_update
+    if (runner.enabled("macro.update_during_checkpoint")) {
+        std::atomic<bool> stop{false};
+        std::thread checkpoints([&]() {
+            while (!stop) {
+                db->saveDatabase();
+            }
+        });
+        try {
+            runner.run("macro.update_during_checkpoint", "macro", config.scaled(500), [&](size_t) {
+                return execute(*db, "UPDATE bench_users SET score = score + 1 WHERE id = " +
+                                   std::to_string(keys.uniform(rowCount)) + ";");
+            });
+        } catch (...) {
+            stop = true;
+            checkpoints.join();
+            throw;
+        }
+        stop = true;
+        checkpoints.join();
+    }
+
+    // Substring search on names ("user_" and 8 hex digits) for 4 random
+    // digits: every row is matched, then only those a trigram index lists
+    auto nameSearch = [&keys]() {
+        char pattern[16];
+        std::snprintf(pattern, sizeof(pattern), "%04llx", static_cast<unsigned long long>(keys.uniform(65536)));
+        return std::string("SELECT id FROM bench_users WHERE name LIKE '%") + pattern + "%';";
+    };
+    runner.run("macro.like_scan", "macro", config.scaled(20), [&](size_t) {
+        return execute(*db, nameSearch());
+    });
+    if (runner.enabled("macro.like_indexed")) {
+        execute(*db, "CREATE INDEX bench_users_name ON bench_users USING trigram (name);");
+        runner.run("macro.like_indexed", "macro", config.scaled(200), [&](size_t) {
+            return execute(*db, nameSearch());
+        });
+    }
+
+    // macro.point_lookup again, reading only the blocks whose Bloom
+    // filter on id may hold the key
+    if (runner.enabled("macro.point_lookup_bloom")) {
+        execute(*db, "CREATE INDEX bench_users_id ON bench_users USING bloom (id);");
+        runner.run("macro.point_lookup_bloom", "macro", config.scaled(200), [&](size_t) {
+            return execute(*db, "SELECT * FROM bench_users WHERE id = " +
+                               std::to_string(keys.uniform(rowCount)) + ";");
+        });
+    }
+
+    // macro.range_scan with the result cache on: the table does not change,
+    // so after the first run of each of the 8 queries they are cache hits
+    if (runner.enabled("macro.range_scan_cached")) {
+        db->setResultCache(size_t(256) << 20);
+        runner.run("macro.range_scan_cached", "macro", config.scaled(50), [&](size_t) {
+            uint64_t low = 76 + keys.uniform(8);
+            return execute(*db, "SELECT id, score FROM bench_users WHERE age > " +
+                               std::to_string(low) + ";");
+        });
+        db->setResultCache(0);
+    }
+
+    // Totals per city read from a materialized view instead of a scan,
+    // then macro.counter_update again with the view kept up to date
+    if (runner.enabled("macro.view_read") || runner.enabled("macro.counter_update_view")) {
+        execute(*db, "CREATE MATERIALIZED VIEW bench_cities AS SELECT city, COUNT(*) AS users, "
+                     "SUM(score) AS total FROM bench_users GROUP BY city;");
+        runner.run("macro.view_read", "macro", config.scaled(200), [&](size_t) {
+            return execute(*db, "SELECT city, users, total FROM bench_cities;");
+        });
+        runner.run("macro.counter_update_view", "macro", config.scaled(500), [&](size_t) {
+            return execute(*db, "UPDATE bench_users SET score = score + 1 WHERE id = " +
+                               std::to_string(keys.uniform(rowCount)) + ";");
+        });
+    }
+
+    // macro.range_scan over a copy of the table partitioned by age in
+    // ranges of 9 years; each scan reads only the
+    // last one or two partitions
+    if (runner.enabled("macro.range_scan_partitioned")) {
+        std::string partitions;
+        for (int upper = 27; upper <= 81; upper += 9) {
+            partitions += "PARTITION a" + std::to_string(upper) + " VALUES LESS THAN (" +
+                          std::to_string(upper) + "), ";
+        }
+        execute(*db, "CREATE TABLE bench_users_by_age (id INTEGER, name TEXT, age INTEGER, "
+                     "city TEXT, score REAL) PARTITION BY RANGE (age) (" + partitions +
+                     "PARTITION rest VALUES LESS THAN (MAXVALUE));");
+        for (size_t b = 0; b < batches; b++) {
+            execute(*db, generator.insertSql("bench_users_by_age", b * INSERT_BATCH, INSERT_BATCH));
+        }
+        runner.run("macro.range_scan_partitioned", "macro", config.scaled(50), [&](size_t) {
+            uint64_t low = 76 + keys.uniform(8);
+            return execute(*db, "SELECT id, score FROM bench_users_by_age WHERE age > " +
+                               std::to_string(low) + ";");
+        });
+    }
+
+    // Closing checkpoints once more; remove the files afterwards
+    db.reset();
+    removeDatabase(path);
+}
@@ -0,0 +1,208 @@
+#include "./benchmark.hpp"
+#include "../sql/tokenizer.hpp"
+#include "../sql/parser.hpp"
+#include "../storage/table.hpp"
+#include "../storage/transaction.hpp"
+#include "../executor/compiled_expression.hpp"
+#include "../include/arena.hpp"
+#include "../include/thread_pool.hpp"
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+static const char* const TABLE_NAME = "bench_users";
+
+// A table holding rows [0, rowCount) of the generator, all committed
+static std::unique_ptr<Table> populatedTable(const DataGenerator& generator,
+                                             TransactionManager& transactionManager,
+                                             size_t rowCount) {
+    auto table = std::make_unique<Table>(TABLE_NAME, DataGenerator::columns());
+
+    auto txn = transactionManager.begin();
+    std::string errorMessage;
+    for (size_t id = 0; id < rowCount; id++) {
+        table->insertRow(*txn, generator.row(id), errorMessage);
+    }
+    transactionManager.commit(*txn);
+    return table;
+}
+
+static void runParserBenchmarks(BenchmarkRunner& runner, const DataGenerator& generator) {
+    const BenchmarkConfig& config = runner.getConfig();
+
+    std::string insertSql = generator.insertSql(TABLE_NAME, 0, 100);
+    std::string selectSql = "SELECT id, name, score FROM bench_users WHERE age > 40;";
+
+    // Each iteration gets a fresh arena, as each query does in a session
+    runner.run("tokenizer.scan_insert_100_rows", "micro", config.scaled(2000), [&](size_t) {
+        QueryArena arena;
+        Tokenizer tokenizer(insertSql);
+        return static_cast<uint64_t>(tokenizer.scanTokens(arena.get()).size());
+    });
+
+    runner.run("tokenizer.scan_select", "micro", config.scaled(50000), [&](size_t) {
+        QueryArena arena;
+        Tokenizer tokenizer(selectSql);
+        return static_cast<uint64_t>(tokenizer.scanTokens(arena.get()).size());
+    });
+
+    Parser parser;
+    runner.run("parser.parse_insert_100_rows", "micro", config.scaled(2000), [&](size_t) {
+        QueryArena arena;
+        ParseResult result = parser.parse(insertSql, arena.get());
+        consume(result.success);
+        return uint64_t(100);
+    });
+
+    runner.run("parser.parse_select", "micro", config.scaled(50000), [&](size_t) {
+        QueryArena arena;
+        ParseResult result = parser.parse(selectSql, arena.get());
+        consume(result.success);
+        return uint64_t(1);
+    });
+}
+
+static void runTableBenchmarks(BenchmarkRunner& runner, const DataGenerator& generator) {
+    const BenchmarkConfig& config = runner.getConfig();
+    size_t rowCount = config.scaled(100000);
+
+    // Insert into an empty table inside one transaction
+    if (runner.enabled("table.insert_row")) {
+        TransactionManager transactionManager;
+        Table table(TABLE_NAME, DataGenerator::columns());
+
+        std::vector<std::vector<Value>> rows;
+        rows.reserve(rowCount);
+        for (size_t id = 0; id < rowCount; id++) {
+            rows.push_back(generator.row(id));
+        }
+
+        auto txn = transactionManager.begin();
+        std::string errorMessage;
+        runner.run("table.insert_row", "micro", rowCount, [&](size_t i) {
+            return static_cast<uint64_t>(table.insertRow(*txn, rows[i], errorMessage));
+        });
+        transactionManager.commit(*txn);
+    }
+
+    bool needTable = false;
+    for (const char* name : {"table.select_where_point", "table.select_where_range",
+                             "table.delete_where_range", "table.save_to_file",
+                             "table.load_from_file"}) {
+        needTable = needTable || runner.enabled(name);
+    }
+    if (!needTable) {
+        return;
+    }
+
+    TransactionManager transactionManager;
+    std::unique_ptr<Table> table = populatedTable(generator, transactionManager, rowCount);
+    DataGenerator keys(config.seed + 1);
+
+    // Scans: a point predicate on the key and a ~10% range on age
+    runner.run("table.select_where_point", "micro", config.scaled(100), [&](size_t) {
+        auto txn = transactionManager.begin();
+        Value id = Value::integer(static_cast<int64_t>(keys.uniform(rowCount)));
+        uint64_t found = table->selectWhere(*txn, "id", "=", id).size();
+        transactionManager.commit(*txn);
+        return found;
+    });
+
+    runner.run("table.select_where_range", "micro", config.scaled(100), [&](size_t) {
+        auto txn = transactionManager.begin();
+        uint64_t found = table->selectWhere(*txn, "age", ">", Value::integer(83)).size();
+        transactionManager.commit(*txn);
+        return found;
+    });
+
+    // Deletes are rolled back untimed so every run sees the full table
+    std::unique_ptr<Transaction> deleteTxn;
+    runner.run("table.delete_where_range", "micro", config.scaled(100), [&](size_t) {
+        deleteTxn = transactionManager.begin();
+        return static_cast<uint64_t>(table->deleteWhere(*deleteTxn, "age", ">", Value::integer(83)));
+    }, [&](size_t) {
+        transactionManager.rollback(*deleteTxn);
+    });
+
+    // Serialization of the whole table
+    std::string path = config.workDir + "/minidb_bench_table.tmp";
+    StoredSection section;
+    auto saveTable = [&]() {
+        auto snapshot = transactionManager.begin();
+        SnapshotWriter writer(path);
+        table->saveToFile(*snapshot, writer, section);
+        writer.finish();
+        transactionManager.commit(*snapshot);
+    };
+    runner.run("table.save_to_file", "micro", config.scaled(5), [&](size_t) {
+        saveTable();
+        return static_cast<uint64_t>(rowCount);
+    });
+
+    if (runner.enabled("table.load_from_file")) {
+        saveTable();
+    }
+    // Chunks decode in parallel, as when the engine opens a database
+    auto decoders = std::make_shared<ThreadPool>(std::thread::hardware_concurrency());
+    runner.run("table.load_from_file", "micro", config.scaled(5), [&](size_t) {
+        auto file = std::make_shared<DatabaseFile>();
+        file->path = path;
+        file->decoders = decoders;
+        std::unique_ptr<Table> loaded = Table::fromSchema(table->encodeSchema());
+        loaded->setStored(file, section);
+        consume(loaded->ensureLoaded());
+        return static_cast<uint64_t>(rowCount);
+    });
+    std::remove(path.c_str());
+}
+
+static void runExpressionBenchmarks(BenchmarkRunner& runner, const DataGenerator& generator) {
+    const BenchmarkConfig& config = runner.getConfig();
+    if (!runner.enabled("expression.filter_batch") && !runner.enabled("expression.project_batch")) {
+        return;
+    }
+
+    size_t rowCount = config.scaled(100000);
+    TransactionManager transactionManager;
+    std::unique_ptr<Table> table = populatedTable(generator, transactionManager, rowCount);
+
+    // Compiled from a parsed statement, as the executor does
+    Parser parser;
+    ParseResult parsed = parser.parse(
+        "SELECT score * age + 1 FROM bench_users WHERE age * 2 > 150 AND score IS NOT NULL;");
+    auto select = std::static_pointer_cast<SelectStatement>(parsed.statement);
+    std::string errorMessage;
+    auto filter = CompiledExpression::compile(*select->where, table->getColumns(), errorMessage);
+    auto projection = CompiledExpression::compile(*select->items[0].expression, table->getColumns(),
+                                                  errorMessage);
+
+    runner.run("expression.filter_batch", "micro", config.scaled(100), [&](size_t) {
+        auto txn = transactionManager.begin();
+        RowBatch selected;
+        uint64_t found = 0;
+        table->scanBatches(*txn, [&](const RowBatch& rows) {
+            filter->filter(rows, selected);
+            found += selected.size();
+        });
+        transactionManager.commit(*txn);
+        return found;
+    });
+
+    runner.run("expression.project_batch", "micro", config.scaled(100), [&](size_t) {
+        auto txn = transactionManager.begin();
+        uint64_t evaluated = 0;
+        table->scanBatches(*txn, [&](const RowBatch& rows) {
+            evaluated += projection->evaluate(rows).size();
+        });
+        transactionManager.commit(*txn);
+        return evaluated;
+    });
+}
+
+void runMicroBenchmarks(BenchmarkRunner& runner) {
+    DataGenerator generator(runner.getConfig().seed);
+
+    runParserBenchmarks(runner, generator);
+    runTableBenchmarks(runner, generator);
+    runExpressionBenchmarks(runner, generator);
+}
@@ -0,0 +1,769 @@
+#include "./compiled_expression.hpp"
+#include "../include/arena.hpp"
+#include "../sql/like_pattern.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+// Node of a compiled expression. Columns and constants are read in
+// place; other nodes fill `results` for a whole batch with `run`, after
+// their children have filled theirs.
+struct ExpressionNode {
+    enum class Source {
+        COLUMN,
+        CONSTANT,
+        RESULTS
+    };
+
+    Source source = Source::RESULTS;
+    size_t column = 0;                         // COLUMN
+    Value constant;                            // CONSTANT
+    TokenType type = TokenType::INVALID;       // Static type; INVALID when unknown, as for NULL
+    std::function<void(const RowBatch&)> run;  // RESULTS
+    std::vector<Value> results;
+    std::vector<std::unique_ptr<ExpressionNode>> children;
+    std::shared_ptr<Expression> folded;        // The expression after constant folding
+
+    // For predicates: append the rows for which the node is true, without
+    // materializing its values. Empty when the generic path is used.
+    std::function<void(const RowBatch&, RowBatch&)> select;
+    RowBatch passed;  // Rows passing the left side of AND
+};
+
+using NodePtr = std::unique_ptr<ExpressionNode>;
+using Source = ExpressionNode::Source;
+
+// Readers of an operand for row i of a batch; closures are generated
+// for each combination, so the loop over the batch has no dispatch
+struct ColumnOperand {
+    size_t column;
+    const Value& at(const RowBatch& rows, size_t i) const { return rows[i]->values[column]; }
+};
+
+struct ConstantOperand {
+    const Value* value;
+    const Value& at(const RowBatch&, size_t) const { return *value; }
+};
+
+struct ResultOperand {
+    const std::vector<Value>* results;
+    const Value& at(const RowBatch&, size_t i) const { return (*results)[i]; }
+};
+
+template <typename Visit>
+static void withOperand(const ExpressionNode& node, Visit visit) {
+    switch (node.source) {
+        case Source::COLUMN: visit(ColumnOperand{node.column}); break;
+        case Source::CONSTANT: visit(ConstantOperand{&node.constant}); break;
+        case Source::RESULTS: visit(ResultOperand{&node.results}); break;
+    }
+}
+
+// Fill the results of a node's subtree for the batch
+static void runNode(ExpressionNode& node, const RowBatch& rows) {
+    if (node.source != Source::RESULTS) {
+        return;
+    }
+    for (auto& child : node.children) {
+        runNode(*child, rows);
+    }
+    node.run(rows);
+}
+
+static NodePtr constantNode(const Value& value) {
+    auto node = std::make_unique<ExpressionNode>();
+    node->source = Source::CONSTANT;
+    node->constant = value;
+    switch (value.type()) {
+        case ValueType::INTEGER: node->type = TokenType::INTEGER; break;
+        case ValueType::REAL: node->type = TokenType::REAL; break;
+        case ValueType::TEXT: node->type = TokenType::TEXT; break;
+        case ValueType::NULL_VALUE: break;
+    }
+    return node;
+}
+
+// Node computing apply(operand) per row, or a constant if the operand is
+template <typename Apply>
+static NodePtr makeUnary(NodePtr operand, TokenType type, Apply apply) {
+    if (operand->source == Source::CONSTANT) {
+        NodePtr node = constantNode(apply(operand->constant));
+        node->type = type;
+        return node;
+    }
+
+    auto node = std::make_unique<ExpressionNode>();
+    node->type = type;
+    ExpressionNode* self = node.get();
+    withOperand(*operand, [&](auto input) {
+        self->run = [self, input, apply](const RowBatch& rows) {
+            self->results.resize(rows.size());
+            for (size_t i = 0; i < rows.size(); i++) {
+                self->results[i] = apply(input.at(rows, i));
+            }
+        };
+    });
+    node->children.push_back(std::move(operand));
+    return node;
+}
+
+// Node computing apply(left, right) per row, or a constant if both are
+template <typename Apply>
+static NodePtr makeBinary(NodePtr left, NodePtr right, TokenType type, Apply apply) {
+    if (left->source == Source::CONSTANT && right->source == Source::CONSTANT) {
+        NodePtr node = constantNode(apply(left->constant, right->constant));
+        node->type = type;
+        return node;
+    }
+
+    auto node = std::make_unique<ExpressionNode>();
+    node->type = type;
+    ExpressionNode* self = node.get();
+    withOperand(*left, [&](auto a) {
+        withOperand(*right, [&](auto b) {
+            self->run = [self, a, b, apply](const RowBatch& rows) {
+                self->results.resize(rows.size());
+                for (size_t i = 0; i < rows.size(); i++) {
+                    self->results[i] = apply(a.at(rows, i), b.at(rows, i));
+                }
+            };
+        });
+    });
+    node->children.push_back(std::move(left));
+    node->children.push_back(std::move(right));
+    return node;
+}
+
+// -1 for NULL, else 0 or 1; text is false
+static int truth(const Value& value) {
+    switch (value.type()) {
+        case ValueType::NULL_VALUE: return -1;
+        case ValueType::INTEGER: return value.asInteger() != 0;
+        case ValueType::REAL: return value.asReal() != 0.0;
+        case ValueType::TEXT: return 0;
+    }
+    return 0;
+}
+
+static Value boolean(bool value) {
+    return Value::integer(value ? 1 : 0);
+}
+
+// Append the rows of the batch for which the node is true
+static void selectRows(ExpressionNode& node, const RowBatch& rows, RowBatch& selected) {
+    if (node.select) {
+        node.select(rows, selected);
+        return;
+    }
+    switch (node.source) {
+        case Source::COLUMN:
+            for (const Row* row : rows) {
+                if (truth(row->values[node.column]) == 1) {
+                    selected.push_back(row);
+                }
+            }
+            break;
+        case Source::CONSTANT:
+            if (truth(node.constant) == 1) {
+                selected.insert(selected.end(), rows.begin(), rows.end());
+            }
+            break;
+        case Source::RESULTS:
+            runNode(node, rows);
+            for (size_t i = 0; i < rows.size(); i++) {
+                if (truth(node.results[i]) == 1) {
+                    selected.push_back(rows[i]);
+                }
+            }
+            break;
+    }
+}
+
+// Arithmetic on any values. Text gives NULL rather than an error, as it
+// is only found at run time here.
+template <char OP>
+struct Arithmetic {
+    Value operator()(const Value& a, const Value& b) const {
+        Value out;
+        if (!Value::arithmetic(a, OP, b, out)) {
+            return Value();
+        }
+        return out;
+    }
+};
+
+// + - * on operands typed INTEGER: stays in int64 unless it overflows
+template <char OP>
+struct IntegerArithmetic {
+    Value operator()(const Value& a, const Value& b) const {
+        if (a.type() == ValueType::INTEGER && b.type() == ValueType::INTEGER) {
+            int64_t x = a.asInteger();
+            int64_t y = b.asInteger();
+            int64_t result;
+            bool exact = OP == '+' ? checkedAdd(x, y, result)
+                       : OP == '-' ? checkedSubtract(x, y, result)
+                                   : checkedMultiply(x, y, result);
+            if (exact) {
+                return Value::integer(result);
+            }
+        }
+        return Arithmetic<OP>()(a, b);
+    }
+};
+
+// + - * with a REAL operand
+template <char OP>
+struct RealArithmetic {
+    Value operator()(const Value& a, const Value& b) const {
+        if (a.isNumeric() && b.isNumeric() &&
+            (a.type() == ValueType::REAL || b.type() == ValueType::REAL)) {
+            double x = a.asReal();
+            double y = b.asReal();
+            return Value::real(OP == '+' ? x + y : OP == '-' ? x - y : x * y);
+        }
+        return Arithmetic<OP>()(a, b);
+    }
+};
+
+// 1 or 0, or NULL if either side is NULL
+template <ExprOp OP>
+struct Comparison {
+    Value operator()(const Value& a, const Value& b) const {
+        if (a.isNull() || b.isNull()) {
+            return Value();
+        }
+        return boolean(holds(a, b));
+    }
+
+    // Whether the comparison is true; false for NULL
+    static bool holds(const Value& a, const Value& b) {
+        int order;
+        if (a.type() == ValueType::INTEGER && b.type() == ValueType::INTEGER) {
+            int64_t x = a.asInteger();
+            int64_t y = b.asInteger();
+            order = x < y ? -1 : (x > y ? 1 : 0);
+        } else if (a.isNull() || b.isNull()) {
+            return false;
+        } else {
+            order = Value::compare(a, b);
+        }
+
+        switch (OP) {
+            case ExprOp::EQUAL: return order == 0;
+            case ExprOp::NOT_EQUAL: return order != 0;
+            case ExprOp::LESS: return order < 0;
+            case ExprOp::LESS_EQUAL: return order <= 0;
+            case ExprOp::GREATER: return order > 0;
+            default: return order >= 0;
+        }
+    }
+};
+
+// Whether a value matches a LIKE pattern; numbers match in display form
+static bool likeMatches(const LikePattern& pattern, const Value& value) {
+    if (value.type() == ValueType::TEXT) {
+        return pattern.matches(value.asText());
+    }
+    return pattern.matches(value.toString());
+}
+
+// x LIKE pattern and x ILIKE pattern: 1 or 0, or NULL if either is NULL.
+// A constant pattern is compiled once, others once per row.
+template <bool IGNORE_CASE>
+struct Like {
+    std::shared_ptr<LikePattern> pattern;  // Set when the pattern is constant
+
+    Value operator()(const Value& a, const Value& b) const {
+        if (a.isNull() || b.isNull()) {
+            return Value();
+        }
+        return boolean(holds(a, b));
+    }
+
+    bool holds(const Value& a, const Value& b) const {
+        if (a.isNull() || b.isNull()) {
+            return false;
+        }
+        if (pattern) {
+            return likeMatches(*pattern, a);
+        }
+        if (b.type() == ValueType::TEXT) {
+            return likeMatches(LikePattern(b.asText(), IGNORE_CASE), a);
+        }
+        return likeMatches(LikePattern(b.toString(), IGNORE_CASE), a);
+    }
+};
+
+// Three-valued logic: FALSE AND NULL is FALSE, TRUE OR NULL is TRUE
+struct And {
+    Value operator()(const Value& a, const Value& b) const {
+        int x = truth(a);
+        int y = truth(b);
+        if (x == 0 || y == 0) {
+            return boolean(false);
+        }
+        return x < 0 || y < 0 ? Value() : boolean(true);
+    }
+};
+
+struct Or {
+    Value operator()(const Value& a, const Value& b) const {
+        int x = truth(a);
+        int y = truth(b);
+        if (x == 1 || y == 1) {
+            return boolean(true);
+        }
+        return x < 0 || y < 0 ? Value() : boolean(false);
+    }
+};
+
+struct Not {
+    Value operator()(const Value& a) const {
+        int x = truth(a);
+        return x < 0 ? Value() : boolean(x == 0);
+    }
+};
+
+template <bool NULL_WANTED>
+struct IsNull {
+    Value operator()(const Value& a) const {
+        return boolean(a.isNull() == NULL_WANTED);
+    }
+};
+
+struct Negate {
+    Value operator()(const Value& a) const {
+        int64_t result;
+        if (a.type() == ValueType::INTEGER && checkedSubtract(0, a.asInteger(), result)) {
+            return Value::integer(result);
+        }
+        return a.isNumeric() ? Value::real(-a.asReal()) : Value();
+    }
+};
+
+// CAST(x AS type). INTEGER truncates reals and numeric text; values that
+// do not convert become NULL.
+struct Cast {
+    TokenType target;
+
+    Value operator()(const Value& a) const {
+        Value out;
+        if (target != TokenType::INTEGER) {
+            return a.castTo(target, out) ? out : Value();
+        }
+
+        Value number = a.type() == ValueType::TEXT ? Value::parse(a.asText(), TokenType::INTEGER) : a;
+        if (number.type() == ValueType::INTEGER) {
+            return number;
+        }
+        if (number.type() == ValueType::REAL) {
+            double truncated = std::trunc(number.asReal());
+            if (truncated >= -9223372036854775808.0 && truncated < 9223372036854775808.0) {
+                return Value::integer(static_cast<int64_t>(truncated));
+            }
+        }
+        return Value();
+    }
+};
+
+struct Abs {
+    Value operator()(const Value& a) const {
+        if (a.type() == ValueType::INTEGER && a.asInteger() != std::numeric_limits<int64_t>::min()) {
+            return Value::integer(a.asInteger() < 0 ? -a.asInteger() : a.asInteger());
+        }
+        return a.isNumeric() ? Value::real(std::fabs(a.asReal())) : Value();
+    }
+};
+
+// Length in bytes of text, or of a number's display form
+struct Length {
+    Value operator()(const Value& a) const {
+        if (a.isNull()) {
+            return Value();
+        }
+        size_t length = a.type() == ValueType::TEXT ? a.asText().size() : a.toString().size();
+        return Value::integer(static_cast<int64_t>(length));
+    }
+};
+
+template <bool UPPER>
+struct ChangeCase {
+    Value operator()(const Value& a) const {
+        if (a.isNull()) {
+            return Value();
+        }
+        std::string text = a.type() == ValueType::TEXT ? std::string(a.asText()) : a.toString();
+        for (char& c : text) {
+            c = static_cast<char>(UPPER ? std::toupper(static_cast<unsigned char>(c))
+                                        : std::tolower(static_cast<unsigned char>(c)));
+        }
+        return Value::text(text);
+    }
+};
+
+// ROUND(x, digits) as a REAL; digits may be negative
+struct Round {
+    Value operator()(const Value& a, const Value& digits) const {
+        if (!a.isNumeric() || !digits.isNumeric()) {
+            return Value();
+        }
+        double places = std::max(-15.0, std::min(15.0, std::trunc(digits.asReal())));
+        double scale = std::pow(10.0, places);
+        double scaled = a.asReal() * scale;
+        if (!std::isfinite(scaled)) {
+            return Value::real(a.asReal());
+        }
+        return Value::real(std::round(scaled) / scale);
+    }
+
+    Value operator()(const Value& a) const {
+        return a.isNumeric() ? Value::real(std::round(a.asReal())) : Value();
+    }
+};
+
+struct Coalesce {
+    Value operator()(const Value& a, const Value& b) const {
+        return a.isNull() ? b : a;
+    }
+};
+
+template <char OP>
+static NodePtr arithmeticNode(NodePtr left, NodePtr right, std::string& errorMessage) {
+    if (left->type == TokenType::TEXT || right->type == TokenType::TEXT) {
+        errorMessage = std::string("Cannot apply '") + OP + "' to text";
+        return nullptr;
+    }
+
+    bool known = left->type != TokenType::INVALID && right->type != TokenType::INVALID;
+    bool integers = left->type == TokenType::INTEGER && right->type == TokenType::INTEGER;
+    TokenType type = !known ? TokenType::INVALID : (integers ? TokenType::INTEGER : TokenType::REAL);
+
+    if constexpr (OP == '/' || OP == '%') {
+        return makeBinary(std::move(left), std::move(right), type, Arithmetic<OP>());
+    } else {
+        if (!known) {
+            return makeBinary(std::move(left), std::move(right), type, Arithmetic<OP>());
+        }
+        if (integers) {
+            return makeBinary(std::move(left), std::move(right), type, IntegerArithmetic<OP>());
+        }
+        return makeBinary(std::move(left), std::move(right), type, RealArithmetic<OP>());
+    }
+}
+
+// A constant compared with a column is converted to the column's type
+// once, as for the WHERE literals before (age > '30' compares numbers)
+static void bindConstant(const ExpressionNode& column, ExpressionNode& constant) {
+    if (column.source != Source::COLUMN || constant.source != Source::CONSTANT) {
+        return;
+    }
+    Value bound;
+    if (constant.constant.castTo(column.type, bound)) {
+        constant.constant = bound;
+    }
+}
+
+template <ExprOp OP>
+static NodePtr comparisonNode(NodePtr left, NodePtr right) {
+    bindConstant(*left, *right);
+    bindConstant(*right, *left);
+    NodePtr node = makeBinary(std::move(left), std::move(right), TokenType::INTEGER, Comparison<OP>());
+    if (node->source == Source::CONSTANT) {
+        return node;
+    }
+
+    // As a predicate, test the operands directly
+    ExpressionNode* self = node.get();
+    withOperand(*self->children[0], [&](auto a) {
+        withOperand(*self->children[1], [&](auto b) {
+            self->select = [self, a, b](const RowBatch& rows, RowBatch& selected) {
+                for (auto& child : self->children) {
+                    runNode(*child, rows);
+                }
+                for (size_t i = 0; i < rows.size(); i++) {
+                    if (Comparison<OP>::holds(a.at(rows, i), b.at(rows, i))) {
+                        selected.push_back(rows[i]);
+                    }
+                }
+            };
+        });
+    });
+    return node;
+}
+
+template <bool IGNORE_CASE>
+static NodePtr likeNode(NodePtr left, NodePtr right) {
+    Like<IGNORE_CASE> like;
+    const Value& pattern = right->constant;
+    if (right->source == Source::CONSTANT && pattern.type() == ValueType::TEXT) {
+        like.pattern = std::make_shared<LikePattern>(pattern.asText(), IGNORE_CASE);
+    } else if (right->source == Source::CONSTANT && !pattern.isNull()) {
+        like.pattern = std::make_shared<LikePattern>(pattern.toString(), IGNORE_CASE);
+    }
+    NodePtr node = makeBinary(std::move(left), std::move(right), TokenType::INTEGER, like);
+    if (node->source == Source::CONSTANT) {
+        return node;
+    }
+
+    // As a predicate, match the operands directly
+    ExpressionNode* self = node.get();
+    withOperand(*self->children[0], [&](auto a) {
+        withOperand(*self->children[1], [&](auto b) {
+            self->select = [self, a, b, like](const RowBatch& rows, RowBatch& selected) {
+                for (auto& child : self->children) {
+                    runNode(*child, rows);
+                }
+                for (size_t i = 0; i < rows.size(); i++) {
+                    if (like.holds(a.at(rows, i), b.at(rows, i))) {
+                        selected.push_back(rows[i]);
+                    }
+                }
+            };
+        });
+    });
+    return node;
+}
+
+// As a predicate, AND only tests its right side on rows passing the left
+static NodePtr andNode(NodePtr left, NodePtr right) {
+    NodePtr node = makeBinary(std::move(left), std::move(right), TokenType::INTEGER, And());
+    if (node->source == Source::CONSTANT) {
+        return node;
+    }
+
+    ExpressionNode* self = node.get();
+    self->select = [self](const RowBatch& rows, RowBatch& selected) {
+        self->passed.clear();
+        selectRows(*self->children[0], rows, self->passed);
+        if (!self->passed.empty()) {
+            selectRows(*self->children[1], self->passed, selected);
+        }
+    };
+    return node;
+}
+
+static NodePtr binaryNode(ExprOp op, NodePtr left, NodePtr right, std::string& errorMessage) {
+    switch (op) {
+        case ExprOp::ADD: return arithmeticNode<'+'>(std::move(left), std::move(right), errorMessage);
+        case ExprOp::SUBTRACT: return arithmeticNode<'-'>(std::move(left), std::move(right), errorMessage);
+        case ExprOp::MULTIPLY: return arithmeticNode<'*'>(std::move(left), std::move(right), errorMessage);
+        case ExprOp::DIVIDE: return arithmeticNode<'/'>(std::move(left), std::move(right), errorMessage);
+        case ExprOp::MODULO: return arithmeticNode<'%'>(std::move(left), std::move(right), errorMessage);
+        case ExprOp::EQUAL: return comparisonNode<ExprOp::EQUAL>(std::move(left), std::move(right));
+        case ExprOp::NOT_EQUAL: return comparisonNode<ExprOp::NOT_EQUAL>(std::move(left), std::move(right));
+        case ExprOp::LESS: return comparisonNode<ExprOp::LESS>(std::move(left), std::move(right));
+        case ExprOp::LESS_EQUAL: return comparisonNode<ExprOp::LESS_EQUAL>(std::move(left), std::move(right));
+        case ExprOp::GREATER: return comparisonNode<ExprOp::GREATER>(std::move(left), std::move(right));
+        case ExprOp::GREATER_EQUAL:
+            return comparisonNode<ExprOp::GREATER_EQUAL>(std::move(left), std::move(right));
+        case ExprOp::LIKE: return likeNode<false>(std::move(left), std::move(right));
+        case ExprOp::ILIKE: return likeNode<true>(std::move(left), std::move(right));
+        case ExprOp::AND: return andNode(std::move(left), std::move(right));
+        case ExprOp::OR: return makeBinary(std::move(left), std::move(right), TokenType::INTEGER, Or());
+        default: break;
+    }
+    errorMessage = std::string("Unsupported operator: ") + operatorName(op);
+    return nullptr;
+}
+
+static NodePtr unaryNode(ExprOp op, NodePtr operand, std::string& errorMessage) {
+    switch (op) {
+        case ExprOp::NEGATE: {
+            if (operand->type == TokenType::TEXT) {
+                errorMessage = "Cannot apply '-' to text";
+                return nullptr;
+            }
+            TokenType type = operand->type;
+            return makeUnary(std::move(operand), type, Negate());
+        }
+        case ExprOp::NOT: return makeUnary(std::move(operand), TokenType::INTEGER, Not());
+        case ExprOp::IS_NULL: return makeUnary(std::move(operand), TokenType::INTEGER, IsNull<true>());
+        case ExprOp::IS_NOT_NULL: return makeUnary(std::move(operand), TokenType::INTEGER, IsNull<false>());
+        default: break;
+    }
+    errorMessage = std::string("Unsupported operator: ") + operatorName(op);
+    return nullptr;
+}
+
+static NodePtr functionNode(const std::string& name, std::vector<NodePtr> arguments,
+                            std::string& errorMessage) {
+    size_t count = arguments.size();
+    bool valid = name == "COALESCE" ? count >= 1 : (name == "ROUND" ? count == 1 || count == 2 : count == 1);
+    bool known = name == "ABS" || name == "LENGTH" || name == "UPPER" || name == "LOWER" ||
+                 name == "ROUND" || name == "COALESCE";
+    if (!known) {
+        errorMessage = "Unknown function: " + name;
+        return nullptr;
+    }
+    if (!valid) {
+        errorMessage = "Wrong number of arguments to " + name;
+        return nullptr;
+    }
+
+    if (name == "ABS") {
+        TokenType type = arguments[0]->type == TokenType::TEXT ? TokenType::INVALID : arguments[0]->type;
+        return makeUnary(std::move(arguments[0]), type, Abs());
+    } else if (name == "LENGTH") {
+        return makeUnary(std::move(arguments[0]), TokenType::INTEGER, Length());
+    } else if (name == "UPPER") {
+        return makeUnary(std::move(arguments[0]), TokenType::TEXT, ChangeCase<true>());
+    } else if (name == "LOWER") {
+        return makeUnary(std::move(arguments[0]), TokenType::TEXT, ChangeCase<false>());
+    } else if (name == "ROUND") {
+        if (count == 1) {
+            return makeUnary(std::move(arguments[0]), TokenType::REAL, Round());
+        }
+        return makeBinary(std::move(arguments[0]), std::move(arguments[1]), TokenType::REAL, Round());
+    }
+
+    // COALESCE(a, b, c) runs as COALESCE(COALESCE(a, b), c)
+    NodePtr result = std::move(arguments[0]);
+    for (size_t i = 1; i < count; i++) {
+        TokenType type = result->type == arguments[i]->type ? result->type : TokenType::INVALID;
+        result = makeBinary(std::move(result), std::move(arguments[i]), type, Coalesce());
+    }
+    return result;
+}
+
+static NodePtr compileNode(const Expression& expression, const std::vector<ColumnDefinition>& columns,
+                           std::string& errorMessage) {
+    if (expression.kind == Expression::Kind::LITERAL) {
+        NodePtr node = constantNode(expression.value);
+        node->folded = Expression::literal(expression.value);
+        return node;
+    }
+
+    if (expression.kind == Expression::Kind::COLUMN) {
+        for (size_t i = 0; i < columns.size(); i++) {
+            if (columns[i].name == expression.name) {
+                auto node = std::make_unique<ExpressionNode>();
+                node->source = Source::COLUMN;
+                node->column = i;
+                node->type = columns[i].dataType;
+                node->folded = Expression::column(expression.name);
+                return node;
+            }
+        }
+        errorMessage = "Column not found: " + expression.name;
+        return nullptr;
+    }
+
+    std::vector<NodePtr> operands;
+    for (const auto& operand : expression.operands) {
+        NodePtr node = compileNode(*operand, columns, errorMessage);
+        if (!node) {
+            return nullptr;
+        }
+        operands.push_back(std::move(node));
+    }
+
+    // Folding may drop operand nodes, so keep their text first
+    std::vector<std::shared_ptr<Expression>> foldedOperands;
+    for (const auto& operand : operands) {
+        foldedOperands.push_back(operand->folded);
+    }
+
+    NodePtr node;
+    switch (expression.kind) {
+        case Expression::Kind::UNARY:
+            node = unaryNode(expression.op, std::move(operands[0]), errorMessage);
+            break;
+        case Expression::Kind::BINARY:
+            node = binaryNode(expression.op, std::move(operands[0]), std::move(operands[1]), errorMessage);
+            break;
+        case Expression::Kind::CAST:
+            node = makeUnary(std::move(operands[0]), expression.castType, Cast{expression.castType});
+            break;
+        case Expression::Kind::FUNCTION:
+            node = functionNode(expression.name, std::move(operands), errorMessage);
+            break;
+        default:
+            break;
+    }
+    if (!node) {
+        return nullptr;
+    }
+
+    if (node->source == Source::CONSTANT) {
+        node->folded = Expression::literal(node->constant);
+    } else {
+        node->folded = makePooled<Expression>(expression);
+        node->folded->operands = std::move(foldedOperands);
+    }
+    return node;
+}
+
+std::unique_ptr<CompiledExpression> CompiledExpression::compile(const Expression& expression,
+                                                                const std::vector<ColumnDefinition>& columns,
+                                                                std::string& errorMessage) {
+    NodePtr root = compileNode(expression, columns, errorMessage);
+    if (!root) {
+        return nullptr;
+    }
+
+    std::unique_ptr<CompiledExpression> compiled(new CompiledExpression());
+    compiled->root = std::move(root);
+    compiled->single.resize(1);
+    return compiled;
+}
+
+CompiledExpression::~CompiledExpression() = default;
+
+const std::vector<Value>& CompiledExpression::evaluate(const RowBatch& rows) {
+    ExpressionNode& node = *root;
+    switch (node.source) {
+        case Source::RESULTS:
+            runNode(node, rows);
+            break;
+        case Source::COLUMN:
+            node.results.resize(rows.size());
+            for (size_t i = 0; i < rows.size(); i++) {
+                node.results[i] = rows[i]->values[node.column];
+            }
+            break;
+        case Source::CONSTANT:
+            node.results.assign(rows.size(), node.constant);
+            break;
+    }
+    return node.results;
+}
+
+void CompiledExpression::filter(const RowBatch& rows, RowBatch& selected) {
+    selected.clear();
+    selectRows(*root, rows, selected);
+}
+
+Value CompiledExpression::evaluate(const Row& row) {
+    switch (root->source) {
+        case Source::COLUMN:
+            return row.values[root->column];
+        case Source::CONSTANT:
+            return root->constant;
+        case Source::RESULTS:
+            break;
+    }
+    single[0] = &row;
+    runNode(*root, single);
+    return std::move(root->results[0]);
+}
+
+bool CompiledExpression::matches(const Row& row) {
+    single[0] = &row;
+    selected.clear();
+    selectRows(*root, single, selected);
+    return !selected.empty();
+}
+
+int CompiledExpression::columnIndex() const {
+    return root->source == Source::COLUMN ? static_cast<int>(root->column) : -1;
+}
+
+bool CompiledExpression::isConstant() const {
+    return root->source == Source::CONSTANT;
+}
+
+std::string CompiledExpression::toString() const {
+    return root->folded->toString();
+}
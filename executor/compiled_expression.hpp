@@ -0,0 +1,57 @@
+#ifndef COMPILED_EXPRESSION_HPP
+#define COMPILED_EXPRESSION_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "../sql/expression.hpp"
+#include "../storage/table.hpp"
+
+struct ExpressionNode;
+
+/**
+ * An expression bound to the columns of a table and compiled once per
+ * statement into a tree of closures. Each closure is generated from a
+ * template for its operator, the static types of its operands and where
+ * they come from (a column, a constant or another closure), and loops
+ * over a whole batch of rows. Subtrees without columns are folded into
+ * constants. Evaluation reuses per-node buffers, so an instance must
+ * only be used by one thread at a time.
+ */
+class CompiledExpression {
+public:
+    // Fails, with errorMessage set, if a column or function is unknown or
+    // an operator cannot apply to the static type of its operands
+    static std::unique_ptr<CompiledExpression> compile(const Expression& expression,
+                                                       const std::vector<ColumnDefinition>& columns,
+                                                       std::string& errorMessage);
+    ~CompiledExpression();
+
+    // The value for each row of the batch, valid until the next call
+    const std::vector<Value>& evaluate(const RowBatch& rows);
+
+    // The rows of the batch for which the expression is true; NULL, zero
+    // and text are false
+    void filter(const RowBatch& rows, RowBatch& selected);
+
+    // Same, for a single row
+    Value evaluate(const Row& row);
+    bool matches(const Row& row);
+
+    // Index of the column if the expression is a plain column, else -1
+    int columnIndex() const;
+
+    bool isConstant() const;
+
+    // SQL text after constant folding
+    std::string toString() const;
+
+private:
+    CompiledExpression() = default;
+
+    std::unique_ptr<ExpressionNode> root;
+    RowBatch single;    // Batch for the one-row calls
+    RowBatch selected;  // Result of matches
+};
+
+#endif // COMPILED_EXPRESSION_HPP
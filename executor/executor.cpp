@@ -1,104 +1,903 @@
 #include "./executor.hpp"
-#include <iostream>
+#include "../sql/like_pattern.hpp"
+#include "./view_maintenance.hpp"
+#include "./row_buffer.hpp"
+#include "../include/thread_pool.hpp"
+#include <algorithm>
+
+// Compile the WHERE clause of a statement, if any
+static bool compileFilter(const std::shared_ptr<Expression>& where, const Table& table,
+                          std::unique_ptr<CompiledExpression>& filter, std::string& errorMessage) {
+    if (where == nullptr) {
+        return true;
+    }
+    filter = CompiledExpression::compile(*where, table.getColumns(), errorMessage);
+    return filter != nullptr;
+}
+
+// "filter: expression" of a WHERE clause, after constant folding
+static std::string describeFilter(const std::unique_ptr<CompiledExpression>& filter) {
+    return filter ? " filter: " + filter->toString() : "";
+}
+
+// Changes to the materialized views over a table, one per view
+static bool bindViews(Catalog& catalog, const Table& table, std::vector<ViewDelta>& views,
+                      std::string& errorMessage) {
+    for (auto& view : catalog.viewsOn(table.getName())) {
+        views.emplace_back();
+        if (!views.back().bind(view, table, errorMessage)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool applyViews(std::vector<ViewDelta>& views, Transaction& txn, std::string& errorMessage) {
+    for (auto& view : views) {
+        if (!view.apply(txn, errorMessage)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether the statement running in the transaction was cancelled or timed
+// out; its scans then ended early
+static bool wasInterrupted(const Transaction& txn) {
+    return txn.control != nullptr && txn.control->wasStopped();
+}
+
+static ExecutionResult interruptedResult(const Transaction& txn) {
+    return {false, txn.control->errorMessage(), {}, {}};
+}
+
+// A conjunct of a WHERE clause that a trigram index can narrow: a column
+// LIKE or ILIKE a text literal
+struct IndexedSearch {
+    size_t column = 0;
+    std::string index;
+    std::vector<std::string> strings;  // Literal parts of the pattern
+};
+
+static bool findIndexedSearch(const Expression& where, const Table& table, IndexedSearch& search) {
+    if (where.kind != Expression::Kind::BINARY) {
+        return false;
+    }
+    if (where.op == ExprOp::AND) {
+        return findIndexedSearch(*where.operands[0], table, search) ||
+               findIndexedSearch(*where.operands[1], table, search);
+    }
+    
+    const Expression& column = *where.operands[0];
+    const Expression& pattern = *where.operands[1];
+    if ((where.op != ExprOp::LIKE && where.op != ExprOp::ILIKE) ||
+        column.kind != Expression::Kind::COLUMN || pattern.kind != Expression::Kind::LITERAL ||
+        pattern.value.type() != ValueType::TEXT) {
+        return false;
+    }
+    
+    const auto& columns = table.getColumns();
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].name != column.name) {
+            continue;
+        }
+        search.column = i;
+        search.index = table.indexOn(i);
+        search.strings = LikePattern(pattern.value.asText(), where.op == ExprOp::ILIKE).literals();
+        
+        // Literal parts shorter than a trigram cannot narrow the scan
+        bool usable = std::any_of(search.strings.begin(), search.strings.end(),
+                                  [](const std::string& text) { return text.size() >= 3; });
+        return !search.index.empty() && usable;
+    }
+    return false;
+}
+
+// A conjunct of a WHERE clause that Bloom filters can narrow: a column
+// equal to a literal, either way round
+struct EqualitySearch {
+    size_t column = 0;
+    std::string index;
+    Value value;
+};
+
+static bool findEqualitySearch(const Expression& where, const Table& table, EqualitySearch& search) {
+    if (where.kind != Expression::Kind::BINARY) {
+        return false;
+    }
+    if (where.op == ExprOp::AND) {
+        return findEqualitySearch(*where.operands[0], table, search) ||
+               findEqualitySearch(*where.operands[1], table, search);
+    }
+    if (where.op != ExprOp::EQUAL) {
+        return false;
+    }
+    
+    const Expression* column = where.operands[0].get();
+    const Expression* value = where.operands[1].get();
+    if (column->kind == Expression::Kind::LITERAL) {
+        std::swap(column, value);
+    }
+    if (column->kind != Expression::Kind::COLUMN || value->kind != Expression::Kind::LITERAL ||
+        value->value.isNull()) {
+        return false;
+    }
+    
+    const auto& columns = table.getColumns();
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].name != column->name) {
+            continue;
+        }
+        search.column = i;
+        search.index = table.bloomFilterOn(i);
+        search.value = value->value;
+        return !search.index.empty();
+    }
+    return false;
+}
+
+// The comparison with its operands swapped: "5 < a" is "a > 5"
+static ExprOp mirrored(ExprOp op) {
+    switch (op) {
+        case ExprOp::LESS:
+            return ExprOp::GREATER;
+        case ExprOp::LESS_EQUAL:
+            return ExprOp::GREATER_EQUAL;
+        case ExprOp::GREATER:
+            return ExprOp::LESS;
+        case ExprOp::GREATER_EQUAL:
+            return ExprOp::LESS_EQUAL;
+        default:
+            return op;
+    }
+}
+
+// Rule out the partitions no row matching a WHERE clause can be in, by
+// its conjuncts comparing the key column with a literal
+static void prunePartitions(const Expression& where, const PartitionScheme& scheme,
+                            std::vector<bool>& candidates) {
+    if (where.kind != Expression::Kind::BINARY) {
+        return;
+    }
+    if (where.op == ExprOp::AND) {
+        prunePartitions(*where.operands[0], scheme, candidates);
+        prunePartitions(*where.operands[1], scheme, candidates);
+        return;
+    }
+    
+    const Expression* column = where.operands[0].get();
+    const Expression* value = where.operands[1].get();
+    ExprOp op = where.op;
+    if (column->kind == Expression::Kind::LITERAL) {
+        std::swap(column, value);
+        op = mirrored(op);
+    }
+    if (column->kind == Expression::Kind::COLUMN && value->kind == Expression::Kind::LITERAL &&
+        column->name == scheme.column) {
+        scheme.prune(op, value->value, candidates);
+    }
+}
+
+// The tables a statement reads: the table itself or, if it is
+// partitioned, the partitions its WHERE clause leaves. detail names them
+// for the plan, e.g. "2 of 4 (p2, p3)".
+static std::vector<std::shared_ptr<Table>> tablesToScan(const Catalog& catalog,
+                                                        const std::shared_ptr<Table>& table,
+                                                        const std::shared_ptr<Expression>& where,
+                                                        std::string& detail) {
+    auto scheme = catalog.partitioning(table->getName());
+    if (scheme == nullptr) {
+        return {table};
+    }
+    std::vector<bool> candidates(scheme->partitions.size(), true);
+    if (where != nullptr) {
+        prunePartitions(*where, *scheme, candidates);
+    }
+    
+    std::vector<std::shared_ptr<Table>> tables;
+    std::string names;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (candidates[i]) {
+            tables.push_back(scheme->partitions[i].table);
+            names += (names.empty() ? "" : ", ") + scheme->partitions[i].name;
+        }
+    }
+    detail = std::to_string(tables.size()) + " of " + std::to_string(candidates.size()) +
+             (names.empty() ? "" : " (" + names + ")");
+    return tables;
+}
+
+// The partition a row with the key goes to. A time-series table gets the
+// segment of a time no segment holds yet, and scheme becomes the one with
+// it. -1 with errorMessage set if the key has no place.
+static int routeRow(Catalog& catalog, std::shared_ptr<const PartitionScheme>& scheme,
+                    const Value& key, std::string& errorMessage) {
+    int partition = scheme->route(key);
+    if (partition < 0 && scheme->method == PartitionScheme::Method::TIMESERIES) {
+        if (!catalog.addSegment(scheme->tableName, key, errorMessage)) {
+            return -1;
+        }
+        scheme = catalog.partitioning(scheme->tableName);
+        partition = scheme->route(key);
+    }
+    if (partition < 0) {
+        errorMessage = "no partition holds key " + key.toLiteral();
+    }
+    return partition;
+}
+
+// The select list and WHERE clause of a query, bound to a table. Plain
+// columns are copied from the row; other expressions are compiled and
+// evaluated a block at a time. Compiled expressions keep their results,
+// so each thread scanning at once needs a projection of its own.
+struct Projection {
+    std::unique_ptr<CompiledExpression> filter;
+    std::pmr::vector<int> columnIndices;
+    std::vector<std::unique_ptr<CompiledExpression>> computed;
+    
+    explicit Projection(std::pmr::memory_resource* arena) : columnIndices(arena) {}
+    
+    // Compile the statement against the table's columns, naming the
+    // result columns in names if given
+    bool bind(const SelectStatement& statement, const Table& table,
+              std::vector<std::string>* names, std::string& errorMessage) {
+        const auto& columns = table.getColumns();
+        for (const auto& item : statement.items) {
+            if (item.expression == nullptr) {
+                // Select all columns
+                for (size_t i = 0; i < columns.size(); i++) {
+                    columnIndices.push_back(static_cast<int>(i));
+                    computed.push_back(nullptr);
+                    if (names) {
+                        names->push_back(columns[i].name);
+                    }
+                }
+                continue;
+            }
+            
+            auto compiled = CompiledExpression::compile(*item.expression, columns, errorMessage);
+            if (compiled == nullptr) {
+                return false;
+            }
+            columnIndices.push_back(compiled->columnIndex());
+            if (compiled->columnIndex() != -1) {
+                compiled.reset();
+            }
+            computed.push_back(std::move(compiled));
+            
+            // Name the result column after its alias, or the expression as written
+            if (names) {
+                names->push_back(!item.alias.empty() ? item.alias : item.expression->toString());
+            }
+        }
+        resultRow.resize(columnIndices.size());
+        computedValues.assign(computed.size(), nullptr);
+        return compileFilter(statement.where, table, filter, errorMessage);
+    }
+    
+    // Filter the visible rows of a block, evaluate the computed columns
+    // over the selected ones and pass each row with its result to emit;
+    // stored rows are never copied
+    template <typename Emit>
+    void run(const RowBatch& batch, Emit&& emit) {
+        const RowBatch* rows = &batch;
+        if (filter) {
+            filter->filter(batch, selected);
+            rows = &selected;
+        }
+        if (rows->empty()) {
+            return;
+        }
+        
+        for (size_t i = 0; i < computed.size(); i++) {
+            if (computed[i]) {
+                computedValues[i] = &computed[i]->evaluate(*rows);
+            }
+        }
+        for (size_t r = 0; r < rows->size(); r++) {
+            const Row& row = *(*rows)[r];
+            for (size_t i = 0; i < columnIndices.size(); i++) {
+                if (columnIndices[i] != -1) {
+                    resultRow[i] = row.values[columnIndices[i]];
+                } else {
+                    resultRow[i] = (*computedValues[i])[r];
+                }
+            }
+            emit(row, resultRow);
+        }
+    }
+    
+private:
+    std::vector<Value> resultRow;
+    std::vector<const std::vector<Value>*> computedValues;
+    RowBatch selected;
+};
 
 ExecutionResult Executor::execute(
     const std::shared_ptr<Statement>& statement,
-    std::vector<std::unique_ptr<Table>>& tables) {
+    Catalog& catalog,
+    Transaction& txn,
+    ResultSink& sink,
+    std::pmr::memory_resource* arena,
+    MemoryReservation* memory) {
     
     switch (statement->type) {
         case Statement::Type::CREATE_TABLE:
             return executeCreateTable(
                 std::static_pointer_cast<CreateTableStatement>(statement),
-                tables);
-            
+                catalog,
+                sink,
+                nullptr);
+        
+        case Statement::Type::CREATE_INDEX:
+            return executeCreateIndex(
+                std::static_pointer_cast<CreateIndexStatement>(statement),
+                catalog,
+                sink,
+                nullptr);
+        
+        case Statement::Type::CREATE_VIEW:
+            return executeCreateView(
+                std::static_pointer_cast<CreateViewStatement>(statement),
+                catalog,
+                txn,
+                sink,
+                memory);
+        
+        case Statement::Type::ALTER_TABLE:
+            return executeAlterTable(
+                std::static_pointer_cast<AlterTableStatement>(statement),
+                catalog,
+                sink);
+        
         case Statement::Type::INSERT:
             return executeInsert(
                 std::static_pointer_cast<InsertStatement>(statement),
-                tables);
-            
+                catalog,
+                txn,
+                sink,
+                nullptr);
+        
         case Statement::Type::SELECT:
             return executeSelect(
                 std::static_pointer_cast<SelectStatement>(statement),
-                tables);
-            
+                catalog,
+                txn,
+                sink,
+                nullptr,
+                arena,
+                memory);
+        
         case Statement::Type::DELETE:
             return executeDelete(
                 std::static_pointer_cast<DeleteStatement>(statement),
-                tables);
-            
+                catalog,
+                txn,
+                sink,
+                nullptr);
+        
+        case Statement::Type::UPDATE:
+            return executeUpdate(
+                std::static_pointer_cast<UpdateStatement>(statement),
+                catalog,
+                txn,
+                sink,
+                nullptr);
+        
+        case Statement::Type::EXPLAIN:
+            return executeExplain(
+                std::static_pointer_cast<ExplainStatement>(statement),
+                catalog,
+                txn,
+                sink,
+                arena,
+                memory);
+        
         default:
             return {false, "Unsupported statement type", {}, {}};
     }
 }
 
+ExecutionResult Executor::executeExplain(
+    const std::shared_ptr<ExplainStatement>& statement,
+    Catalog& catalog,
+    Transaction& txn,
+    ResultSink& sink,
+    std::pmr::memory_resource* arena,
+    MemoryReservation* memory) {
+    
+    QueryProfile profile;
+    profile.analyze = statement->analyze;
+    profile.parseNs = statement->parseNs;
+    
+    // EXPLAIN ANALYZE runs the statement, changes included, but drops
+    // its output
+    DiscardSink discard;
+    Stopwatch timer;
+    ExecutionResult result;
+    
+    const auto& target = statement->statement;
+    switch (target->type) {
+        case Statement::Type::CREATE_TABLE:
+            result = executeCreateTable(
+                std::static_pointer_cast<CreateTableStatement>(target),
+                catalog, discard, &profile);
+            break;
+        case Statement::Type::CREATE_INDEX:
+            result = executeCreateIndex(
+                std::static_pointer_cast<CreateIndexStatement>(target),
+                catalog, discard, &profile);
+            break;
+        case Statement::Type::INSERT:
+            result = executeInsert(
+                std::static_pointer_cast<InsertStatement>(target),
+                catalog, txn, discard, &profile);
+            break;
+        case Statement::Type::SELECT:
+            result = executeSelect(
+                std::static_pointer_cast<SelectStatement>(target),
+                catalog, txn, discard, &profile, arena, memory);
+            break;
+        case Statement::Type::DELETE:
+            result = executeDelete(
+                std::static_pointer_cast<DeleteStatement>(target),
+                catalog, txn, discard, &profile);
+            break;
+        case Statement::Type::UPDATE:
+            result = executeUpdate(
+                std::static_pointer_cast<UpdateStatement>(target),
+                catalog, txn, discard, &profile);
+            break;
+        default:
+            return {false, "EXPLAIN is not supported for this statement", {}, {}};
+    }
+    if (!result.success) {
+        return result;
+    }
+    
+    uint64_t totalNs = timer.elapsedNs();
+    profile.executeNs = totalNs > profile.bindNs ? totalNs - profile.bindNs : 0;
+    
+    // The plan is a one-column result set, one line per row
+    std::vector<std::string> lines = profile.render();
+    sink.beginResult({"QUERY PLAN"});
+    for (const auto& line : lines) {
+        sink.addRow({Value::text(line)});
+    }
+    sink.endResult(lines.size());
+    
+    result = {true, "", {}, {}};
+    result.rowCount = lines.size();
+    return result;
+}
+
 ExecutionResult Executor::executeCreateTable(
     const std::shared_ptr<CreateTableStatement>& statement,
-    std::vector<std::unique_ptr<Table>>& tables) {
+    Catalog& catalog,
+    ResultSink& sink,
+    QueryProfile* profile) {
+    
+    if (profile) {
+        profile->plan = PlanNode("Create Table", statement->tableName);
+        if (!profile->analyze) {
+            return {true, "", {}, {}};
+        }
+    }
+    
+    // Create the new table; fails if the name is already taken. A
+    // partitioned table holds no rows, only the columns and indexes of
+    // the tables of its partitions.
+    Stopwatch timer;
+    auto table = std::make_shared<Table>(statement->tableName, statement->columns);
+    std::string errorMessage;
+    if (statement->partitioning.method != PartitionSpec::Method::NONE) {
+        auto scheme = PartitionScheme::create(table, statement->partitioning, errorMessage);
+        if (scheme == nullptr || !catalog.addPartitioned(table, scheme, errorMessage)) {
+            return {false, errorMessage, {}, {}};
+        }
+    } else if (!catalog.add(table, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
+    
+    if (profile) {
+        profile->plan.timeNs = timer.elapsedNs();
+    }
     
-    // Check if table already exists
-    if (findTable(statement->tableName, tables) != nullptr) {
-        return {false, "Table already exists: " + statement->tableName, {}, {}};
+    sink.message("Table created: " + statement->tableName);
+    return {true, "", {}, {}};
+}
+
+ExecutionResult Executor::executeCreateIndex(
+    const std::shared_ptr<CreateIndexStatement>& statement,
+    Catalog& catalog,
+    ResultSink& sink,
+    QueryProfile* profile) {
+    
+    IndexDefinition index;
+    index.name = statement->indexName;
+    index.column = statement->columnName;
+    index.method = statement->method;
+    index.falsePositiveRate = statement->falsePositiveRate;
+    
+    if (profile) {
+        std::string detail = index.name + " on " + statement->tableName +
+                             " using " + index.method + " (" + index.column + ")";
+        if (index.method == "bloom") {
+            detail += " with (false_positive_rate = " + Value::real(index.falsePositiveRate).toString() + ")";
+        }
+        profile->plan = PlanNode("Create Index", detail);
+        if (!profile->analyze) {
+            return {true, "", {}, {}};
+        }
     }
     
-    // Create the new table
-    tables.push_back(std::make_unique<Table>(statement->tableName, statement->columns));
+    // Index the rows already there; fails if the name is taken
+    Stopwatch timer;
+    std::string errorMessage;
+    if (!catalog.addIndex(statement->tableName, index, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
     
-    std::cout << "Table created: " << statement->tableName << std::endl;
+    if (profile) {
+        profile->plan.timeNs = timer.elapsedNs();
+    }
+    
+    sink.message("Index created: " + statement->indexName);
+    return {true, "", {}, {}};
+}
+
+ExecutionResult Executor::executeCreateView(
+    const std::shared_ptr<CreateViewStatement>& statement,
+    Catalog& catalog,
+    Transaction& txn,
+    ResultSink& sink,
+    MemoryReservation* memory) {
+    
+    std::shared_ptr<Table> base = catalog.find(statement->tableName);
+    if (base == nullptr) {
+        return {false, "Table not found: " + statement->tableName, {}, {}};
+    }
+    if (catalog.isView(statement->tableName)) {
+        return {false, "Cannot create a materialized view over materialized view: " +
+                       statement->tableName, {}, {}};
+    }
+    
+    // Check the definition before anything is created
+    std::vector<ColumnDefinition> columns;
+    std::string errorMessage;
+    if (!ViewDelta::viewColumns(*statement, *base, columns, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
+    auto view = std::make_shared<MaterializedView>();
+    view->definition = statement;
+    view->table = std::make_shared<Table>(statement->viewName, columns);
+    ViewDelta groups;
+    if (!groups.bind(view, *base, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
+    std::string partitionDetail;
+    std::vector<std::shared_ptr<Table>> sources = tablesToScan(catalog, base, nullptr, partitionDetail);
+    for (const auto& source : sources) {
+        if (!source->ensureLoaded()) {
+            return {false, "Failed to load table: " + statement->tableName, {}, {}};
+        }
+    }
+    
+    // The one full scan; from here on the groups follow the writes. The
+    // groups are built in memory, so the view fails here if they do not
+    // fit in the query's reservation.
+    uint64_t granted = 0;
+    for (const auto& source : sources) {
+        source->scan(txn, [&groups, &granted, memory](const Row& row) {
+            if (memory != nullptr && memory->exhausted()) {
+                return;
+            }
+            groups.add(row, 1);
+            if (memory != nullptr && groups.bytes() > granted) {
+                uint64_t more = std::max(MemoryReservation::CHUNK_BYTES, groups.bytes() - granted);
+                if (memory->grow(more)) {
+                    granted += more;
+                }
+            }
+        });
+    }
+    if (memory != nullptr && memory->exhausted()) {
+        return {false, memory->errorMessage(), {}, {}};
+    }
+    if (wasInterrupted(txn)) {
+        return interruptedResult(txn);
+    }
+    
+    // Fill in the groups before the view is listed, so a failure leaves
+    // nothing behind. The rows are then in a table no one else can see
+    // and that goes away here, so their undo entries go with it.
+    size_t savepoint = txn.undoLog.size();
+    if (!groups.apply(txn, errorMessage) || !catalog.createView(view, errorMessage)) {
+        txn.undoLog.resize(savepoint);
+        return {false, errorMessage, {}, {}};
+    }
+    
+    sink.message("Materialized view created: " + statement->viewName);
+    return {true, "", {}, {}};
+}
+
+ExecutionResult Executor::executeAlterTable(
+    const std::shared_ptr<AlterTableStatement>& statement,
+    Catalog& catalog,
+    ResultSink& sink) {
+    
+    // Dropping a partition only unlists its table, whatever it holds
+    std::string errorMessage;
+    const std::string& name = statement->partition.name;
+    if (statement->action == AlterTableStatement::Action::ADD_PARTITION) {
+        if (!catalog.addPartition(statement->tableName, statement->partition, errorMessage)) {
+            return {false, errorMessage, {}, {}};
+        }
+        sink.message("Partition added: " + name);
+    } else {
+        // The views would keep counting the rows dropped with it
+        if (!catalog.viewsOn(statement->tableName).empty()) {
+            return {false, "Cannot drop a partition of a table with materialized views: " +
+                           statement->tableName, {}, {}};
+        }
+        if (!catalog.dropPartition(statement->tableName, name, errorMessage)) {
+            return {false, errorMessage, {}, {}};
+        }
+        sink.message("Partition dropped: " + name);
+    }
     return {true, "", {}, {}};
 }
 
 ExecutionResult Executor::executeInsert(
     const std::shared_ptr<InsertStatement>& statement,
-    std::vector<std::unique_ptr<Table>>& tables) {
+    Catalog& catalog,
+    Transaction& txn,
+    ResultSink& sink,
+    QueryProfile* profile) {
     
     // Find the table
-    Table* table = findTable(statement->tableName, tables);
+    Stopwatch bindTimer;
+    std::shared_ptr<Table> table = catalog.find(statement->tableName);
     if (table == nullptr) {
         return {false, "Table not found: " + statement->tableName, {}, {}};
     }
+    if (catalog.isView(statement->tableName)) {
+        return {false, "Cannot modify materialized view: " + statement->tableName, {}, {}};
+    }
+    
+    if (profile) {
+        profile->bindNs = bindTimer.elapsedNs();
+        profile->plan = PlanNode("Insert", "into " + statement->tableName);
+        profile->plan.children.emplace_back(
+            "Values", "(" + std::to_string(statement->values.size()) + " rows)");
+        if (!profile->analyze) {
+            return {true, "", {}, {}};
+        }
+    }
+    
+    // Rows of a partitioned table go to the partition of their key
+    std::shared_ptr<const PartitionScheme> scheme = catalog.partitioning(statement->tableName);
+    int keyPosition = -1;
+    if (scheme != nullptr) {
+        if (statement->columnNames.empty()) {
+            keyPosition = static_cast<int>(scheme->columnIndex);
+        } else {
+            auto found = std::find(statement->columnNames.begin(), statement->columnNames.end(),
+                                   scheme->column);
+            if (found != statement->columnNames.end()) {
+                keyPosition = static_cast<int>(found - statement->columnNames.begin());
+            }
+        }
+    } else if (!table->ensureLoaded()) {
+        return {false, "Failed to load table: " + statement->tableName, {}, {}};
+    }
+    
+    // Materialized views over the table count the new rows in
+    std::vector<ViewDelta> views;
+    std::string viewError;
+    if (!bindViews(catalog, *table, views, viewError)) {
+        return {false, viewError, {}, {}};
+    }
     
     // Insert each row
+    Stopwatch insertTimer;
+    size_t inserted = 0;
     for (const auto& values : statement->values) {
         bool success;
+        std::string errorMessage;
+        
+        if (inserted++ % BLOCK_SIZE == 0 && txn.interrupted()) {
+            return interruptedResult(txn);
+        }
+        
+        Table* target = table.get();
+        if (scheme != nullptr) {
+            // A missing key is NULL; one that does not fit the column
+            // fails in insertRow wherever it is routed
+            Value key;
+            if (keyPosition >= 0 && static_cast<size_t>(keyPosition) < values.size() &&
+                !values[keyPosition].castTo(scheme->columnType, key)) {
+                key = values[keyPosition];
+            }
+            int partition = routeRow(catalog, scheme, key, errorMessage);
+            if (partition < 0) {
+                return {false, "Failed to insert row into table " + statement->tableName +
+                               ": " + errorMessage, {}, {}};
+            }
+            target = scheme->partitions[partition].table.get();
+            if (!target->ensureLoaded()) {
+                return {false, "Failed to load table: " + statement->tableName, {}, {}};
+            }
+        }
         
         if (statement->columnNames.empty()) {
             // No column names specified, use direct insertion
-            success = table->insertRow(values);
+            success = target->insertRow(txn, values, errorMessage);
         } else {
             // Column names specified
-            success = table->insertRow(statement->columnNames, values);
+            success = target->insertRow(txn, statement->columnNames, values, errorMessage);
         }
         
         if (!success) {
-            return {false, "Failed to insert row into table: " + statement->tableName, {}, {}};
+            return {false, "Failed to insert row into table " + statement->tableName +
+                           ": " + errorMessage, {}, {}};
+        }
+        
+        if (!views.empty()) {
+            // The row as stored, after conversion to the column types
+            Row row;
+            row.values = target->versionValues(txn.undoLog.back().rowIndex);
+            for (auto& view : views) {
+                view.add(row, 1);
+            }
         }
     }
+    if (!applyViews(views, txn, viewError)) {
+        return {false, viewError, {}, {}};
+    }
     
-    std::cout << statement->values.size() << " row(s) inserted into " << statement->tableName << std::endl;
-    return {true, "", {}, {}};
+    if (profile) {
+        // The literals were materialized by the parser; Values only hands
+        // them on
+        PlanNode& values = profile->plan.children[0];
+        values.rowsIn = values.rowsOut = statement->values.size();
+        for (const auto& row : statement->values) {
+            values.bytes += estimateRowBytes(row);
+        }
+        
+        PlanNode& insert = profile->plan;
+        insert.timeNs = insertTimer.elapsedNs();
+        insert.rowsIn = insert.rowsOut = statement->values.size();
+        insert.bytes = values.bytes + statement->values.size() * sizeof(Row);
+    }
+    
+    sink.message(std::to_string(statement->values.size()) + " row(s) inserted into " + statement->tableName);
+    ExecutionResult result = {true, "", {}, {}};
+    result.rowCount = statement->values.size();
+    return result;
 }
 
-ExecutionResult Executor::executeSelect(
-    const std::shared_ptr<SelectStatement>& statement,
-    std::vector<std::unique_ptr<Table>>& tables) {
+ExecutionResult Executor::append(
+    const std::string& tableName,
+    std::vector<std::vector<Value>>& rows,
+    Catalog& catalog,
+    Transaction& txn) {
     
-    // Find the table
-    Table* table = findTable(statement->tableName, tables);
+    std::shared_ptr<Table> table = catalog.find(tableName);
     if (table == nullptr) {
-        return {false, "Table not found: " + statement->tableName, {}, {}};
+        return {false, "Table not found: " + tableName, {}, {}};
+    }
+    if (catalog.isView(tableName)) {
+        return {false, "Cannot modify materialized view: " + tableName, {}, {}};
     }
     
-    std::vector<Row> rows;
+    std::vector<ViewDelta> views;
+    std::string errorMessage;
+    if (!bindViews(catalog, *table, views, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
     
-    // Apply WHERE clause if present
-    if (statement->hasWhere) {
-        rows = table->selectWhere(
-            statement->whereColumn,
-            statement->whereOperator,
-            statement->whereValue
-        );
+    // Route the rows of a partitioned table first, so that each partition
+    // takes its rows in one batch
+    std::vector<Table*> targets;
+    std::vector<std::vector<std::vector<Value>>> batches;
+    std::shared_ptr<const PartitionScheme> scheme = catalog.partitioning(tableName);
+    if (scheme != nullptr) {
+        std::vector<Value> keys(rows.size());
+        for (size_t r = 0; r < rows.size(); r++) {
+            const std::vector<Value>& values = rows[r];
+            if (scheme->columnIndex < values.size() &&
+                !values[scheme->columnIndex].castTo(scheme->columnType, keys[r])) {
+                keys[r] = values[scheme->columnIndex];
+            }
+        }
+        
+        // New segments of a time-series table come first, as they move
+        // the positions of the segments after them
+        int last = -1;
+        if (scheme->method == PartitionScheme::Method::TIMESERIES) {
+            for (const Value& key : keys) {
+                last = scheme->route(key, last);
+                if (last < 0 && (last = routeRow(catalog, scheme, key, errorMessage)) < 0) {
+                    return {false, "Failed to insert row into table " + tableName +
+                                   ": " + errorMessage, {}, {}};
+                }
+            }
+        }
+        
+        // Each batch is allocated once, at the size it ends up with
+        std::vector<int> routed(rows.size());
+        std::vector<size_t> counts(scheme->partitions.size(), 0);
+        for (size_t r = 0; r < rows.size(); r++) {
+            int partition = scheme->route(keys[r], last);
+            if (partition < 0) {
+                return {false, "Failed to insert row into table " + tableName +
+                               ": no partition holds key " + keys[r].toLiteral(), {}, {}};
+            }
+            routed[r] = last = partition;
+            counts[partition]++;
+        }
+        batches.resize(scheme->partitions.size());
+        for (size_t i = 0; i < batches.size(); i++) {
+            batches[i].reserve(counts[i]);
+        }
+        for (size_t r = 0; r < rows.size(); r++) {
+            batches[routed[r]].push_back(std::move(rows[r]));
+        }
+        for (const auto& partition : scheme->partitions) {
+            targets.push_back(partition.table.get());
+        }
     } else {
-        rows = table->selectAll();
+        batches.push_back(std::move(rows));
+        targets.push_back(table.get());
+    }
+    rows.clear();
+    
+    ExecutionResult result = {true, "", {}, {}};
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (batches[i].empty()) {
+            continue;
+        }
+        if (!targets[i]->ensureLoaded()) {
+            return {false, "Failed to load table: " + tableName, {}, {}};
+        }
+        size_t firstIndex;
+        if (!targets[i]->insertRows(txn, batches[i], firstIndex, errorMessage)) {
+            return {false, "Failed to insert row into table " + tableName +
+                           ": " + errorMessage, {}, {}};
+        }
+        if (!views.empty()) {
+            // The rows as stored, after conversion to the column types
+            for (size_t r = 0; r < batches[i].size(); r++) {
+                Row row;
+                row.values = targets[i]->versionValues(firstIndex + r);
+                for (auto& view : views) {
+                    view.add(row, 1);
+                }
+            }
+        }
+        result.rowCount += batches[i].size();
+    }
+    if (!applyViews(views, txn, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
+    return result;
+}
+
+ExecutionResult Executor::executeSelect(
+    const std::shared_ptr<SelectStatement>& statement,
+    Catalog& catalog,
+    Transaction& txn,
+    ResultSink& sink,
+    QueryProfile* profile,
+    std::pmr::memory_resource* arena,
+    MemoryReservation* memory) {
+    
+    // Find the table
+    Stopwatch bindTimer;
+    std::shared_ptr<Table> table = catalog.find(statement->tableName);
+    if (table == nullptr) {
+        return {false, "Table not found: " + statement->tableName, {}, {}};
     }
     
     // Prepare result
@@ -107,115 +906,413 @@ ExecutionResult Executor::executeSelect(
     // Get column information
     const auto& columns = table->getColumns();
     
-    // Determine which columns to include
-    std::vector<int> columnIndices;
-    if (statement->columns.size() == 1 && statement->columns[0] == "*") {
-        // Select all columns
-        for (size_t i = 0; i < columns.size(); i++) {
-            columnIndices.push_back(static_cast<int>(i));
-            result.columnNames.push_back(columns[i].name);
+    // Bind the select list and the WHERE clause
+    Projection projection(arena);
+    std::string errorMessage;
+    if (!projection.bind(*statement, *table, &result.columnNames, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
+    
+    // A LIKE on a column with a trigram index only checks the rows the
+    // index lists, and an equality on a column with Bloom filters only the
+    // blocks that may hold the value; the whole filter still runs on them.
+    // Partitions have the indexes of their table.
+    IndexedSearch search;
+    bool indexed = statement->where != nullptr && findIndexedSearch(*statement->where, *table, search);
+    EqualitySearch equality;
+    bool filtered = !indexed && statement->where != nullptr &&
+                    findEqualitySearch(*statement->where, *table, equality);
+    
+    // Of a partitioned table, only the partitions the WHERE clause leaves
+    std::string partitionDetail;
+    std::vector<std::shared_ptr<Table>> sources =
+        tablesToScan(catalog, table, statement->where, partitionDetail);
+    
+    if (profile) {
+        profile->bindNs = bindTimer.elapsedNs();
+        
+        const auto& computed = projection.computed;
+        std::string projected;
+        for (size_t i = 0; i < computed.size(); i++) {
+            projected += (i > 0 ? ", " : "");
+            projected += computed[i] ? computed[i]->toString() : columns[projection.columnIndices[i]].name;
         }
-    } else {
-        // Select specific columns
-        for (const auto& colName : statement->columns) {
-            int colIndex = -1;
-            for (size_t i = 0; i < columns.size(); i++) {
-                if (columns[i].name == colName) {
-                    colIndex = static_cast<int>(i);
-                    break;
+        profile->plan = PlanNode("Project", "(" + projected + ")");
+        
+        std::string scanDetail = "on " + statement->tableName + describeFilter(projection.filter);
+        profile->plan.children.emplace_back(indexed ? "Index Scan" : "Seq Scan", scanDetail);
+        if (indexed) {
+            profile->plan.children[0].index = search.index;
+        } else if (filtered) {
+            profile->plan.children[0].index = equality.index;
+        }
+        profile->plan.children[0].partitions = partitionDetail;
+        if (!profile->analyze) {
+            return result;
+        }
+    }
+    
+    for (const auto& source : sources) {
+        if (!source->ensureLoaded()) {
+            return {false, "Failed to load table: " + statement->tableName, {}, {}};
+        }
+    }
+    
+    // Read a table with the narrowest scan its indexes allow; returns the
+    // number of row versions read
+    auto scanSource = [&](const Table& source, auto visit) -> size_t {
+        size_t scanned = 0;
+        size_t skipped = 0;
+        if (indexed && source.scanContaining(txn, search.column, search.strings, scanned, visit)) {
+            return scanned;
+        }
+        if (filtered && source.scanEqual(txn, equality.column, equality.value, skipped, visit)) {
+            // Versions in the blocks passed over were never read
+            scanned = source.versionCount();
+            return scanned - std::min(skipped, scanned);
+        }
+        source.scanBatches(txn, visit);
+        return source.versionCount();
+    };
+    
+    // Scan a block at a time: filter its visible rows, evaluate the
+    // computed columns over the selected ones, and stream each result row
+    // into the sink
+    Stopwatch scanTimer;
+    sink.beginResult(result.columnNames);
+    size_t rowCount = 0;
+    size_t scanned = 0;
+    uint64_t scannedBytes = 0;
+    uint64_t projectedBytes = 0;
+    if (sources.size() > 1 && workers != nullptr && workers->size() > 1 && profile == nullptr) {
+        // Partitions are scanned on the workers, each into a buffer of its
+        // own, and their rows streamed out in partition order. Buffering
+        // costs more than it saves with a single core to share. Buffers
+        // beyond the query's reservation spill to disk.
+        struct PartitionScan {
+            std::unique_ptr<RowBuffer> rows;
+            size_t scanned = 0;
+            bool buffered = true;
+        };
+        std::vector<PartitionScan> scans(sources.size());
+        workers->parallelFor(sources.size(), [&](size_t i) {
+            // Bound above against the same columns, so this cannot fail
+            Projection local(std::pmr::get_default_resource());
+            std::string ignored;
+            local.bind(*statement, *sources[i], nullptr, ignored);
+            PartitionScan& scan = scans[i];
+            scan.rows = std::make_unique<RowBuffer>(memory);
+            scan.scanned = scanSource(*sources[i], [&local, &scan](const RowBatch& batch) {
+                if (!scan.buffered) {
+                    return;
                 }
+                local.run(batch, [&scan](const Row&, const std::vector<Value>& values) {
+                    scan.buffered = scan.buffered && scan.rows->add(values);
+                });
+            });
+        });
+        for (PartitionScan& scan : scans) {
+            if (txn.interrupted()) {
+                break;
             }
-            
-            if (colIndex == -1) {
-                return {false, "Column not found: " + colName, {}, {}};
+            auto emit = [&sink](const std::vector<Value>& row) { sink.addRow(row); };
+            if (!scan.buffered || !scan.rows->replay(emit)) {
+                if (memory != nullptr && memory->exhausted()) {
+                    return {false, memory->errorMessage(), {}, {}};
+                }
+                return {false, "Failed to spill rows of " + statement->tableName + " to disk", {}, {}};
             }
-            
-            columnIndices.push_back(colIndex);
-            result.columnNames.push_back(colName);
+            rowCount += scan.rows->size();
+            scanned += scan.scanned;
+            scan.rows.reset();
         }
+    } else {
+        auto visit = [&](const RowBatch& batch) {
+            if (memory != nullptr && memory->exhausted()) {
+                return;
+            }
+            projection.run(batch, [&](const Row& row, const std::vector<Value>& values) {
+                if (profile) {
+                    scannedBytes += sizeof(Row) + estimateRowBytes(row.values) - sizeof(std::vector<Value>);
+                    projectedBytes += estimateRowBytes(values);
+                }
+                sink.addRow(values);
+                rowCount++;
+            });
+        };
+        for (const auto& source : sources) {
+            scanned += scanSource(*source, visit);
+        }
+    }
+    // A failed result set is not ended, so no row count is reported for it
+    if (memory != nullptr && memory->exhausted()) {
+        return {false, memory->errorMessage(), {}, {}};
     }
+    if (wasInterrupted(txn)) {
+        return interruptedResult(txn);
+    }
+    sink.endResult(rowCount);
     
-    // Extract values for the selected columns
-    for (const auto& row : rows) {
-        std::vector<std::string> resultRow;
-        for (int index : columnIndices) {
-            resultRow.push_back(row.values[index]);
-        }
-        result.rows.push_back(resultRow);
+    if (profile) {
+        // Scan and projection run as one pass, so both report its time
+        PlanNode& scan = profile->plan.children[0];
+        scan.timeNs = scanTimer.elapsedNs();
+        scan.rowsIn = scanned;
+        scan.rowsOut = rowCount;
+        scan.bytes = scannedBytes;
+        
+        PlanNode& project = profile->plan;
+        project.timeNs = scan.timeNs;
+        project.rowsIn = project.rowsOut = rowCount;
+        project.bytes = projectedBytes;
     }
     
-    std::cout << rows.size() << " row(s) returned" << std::endl;
+    result.rowCount = rowCount;
+    result.rowsScanned = scanned;
+    return result;
+}
+
+ExecutionResult Executor::executeDelete(
+    const std::shared_ptr<DeleteStatement>& statement,
+    Catalog& catalog,
+    Transaction& txn,
+    ResultSink& sink,
+    QueryProfile* profile) {
     
-    // Print the result to console
-    // Print header
-    for (size_t i = 0; i < result.columnNames.size(); i++) {
-        if (i > 0) {
-            std::cout << " | ";
+    // Find the table
+    Stopwatch bindTimer;
+    std::shared_ptr<Table> table = catalog.find(statement->tableName);
+    if (table == nullptr) {
+        return {false, "Table not found: " + statement->tableName, {}, {}};
+    }
+    if (catalog.isView(statement->tableName)) {
+        return {false, "Cannot modify materialized view: " + statement->tableName, {}, {}};
+    }
+    
+    std::unique_ptr<CompiledExpression> filter;
+    std::string errorMessage;
+    if (!compileFilter(statement->where, *table, filter, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
+    
+    std::string partitionDetail;
+    std::vector<std::shared_ptr<Table>> sources =
+        tablesToScan(catalog, table, statement->where, partitionDetail);
+    
+    if (profile) {
+        profile->bindNs = bindTimer.elapsedNs();
+        
+        // Scanning and marking happen in one pass over the table
+        profile->plan = PlanNode("Delete", "on " + statement->tableName + describeFilter(filter));
+        profile->plan.partitions = partitionDetail;
+        if (!profile->analyze) {
+            return {true, "", {}, {}};
         }
-        std::cout << result.columnNames[i];
     }
-    std::cout << std::endl;
     
-    // Print separator
-    for (size_t i = 0; i < result.columnNames.size(); i++) {
-        if (i > 0) {
-            std::cout << "-+-";
+    for (const auto& source : sources) {
+        if (!source->ensureLoaded()) {
+            return {false, "Failed to load table: " + statement->tableName, {}, {}};
         }
-        std::cout << std::string(result.columnNames[i].length(), '-');
     }
-    std::cout << std::endl;
     
-    // Print rows
-    for (const auto& row : result.rows) {
-        for (size_t i = 0; i < row.size(); i++) {
-            if (i > 0) {
-                std::cout << " | ";
+    // Materialized views over the table count the deleted rows out
+    std::vector<ViewDelta> views;
+    if (!bindViews(catalog, *table, views, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
+    
+    Stopwatch deleteTimer;
+    int rowsDeleted = 0;
+    size_t rowsScanned = 0;
+    
+    for (const auto& source : sources) {
+        int deleted;
+        
+        // Apply WHERE clause if present
+        if (filter || !views.empty()) {
+            deleted = source->deleteWhere(txn, [&filter, &views](const Row& row) {
+                if (filter && !filter->matches(row)) {
+                    return false;
+                }
+                for (auto& view : views) {
+                    view.add(row, -1);
+                }
+                return true;
+            });
+        } else {
+            // Delete all rows (dangerous!)
+            deleted = source->deleteAll(txn);
+        }
+        
+        if (deleted < 0) {
+            if (wasInterrupted(txn)) {
+                return interruptedResult(txn);
             }
-            std::cout << row[i];
+            return {false, "Write conflict on table " + statement->tableName +
+                           ": row was changed by a concurrent transaction", {}, {}};
         }
-        std::cout << std::endl;
+        rowsDeleted += deleted;
+        rowsScanned += source->versionCount();
+    }
+    if (!applyViews(views, txn, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
+    
+    if (profile) {
+        PlanNode& remove = profile->plan;
+        remove.timeNs = deleteTimer.elapsedNs();
+        remove.rowsIn = rowsScanned;
+        remove.rowsOut = static_cast<uint64_t>(rowsDeleted);
     }
     
+    sink.message(std::to_string(rowsDeleted) + " row(s) deleted from " + statement->tableName);
+    ExecutionResult result = {true, "", {}, {}};
+    result.rowCount = static_cast<size_t>(rowsDeleted);
+    result.rowsScanned = rowsScanned;
     return result;
 }
 
-ExecutionResult Executor::executeDelete(
-    const std::shared_ptr<DeleteStatement>& statement,
-    std::vector<std::unique_ptr<Table>>& tables) {
+ExecutionResult Executor::executeUpdate(
+    const std::shared_ptr<UpdateStatement>& statement,
+    Catalog& catalog,
+    Transaction& txn,
+    ResultSink& sink,
+    QueryProfile* profile) {
     
     // Find the table
-    Table* table = findTable(statement->tableName, tables);
+    Stopwatch bindTimer;
+    std::shared_ptr<Table> table = catalog.find(statement->tableName);
     if (table == nullptr) {
         return {false, "Table not found: " + statement->tableName, {}, {}};
     }
+    if (catalog.isView(statement->tableName)) {
+        return {false, "Cannot modify materialized view: " + statement->tableName, {}, {}};
+    }
     
-    int rowsDeleted = 0;
+    // Compile the assigned expressions and the WHERE clause
+    std::vector<std::string> columnNames;
+    std::vector<std::unique_ptr<CompiledExpression>> values;
+    std::string errorMessage;
+    for (const Assignment& assignment : statement->assignments) {
+        auto compiled = CompiledExpression::compile(*assignment.expression, table->getColumns(),
+                                                    errorMessage);
+        if (compiled == nullptr) {
+            return {false, "Failed to update table " + statement->tableName +
+                           ": " + errorMessage, {}, {}};
+        }
+        columnNames.push_back(assignment.column);
+        values.push_back(std::move(compiled));
+    }
     
-    // Apply WHERE clause if present
-    if (statement->hasWhere) {
-        rowsDeleted = table->deleteWhere(
-            statement->whereColumn,
-            statement->whereOperator,
-            statement->whereValue
-        );
-    } else {
-        // Delete all rows (dangerous!)
-        rowsDeleted = table->deleteWhere("", "=", "");  // This should delete all rows
+    std::unique_ptr<CompiledExpression> filter;
+    if (!compileFilter(statement->where, *table, filter, errorMessage)) {
+        return {false, errorMessage, {}, {}};
     }
     
-    std::cout << rowsDeleted << " row(s) deleted from " << statement->tableName << std::endl;
-    return {true, "", {}, {}};
-}
-
-Table* Executor::findTable(
-    const std::string& tableName,
-    std::vector<std::unique_ptr<Table>>& tables) {
+    // A row stays in the partition of its key, so the key cannot change
+    std::shared_ptr<const PartitionScheme> scheme = catalog.partitioning(statement->tableName);
+    if (scheme != nullptr &&
+        std::find(columnNames.begin(), columnNames.end(), scheme->column) != columnNames.end()) {
+        return {false, "Failed to update table " + statement->tableName +
+                       ": cannot update partition key column " + scheme->column, {}, {}};
+    }
+    std::string partitionDetail;
+    std::vector<std::shared_ptr<Table>> sources =
+        tablesToScan(catalog, table, statement->where, partitionDetail);
+    
+    if (profile) {
+        profile->bindNs = bindTimer.elapsedNs();
+        
+        // Scanning and rewriting happen in one pass over the table
+        std::string detail = "on " + statement->tableName + " set ";
+        for (size_t i = 0; i < values.size(); i++) {
+            detail += (i > 0 ? ", " : "") + columnNames[i] + " = " + values[i]->toString();
+        }
+        profile->plan = PlanNode("Update", detail + describeFilter(filter));
+        profile->plan.partitions = partitionDetail;
+        if (!profile->analyze) {
+            return {true, "", {}, {}};
+        }
+    }
     
-    for (auto& table : tables) {
-        if (table->getName() == tableName) {
-            return table.get();
+    for (const auto& source : sources) {
+        if (!source->ensureLoaded()) {
+            return {false, "Failed to load table: " + statement->tableName, {}, {}};
         }
     }
     
-    return nullptr;
-}
\ No newline at end of file
+    // Materialized views that read an assigned column move the rows from
+    // their old groups to their new ones
+    std::vector<ViewDelta> views;
+    if (!bindViews(catalog, *table, views, errorMessage)) {
+        return {false, errorMessage, {}, {}};
+    }
+    views.erase(std::remove_if(views.begin(), views.end(), [&columnNames](const ViewDelta& view) {
+        return !view.dependsOn(columnNames);
+    }), views.end());
+    size_t firstUpdate = txn.undoLog.size();
+    
+    Stopwatch updateTimer;
+    auto compute = [&values](const Row& row, std::vector<Value>& newValues) {
+        for (size_t i = 0; i < values.size(); i++) {
+            newValues[i] = values[i]->evaluate(row);
+        }
+    };
+    
+    // Without a WHERE clause every visible row is updated
+    int rowsUpdated = 0;
+    size_t rowsScanned = 0;
+    for (const auto& source : sources) {
+        int updated = source->updateWhere(txn, columnNames, compute, [&filter, &views](const Row& row) {
+            if (filter != nullptr && !filter->matches(row)) {
+                return false;
+            }
+            for (auto& view : views) {
+                view.add(row, -1);
+            }
+            return true;
+        }, errorMessage);
+        
+        if (updated < 0) {
+            if (wasInterrupted(txn)) {
+                return interruptedResult(txn);
+            }
+            if (!errorMessage.empty()) {
+                return {false, "Failed to update table " + statement->tableName +
+                               ": " + errorMessage, {}, {}};
+            }
+            return {false, "Write conflict on table " + statement->tableName +
+                           ": row was changed by a concurrent transaction", {}, {}};
+        }
+        rowsUpdated += updated;
+        rowsScanned += source->versionCount();
+    }
+    
+    if (!views.empty()) {
+        // The rewritten rows, one undo entry each
+        for (size_t i = firstUpdate; i < txn.undoLog.size(); i++) {
+            Row row;
+            row.values = txn.undoLog[i].table->versionValues(txn.undoLog[i].rowIndex);
+            for (auto& view : views) {
+                view.add(row, 1);
+            }
+        }
+        if (!applyViews(views, txn, errorMessage)) {
+            return {false, errorMessage, {}, {}};
+        }
+    }
+    
+    if (profile) {
+        PlanNode& update = profile->plan;
+        update.timeNs = updateTimer.elapsedNs();
+        update.rowsIn = rowsScanned;
+        update.rowsOut = static_cast<uint64_t>(rowsUpdated);
+    }
+    
+    sink.message(std::to_string(rowsUpdated) + " row(s) updated in " + statement->tableName);
+    ExecutionResult result = {true, "", {}, {}};
+    result.rowCount = static_cast<size_t>(rowsUpdated);
+    result.rowsScanned = rowsScanned;
+    return result;
+}
@@ -2,17 +2,27 @@
 #define EXECUTOR_HPP
 
 #include <memory>
+#include <memory_resource>
 #include <vector>
 #include <string>
 #include "../sql/parser.hpp"
 #include "../storage/table.hpp"
+#include "../storage/catalog.hpp"
+#include "./result_sink.hpp"
+#include "./plan.hpp"
+#include "./compiled_expression.hpp"
+#include "../include/memory_budget.hpp"
+
+class ThreadPool;
 
 // Result of executing a statement
 struct ExecutionResult {
     bool success;
     std::string errorMessage;
-    std::vector<std::vector<std::string>> rows;  // Result rows for SELECT
+    std::vector<std::vector<Value>> rows;        // Result rows for SELECT
     std::vector<std::string> columnNames;        // Column names for SELECT
+    size_t rowCount = 0;                         // Rows returned, inserted or deleted
+    size_t rowsScanned = 0;                      // Row versions read by scans
 };
 
 // Executor class to execute parsed statements
@@ -20,32 +30,104 @@ class Executor {
 public:
     Executor() = default;
     
-    // Execute a SQL statement
+    // Execute a SQL statement, streaming its output into the sink. Rows
+    // are not kept in the returned result. Scratch memory comes from the
+    // arena, which must outlive the call. Rows the statement buffers are
+    // accounted to the reservation, if given; it fails once that is
+    // exhausted. It also fails, a block or batch of rows after the stop,
+    // if the transaction's query control is cancelled or times out.
     ExecutionResult execute(
         const std::shared_ptr<Statement>& statement,
-        std::vector<std::unique_ptr<Table>>& tables);
+        Catalog& catalog,
+        Transaction& txn,
+        ResultSink& sink,
+        std::pmr::memory_resource* arena = std::pmr::get_default_resource(),
+        MemoryReservation* memory = nullptr);
+    
+    // Insert rows of values given in column order, without a statement:
+    // each partition's rows are added as one batch. Materialized views
+    // over the table count them in. Fails without inserting any row if
+    // one does not fit the table.
+    ExecutionResult append(
+        const std::string& tableName,
+        std::vector<std::vector<Value>>& rows,
+        Catalog& catalog,
+        Transaction& txn);
+    
+    // Threads that scan the partitions of a partitioned table at once;
+    // without them partitions are scanned one after another
+    void setWorkers(ThreadPool* workers) { this->workers = workers; }
     
 private:
-    // Execute specific statement types
+    ThreadPool* workers = nullptr;  // See setWorkers
+    
+    // Execute specific statement types. With a profile, record the plan
+    // (and with profile->analyze its measurements); without ANALYZE the
+    // statement is only bound, not run.
     ExecutionResult executeCreateTable(
         const std::shared_ptr<CreateTableStatement>& statement,
-        std::vector<std::unique_ptr<Table>>& tables);
+        Catalog& catalog,
+        ResultSink& sink,
+        QueryProfile* profile);
+        
+    ExecutionResult executeCreateIndex(
+        const std::shared_ptr<CreateIndexStatement>& statement,
+        Catalog& catalog,
+        ResultSink& sink,
+        QueryProfile* profile);
+        
+    // Add or drop a partition of a RANGE partitioned table
+    ExecutionResult executeAlterTable(
+        const std::shared_ptr<AlterTableStatement>& statement,
+        Catalog& catalog,
+        ResultSink& sink);
+        
+    // Create a materialized view and fill in the groups its table has
+    ExecutionResult executeCreateView(
+        const std::shared_ptr<CreateViewStatement>& statement,
+        Catalog& catalog,
+        Transaction& txn,
+        ResultSink& sink,
+        MemoryReservation* memory);
         
     ExecutionResult executeInsert(
         const std::shared_ptr<InsertStatement>& statement,
-        std::vector<std::unique_ptr<Table>>& tables);
+        Catalog& catalog,
+        Transaction& txn,
+        ResultSink& sink,
+        QueryProfile* profile);
         
     ExecutionResult executeSelect(
         const std::shared_ptr<SelectStatement>& statement,
-        std::vector<std::unique_ptr<Table>>& tables);
+        Catalog& catalog,
+        Transaction& txn,
+        ResultSink& sink,
+        QueryProfile* profile,
+        std::pmr::memory_resource* arena,
+        MemoryReservation* memory);
         
     ExecutionResult executeDelete(
         const std::shared_ptr<DeleteStatement>& statement,
-        std::vector<std::unique_ptr<Table>>& tables);
+        Catalog& catalog,
+        Transaction& txn,
+        ResultSink& sink,
+        QueryProfile* profile);
+        
+    ExecutionResult executeUpdate(
+        const std::shared_ptr<UpdateStatement>& statement,
+        Catalog& catalog,
+        Transaction& txn,
+        ResultSink& sink,
+        QueryProfile* profile);
         
-    // Helper to find a table by name
-    Table* findTable(const std::string& tableName, 
-                   std::vector<std::unique_ptr<Table>>& tables);
+    // Plan, and with ANALYZE run, a statement; the plan is the result set
+    ExecutionResult executeExplain(
+        const std::shared_ptr<ExplainStatement>& statement,
+        Catalog& catalog,
+        Transaction& txn,
+        ResultSink& sink,
+        std::pmr::memory_resource* arena,
+        MemoryReservation* memory);
 };
 
 #endif // EXECUTOR_HPP
\ No newline at end of file
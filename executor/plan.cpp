@@ -0,0 +1,47 @@
+#include "./plan.hpp"
+#include <cstdio>
+
+// Milliseconds with microsecond precision
+static std::string formatMs(uint64_t ns) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3f ms", static_cast<double>(ns) / 1e6);
+    return text;
+}
+
+static void renderNode(const PlanNode& node, bool analyze, size_t depth,
+                       std::vector<std::string>& lines) {
+    std::string line = depth == 0 ? "" : std::string(depth * 4 - 4, ' ') + "->  ";
+    line += node.name;
+    if (!node.detail.empty()) {
+        line += " " + node.detail;
+    }
+    if (!node.index.empty()) {
+        line += " using index " + node.index;
+    }
+    if (!node.partitions.empty()) {
+        line += " partitions " + node.partitions;
+    }
+    if (analyze) {
+        line += "  (time=" + formatMs(node.timeNs) +
+                " rows in=" + std::to_string(node.rowsIn) +
+                " out=" + std::to_string(node.rowsOut) +
+                " bytes=" + std::to_string(node.bytes) + ")";
+    }
+    lines.push_back(line);
+
+    for (const PlanNode& child : node.children) {
+        renderNode(child, analyze, depth + 1, lines);
+    }
+}
+
+std::vector<std::string> QueryProfile::render() const {
+    std::vector<std::string> lines;
+    renderNode(plan, analyze, 0, lines);
+
+    if (analyze) {
+        lines.push_back("Parse: " + formatMs(parseNs));
+        lines.push_back("Bind: " + formatMs(bindNs));
+        lines.push_back("Execute: " + formatMs(executeNs));
+    }
+    return lines;
+}
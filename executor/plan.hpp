@@ -0,0 +1,52 @@
+#ifndef PLAN_HPP
+#define PLAN_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One operator of a query plan; EXPLAIN ANALYZE fills in the measurements
+struct PlanNode {
+    std::string name;      // Operator, e.g. "Seq Scan"
+    std::string detail;    // Target and arguments, e.g. "on users filter: age > 40"
+    std::string index;     // Index the operator used, empty if none
+    std::string partitions;  // Partitions it read, e.g. "2 of 12 (p11, p12)"; empty if none
+    uint64_t rowsIn = 0;
+    uint64_t rowsOut = 0;
+    uint64_t bytes = 0;    // Estimated bytes allocated for the rows it produced
+    uint64_t timeNs = 0;   // Wall time, including the time of its children
+    std::vector<PlanNode> children;
+
+    PlanNode() = default;
+    PlanNode(const std::string& name, const std::string& detail)
+        : name(name), detail(detail) {}
+};
+
+// Plan of one statement and, for EXPLAIN ANALYZE, where its time went
+struct QueryProfile {
+    bool analyze = false;  // Execute the statement; otherwise only plan it
+    PlanNode plan;
+    uint64_t parseNs = 0;
+    uint64_t bindNs = 0;   // Resolving tables and columns
+    uint64_t executeNs = 0;
+
+    // Lines of the textual plan, one per row of EXPLAIN output
+    std::vector<std::string> render() const;
+};
+
+// Measures wall time from construction
+class Stopwatch {
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+    uint64_t elapsedNs() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // PLAN_HPP
@@ -0,0 +1,239 @@
+#include "./result_sink.hpp"
+#include "./row_buffer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+void CollectingSink::beginResult(const std::vector<std::string>& columnNames) {
+    // Only the last result set of a script is kept
+    this->columnNames = columnNames;
+    rows.clear();
+    used = 0;
+}
+
+void CollectingSink::addRow(const std::vector<Value>& values) {
+    if (memory != nullptr) {
+        uint64_t bytes = estimateRowBytes(values);
+        if (used + bytes > granted) {
+            uint64_t more = std::max(MemoryReservation::CHUNK_BYTES, used + bytes - granted);
+            if (!memory->grow(more)) {
+                return;
+            }
+            granted += more;
+        }
+        used += bytes;
+    }
+    rows.push_back(values);
+}
+
+RenderingSink::RenderingSink(std::ostream& out, RenderFormat format)
+    : out(out), format(format) {}
+
+RenderingSink::~RenderingSink() {
+    flush();
+}
+
+bool RenderingSink::parseFormat(const std::string& name, RenderFormat& format) {
+    if (name == "table") {
+        format = RenderFormat::TABLE;
+    } else if (name == "csv") {
+        format = RenderFormat::CSV;
+    } else if (name == "json") {
+        format = RenderFormat::JSON;
+    } else if (name == "quiet") {
+        format = RenderFormat::QUIET;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void RenderingSink::beginResult(const std::vector<std::string>& columnNames) {
+    this->columnNames = columnNames;
+    rowsInResult = 0;
+
+    switch (format) {
+        case RenderFormat::TABLE:
+            // Header and separator
+            for (size_t i = 0; i < columnNames.size(); i++) {
+                if (i > 0) {
+                    buffer += " | ";
+                }
+                buffer += columnNames[i];
+            }
+            buffer += '\n';
+            for (size_t i = 0; i < columnNames.size(); i++) {
+                if (i > 0) {
+                    buffer += "-+-";
+                }
+                buffer.append(columnNames[i].length(), '-');
+            }
+            buffer += '\n';
+            break;
+
+        case RenderFormat::CSV:
+            for (size_t i = 0; i < columnNames.size(); i++) {
+                if (i > 0) {
+                    buffer += ',';
+                }
+                appendCsvField(columnNames[i]);
+            }
+            buffer += "\r\n";
+            break;
+
+        case RenderFormat::JSON:
+            buffer += '[';
+            break;
+
+        case RenderFormat::QUIET:
+            break;
+    }
+}
+
+void RenderingSink::addRow(const std::vector<Value>& values) {
+    switch (format) {
+        case RenderFormat::TABLE:
+            for (size_t i = 0; i < values.size(); i++) {
+                if (i > 0) {
+                    buffer += " | ";
+                }
+                values[i].appendTo(buffer);
+            }
+            buffer += '\n';
+            break;
+
+        case RenderFormat::CSV:
+            for (size_t i = 0; i < values.size(); i++) {
+                if (i > 0) {
+                    buffer += ',';
+                }
+                if (values[i].type() == ValueType::TEXT) {
+                    appendCsvField(values[i].asText());
+                } else if (!values[i].isNull()) {
+                    values[i].appendTo(buffer);
+                }
+            }
+            buffer += "\r\n";
+            break;
+
+        case RenderFormat::JSON:
+            if (rowsInResult > 0) {
+                buffer += ',';
+            }
+            buffer += "\n  {";
+            for (size_t i = 0; i < values.size() && i < columnNames.size(); i++) {
+                if (i > 0) {
+                    buffer += ", ";
+                }
+                appendJsonString(columnNames[i]);
+                buffer += ": ";
+                appendJsonValue(values[i]);
+            }
+            buffer += '}';
+            break;
+
+        case RenderFormat::QUIET:
+            return;
+    }
+
+    rowsInResult++;
+    flushIfFull();
+}
+
+void RenderingSink::endResult(size_t rowCount) {
+    switch (format) {
+        case RenderFormat::TABLE:
+        case RenderFormat::QUIET:
+            buffer += std::to_string(rowCount) + " row(s) returned\n";
+            break;
+
+        case RenderFormat::CSV:
+            break;
+
+        case RenderFormat::JSON:
+            buffer += rowCount > 0 ? "\n]\n" : "]\n";
+            break;
+    }
+}
+
+void RenderingSink::message(const std::string& text) {
+    buffer += text;
+    buffer += '\n';
+}
+
+void RenderingSink::flush() {
+    if (!buffer.empty()) {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+    out.flush();
+}
+
+void RenderingSink::flushIfFull() {
+    if (buffer.size() >= FLUSH_THRESHOLD) {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+}
+
+void RenderingSink::appendCsvField(std::string_view value) {
+    // Quote only fields that need it, doubling embedded quotes; empty text
+    // is quoted to tell it apart from NULL
+    if (!value.empty() && value.find_first_of(",\"\r\n") == std::string_view::npos) {
+        buffer += value;
+        return;
+    }
+
+    buffer += '"';
+    for (char c : value) {
+        if (c == '"') {
+            buffer += '"';
+        }
+        buffer += c;
+    }
+    buffer += '"';
+}
+
+void RenderingSink::appendJsonString(std::string_view value) {
+    buffer += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"':  buffer += "\\\""; break;
+            case '\\': buffer += "\\\\"; break;
+            case '\n': buffer += "\\n"; break;
+            case '\r': buffer += "\\r"; break;
+            case '\t': buffer += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    buffer += escaped;
+                } else {
+                    buffer += c;
+                }
+        }
+    }
+    buffer += '"';
+}
+
+void RenderingSink::appendJsonValue(const Value& value) {
+    switch (value.type()) {
+        case ValueType::TEXT:
+            appendJsonString(value.asText());
+            break;
+        case ValueType::INTEGER:
+            value.appendTo(buffer);
+            break;
+        case ValueType::REAL:
+            // JSON has no infinity or NaN
+            if (std::isfinite(value.asReal())) {
+                value.appendTo(buffer);
+            } else {
+                buffer += "null";
+            }
+            break;
+        case ValueType::NULL_VALUE:
+            buffer += "null";
+            break;
+    }
+}
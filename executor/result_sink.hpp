@@ -0,0 +1,115 @@
+#ifndef RESULT_SINK_HPP
+#define RESULT_SINK_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../sql/value.hpp"
+#include "../include/memory_budget.hpp"
+
+/**
+ * Destination of statement output. The executor streams each result set
+ * into a sink row by row instead of printing or collecting it, so the
+ * caller decides what a row costs: nothing, a counter, a copy or a
+ * formatted line.
+ */
+class ResultSink {
+public:
+    virtual ~ResultSink() = default;
+
+    // A result set starts; called once before its rows
+    virtual void beginResult(const std::vector<std::string>& columnNames) = 0;
+
+    // One row of the current result set, in column order
+    virtual void addRow(const std::vector<Value>& values) = 0;
+
+    // The current result set is complete
+    virtual void endResult(size_t rowCount) { (void)rowCount; }
+
+    // Status of a statement without a result set, e.g. "1 row(s) inserted"
+    virtual void message(const std::string& text) { (void)text; }
+
+    // Push buffered output to its destination
+    virtual void flush() {}
+};
+
+// Drops everything
+class DiscardSink : public ResultSink {
+public:
+    void beginResult(const std::vector<std::string>&) override {}
+    void addRow(const std::vector<Value>&) override {}
+};
+
+// Counts rows without looking at them
+class CountingSink : public ResultSink {
+public:
+    void beginResult(const std::vector<std::string>&) override {}
+    void addRow(const std::vector<Value>&) override { rowCount++; }
+
+    size_t getRowCount() const { return rowCount; }
+
+private:
+    size_t rowCount = 0;
+};
+
+// Keeps the last result set in memory. With a reservation, rows that do
+// not fit in it are dropped and the reservation is exhausted, which fails
+// the query.
+class CollectingSink : public ResultSink {
+public:
+    void beginResult(const std::vector<std::string>& columnNames) override;
+    void addRow(const std::vector<Value>& values) override;
+
+    void setMemory(MemoryReservation* memory) { this->memory = memory; }
+
+    std::vector<std::string> columnNames;
+    std::vector<std::vector<Value>> rows;
+
+private:
+    MemoryReservation* memory = nullptr;
+    uint64_t granted = 0;  // Bytes of the reservation the rows hold
+    uint64_t used = 0;
+};
+
+// Output formats of RenderingSink
+enum class RenderFormat {
+    TABLE,  // Header, separator and " | " separated rows
+    CSV,    // RFC 4180; NULL is an empty field, empty text is ""
+    JSON,   // One array of objects per result set, typed values
+    QUIET   // Only the row count and status messages
+};
+
+// Formats results as text into a buffer that is written to the stream in
+// large chunks rather than line by line
+class RenderingSink : public ResultSink {
+public:
+    RenderingSink(std::ostream& out, RenderFormat format);
+    ~RenderingSink() override;
+
+    void beginResult(const std::vector<std::string>& columnNames) override;
+    void addRow(const std::vector<Value>& values) override;
+    void endResult(size_t rowCount) override;
+    void message(const std::string& text) override;
+    void flush() override;
+
+    // Parse "table", "csv", "json" or "quiet"
+    static bool parseFormat(const std::string& name, RenderFormat& format);
+
+private:
+    static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    std::ostream& out;
+    RenderFormat format;
+    std::string buffer;
+    std::vector<std::string> columnNames;
+    size_t rowsInResult = 0;
+
+    void appendCsvField(std::string_view value);
+    void appendJsonString(std::string_view value);
+    void appendJsonValue(const Value& value);
+    void flushIfFull();
+};
+
+#endif // RESULT_SINK_HPP
@@ -0,0 +1,125 @@
+#include "./row_buffer.hpp"
+#include "../storage/table.hpp"
+#include <algorithm>
+#include <cstdio>
+
+uint64_t estimateRowBytes(const std::vector<Value>& values) {
+    uint64_t bytes = sizeof(std::vector<Value>) + values.size() * sizeof(Value);
+    for (const auto& value : values) {
+        bytes += value.heapBytes();
+    }
+    return bytes;
+}
+
+// Type letters of spilled values; NULL decodes as NULL whatever its type
+static char typeLetter(const Value& value) {
+    switch (value.type()) {
+        case ValueType::INTEGER:
+            return 'i';
+        case ValueType::REAL:
+            return 'r';
+        default:
+            return 't';
+    }
+}
+
+static TokenType letterType(char letter) {
+    switch (letter) {
+        case 'i':
+            return TokenType::INTEGER;
+        case 'r':
+            return TokenType::REAL;
+        default:
+            return TokenType::TEXT;
+    }
+}
+
+RowBuffer::RowBuffer(MemoryReservation* memory) : memory(memory) {}
+
+RowBuffer::~RowBuffer() {
+    if (memory != nullptr) {
+        memory->shrink(granted);
+    }
+    if (spillFile.is_open()) {
+        spillFile.close();
+        std::remove(spillPath.c_str());
+    }
+}
+
+bool RowBuffer::add(const std::vector<Value>& values) {
+    if (spillFile.is_open()) {
+        return spill(values);
+    }
+
+    uint64_t bytes = estimateRowBytes(values);
+    if (memory != nullptr && used + bytes > granted) {
+        uint64_t more = std::max(MemoryReservation::CHUNK_BYTES, used + bytes - granted);
+        if (!memory->tryGrow(more)) {
+            if (startSpill()) {
+                return spill(values);
+            }
+            // Nowhere to spill to: the query is out of memory
+            if (!memory->grow(more)) {
+                return false;
+            }
+        }
+        granted += more;
+    }
+    used += bytes;
+    rows.push_back(values);
+    return true;
+}
+
+bool RowBuffer::replay(const std::function<void(const std::vector<Value>&)>& visit) {
+    for (const auto& row : rows) {
+        visit(row);
+    }
+    if (spilledRows == 0) {
+        return true;
+    }
+
+    spillFile.flush();
+    spillFile.seekg(0);
+    std::vector<TokenType> types;
+    for (size_t i = 0; i < spilledRows; i++) {
+        if (!std::getline(spillFile, line)) {
+            return false;
+        }
+        size_t space = line.find(' ');
+        if (space == std::string::npos) {
+            return false;
+        }
+        types.clear();
+        for (size_t c = 0; c < space; c++) {
+            types.push_back(letterType(line[c]));
+        }
+        visit(Table::decodeValues(line.substr(space + 1), types));
+    }
+    return true;
+}
+
+bool RowBuffer::startSpill() {
+    spillPath = memory->spillPath();
+    if (spillPath.empty()) {
+        return false;
+    }
+    spillFile.open(spillPath, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    return spillFile.is_open();
+}
+
+bool RowBuffer::spill(const std::vector<Value>& values) {
+    line.clear();
+    for (const auto& value : values) {
+        line += typeLetter(value);
+    }
+    line += ' ';
+    Table::appendEncodedRow(line, values);
+    line += '\n';
+    spillFile.write(line.data(), static_cast<std::streamsize>(line.size()));
+    if (!spillFile) {
+        return false;
+    }
+    spilledRows++;
+    memory->addSpilledRows(1);
+    return true;
+}
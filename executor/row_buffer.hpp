@@ -0,0 +1,58 @@
+#ifndef ROW_BUFFER_HPP
+#define ROW_BUFFER_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "../sql/value.hpp"
+#include "../include/memory_budget.hpp"
+
+// Estimated heap and inline bytes of a row of values
+uint64_t estimateRowBytes(const std::vector<Value>& values);
+
+/**
+ * Rows an operator keeps to hand on later, in the order they came. They
+ * stay in memory while the query's reservation allows and go to a spill
+ * file after that, so a buffer larger than the query may hold slows the
+ * query down instead of failing it.
+ */
+class RowBuffer {
+public:
+    // Without a reservation every row stays in memory
+    explicit RowBuffer(MemoryReservation* memory);
+    ~RowBuffer();
+
+    RowBuffer(const RowBuffer&) = delete;
+    RowBuffer& operator=(const RowBuffer&) = delete;
+
+    // Keep a row. False if it fits neither in memory nor on disk: the
+    // reservation is then exhausted, or the spill file failed.
+    bool add(const std::vector<Value>& values);
+
+    // Pass every row to visit in order; false if the spill file cannot be
+    // read back
+    bool replay(const std::function<void(const std::vector<Value>&)>& visit);
+
+    size_t size() const { return rows.size() + spilledRows; }
+
+private:
+    MemoryReservation* memory;
+    uint64_t granted = 0;  // Bytes of the reservation this buffer holds
+    uint64_t used = 0;
+    std::vector<std::vector<Value>> rows;
+
+    // One line per spilled row: a type letter per value, a space and the
+    // values as Table::encodeRow writes them
+    std::string spillPath;
+    std::fstream spillFile;
+    size_t spilledRows = 0;
+    std::string line;  // Reused to encode each row
+
+    // Open a spill file; false if the query may not spill or it fails
+    bool startSpill();
+    bool spill(const std::vector<Value>& values);
+};
+
+#endif // ROW_BUFFER_HPP
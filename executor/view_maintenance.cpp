@@ -0,0 +1,354 @@
+#include "./view_maintenance.hpp"
+#include "./row_buffer.hpp"
+#include <algorithm>
+
+static int findColumn(const Table& table, const std::string& name) {
+    const auto& columns = table.getColumns();
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// Names of the columns an expression reads
+static void collectColumns(const Expression& expression, std::vector<std::string>& names) {
+    if (expression.kind == Expression::Kind::COLUMN) {
+        names.push_back(expression.name);
+    }
+    for (const auto& operand : expression.operands) {
+        collectColumns(*operand, names);
+    }
+}
+
+bool ViewDelta::viewColumns(const CreateViewStatement& definition, const Table& base,
+                            std::vector<ColumnDefinition>& columns, std::string& errorMessage) {
+    const auto& baseColumns = base.getColumns();
+    const auto& groupBy = definition.groupBy;
+    bool counted = false;
+    columns.clear();
+    for (const ViewColumn& column : definition.columns) {
+        std::string name = column.name();
+        for (const auto& existing : columns) {
+            if (existing.name == name) {
+                errorMessage = "Duplicate column in materialized view: " + name;
+                return false;
+            }
+        }
+        if (column.kind == ViewColumn::Kind::COUNT) {
+            columns.emplace_back(name, TokenType::INTEGER, false, true);
+            counted = true;
+            continue;
+        }
+        int index = findColumn(base, column.column);
+        if (index == -1) {
+            errorMessage = "Column not found: " + column.column;
+            return false;
+        }
+        TokenType type = baseColumns[index].dataType;
+        if (column.kind == ViewColumn::Kind::SUM) {
+            if (type == TokenType::TEXT) {
+                errorMessage = "SUM needs an INTEGER or REAL column: " + column.column;
+                return false;
+            }
+            columns.emplace_back(name, type);
+            continue;
+        }
+        if (std::find(groupBy.begin(), groupBy.end(), column.column) == groupBy.end()) {
+            errorMessage = "Column must appear in GROUP BY: " + column.column;
+            return false;
+        }
+        columns.emplace_back(name, type);
+    }
+
+    // Every group needs its row, and its count to tell when it is empty
+    for (const auto& name : groupBy) {
+        bool selected = std::any_of(definition.columns.begin(), definition.columns.end(),
+                                    [&name](const ViewColumn& column) {
+                                        return column.kind == ViewColumn::Kind::GROUP_KEY &&
+                                               column.column == name;
+                                    });
+        if (!selected) {
+            errorMessage = "GROUP BY column must be selected: " + name;
+            return false;
+        }
+    }
+    if (!counted) {
+        errorMessage = "A materialized view needs COUNT(*) to keep track of its groups";
+        return false;
+    }
+
+    // A SUM is NULL while its group has no value to add up, which only a
+    // count of them tells after deletes
+    for (const ViewColumn& column : definition.columns) {
+        if (column.kind != ViewColumn::Kind::SUM) {
+            continue;
+        }
+        std::string name = column.name() + "_count";
+        for (const auto& existing : columns) {
+            if (existing.name == name) {
+                errorMessage = "Duplicate column in materialized view: " + name;
+                return false;
+            }
+        }
+        columns.emplace_back(name, TokenType::INTEGER, false, true);
+    }
+    return true;
+}
+
+bool ViewDelta::bind(std::shared_ptr<MaterializedView> view, const Table& base,
+                     std::string& errorMessage) {
+    const CreateViewStatement& definition = *view->definition;
+    std::vector<ColumnDefinition> columns;
+    if (!viewColumns(definition, base, columns, errorMessage)) {
+        return false;
+    }
+    if (definition.where) {
+        filter = CompiledExpression::compile(*definition.where, base.getColumns(), errorMessage);
+        if (filter == nullptr) {
+            return false;
+        }
+        collectColumns(*definition.where, referenced);
+    }
+
+    // Views created before the counts of non-NULL values have only the
+    // columns of their definition, and keep NULLs out of their sums
+    bool valueCounts = view->table->getColumns().size() == columns.size();
+    size_t nextCount = definition.columns.size();
+
+    bool counted = false;
+    for (size_t i = 0; i < definition.columns.size(); i++) {
+        const ViewColumn& column = definition.columns[i];
+        int index = column.kind == ViewColumn::Kind::COUNT ? -1 : findColumn(base, column.column);
+        if (column.kind == ViewColumn::Kind::GROUP_KEY) {
+            keyColumns.push_back(static_cast<size_t>(index));
+            keyPositions.push_back(i);
+        } else {
+            int valueCount = -1;
+            if (column.kind == ViewColumn::Kind::SUM && valueCounts) {
+                valueCount = static_cast<int>(nextCount++);
+            }
+            aggregates.push_back({i, index, columns[i].dataType, valueCount});
+        }
+        if (column.kind == ViewColumn::Kind::COUNT && !counted) {
+            countPosition = i;
+            counted = true;
+        }
+        if (index != -1) {
+            referenced.push_back(column.column);
+        }
+    }
+    this->view = std::move(view);
+    return true;
+}
+
+bool ViewDelta::dependsOn(const std::vector<std::string>& columnNames) const {
+    return std::any_of(columnNames.begin(), columnNames.end(), [this](const std::string& name) {
+        return std::find(referenced.begin(), referenced.end(), name) != referenced.end();
+    });
+}
+
+void ViewDelta::add(const Row& row, int sign) {
+    if (filter && !filter->matches(row)) {
+        return;
+    }
+
+    int found = findGroup(row.values, keyColumns);
+    if (found == -1) {
+        Group group;
+        for (size_t column : keyColumns) {
+            group.key.push_back(row.values[column]);
+        }
+        for (const Aggregate& aggregate : aggregates) {
+            group.deltas.push_back(aggregate.type == TokenType::REAL ? Value::real(0) : Value::integer(0));
+        }
+        group.valueDeltas.resize(aggregates.size(), 0);
+        found = static_cast<int>(groups.size());
+        groupBytes += sizeof(Group) + estimateRowBytes(group.key) + estimateRowBytes(group.deltas) +
+                      group.valueDeltas.size() * sizeof(int64_t);
+        groupsByHash.emplace(hashKey(row.values, keyColumns), groups.size());
+        groups.push_back(std::move(group));
+    }
+
+    // SUM skips NULLs; an integer sum that overflows turns real and then
+    // fails to fit its column
+    Group& group = groups[found];
+    group.count += sign;
+    for (size_t i = 0; i < aggregates.size(); i++) {
+        const Aggregate& aggregate = aggregates[i];
+        Value& delta = group.deltas[i];
+        if (aggregate.baseColumn == -1) {
+            delta = Value::integer(delta.asInteger() + sign);
+            continue;
+        }
+        const Value& value = row.values[aggregate.baseColumn];
+        if (value.isNull()) {
+            continue;
+        }
+        Value sum;
+        if (Value::arithmetic(delta, sign > 0 ? '+' : '-', value, sum)) {
+            delta = std::move(sum);
+        }
+        group.valueDeltas[i] += sign;
+    }
+}
+
+bool ViewDelta::apply(Transaction& txn, std::string& errorMessage) {
+    if (groups.empty()) {
+        return true;
+    }
+    Table& table = *view->table;
+    const std::string& viewName = view->definition->viewName;
+    std::string conflict = "Write conflict on materialized view " + viewName +
+                           ": a group was changed by a concurrent transaction";
+    if (!table.ensureLoaded()) {
+        errorMessage = "Failed to load table: " + viewName;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(view->maintenanceMutex);
+
+    // Add the changes to the groups that have a row: the aggregates, then
+    // the counts of non-NULL values
+    std::vector<std::string> names;
+    for (const Aggregate& aggregate : aggregates) {
+        names.push_back(table.getColumns()[aggregate.position].name);
+    }
+    for (const Aggregate& aggregate : aggregates) {
+        if (aggregate.valueCount != -1) {
+            names.push_back(table.getColumns()[aggregate.valueCount].name);
+        }
+    }
+
+    // A row that left its group and came back (UPDATE ... SET k = k)
+    // leaves it as it was
+    std::vector<bool> changed(groups.size(), false);
+    for (size_t i = 0; i < groups.size(); i++) {
+        const Group& group = groups[i];
+        changed[i] = group.count != 0 ||
+                     std::any_of(group.deltas.begin(), group.deltas.end(),
+                                 [](const Value& delta) { return delta.asReal() != 0; }) ||
+                     std::any_of(group.valueDeltas.begin(), group.valueDeltas.end(),
+                                 [](int64_t delta) { return delta != 0; });
+    }
+    std::vector<bool> existing(groups.size(), false);
+    bool emptied = false;
+    int current = -1;
+    auto inGroup = [this, &changed, &current](const Row& row) {
+        current = findGroup(row.values, keyPositions);
+        return current != -1 && changed[current];
+    };
+    auto compute = [&](const Row& row, std::vector<Value>& values) {
+        const Group& group = groups[current];
+        existing[current] = true;
+        if (row.values[countPosition].asInteger() + group.count == 0) {
+            emptied = true;
+        }
+        size_t next = aggregates.size();
+        for (size_t i = 0; i < aggregates.size(); i++) {
+            const Aggregate& aggregate = aggregates[i];
+            const Value& old = row.values[aggregate.position];
+            if (aggregate.valueCount == -1) {
+                Value::arithmetic(old, '+', group.deltas[i], values[i]);
+                continue;
+            }
+            int64_t valueCount = row.values[aggregate.valueCount].asInteger() + group.valueDeltas[i];
+            values[next++] = Value::integer(valueCount);
+            if (valueCount == 0) {
+                values[i] = Value::null();
+            } else if (old.isNull()) {
+                values[i] = group.deltas[i];
+            } else {
+                Value::arithmetic(old, '+', group.deltas[i], values[i]);
+            }
+        }
+    };
+    int updated = table.updateWhere(txn, names, compute, inGroup, errorMessage);
+    if (updated < 0) {
+        if (errorMessage.empty()) {
+            errorMessage = conflict;
+        } else {
+            errorMessage = "Failed to update materialized view " + viewName + ": " + errorMessage;
+        }
+        return false;
+    }
+
+    // Then the new groups, unless another transaction is adding them too
+    std::vector<bool> added(groups.size(), false);
+    bool adding = false;
+    for (size_t i = 0; i < groups.size(); i++) {
+        added[i] = !existing[i] && groups[i].count > 0;
+        adding |= added[i];
+    }
+    auto isAdded = [this, &added](const Row& row) {
+        int group = findGroup(row.values, keyPositions);
+        return group != -1 && added[group];
+    };
+    if (adding && table.hasConcurrentMatch(txn, isAdded)) {
+        errorMessage = conflict;
+        return false;
+    }
+    std::vector<Value> values(table.getColumns().size());
+    for (size_t i = 0; i < groups.size(); i++) {
+        if (!added[i]) {
+            continue;
+        }
+        for (size_t k = 0; k < keyPositions.size(); k++) {
+            values[keyPositions[k]] = groups[i].key[k];
+        }
+        for (size_t a = 0; a < aggregates.size(); a++) {
+            const Aggregate& aggregate = aggregates[a];
+            values[aggregate.position] = groups[i].deltas[a];
+            if (aggregate.valueCount == -1) {
+                continue;
+            }
+            int64_t valueCount = groups[i].valueDeltas[a];
+            values[aggregate.valueCount] = Value::integer(valueCount);
+            if (valueCount == 0) {
+                values[aggregate.position] = Value::null();
+            }
+        }
+        if (!table.insertRow(txn, values, errorMessage)) {
+            errorMessage = "Failed to update materialized view " + viewName + ": " + errorMessage;
+            return false;
+        }
+    }
+
+    // Groups whose last row went away have no row in the view
+    if (emptied) {
+        int deleted = table.deleteWhere(txn, [this](const Row& row) {
+            return row.values[countPosition].asInteger() == 0 &&
+                   findGroup(row.values, keyPositions) != -1;
+        });
+        if (deleted < 0) {
+            errorMessage = conflict;
+            return false;
+        }
+    }
+    return true;
+}
+
+int ViewDelta::findGroup(const std::vector<Value>& values, const std::vector<size_t>& positions) const {
+    auto range = groupsByHash.equal_range(hashKey(values, positions));
+    for (auto it = range.first; it != range.second; ++it) {
+        const std::vector<Value>& key = groups[it->second].key;
+        bool same = true;
+        for (size_t i = 0; i < positions.size() && same; i++) {
+            same = values[positions[i]] == key[i];
+        }
+        if (same) {
+            return static_cast<int>(it->second);
+        }
+    }
+    return -1;
+}
+
+uint64_t ViewDelta::hashKey(const std::vector<Value>& values, const std::vector<size_t>& positions) {
+    uint64_t hash = 0;
+    for (size_t position : positions) {
+        const Value& value = values[position];
+        hash = hash * 0x9e3779b97f4a7c15ULL + (value.isNull() ? 0 : BloomFilter::hash(value));
+    }
+    return hash;
+}
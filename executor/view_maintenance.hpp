@@ -0,0 +1,82 @@
+#ifndef VIEW_MAINTENANCE_HPP
+#define VIEW_MAINTENANCE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../storage/catalog.hpp"
+#include "./compiled_expression.hpp"
+
+/**
+ * Changes to the groups of one materialized view, collected from the rows
+ * a statement inserts into and deletes from the view's base table (an
+ * update is both) and then applied to the view's table in the statement's
+ * transaction. Only the groups the rows fall in are rewritten, so the
+ * cost follows the rows written and the number of groups, never the size
+ * of the base table.
+ */
+class ViewDelta {
+public:
+    // Check a view definition against its base table and give the columns
+    // of the view's table: the GROUP BY columns with their types, COUNT(*)
+    // as INTEGER and each SUM with the type of its column, then for each
+    // SUM an INTEGER <name>_count of the non-NULL values it adds up
+    static bool viewColumns(const CreateViewStatement& definition, const Table& base,
+                            std::vector<ColumnDefinition>& columns, std::string& errorMessage);
+
+    // Bind the view to its base table; fails like viewColumns
+    bool bind(std::shared_ptr<MaterializedView> view, const Table& base, std::string& errorMessage);
+
+    // Whether changing these base table columns can change the view
+    bool dependsOn(const std::vector<std::string>& columnNames) const;
+
+    // Count a base table row in (sign 1) or out (sign -1) of its group,
+    // unless the view's WHERE rejects it
+    void add(const Row& row, int sign);
+
+    // Rewrite the changed groups, add new ones and delete emptied ones.
+    // Fails on a write conflict with another transaction changing the
+    // same groups, or if a sum no longer fits its column.
+    bool apply(Transaction& txn, std::string& errorMessage);
+
+    // Estimated bytes of the groups collected so far
+    uint64_t bytes() const { return groupBytes; }
+
+private:
+    // A COUNT(*) or SUM column of the view
+    struct Aggregate {
+        size_t position;    // In the view's table
+        int baseColumn;     // Summed column of the base table; -1 for COUNT(*)
+        TokenType type;
+        int valueCount;     // Its count of non-NULL values in the view's table;
+                            // -1 for COUNT(*) and views created without it
+    };
+
+    // One group's key and the changes to its count and aggregates
+    struct Group {
+        std::vector<Value> key;
+        int64_t count = 0;
+        std::vector<Value> deltas;         // One per aggregate
+        std::vector<int64_t> valueDeltas;  // Non-NULL values, one per aggregate
+    };
+
+    std::shared_ptr<MaterializedView> view;
+    std::unique_ptr<CompiledExpression> filter;
+    std::vector<size_t> keyColumns;    // GROUP BY columns in the base table
+    std::vector<size_t> keyPositions;  // Same columns in the view's table
+    std::vector<Aggregate> aggregates;
+    size_t countPosition = 0;          // First COUNT(*) in the view's table
+    std::vector<std::string> referenced;  // Base table columns the view reads
+
+    std::vector<Group> groups;
+    std::unordered_multimap<uint64_t, size_t> groupsByHash;
+    uint64_t groupBytes = 0;
+
+    // The group of the key at these positions of a row, or -1
+    int findGroup(const std::vector<Value>& values, const std::vector<size_t>& positions) const;
+    static uint64_t hashKey(const std::vector<Value>& values, const std::vector<size_t>& positions);
+};
+
+#endif // VIEW_MAINTENANCE_HPP
@@ -0,0 +1,67 @@
+#include "./appender.hpp"
+
+Appender::Appender(std::unique_ptr<Session> session, const std::string& tableName,
+                   size_t columnCount)
+    : session(std::move(session)), tableName(tableName), columnCount(columnCount) {
+    current.reserve(columnCount);
+}
+
+Appender::~Appender() {
+    flush();
+}
+
+void Appender::appendInteger(int64_t value) {
+    current.push_back(Value::integer(value));
+}
+
+void Appender::appendReal(double value) {
+    current.push_back(Value::real(value));
+}
+
+void Appender::appendText(std::string_view value) {
+    current.push_back(Value::text(value));
+}
+
+void Appender::appendNull() {
+    current.emplace_back();
+}
+
+void Appender::appendValue(Value value) {
+    current.push_back(std::move(value));
+}
+
+bool Appender::endRow() {
+    bool ok = appendRow(std::move(current));
+    current.clear();
+    current.reserve(columnCount);
+    return ok;
+}
+
+bool Appender::appendRow(std::vector<Value> values) {
+    if (values.size() != columnCount) {
+        errorMessage = "Table " + tableName + " has " + std::to_string(columnCount) +
+                       " columns but " + std::to_string(values.size()) + " values were supplied";
+        return false;
+    }
+    rows.push_back(std::move(values));
+    if (rows.size() >= BATCH_ROWS) {
+        return flush();
+    }
+    return true;
+}
+
+bool Appender::flush() {
+    if (rows.empty()) {
+        return true;
+    }
+
+    size_t count = rows.size();
+    ExecutionResult result = session->append(tableName, rows);
+    rows.clear();
+    if (!result.success) {
+        errorMessage = result.errorMessage;
+        return false;
+    }
+    appended += count;
+    return true;
+}
@@ -0,0 +1,68 @@
+#ifndef APPENDER_HPP
+#define APPENDER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../sql/value.hpp"
+#include "./session.hpp"
+
+/**
+ * Bulk loads one table without SQL. Values are given column by column or
+ * a row at a time, buffered, and appended BATCH_ROWS rows at a time in
+ * one transaction each, without tokenizing or parsing. Rows buffered
+ * when the appender is destroyed are appended then; call flush to see
+ * whether that worked. Not thread-safe; use one appender per thread.
+ */
+class Appender {
+public:
+    static const size_t BATCH_ROWS = 64 * 1024;
+
+    // Append to the table through the session, which the appender owns
+    Appender(std::unique_ptr<Session> session, const std::string& tableName, size_t columnCount);
+    ~Appender();
+
+    Appender(const Appender&) = delete;
+    Appender& operator=(const Appender&) = delete;
+
+    // The next value of the current row; converted to the column's type
+    // when the batch is appended
+    void appendInteger(int64_t value);
+    void appendReal(double value);
+    void appendText(std::string_view value);
+    void appendNull();
+    void appendValue(Value value);
+
+    // Finish the current row, appending the batch once it is full. False
+    // if the row has the wrong number of values (it is dropped) or the
+    // batch failed.
+    bool endRow();
+
+    // Same for a whole row
+    bool appendRow(std::vector<Value> values);
+
+    // Append the buffered rows now. If any does not fit the table, none of
+    // the batch is appended and the batch is dropped.
+    bool flush();
+
+    // Why the last call failed
+    const std::string& error() const { return errorMessage; }
+
+    // Rows appended so far, and rows buffered
+    uint64_t appendedRows() const { return appended; }
+    size_t pendingRows() const { return rows.size(); }
+
+private:
+    std::unique_ptr<Session> session;
+    std::string tableName;
+    size_t columnCount;
+
+    std::vector<std::vector<Value>> rows;
+    std::vector<Value> current;
+    uint64_t appended = 0;
+    std::string errorMessage;
+};
+
+#endif // APPENDER_HPP
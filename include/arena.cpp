@@ -0,0 +1,14 @@
+#include "./arena.hpp"
+
+std::pmr::memory_resource* longLivedPool() {
+    // Blocks up to 4 KiB come from per-size free lists, larger ones
+    // straight from the heap. Never destroyed, so objects released during
+    // static destruction (sessions of a global engine) can still return
+    // their memory.
+    static std::pmr::synchronized_pool_resource* pool = [] {
+        std::pmr::pool_options options;
+        options.largest_required_pool_block = 4096;
+        return new std::pmr::synchronized_pool_resource(options);
+    }();
+    return pool;
+}
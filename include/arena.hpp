@@ -0,0 +1,43 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+/**
+ * Scratch memory of one query. Tokens, bind state and other per-query
+ * buffers are bump-allocated, starting in an inline buffer, and released
+ * all at once when the arena goes out of scope; nothing is freed before.
+ * Not thread-safe: an arena belongs to the session running the query.
+ */
+class QueryArena {
+public:
+    static const size_t INLINE_BYTES = 8 * 1024;
+
+    QueryArena() : resource(inlineBuffer, sizeof(inlineBuffer)) {}
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    std::pmr::memory_resource* get() { return &resource; }
+
+private:
+    alignas(std::max_align_t) std::byte inlineBuffer[INLINE_BYTES];
+    std::pmr::monotonic_buffer_resource resource;  // Grows from the heap when the buffer is full
+};
+
+// Size-class pool for memory that outlives a query, such as parsed
+// statements kept by the parse cache. Thread-safe.
+std::pmr::memory_resource* longLivedPool();
+
+// make_shared for objects that outlive the query; control block and
+// object share one pool allocation
+template <typename T, typename... Args>
+std::shared_ptr<T> makePooled(Args&&... args) {
+    return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(longLivedPool()),
+                                   std::forward<Args>(args)...);
+}
+
+#endif // ARENA_HPP
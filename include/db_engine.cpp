@@ -1,28 +1,71 @@
 #include "../include/db_engine.hpp"
+#include "../include/string_utils.hpp"
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cstdio>
+
+// How often the checkpoint thread looks at the log size
+static const std::chrono::milliseconds AUTO_CHECKPOINT_POLL(200);
+
+// The last line of a database file: "CATALOG " and the catalog's offset
+// in 20 digits
+static const size_t CATALOG_TRAILER_BYTES = 29;
+
+// Rename over an existing file
+static bool replaceFile(const std::string& from, const std::string& to) {
+    if (std::rename(from.c_str(), to.c_str()) == 0) {
+        return true;
+    }
+    
+    // Windows refuses to rename over an existing file
+    std::remove(to.c_str());
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+// Removes a file when it goes out of scope, unless released first
+struct RemoveUnlessReleased {
+    std::string path;
+    bool released = false;
+    
+    ~RemoveUnlessReleased() {
+        if (!released) {
+            std::remove(path.c_str());
+        }
+    }
+};
 
 DBEngine::DBEngine() : isDatabaseOpen(false) {
-    parser = std::make_unique<Parser>();
-    executor = std::make_unique<Executor>();
+    workers = std::make_shared<ThreadPool>(std::thread::hardware_concurrency());
+    catalog.setTransactions(&transactionManager);
 }
 
 DBEngine::~DBEngine() {
-    // Save tables and close database if open
-    if (isDatabaseOpen) {
-        // Implementation for saving database state would go here
-    }
+    stopMetricsDump();
+    closeDatabase();
 }
 
 bool DBEngine::openDatabase(const std::string& filename) {
     // Close previous database if open
-    if (isDatabaseOpen) {
-        // Save current state
-        tables.clear();
+    closeDatabase();
+    
+    // A checkpoint that was written completely but not swapped in yet
+    // already covers the archived log
+    std::string newFilename = filename + ".new";
+    std::string archive = filename + "-wal.1";
+    if (std::ifstream(newFilename, std::ios::binary).is_open()) {
+        std::remove(archive.c_str());
+        if (!replaceFile(newFilename, filename)) {
+            return false;
+        }
     }
     
     // Try to open the database file
+    databaseFile = std::make_shared<DatabaseFile>();
+    databaseFile->path = filename;
+    databaseFile->decoders = workers;
     std::ifstream file(filename, std::ios::binary);
+    int formatVersion = Table::FORMAT_VERSION;
     if (!file.is_open()) {
         // If the file doesn't exist, create a new one
         std::ofstream newFile(filename, std::ios::binary);
@@ -30,39 +73,531 @@ bool DBEngine::openDatabase(const std::string& filename) {
             return false;
         }
         newFile.close();
-        
-        // New empty database
-        databaseFilename = filename;
-        isDatabaseOpen = true;
-        return true;
+    } else if (!loadTables(file, formatVersion)) {
+        catalog.clear();
+        return false;
     }
+    file.close();
     
-    // Read database file and load table metadata
-    // This is a simplified version - a real implementation would 
-    // read the database file format and load all tables
+    // Re-apply transactions committed since the last checkpoint, older
+    // ones first; the logs were written by the same version as the file
+    std::string walPath = filename + "-wal";
+    auto apply = [this, formatVersion](const std::vector<std::string>& records) {
+        return applyLogRecords(records, formatVersion);
+    };
+    bool replayed = WriteAheadLog::replay(archive, apply) && WriteAheadLog::replay(walPath, apply);
+    if (!replayed || !preloadTables() || !wal.open(walPath)) {
+        catalog.clear();
+        return false;
+    }
+    
+    // From now on every commit goes through the log
+    transactionManager.setLog(&wal);
+    catalog.setLog(&wal);
     
     databaseFilename = filename;
+    memoryBudget.setSpillPrefix(filename + "-spill");
     isDatabaseOpen = true;
     
-    // For now, we'll just create an empty database
+    checkpointStopping = false;
+    checkpointThread = std::thread([this]() { runCheckpoints(); });
+    
+    // Rewrite older files right away, so the log never mixes row formats
+    if (formatVersion != Table::FORMAT_VERSION) {
+        return saveDatabase();
+    }
+    return true;
+}
+
+bool DBEngine::saveDatabase() {
+    if (!isDatabaseOpen) {
+        return false;
+    }
+    
+    // A checkpoint already running may have taken its snapshot before the
+    // caller's last commit, so wait for one that starts after this call
+    std::unique_lock<std::mutex> lock(checkpointMutex);
+    uint64_t ticket = ++checkpointsRequested;
+    checkpointWakeup.notify_all();
+    checkpointWakeup.wait(lock, [this, ticket]() {
+        return checkpointsDone >= ticket || checkpointStopping;
+    });
+    return checkpointsDone >= ticket && lastCheckpointOk;
+}
+
+void DBEngine::setAutoCheckpoint(uint64_t logBytes) {
+    autoCheckpointBytes = logBytes;
+}
+
+void DBEngine::runCheckpoints() {
+    std::unique_lock<std::mutex> lock(checkpointMutex);
+    while (true) {
+        checkpointWakeup.wait_for(lock, AUTO_CHECKPOINT_POLL, [this]() {
+            return checkpointStopping || checkpointsRequested > checkpointsDone;
+        });
+        if (checkpointStopping) {
+            return;
+        }
+        
+        uint64_t limit = autoCheckpointBytes;
+        if (checkpointsRequested == checkpointsDone && (limit == 0 || wal.size() < limit)) {
+            continue;
+        }
+        
+        uint64_t target = checkpointsRequested;
+        lock.unlock();
+        bool ok = checkpoint();
+        lock.lock();
+        
+        checkpointsDone = target;
+        lastCheckpointOk = ok;
+        checkpointWakeup.notify_all();
+    }
+}
+
+void DBEngine::stopCheckpoints() {
+    if (!checkpointThread.joinable()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(checkpointMutex);
+        checkpointStopping = true;
+    }
+    checkpointWakeup.notify_all();
+    checkpointThread.join();
+}
+
+bool DBEngine::checkpoint() {
+    // The snapshot must hold exactly the commits in the archived log, so
+    // no commit may run in between. This is the only part of a checkpoint
+    // that holds up other queries.
+    std::unique_ptr<Transaction> snapshot;
+    std::vector<std::shared_ptr<Table>> tables;
+    std::vector<std::vector<IndexDefinition>> indexes;
+    std::vector<std::string> views;
+    std::vector<std::string> partitioning;
+    {
+        auto pause = wal.pauseCommits();
+        if (!wal.archive(archivePath())) {
+            return false;
+        }
+        snapshot = transactionManager.begin();
+        tables = catalog.list();
+        for (const auto& table : tables) {
+            indexes.push_back(table->indexDefinitions());
+        }
+        for (const auto& view : catalog.listViews()) {
+            views.push_back(view->definition->toString());
+        }
+        for (const auto& scheme : catalog.listPartitioned()) {
+            partitioning.push_back(scheme->encode());
+        }
+    }
+    
+    // The open snapshot keeps garbage collection from dropping the
+    // versions it sees
+    bool ok = writeSnapshot(*snapshot, tables, indexes, views, partitioning);
+    transactionManager.rollback(*snapshot);
+    return ok;
+}
+
+bool DBEngine::writeSnapshot(const Transaction& snapshot,
+                             const std::vector<std::shared_ptr<Table>>& tables,
+                             const std::vector<std::vector<IndexDefinition>>& indexes,
+                             const std::vector<std::string>& views,
+                             const std::vector<std::string>& partitioning) {
+    // Write to a temporary file, so a crash mid-save leaves the previous
+    // checkpoint intact. Once renamed to .new the file is complete and on
+    // disk, and covers the archived log (see openDatabase).
+    std::string tempFilename = databaseFilename + ".tmp";
+    std::string newFilename = databaseFilename + ".new";
+    uint64_t bytes = 0;
+    std::vector<StoredSection> sections(tables.size());
+    
+    // A failed write leaves no temporary file behind; the writer closes it
+    // first, as it goes out of scope before the guard
+    RemoveUnlessReleased tempFile{tempFilename};
+    {
+        SnapshotWriter writer(tempFilename);
+        if (!writer.isOpen()) {
+            return false;
+        }
+        writer.write("MINIDB " + std::to_string(Table::FORMAT_VERSION) + "\n");
+        
+        // Table sections, then the catalog of their definitions and
+        // positions, so an open reads only the catalog
+        std::string catalogText = std::to_string(tables.size()) + "\n";
+        for (size_t i = 0; i < tables.size(); i++) {
+            if (!tables[i]->saveToFile(snapshot, writer, sections[i])) {
+                return false;
+            }
+            catalogText += std::to_string(sections[i].offset) + " " +
+                           std::to_string(sections[i].length) + " " +
+                           std::to_string(sections[i].rowCount) + " " +
+                           tables[i]->encodeSchema() + "\n";
+        }
+        
+        // Then the indexes, rebuilt as the rows load
+        std::string indexText;
+        size_t indexCount = 0;
+        for (size_t i = 0; i < tables.size(); i++) {
+            for (const auto& index : indexes[i]) {
+                indexText += tables[i]->getName() + " " + index.encode() + "\n";
+                indexCount++;
+            }
+        }
+        catalogText += std::to_string(indexCount) + "\n" + indexText;
+        
+        // And the views, whose tables are listed with the others
+        catalogText += std::to_string(views.size()) + "\n";
+        for (const auto& view : views) {
+            catalogText += escapeLineBreaks(view) + "\n";
+        }
+        
+        // And how partitioned tables spread over theirs, a line each
+        catalogText += std::to_string(partitioning.size()) + "\n";
+        for (const auto& scheme : partitioning) {
+            catalogText += scheme + "\n";
+        }
+        
+        char trailer[CATALOG_TRAILER_BYTES + 1];
+        std::snprintf(trailer, sizeof(trailer), "CATALOG %020llu\n",
+                      static_cast<unsigned long long>(writer.size()));
+        writer.write(catalogText);
+        writer.write(trailer, CATALOG_TRAILER_BYTES);
+        bytes = writer.size();
+        if (!writer.finish()) {
+            return false;
+        }
+    }
+    
+    if (!replaceFile(tempFilename, newFilename)) {
+        return false;
+    }
+    tempFile.released = true;
+    std::remove(archivePath().c_str());
+    
+    // Tables not loaded yet read from the new file from now on
+    {
+        std::unique_lock<std::shared_mutex> fileLock(databaseFile->latch);
+        if (!replaceFile(newFilename, databaseFilename)) {
+            return false;
+        }
+        for (size_t i = 0; i < tables.size(); i++) {
+            tables[i]->moveStored(sections[i]);
+        }
+    }
+    
+    metrics.add(Counter::CHECKPOINTS);
+    metrics.add(Counter::CHECKPOINT_BYTES, bytes);
+    return true;
+}
+
+void DBEngine::closeDatabase() {
+    if (!isDatabaseOpen) {
+        return;
+    }
+    
+    // Sessions roll back transactions that were never committed
+    threadSessions.clear();
+    
+    // Checkpoint so the next open does not need to replay the log
+    stopCheckpoints();
+    checkpoint();
+    
+    transactionManager.setLog(nullptr);
+    catalog.setLog(nullptr);
+    wal.close();
+    catalog.clear();
+    resultCache.clear();
+    databaseFile.reset();
+    isDatabaseOpen = false;
+}
+
+bool DBEngine::loadTables(std::ifstream& file, int& formatVersion) {
+    // A freshly created database file is empty
+    std::string header;
+    if (!std::getline(file, header)) {
+        return true;
+    }
+    if (header == "MINIDB 1") {
+        formatVersion = 1;
+    } else if (header == "MINIDB 2") {
+        formatVersion = 2;
+    } else if (header == "MINIDB 3" || header == "MINIDB 4" || header == "MINIDB 5" ||
+               header == "MINIDB 6" || header == "MINIDB 7" || header == "MINIDB 8" ||
+               header == "MINIDB 9") {
+        formatVersion = header.back() - '0';
+        return loadCatalog(file, formatVersion);
+    } else {
+        return false;
+    }
+    
+    size_t tableCount = 0;
+    file >> tableCount;
+    file.ignore();  // Skip newline
+    
+    for (size_t i = 0; i < tableCount; i++) {
+        std::unique_ptr<Table> table = Table::loadFromFile(file, formatVersion);
+        std::string errorMessage;
+        if (!table || !file || !catalog.add(std::move(table), errorMessage)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool DBEngine::preloadTables() {
+    if (!preload) {
+        return true;
+    }
+    
+    // Tables load in parallel, and each spreads its chunks over the same
+    // pool; a bad checksum fails the open
+    auto tables = catalog.list();
+    std::atomic<bool> ok{true};
+    workers->parallelFor(tables.size(), [&tables, &ok](size_t i) {
+        if (!tables[i]->ensureLoaded()) {
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+bool DBEngine::loadCatalog(std::ifstream& file, int formatVersion) {
+    // Find the catalog through the trailer
+    file.seekg(0, std::ios::end);
+    std::streamoff fileSize = file.tellg();
+    if (fileSize < static_cast<std::streamoff>(CATALOG_TRAILER_BYTES)) {
+        return false;
+    }
+    file.seekg(fileSize - static_cast<std::streamoff>(CATALOG_TRAILER_BYTES));
+    std::string label;
+    uint64_t catalogOffset = 0;
+    if (!(file >> label >> catalogOffset) || label != "CATALOG" ||
+        catalogOffset > static_cast<uint64_t>(fileSize)) {
+        return false;
+    }
+    file.seekg(static_cast<std::streamoff>(catalogOffset));
+    
+    size_t tableCount = 0;
+    file >> tableCount;
+    file.ignore();  // Skip newline
+    
+    // Only definitions are read here; rows load on first access
+    for (size_t i = 0; i < tableCount; i++) {
+        StoredSection section;
+        section.chunked = formatVersion >= 4;
+        std::string schema;
+        file >> section.offset >> section.length >> section.rowCount;
+        file.ignore();  // Skip the space
+        if (!std::getline(file, schema) || section.offset + section.length > catalogOffset) {
+            return false;
+        }
+        
+        std::unique_ptr<Table> table = Table::fromSchema(schema);
+        std::string errorMessage;
+        if (!table) {
+            return false;
+        }
+        table->setStored(databaseFile, section);
+        if (!catalog.add(std::move(table), errorMessage)) {
+            return false;
+        }
+    }
+    
+    // Version 5 lists the indexes after the tables, all trigram; 6 adds
+    // their method and false positive rate
+    size_t indexCount = 0;
+    if (formatVersion >= 5 && !(file >> indexCount)) {
+        return false;
+    }
+    for (size_t i = 0; i < indexCount; i++) {
+        std::string tableName;
+        IndexDefinition index;
+        std::string errorMessage;
+        if (!(file >> tableName >> index.name >> index.column) ||
+            (formatVersion >= 6 && !(file >> index.method >> index.falsePositiveRate)) ||
+            !catalog.addIndex(tableName, index, errorMessage)) {
+            return false;
+        }
+    }
+    
+    // Version 7 ends with the view definitions, one per line
+    size_t viewCount = 0;
+    if (formatVersion >= 7 && !(file >> viewCount)) {
+        return false;
+    }
+    file.ignore();  // Skip newline
+    for (size_t i = 0; i < viewCount; i++) {
+        std::string definition;
+        if (!std::getline(file, definition) || !restoreView(unescapeLineBreaks(definition))) {
+            return false;
+        }
+    }
+    
+    // Version 8 adds the partitioning of partitioned tables, whose
+    // partitions are listed with the other tables
+    size_t schemeCount = 0;
+    if (formatVersion >= 8 && !(file >> schemeCount)) {
+        return false;
+    }
+    file.ignore();  // Skip newline
+    for (size_t i = 0; i < schemeCount; i++) {
+        std::string encoded;
+        std::string errorMessage;
+        if (!std::getline(file, encoded) ||
+            !catalog.restorePartitioning(encoded, errorMessage)) {
+            return false;
+        }
+    }
+    
     return true;
 }
 
+bool DBEngine::restoreView(const std::string& definition) {
+    Parser parser;
+    ParseResult parsed = parser.parse(definition);
+    if (!parsed.success || parsed.statement->type != Statement::Type::CREATE_VIEW) {
+        return false;
+    }
+    
+    auto view = std::make_shared<MaterializedView>();
+    view->definition = std::static_pointer_cast<CreateViewStatement>(parsed.statement);
+    view->table = catalog.find(view->definition->viewName);
+    std::string errorMessage;
+    return view->table != nullptr && catalog.addView(view, errorMessage);
+}
+
+bool DBEngine::applyLogRecords(const std::vector<std::string>& records, int formatVersion) {
+    auto txn = transactionManager.begin();
+    
+    for (const std::string& record : records) {
+        if (record.size() < 2) {
+            continue;
+        }
+        
+        char kind = record[0];
+        std::string rest = record.substr(2);
+        
+        if (kind == 'T') {
+            auto table = Table::fromSchema(rest);
+            std::string errorMessage;
+            if (!table || !catalog.add(std::move(table), errorMessage)) {
+                transactionManager.rollback(*txn);
+                return false;
+            }
+            continue;
+        }
+        
+        if (kind == 'V') {
+            if (!restoreView(unescapeLineBreaks(rest))) {
+                transactionManager.rollback(*txn);
+                return false;
+            }
+            continue;
+        }
+        
+        if (kind == 'P') {
+            std::string errorMessage;
+            if (!catalog.restorePartitioning(rest, errorMessage)) {
+                transactionManager.rollback(*txn);
+                return false;
+            }
+            continue;
+        }
+        
+        // X <table> <index> <column> <method> <rate>; older records stop
+        // at the column and are trigram indexes
+        if (kind == 'X') {
+            std::istringstream fields(rest);
+            std::string tableName;
+            IndexDefinition index;
+            std::string errorMessage;
+            std::string method;
+            bool parsed = static_cast<bool>(fields >> tableName >> index.name >> index.column);
+            if (parsed && fields >> method) {
+                index.method = method;
+                parsed = static_cast<bool>(fields >> index.falsePositiveRate);
+            }
+            if (!parsed || !catalog.addIndex(tableName, index, errorMessage)) {
+                transactionManager.rollback(*txn);
+                return false;
+            }
+            continue;
+        }
+        
+        // I/D <table> <row>
+        size_t space = rest.find(' ');
+        std::string tableName = rest.substr(0, space);
+        std::string row = space == std::string::npos ? "" : rest.substr(space + 1);
+        
+        std::shared_ptr<Table> table = catalog.find(tableName);
+        if (table == nullptr && tableName.find('#') != std::string::npos) {
+            // A partition dropped later in the log; its rows went with it
+            continue;
+        }
+        bool applied = table != nullptr &&
+            (kind == 'I' ? table->restoreRow(*txn, table->decodeRow(row, formatVersion))
+                         : table->deleteRow(*txn, table->decodeRow(row, formatVersion)));
+        if (!applied) {
+            transactionManager.rollback(*txn);
+            return false;
+        }
+    }
+    
+    return transactionManager.commit(*txn);
+}
+
 ExecutionResult DBEngine::executeQuery(const std::string& query) {
     if (!isDatabaseOpen) {
-        return ExecutionResult{false, "No database is open"};
+        return ExecutionResult{false, "No database is open", {}, {}};
     }
     
-    // Parse the SQL query
-    ParseResult parseResult = parser->parse(query);
-    if (!parseResult.success) {
-        return ExecutionResult{false, parseResult.errorMessage};
+    return threadSession().executeQuery(query);
+}
+
+ExecutionResult DBEngine::executeQuery(const std::string& query, ResultSink& sink,
+                                       std::optional<uint64_t> interruptsSeen) {
+    if (!isDatabaseOpen) {
+        return ExecutionResult{false, "No database is open", {}, {}};
     }
     
-    // Execute the parsed statement
-    ExecutionResult result = executor->execute(parseResult.statement, tables);
+    return threadSession().executeQuery(query, sink, interruptsSeen);
+}
+
+ExecutionResult DBEngine::executeScript(std::istream& input, ResultSink& sink,
+                                        std::optional<uint64_t> interruptsSeen) {
+    if (!isDatabaseOpen) {
+        return ExecutionResult{false, "No database is open", {}, {}};
+    }
+    
+    return threadSession().executeScript(input, sink, interruptsSeen);
+}
+
+std::unique_ptr<Session> DBEngine::createSession() {
+    return std::make_unique<Session>(catalog, transactionManager, &metrics, &resultCache,
+                                     workers.get(), &memoryBudget, &queries);
+}
+
+std::unique_ptr<Appender> DBEngine::createAppender(const std::string& tableName) {
+    std::shared_ptr<Table> table = catalog.find(tableName);
+    if (table == nullptr || catalog.isView(tableName)) {
+        return nullptr;
+    }
+    return std::make_unique<Appender>(createSession(), tableName, table->getColumns().size());
+}
+
+Session& DBEngine::threadSession() {
+    std::lock_guard<std::mutex> lock(sessionsMutex);
     
-    return result;
+    auto& session = threadSessions[std::this_thread::get_id()];
+    if (!session) {
+        session = createSession();
+    }
+    return *session;
 }
 
 void DBEngine::listTables() {
@@ -71,13 +606,95 @@ void DBEngine::listTables() {
         return;
     }
     
+    auto tables = catalog.list();
     if (tables.empty()) {
         std::cout << "No tables found" << std::endl;
         return;
     }
     
+    // Partitions are listed with their table, not on their own
     std::cout << "Tables:" << std::endl;
     for (const auto& table : tables) {
-        std::cout << "  " << table->getName() << std::endl;
+        if (table->getName().find('#') != std::string::npos) {
+            continue;
+        }
+        std::cout << "  " << table->getName();
+        if (auto scheme = catalog.partitioning(table->getName())) {
+            bool timeSeries = scheme->method == PartitionScheme::Method::TIMESERIES;
+            std::cout << " (" << scheme->partitions.size()
+                      << (timeSeries ? " segments)" : " partitions)");
+        }
+        std::cout << std::endl;
+    }
+}
+
+MetricsSnapshot DBEngine::getMetrics() const {
+    return metrics.snapshot();
+}
+
+std::vector<TableMemoryUsage> DBEngine::tableMemoryUsage() const {
+    std::vector<TableMemoryUsage> usage;
+    for (const auto& table : catalog.list()) {
+        usage.push_back(table->memoryUsage());
     }
-}
\ No newline at end of file
+    return usage;
+}
+
+void DBEngine::writeStats(std::ostream& out) const {
+    writeMetricsText(out, metrics.snapshot(), tableMemoryUsage());
+}
+
+void DBEngine::writePrometheusMetrics(std::ostream& out) const {
+    writeMetricsPrometheus(out, metrics.snapshot(), tableMemoryUsage());
+}
+
+bool DBEngine::dumpMetrics(const std::string& path) const {
+    // Scrapers never see a half-written file
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        writePrometheusMetrics(file);
+        if (!file) {
+            return false;
+        }
+    }
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+bool DBEngine::startMetricsDump(const std::string& path, std::chrono::seconds interval) {
+    stopMetricsDump();
+    if (!dumpMetrics(path)) {
+        return false;
+    }
+    
+    metricsDumpStopping = false;
+    metricsDumpThread = std::thread([this, path, interval]() {
+        std::unique_lock<std::mutex> lock(metricsDumpMutex);
+        while (!metricsDumpWakeup.wait_for(lock, interval, [this]() { return metricsDumpStopping; })) {
+            lock.unlock();
+            dumpMetrics(path);
+            lock.lock();
+        }
+    
+        // Final state on shutdown
+        lock.unlock();
+        dumpMetrics(path);
+    });
+    return true;
+}
+
+void DBEngine::stopMetricsDump() {
+    if (!metricsDumpThread.joinable()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(metricsDumpMutex);
+        metricsDumpStopping = true;
+    }
+    metricsDumpWakeup.notify_all();
+    metricsDumpThread.join();
+}
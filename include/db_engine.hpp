@@ -4,33 +4,210 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <optional>
+#include <ostream>
+#include <unordered_map>
 #include "../sql/parser.hpp"
 #include "../executor/executor.hpp"
 #include "../storage/table.hpp"
+#include "../storage/catalog.hpp"
+#include "../storage/transaction.hpp"
+#include "../storage/wal.hpp"
+#include "./session.hpp"
+#include "./appender.hpp"
+#include "./metrics.hpp"
+#include "./query_control.hpp"
+#include "./result_cache.hpp"
+#include "./thread_pool.hpp"
 
 /**
- * Main database engine class that coordinates the parser, executor, and storage
+ * Main database engine class that coordinates the parser, executor, and storage.
+ * Queries may be executed from many threads at once; each thread gets its
+ * own session unless it creates one explicitly.
  */
 class DBEngine {
 public:
     DBEngine();
     ~DBEngine();
     
-    // Open a database file
+    // Open a database file (not safe while queries are running)
     bool openDatabase(const std::string& filename);
     
-    // Execute a SQL query
+    // Checkpoint: write a snapshot of all committed data to the database
+    // file and drop the log records it covers. Commits pause only while
+    // the snapshot is taken; a background thread writes the file while
+    // queries keep running. Waits for the result.
+    bool saveDatabase();
+    
+    // Load every table while opening instead of on first use, several
+    // tables and chunks of large tables at a time (set before opening)
+    void setPreload(bool enabled) { preload = enabled; }
+    
+    // Checkpoint in the background whenever the write-ahead log grows
+    // past logBytes; 0 (the default) turns this off
+    void setAutoCheckpoint(uint64_t logBytes);
+    
+    // Keep the results of repeated SELECTs, up to this many bytes in all,
+    // and answer them again while their table is unchanged; 0 (the
+    // default) turns the cache off
+    void setResultCache(size_t bytes) { resultCache.setCapacity(bytes); }
+    
+    // Memory all running queries may hold at once for the rows they
+    // buffer, and each query on its own; 0 (the default) means no limit.
+    // Parallel scans spill their buffers to files next to the database
+    // beyond that; queries whose results do not fit fail.
+    void setMemoryLimit(uint64_t bytes) { memoryBudget.setLimit(bytes); }
+    void setQueryMemoryLimit(uint64_t bytes) { memoryBudget.setQueryLimit(bytes); }
+    
+    // Time each statement may run for before it fails and is rolled back;
+    // 0 (the default) means no limit
+    void setStatementTimeout(std::chrono::milliseconds timeout) {
+        queries.setStatementTimeout(timeout);
+    }
+    
+    // Queries running now in any session, with the ids cancel takes
+    std::vector<RunningQuery> runningQueries() const { return queries.running(); }
+    
+    // Stop a running query at its next block or batch of rows; the
+    // statement fails and leaves no changes behind. Thread-safe; false if
+    // no query has this id.
+    bool cancel(uint64_t queryId) { return queries.cancel(queryId); }
+    
+    // Cancel every running query; safe to call from a signal handler
+    void interrupt() { queries.interrupt(); }
+    
+    // Calls to interrupt so far. Passed to executeQuery or executeScript,
+    // a value read before they start makes an interrupt that comes while
+    // they set up the query cancel it too.
+    uint64_t interruptCount() const { return queries.interruptCount(); }
+    
+    // Execute a SQL query in the calling thread's session; the rows of
+    // the last result set are returned in the result
     ExecutionResult executeQuery(const std::string& query);
     
+    // Execute a SQL query, streaming its output into the sink
+    ExecutionResult executeQuery(const std::string& query, ResultSink& sink,
+                                 std::optional<uint64_t> interruptsSeen = std::nullopt);
+    
+    // Execute a script read from a stream, e.g. a large SQL dump, in the
+    // calling thread's session without reading it into memory first
+    ExecutionResult executeScript(std::istream& input, ResultSink& sink,
+                                  std::optional<uint64_t> interruptsSeen = std::nullopt);
+    
+    // Create an independent session, e.g. one per client connection
+    std::unique_ptr<Session> createSession();
+    
+    // Bulk load a table through its own session, bypassing SQL; nullptr
+    // if there is no such table or it is a materialized view
+    std::unique_ptr<Appender> createAppender(const std::string& tableName);
+    
     // List all tables in the database
     void listTables();
     
+    // Counters and statement latencies since the engine was created
+    MetricsSnapshot getMetrics() const;
+    
+    // Memory held by each table (walks all rows)
+    std::vector<TableMemoryUsage> tableMemoryUsage() const;
+    
+    // Human-readable metrics report, as printed by .stats
+    void writeStats(std::ostream& out) const;
+    
+    // Metrics in Prometheus text format
+    void writePrometheusMetrics(std::ostream& out) const;
+    
+    // Rewrite `path` with the Prometheus metrics every interval, from a
+    // background thread, until stopped or the engine is destroyed
+    bool startMetricsDump(const std::string& path, std::chrono::seconds interval);
+    void stopMetricsDump();
+    
 private:
     std::string databaseFilename;
     bool isDatabaseOpen;
-    std::unique_ptr<Parser> parser;
-    std::unique_ptr<Executor> executor;
-    std::vector<std::unique_ptr<Table>> tables;
+    
+    // Shared by all sessions
+    Catalog catalog;
+    TransactionManager transactionManager;
+    WriteAheadLog wal;
+    Metrics metrics;
+    ResultCache resultCache;
+    MemoryBudget memoryBudget;
+    QueryRegistry queries;
+    
+    // Implicit sessions used by executeQuery, one per calling thread
+    std::mutex sessionsMutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<Session>> threadSessions;
+    
+    Session& threadSession();
+    
+    // Periodic metrics dump
+    std::thread metricsDumpThread;
+    std::mutex metricsDumpMutex;
+    std::condition_variable metricsDumpWakeup;
+    bool metricsDumpStopping = false;
+    
+    // Write the Prometheus metrics to a file, replacing it atomically
+    bool dumpMetrics(const std::string& path) const;
+    
+    // Background checkpoints, run one at a time. saveDatabase waits for a
+    // checkpoint that started after its request.
+    std::thread checkpointThread;
+    std::mutex checkpointMutex;
+    std::condition_variable checkpointWakeup;
+    uint64_t checkpointsRequested = 0;
+    uint64_t checkpointsDone = 0;
+    bool lastCheckpointOk = true;
+    bool checkpointStopping = false;
+    std::atomic<uint64_t> autoCheckpointBytes{0};
+    
+    void runCheckpoints();
+    void stopCheckpoints();
+    
+    // Snapshot the committed data and archive the log with commits
+    // paused, then write the snapshot to the database file
+    bool checkpoint();
+    bool writeSnapshot(const Transaction& snapshot,
+                       const std::vector<std::shared_ptr<Table>>& tables,
+                       const std::vector<std::vector<IndexDefinition>>& indexes,
+                       const std::vector<std::string>& views,
+                       const std::vector<std::string>& partitioning);
+    
+    // Log records not yet covered by the database file while a checkpoint
+    // is written (or after it failed)
+    std::string archivePath() const { return databaseFilename + "-wal.1"; }
+    
+    // Tables opened from it read their rows from this file
+    std::shared_ptr<DatabaseFile> databaseFile;
+    
+    // Load the tables of a database file and report its format version
+    bool loadTables(std::ifstream& file, int& formatVersion);
+    
+    // Read the table, index, view and partitioning definitions of a file
+    // of version 3 up to Table::FORMAT_VERSION, leaving the rows in it
+    bool loadCatalog(std::ifstream& file, int formatVersion);
+    
+    // Make a loaded table the materialized view the SQL text defines
+    bool restoreView(const std::string& definition);
+    
+    // Load every table now if preloading is on
+    bool preloadTables();
+    
+    // Decodes tables and chunks of tables, and scans partitions, in
+    // parallel
+    std::shared_ptr<ThreadPool> workers;
+    bool preload = false;
+    
+    // Apply one committed transaction from the write-ahead log, written
+    // in the given row format
+    bool applyLogRecords(const std::vector<std::string>& records, int formatVersion);
+    
+    // Checkpoint and close the open database
+    void closeDatabase();
 };
 
-#endif // DB_ENGINE_HPP
\ No newline at end of file
+#endif // DB_ENGINE_HPP
@@ -0,0 +1,110 @@
+#include "./memory_budget.hpp"
+
+// "64 MB" for whole megabytes, otherwise bytes
+static std::string formatBytes(uint64_t bytes) {
+    if (bytes % (uint64_t(1) << 20) == 0) {
+        return std::to_string(bytes >> 20) + " MB";
+    }
+    return std::to_string(bytes) + " bytes";
+}
+
+bool MemoryBudget::tryReserve(uint64_t bytes) {
+    uint64_t current = used.load();
+    do {
+        uint64_t max = limit.load();
+        if (max != 0 && current + bytes > max) {
+            return false;
+        }
+    } while (!used.compare_exchange_weak(current, current + bytes));
+
+    uint64_t now = current + bytes;
+    uint64_t highest = peakUsed.load();
+    while (now > highest && !peakUsed.compare_exchange_weak(highest, now)) {
+    }
+    return true;
+}
+
+void MemoryBudget::release(uint64_t bytes) {
+    used.fetch_sub(bytes);
+}
+
+void MemoryBudget::setSpillPrefix(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(spillMutex);
+    spillPrefix = prefix;
+}
+
+std::string MemoryBudget::nextSpillPath() {
+    std::lock_guard<std::mutex> lock(spillMutex);
+    if (spillPrefix.empty()) {
+        return "";
+    }
+    return spillPrefix + "." + std::to_string(spillCount++);
+}
+
+MemoryReservation::MemoryReservation(MemoryBudget* budget) : budget(budget) {}
+
+MemoryReservation::~MemoryReservation() {
+    if (budget != nullptr) {
+        budget->release(reserved.load());
+    }
+}
+
+bool MemoryReservation::admit() const {
+    if (budget == nullptr || budget->getLimit() == 0) {
+        return true;
+    }
+    return budget->reserved() + CHUNK_BYTES <= budget->getLimit();
+}
+
+bool MemoryReservation::tryGrow(uint64_t bytes) {
+    if (budget == nullptr) {
+        return true;
+    }
+
+    // The query's own limit first, then the database's
+    uint64_t current = reserved.load();
+    do {
+        uint64_t max = budget->getQueryLimit();
+        if (max != 0 && current + bytes > max) {
+            queryLimitHit = true;
+            return false;
+        }
+    } while (!reserved.compare_exchange_weak(current, current + bytes));
+    if (!budget->tryReserve(bytes)) {
+        reserved.fetch_sub(bytes);
+        queryLimitHit = false;
+        return false;
+    }
+    return true;
+}
+
+bool MemoryReservation::grow(uint64_t bytes) {
+    if (!tryGrow(bytes)) {
+        isExhausted = true;
+        return false;
+    }
+    return true;
+}
+
+void MemoryReservation::shrink(uint64_t bytes) {
+    if (budget != nullptr) {
+        reserved.fetch_sub(bytes);
+        budget->release(bytes);
+    }
+}
+
+std::string MemoryReservation::errorMessage() const {
+    if (budget == nullptr) {
+        return "";
+    }
+    if (queryLimitHit) {
+        return "Out of memory: query exceeds its memory limit of " +
+               formatBytes(budget->getQueryLimit());
+    }
+    return "Out of memory: database memory limit of " + formatBytes(budget->getLimit()) +
+           " is in use by other queries";
+}
+
+std::string MemoryReservation::spillPath() {
+    return budget != nullptr ? budget->nextSpillPath() : "";
+}
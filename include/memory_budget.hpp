@@ -0,0 +1,94 @@
+#ifndef MEMORY_BUDGET_HPP
+#define MEMORY_BUDGET_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * Memory the running queries of a database may hold at once for the rows
+ * they buffer, and the share of it one query may take. Tables are not
+ * counted; a limit of 0 means no limit. Queries take their share through
+ * a MemoryReservation.
+ */
+class MemoryBudget {
+public:
+    void setLimit(uint64_t bytes) { limit.store(bytes); }
+    uint64_t getLimit() const { return limit.load(); }
+
+    void setQueryLimit(uint64_t bytes) { queryLimit.store(bytes); }
+    uint64_t getQueryLimit() const { return queryLimit.load(); }
+
+    // Take bytes from the budget, or return false if fewer are left
+    bool tryReserve(uint64_t bytes);
+    void release(uint64_t bytes);
+
+    // Bytes reserved now, and the most reserved at once
+    uint64_t reserved() const { return used.load(); }
+    uint64_t peak() const { return peakUsed.load(); }
+
+    // Files that queries spill rows to are named "<prefix>.<n>"; without
+    // a prefix nothing is spilled
+    void setSpillPrefix(const std::string& prefix);
+    std::string nextSpillPath();
+
+private:
+    std::atomic<uint64_t> limit{0};
+    std::atomic<uint64_t> queryLimit{0};
+    std::atomic<uint64_t> used{0};
+    std::atomic<uint64_t> peakUsed{0};
+
+    std::mutex spillMutex;
+    std::string spillPrefix;
+    uint64_t spillCount = 0;
+};
+
+/**
+ * One query's share of a budget, given back when the query finishes.
+ * Buffers grow it a chunk at a time rather than per row. Thread-safe, so
+ * the tasks of a parallel scan can share it.
+ */
+class MemoryReservation {
+public:
+    static constexpr uint64_t CHUNK_BYTES = 64 * 1024;
+
+    // Without a budget nothing is limited
+    explicit MemoryReservation(MemoryBudget* budget);
+    ~MemoryReservation();
+
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+    // Whether the database has a chunk left for a new query; queries are
+    // turned away before they start while it has not
+    bool admit() const;
+
+    // Reserve bytes more, unless the query's or the database's limit is
+    // in the way. grow then marks the reservation exhausted, which fails
+    // the query; tryGrow leaves the caller to spill instead.
+    bool tryGrow(uint64_t bytes);
+    bool grow(uint64_t bytes);
+    void shrink(uint64_t bytes);
+
+    bool exhausted() const { return isExhausted.load(); }
+
+    // Why the query was turned away or ran out of memory
+    std::string errorMessage() const;
+
+    // Rows operators wrote to disk instead of keeping in memory
+    void addSpilledRows(uint64_t rows) { spilled.fetch_add(rows); }
+    uint64_t spilledRows() const { return spilled.load(); }
+
+    // Path of a new spill file, or empty if the query may not spill
+    std::string spillPath();
+
+private:
+    MemoryBudget* budget;
+    std::atomic<uint64_t> reserved{0};
+    std::atomic<uint64_t> spilled{0};
+    std::atomic<bool> isExhausted{false};
+    std::atomic<bool> queryLimitHit{false};
+};
+
+#endif // MEMORY_BUDGET_HPP
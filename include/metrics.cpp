@@ -0,0 +1,361 @@
+#include "./metrics.hpp"
+#include <algorithm>
+#include <cstdio>
+
+// Counters of one thread. Only its own thread writes to a shard, so
+// updates are plain relaxed load/store pairs rather than read-modify-write.
+struct Metrics::Shard {
+    std::atomic<uint64_t> counters[COUNTER_COUNT]{};
+    std::atomic<uint64_t> statements[MAX_STATEMENT_TYPES]{};
+    std::atomic<uint64_t> errors[MAX_STATEMENT_TYPES]{};
+    std::atomic<uint64_t> latencySum[MAX_STATEMENT_TYPES]{};
+    std::atomic<uint64_t> latencyMax[MAX_STATEMENT_TYPES]{};
+    std::atomic<uint64_t> buckets[MAX_STATEMENT_TYPES][LatencyHistogram::BUCKET_COUNT]{};
+};
+
+static void bump(std::atomic<uint64_t>& value, uint64_t amount) {
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static uint64_t read(const std::atomic<uint64_t>& value) {
+    return value.load(std::memory_order_relaxed);
+}
+
+// Shard of the calling thread for the Metrics object it last recorded into
+namespace {
+struct ShardCache {
+    uint64_t owner = 0;
+    void* shard = nullptr;
+};
+thread_local ShardCache shardCache;
+std::atomic<uint64_t> nextInstanceId{1};
+}
+
+// Index of the highest set bit; value must not be 0
+static size_t highestBit(uint64_t value) {
+    size_t bit = 0;
+    for (size_t step = 32; step > 0; step /= 2) {
+        if (value >> step) {
+            value >>= step;
+            bit += step;
+        }
+    }
+    return bit;
+}
+
+size_t LatencyHistogram::bucketFor(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+
+    size_t exponent = highestBit(value);
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    size_t shift = exponent - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    size_t shift = bucket / SUB_BUCKETS - 1;
+    uint64_t sub = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    add(bucketFor(value), 1);
+    sum += value;
+    if (value > max) {
+        max = value;
+    }
+}
+
+uint64_t LatencyHistogram::countAtMost(uint64_t value) const {
+    uint64_t count = 0;
+    for (size_t b = 0; b < BUCKET_COUNT && bucketUpperBound(b) <= value; b++) {
+        count += buckets[b];
+    }
+    return count;
+}
+
+uint64_t LatencyHistogram::percentile(double quantile) const {
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the value, 1-based
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKET_COUNT; b++) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(b), max);
+        }
+    }
+    return max;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t b = 0; b < BUCKET_COUNT; b++) {
+        buckets[b] += other.buckets[b];
+    }
+    total += other.total;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
+
+Metrics::Metrics() : instanceId(nextInstanceId++) {}
+
+Metrics::~Metrics() = default;
+
+Metrics::Shard& Metrics::localShard() {
+    if (shardCache.owner == instanceId) {
+        return *static_cast<Shard*>(shardCache.shard);
+    }
+
+    // First record from this thread, or it recorded elsewhere in between
+    std::lock_guard<std::mutex> lock(shardsMutex);
+    Shard*& shard = shardByThread[std::this_thread::get_id()];
+    if (shard == nullptr) {
+        shards.push_back(std::make_unique<Shard>());
+        shard = shards.back().get();
+    }
+    shardCache.owner = instanceId;
+    shardCache.shard = shard;
+    return *shard;
+}
+
+void Metrics::add(Counter counter, uint64_t amount) {
+    bump(localShard().counters[static_cast<size_t>(counter)], amount);
+}
+
+void Metrics::recordStatement(Statement::Type type, uint64_t latencyNs,
+                              const ExecutionResult& result) {
+    Shard& shard = localShard();
+    size_t t = static_cast<size_t>(type);
+
+    bump(shard.counters[static_cast<size_t>(Counter::STATEMENTS)], 1);
+    bump(shard.statements[t], 1);
+    bump(shard.latencySum[t], latencyNs);
+    bump(shard.buckets[t][LatencyHistogram::bucketFor(latencyNs)], 1);
+    if (latencyNs > read(shard.latencyMax[t])) {
+        shard.latencyMax[t].store(latencyNs, std::memory_order_relaxed);
+    }
+
+    if (!result.success) {
+        bump(shard.errors[t], 1);
+        bump(shard.counters[static_cast<size_t>(Counter::STATEMENT_ERRORS)], 1);
+        return;
+    }
+
+    bump(shard.counters[static_cast<size_t>(Counter::ROWS_SCANNED)], result.rowsScanned);
+    switch (type) {
+        case Statement::Type::SELECT:
+            bump(shard.counters[static_cast<size_t>(Counter::ROWS_RETURNED)], result.rowCount);
+            break;
+        case Statement::Type::INSERT:
+            bump(shard.counters[static_cast<size_t>(Counter::ROWS_INSERTED)], result.rowCount);
+            break;
+        case Statement::Type::UPDATE:
+            bump(shard.counters[static_cast<size_t>(Counter::ROWS_UPDATED)], result.rowCount);
+            break;
+        case Statement::Type::DELETE:
+            bump(shard.counters[static_cast<size_t>(Counter::ROWS_DELETED)], result.rowCount);
+            break;
+        default:
+            break;
+    }
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot snapshot;
+
+    std::lock_guard<std::mutex> lock(shardsMutex);
+    for (const auto& shard : shards) {
+        for (size_t c = 0; c < COUNTER_COUNT; c++) {
+            snapshot.counters[c] += read(shard->counters[c]);
+        }
+        for (size_t t = 0; t < MAX_STATEMENT_TYPES; t++) {
+            snapshot.statements[t] += read(shard->statements[t]);
+            snapshot.errors[t] += read(shard->errors[t]);
+
+            LatencyHistogram& histogram = snapshot.latency[t];
+            for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+                uint64_t count = read(shard->buckets[t][b]);
+                if (count > 0) {
+                    histogram.add(b, count);
+                }
+            }
+            histogram.sum += read(shard->latencySum[t]);
+            histogram.max = std::max(histogram.max, read(shard->latencyMax[t]));
+        }
+    }
+    return snapshot;
+}
+
+std::string statementTypeName(size_t type) {
+    switch (static_cast<Statement::Type>(type)) {
+        case Statement::Type::CREATE_TABLE: return "create_table";
+        case Statement::Type::INSERT: return "insert";
+        case Statement::Type::SELECT: return "select";
+        case Statement::Type::DELETE: return "delete";
+        case Statement::Type::UPDATE: return "update";
+        case Statement::Type::DROP_TABLE: return "drop_table";
+        case Statement::Type::BEGIN_TRANSACTION: return "begin";
+        case Statement::Type::COMMIT: return "commit";
+        case Statement::Type::ROLLBACK: return "rollback";
+        case Statement::Type::EXPLAIN: return "explain";
+        case Statement::Type::CREATE_INDEX: return "create_index";
+        case Statement::Type::CREATE_VIEW: return "create_view";
+        case Statement::Type::ALTER_TABLE: return "alter_table";
+    }
+    return "type_" + std::to_string(type);
+}
+
+static const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "queries", "statements", "statement_errors", "parse_errors", "rows_scanned",
+    "rows_returned", "rows_inserted", "rows_updated", "rows_deleted", "parse_cache_hits",
+    "parse_cache_misses", "result_cache_hits", "result_cache_misses", "checkpoints",
+    "checkpoint_bytes", "rows_spilled", "memory_limit_errors", "queries_cancelled",
+    "statement_timeouts"
+};
+
+static std::string formatUs(uint64_t ns) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f", static_cast<double>(ns) / 1000.0);
+    return text;
+}
+
+void writeMetricsText(std::ostream& out, const MetricsSnapshot& snapshot,
+                      const std::vector<TableMemoryUsage>& tables) {
+    out << "Counters:\n";
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        out << "  " << COUNTER_NAMES[c] << ": " << snapshot.counters[c] << "\n";
+    }
+
+    out << "Statements (latency in us):\n";
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %-14s %10s %8s %10s %10s %10s %10s\n",
+                  "type", "count", "errors", "p50", "p95", "p99", "max");
+    out << line;
+    for (size_t t = 0; t < MAX_STATEMENT_TYPES; t++) {
+        if (snapshot.statements[t] == 0) {
+            continue;
+        }
+        const LatencyHistogram& latency = snapshot.latency[t];
+        std::snprintf(line, sizeof(line), "  %-14s %10llu %8llu %10s %10s %10s %10s\n",
+                      statementTypeName(t).c_str(),
+                      static_cast<unsigned long long>(snapshot.statements[t]),
+                      static_cast<unsigned long long>(snapshot.errors[t]),
+                      formatUs(latency.percentile(0.50)).c_str(),
+                      formatUs(latency.percentile(0.95)).c_str(),
+                      formatUs(latency.percentile(0.99)).c_str(),
+                      formatUs(latency.max).c_str());
+        out << line;
+    }
+
+    out << "Table memory (bytes):\n";
+    std::snprintf(line, sizeof(line), "  %-20s %10s %12s %12s %12s\n",
+                  "table", "versions", "data", "indexes", "overhead");
+    out << line;
+    for (const auto& table : tables) {
+        std::snprintf(line, sizeof(line), "  %-20s %10llu %12llu %12llu %12llu\n",
+                      table.table.c_str(),
+                      static_cast<unsigned long long>(table.versions),
+                      static_cast<unsigned long long>(table.dataBytes),
+                      static_cast<unsigned long long>(table.indexBytes),
+                      static_cast<unsigned long long>(table.overheadBytes));
+        out << line;
+    }
+}
+
+// Label values may not contain unescaped quotes, backslashes or newlines
+static std::string labelValue(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+void writeMetricsPrometheus(std::ostream& out, const MetricsSnapshot& snapshot,
+                            const std::vector<TableMemoryUsage>& tables) {
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        std::string name = std::string("minidb_") + COUNTER_NAMES[c] + "_total";
+        out << "# TYPE " << name << " counter\n"
+            << name << " " << snapshot.counters[c] << "\n";
+    }
+
+    out << "# TYPE minidb_statements_by_type_total counter\n";
+    for (size_t t = 0; t < MAX_STATEMENT_TYPES; t++) {
+        if (snapshot.statements[t] > 0) {
+            out << "minidb_statements_by_type_total{type=\"" << statementTypeName(t) << "\"} "
+                << snapshot.statements[t] << "\n";
+        }
+    }
+
+    out << "# TYPE minidb_statement_errors_by_type_total counter\n";
+    for (size_t t = 0; t < MAX_STATEMENT_TYPES; t++) {
+        if (snapshot.statements[t] > 0) {
+            out << "minidb_statement_errors_by_type_total{type=\"" << statementTypeName(t) << "\"} "
+                << snapshot.errors[t] << "\n";
+        }
+    }
+
+    // Decade buckets derived from the fine-grained histogram
+    static const uint64_t BOUNDS_NS[] = {
+        1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000, 10000000000ULL
+    };
+    static const char* const BOUNDS[] = {
+        "1e-06", "1e-05", "0.0001", "0.001", "0.01", "0.1", "1", "10"
+    };
+    out << "# TYPE minidb_statement_duration_seconds histogram\n";
+    for (size_t t = 0; t < MAX_STATEMENT_TYPES; t++) {
+        if (snapshot.statements[t] == 0) {
+            continue;
+        }
+        const LatencyHistogram& latency = snapshot.latency[t];
+        std::string type = statementTypeName(t);
+        for (size_t b = 0; b < sizeof(BOUNDS_NS) / sizeof(BOUNDS_NS[0]); b++) {
+            out << "minidb_statement_duration_seconds_bucket{type=\"" << type
+                << "\",le=\"" << BOUNDS[b] << "\"} " << latency.countAtMost(BOUNDS_NS[b]) << "\n";
+        }
+        char sum[32];
+        std::snprintf(sum, sizeof(sum), "%.9f", static_cast<double>(latency.sum) / 1e9);
+        out << "minidb_statement_duration_seconds_bucket{type=\"" << type << "\",le=\"+Inf\"} "
+            << latency.count() << "\n"
+            << "minidb_statement_duration_seconds_sum{type=\"" << type << "\"} " << sum << "\n"
+            << "minidb_statement_duration_seconds_count{type=\"" << type << "\"} "
+            << latency.count() << "\n";
+    }
+
+    out << "# TYPE minidb_table_versions gauge\n";
+    for (const auto& table : tables) {
+        out << "minidb_table_versions{table=\"" << labelValue(table.table) << "\"} "
+            << table.versions << "\n";
+    }
+    out << "# TYPE minidb_table_memory_bytes gauge\n";
+    for (const auto& table : tables) {
+        std::string label = labelValue(table.table);
+        out << "minidb_table_memory_bytes{table=\"" << label << "\",kind=\"data\"} "
+            << table.dataBytes << "\n"
+            << "minidb_table_memory_bytes{table=\"" << label << "\",kind=\"indexes\"} "
+            << table.indexBytes << "\n"
+            << "minidb_table_memory_bytes{table=\"" << label << "\",kind=\"overhead\"} "
+            << table.overheadBytes << "\n";
+    }
+}
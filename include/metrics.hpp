@@ -0,0 +1,136 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../executor/executor.hpp"
+#include "../storage/table.hpp"
+
+// Engine-wide counters
+enum class Counter {
+    QUERIES,             // Calls to executeQuery
+    STATEMENTS,
+    STATEMENT_ERRORS,
+    PARSE_ERRORS,
+    ROWS_SCANNED,        // Row versions read by scans
+    ROWS_RETURNED,
+    ROWS_INSERTED,
+    ROWS_UPDATED,
+    ROWS_DELETED,
+    PARSE_CACHE_HITS,
+    PARSE_CACHE_MISSES,
+    RESULT_CACHE_HITS,
+    RESULT_CACHE_MISSES, // SELECTs looked up in an enabled cache and not found
+    CHECKPOINTS,
+    CHECKPOINT_BYTES,    // Bytes written by checkpoints
+    ROWS_SPILLED,        // Rows buffered on disk for want of query memory
+    MEMORY_LIMIT_ERRORS, // Queries failed or turned away by a memory limit
+    QUERIES_CANCELLED,   // Statements stopped by a cancel or interrupt
+    STATEMENT_TIMEOUTS,  // Statements stopped by the statement timeout
+    COUNT                // Number of counters, not a counter
+};
+
+constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::COUNT);
+
+// Statement::Type values are used as array indices
+constexpr size_t MAX_STATEMENT_TYPES = 16;
+static_assert(static_cast<size_t>(Statement::Type::ALTER_TABLE) < MAX_STATEMENT_TYPES,
+              "MAX_STATEMENT_TYPES is too small");
+
+/**
+ * Log-linear latency histogram in the style of HdrHistogram: every power
+ * of two is split into 16 linear sub-buckets, so any recorded value is
+ * off by at most 1/16 (about 6%) over the range of 1 ns to ~18 minutes.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t MAX_EXPONENT = 40;  // Larger values share the last bucket
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    // Bucket of a value and the largest value that falls into a bucket
+    static size_t bucketFor(uint64_t value);
+    static uint64_t bucketUpperBound(size_t bucket);
+
+    LatencyHistogram() : buckets(BUCKET_COUNT, 0) {}
+
+    void record(uint64_t value);
+    void add(size_t bucket, uint64_t count) { buckets[bucket] += count; total += count; }
+
+    uint64_t count() const { return total; }
+    uint64_t countAtMost(uint64_t value) const;
+
+    // Upper bound of the bucket holding the given quantile (0..1)
+    uint64_t percentile(double quantile) const;
+
+    void merge(const LatencyHistogram& other);
+
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+private:
+    std::vector<uint64_t> buckets;
+    uint64_t total = 0;
+};
+
+// Point-in-time copy of all metrics
+struct MetricsSnapshot {
+    uint64_t counters[COUNTER_COUNT] = {};
+    uint64_t statements[MAX_STATEMENT_TYPES] = {};
+    uint64_t errors[MAX_STATEMENT_TYPES] = {};
+    std::vector<LatencyHistogram> latency = std::vector<LatencyHistogram>(MAX_STATEMENT_TYPES);
+
+    uint64_t counter(Counter c) const { return counters[static_cast<size_t>(c)]; }
+};
+
+/**
+ * Engine metrics. Each thread records into its own shard with plain
+ * relaxed atomic stores, so recording takes no lock and never contends;
+ * snapshot() sums the shards.
+ */
+class Metrics {
+public:
+    Metrics();
+    ~Metrics();
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void add(Counter counter, uint64_t amount = 1);
+
+    // Record one executed statement: its type, latency and row counts
+    void recordStatement(Statement::Type type, uint64_t latencyNs, const ExecutionResult& result);
+
+    MetricsSnapshot snapshot() const;
+
+private:
+    struct Shard;
+
+    uint64_t instanceId;  // Identifies this object in the per-thread shard cache
+    mutable std::mutex shardsMutex;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::unordered_map<std::thread::id, Shard*> shardByThread;
+
+    Shard& localShard();
+};
+
+// Lowercase name of a statement type, e.g. "select"
+std::string statementTypeName(size_t type);
+
+// Human-readable report, as printed by .stats
+void writeMetricsText(std::ostream& out, const MetricsSnapshot& snapshot,
+                      const std::vector<TableMemoryUsage>& tables);
+
+// Prometheus text exposition format
+void writeMetricsPrometheus(std::ostream& out, const MetricsSnapshot& snapshot,
+                            const std::vector<TableMemoryUsage>& tables);
+
+#endif // METRICS_HPP
@@ -0,0 +1,271 @@
+#include "./minidb.h"
+#include "./db_engine.hpp"
+#include <filesystem>
+#include <map>
+#include <new>
+
+struct minidb {
+    // The shared database and its key, unless opening failed
+    DBEngine* engine = nullptr;
+    std::string path;
+    std::unique_ptr<Session> session;
+    std::string errorMessage;
+};
+
+struct minidb_appender {
+    std::unique_ptr<Appender> appender;
+    std::string errorMessage;
+};
+
+namespace {
+
+// A database open through the C API, shared by every handle on its file.
+// Two engines on one file would each write the log and checkpoint over
+// the other's commits.
+struct OpenDatabase {
+    DBEngine engine;
+    size_t handles = 0;
+};
+
+std::mutex openDatabasesMutex;
+std::map<std::string, std::unique_ptr<OpenDatabase>> openDatabases;
+
+// Hands each row to the C callback as text
+class CallbackSink : public ResultSink {
+public:
+    CallbackSink(minidb_row_callback callback, void* context)
+        : callback(callback), context(context) {}
+
+    void beginResult(const std::vector<std::string>& columnNames) override {
+        columns = columnNames;
+        names.clear();
+        for (const auto& name : columns) {
+            names.push_back(name.c_str());
+        }
+    }
+
+    void addRow(const std::vector<Value>& values) override {
+        if (callback == nullptr) {
+            return;
+        }
+        texts.resize(values.size());
+        pointers.resize(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            if (values[i].isNull()) {
+                pointers[i] = nullptr;
+            } else {
+                texts[i] = values[i].toString();
+                pointers[i] = texts[i].c_str();
+            }
+        }
+        callback(context, static_cast<int>(values.size()), pointers.data(), names.data());
+    }
+
+private:
+    minidb_row_callback callback;
+    void* context;
+    std::vector<std::string> columns;
+    std::vector<const char*> names;
+    std::vector<std::string> texts;
+    std::vector<const char*> pointers;
+};
+
+}
+
+// Exceptions must not unwind into C code: a throw fails the call
+template <typename Body>
+static int guarded(std::string& errorMessage, Body body) {
+    try {
+        return body();
+    } catch (const std::bad_alloc&) {
+        errorMessage = "Out of memory";
+    } catch (const std::exception& error) {
+        errorMessage = error.what();
+    } catch (...) {
+        errorMessage = "Unknown error";
+    }
+    return MINIDB_ERROR;
+}
+
+// Open the database of a file, or share it if a handle has it open
+static DBEngine* acquireDatabase(const std::string& path, std::string& key, std::string& errorMessage) {
+    // Different spellings of the path name the same database
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    std::string name = error ? path : canonical.string();
+
+    std::lock_guard<std::mutex> lock(openDatabasesMutex);
+    auto found = openDatabases.find(name);
+    if (found == openDatabases.end()) {
+        auto database = std::make_unique<OpenDatabase>();
+        if (!database->engine.openDatabase(name)) {
+            errorMessage = "Failed to open database file: " + path;
+            return nullptr;
+        }
+        found = openDatabases.emplace(name, std::move(database)).first;
+    }
+    found->second->handles++;
+    key = name;
+    return &found->second->engine;
+}
+
+static void releaseDatabase(const std::string& key) {
+    // Closed under the lock, so the file is not opened anew while the
+    // last handle's checkpoint is written
+    std::lock_guard<std::mutex> lock(openDatabasesMutex);
+    auto found = openDatabases.find(key);
+    if (found != openDatabases.end() && --found->second->handles == 0) {
+        openDatabases.erase(found);
+    }
+}
+
+int minidb_open(const char* path, minidb** db) {
+    minidb* handle = new (std::nothrow) minidb;
+    *db = handle;
+    if (handle == nullptr) {
+        return MINIDB_ERROR;
+    }
+    return guarded(handle->errorMessage, [&] {
+        if (path == nullptr) {
+            handle->errorMessage = "No database file given";
+            return MINIDB_ERROR;
+        }
+        handle->engine = acquireDatabase(path, handle->path, handle->errorMessage);
+        if (handle->engine == nullptr) {
+            return MINIDB_ERROR;
+        }
+        handle->session = handle->engine->createSession();
+        return MINIDB_OK;
+    });
+}
+
+void minidb_close(minidb* db) {
+    if (db == nullptr) {
+        return;
+    }
+    guarded(db->errorMessage, [db] {
+        // The session rolls back a transaction left open
+        db->session.reset();
+        if (db->engine != nullptr) {
+            releaseDatabase(db->path);
+        }
+        return MINIDB_OK;
+    });
+    delete db;
+}
+
+int minidb_exec(minidb* db, const char* sql, minidb_row_callback callback, void* context) {
+    return guarded(db->errorMessage, [&] {
+        if (db->session == nullptr) {
+            db->errorMessage = "No database is open";
+            return MINIDB_ERROR;
+        }
+        CallbackSink sink(callback, context);
+        ExecutionResult result = db->session->executeQuery(sql, sink);
+        if (!result.success) {
+            db->errorMessage = result.errorMessage;
+            return MINIDB_ERROR;
+        }
+        return MINIDB_OK;
+    });
+}
+
+void minidb_interrupt(minidb* db) {
+    if (db->session != nullptr) {
+        db->session->interrupt();
+    }
+}
+
+int minidb_checkpoint(minidb* db) {
+    return guarded(db->errorMessage, [db] {
+        if (db->engine == nullptr || !db->engine->saveDatabase()) {
+            db->errorMessage = "Failed to write the database file";
+            return MINIDB_ERROR;
+        }
+        return MINIDB_OK;
+    });
+}
+
+const char* minidb_errmsg(minidb* db) {
+    return db != nullptr ? db->errorMessage.c_str() : "Out of memory";
+}
+
+minidb_appender* minidb_appender_create(minidb* db, const char* table) {
+    minidb_appender* created = nullptr;
+    guarded(db->errorMessage, [&] {
+        if (db->engine == nullptr) {
+            db->errorMessage = "No database is open";
+            return MINIDB_ERROR;
+        }
+        if (table == nullptr) {
+            db->errorMessage = "No table given";
+            return MINIDB_ERROR;
+        }
+        std::unique_ptr<Appender> appender = db->engine->createAppender(table);
+        if (appender == nullptr) {
+            db->errorMessage = std::string("Table not found: ") + table;
+            return MINIDB_ERROR;
+        }
+        created = new minidb_appender{std::move(appender), ""};
+        return MINIDB_OK;
+    });
+    return created;
+}
+
+int minidb_append_int64(minidb_appender* appender, int64_t value) {
+    return guarded(appender->errorMessage, [&] {
+        appender->appender->appendInteger(value);
+        return MINIDB_OK;
+    });
+}
+
+int minidb_append_double(minidb_appender* appender, double value) {
+    return guarded(appender->errorMessage, [&] {
+        appender->appender->appendReal(value);
+        return MINIDB_OK;
+    });
+}
+
+int minidb_append_text(minidb_appender* appender, const char* value, size_t length) {
+    return guarded(appender->errorMessage, [&] {
+        appender->appender->appendText(std::string_view(value, length));
+        return MINIDB_OK;
+    });
+}
+
+int minidb_append_null(minidb_appender* appender) {
+    return guarded(appender->errorMessage, [&] {
+        appender->appender->appendNull();
+        return MINIDB_OK;
+    });
+}
+
+int minidb_appender_end_row(minidb_appender* appender) {
+    return guarded(appender->errorMessage, [&] {
+        if (!appender->appender->endRow()) {
+            appender->errorMessage = appender->appender->error();
+            return MINIDB_ERROR;
+        }
+        return MINIDB_OK;
+    });
+}
+
+int minidb_appender_flush(minidb_appender* appender) {
+    return guarded(appender->errorMessage, [&] {
+        if (!appender->appender->flush()) {
+            appender->errorMessage = appender->appender->error();
+            return MINIDB_ERROR;
+        }
+        return MINIDB_OK;
+    });
+}
+
+const char* minidb_appender_errmsg(minidb_appender* appender) {
+    return appender->errorMessage.c_str();
+}
+
+int minidb_appender_destroy(minidb_appender* appender) {
+    int result = minidb_appender_flush(appender);
+    delete appender;
+    return result;
+}
@@ -0,0 +1,80 @@
+#ifndef MINIDB_H
+#define MINIDB_H
+
+/*
+ * C interface of libminidb. A handle may be used from one thread at a
+ * time; open one per thread to run queries in parallel. Handles open on
+ * the same file in a process share one database, each with a session of
+ * its own. Functions that can fail return MINIDB_OK or MINIDB_ERROR, and
+ * the handle's errmsg function says why.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MINIDB_OK 0
+#define MINIDB_ERROR 1
+
+typedef struct minidb minidb;
+typedef struct minidb_appender minidb_appender;
+
+/* Open or create a database file and store a handle to it in *db. If
+ * the file cannot be opened the handle only reports why through
+ * minidb_errmsg; it is NULL only when out of memory. Either way it is
+ * freed with minidb_close. */
+int minidb_open(const char* path, minidb** db);
+
+/* Close the handle; the last one closed on a file checkpoints it */
+void minidb_close(minidb* db);
+
+/* Called once per result row. Values are NUL-terminated text, or NULL
+ * for SQL NULL, and are only valid during the call. */
+typedef void (*minidb_row_callback)(void* context, int columnCount,
+                                    const char* const* values,
+                                    const char* const* columnNames);
+
+/* Run one or more semicolon-separated statements, passing the rows of
+ * every result set to callback, which may be NULL */
+int minidb_exec(minidb* db, const char* sql, minidb_row_callback callback, void* context);
+
+/* Stop the statements running on the handle, which then fail with
+ * "Query cancelled" and leave no changes behind. Statements of other
+ * handles keep running. May be called from another thread or a signal
+ * handler. */
+void minidb_interrupt(minidb* db);
+
+/* Write all committed data to the database file */
+int minidb_checkpoint(minidb* db);
+
+/* Why the last failing call on the handle failed; db may be NULL */
+const char* minidb_errmsg(minidb* db);
+
+/* Bulk load a table without SQL; NULL if table is NULL or there is no
+ * such table. Values are given column by column and each row is finished
+ * with end_row. The appender must be destroyed before its database is
+ * closed. */
+minidb_appender* minidb_appender_create(minidb* db, const char* table);
+
+int minidb_append_int64(minidb_appender* appender, int64_t value);
+int minidb_append_double(minidb_appender* appender, double value);
+int minidb_append_text(minidb_appender* appender, const char* value, size_t length);
+int minidb_append_null(minidb_appender* appender);
+int minidb_appender_end_row(minidb_appender* appender);
+
+/* Append the buffered rows now */
+int minidb_appender_flush(minidb_appender* appender);
+
+const char* minidb_appender_errmsg(minidb_appender* appender);
+
+/* Append the buffered rows and free the appender */
+int minidb_appender_destroy(minidb_appender* appender);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MINIDB_H */
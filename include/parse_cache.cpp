@@ -0,0 +1,34 @@
+#include "./parse_cache.hpp"
+
+const std::vector<std::shared_ptr<Statement>>* ParseCache::find(const std::string& query) {
+    auto it = byQuery.find(query);
+    if (it == byQuery.end()) {
+        return nullptr;
+    }
+
+    // Move to the front; list iterators and keys stay valid
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->second;
+}
+
+void ParseCache::insert(const std::string& query,
+                        const std::vector<std::shared_ptr<Statement>>& statements) {
+    if (capacity == 0 || query.size() > MAX_QUERY_LENGTH || byQuery.count(query) != 0) {
+        return;
+    }
+
+    // EXPLAIN ANALYZE reports the parse time of its own parse
+    for (const auto& statement : statements) {
+        if (statement->type == Statement::Type::EXPLAIN) {
+            return;
+        }
+    }
+
+    if (entries.size() >= capacity) {
+        byQuery.erase(entries.back().first);
+        entries.pop_back();
+    }
+
+    entries.emplace_front(query, statements);
+    byQuery.emplace(entries.front().first, entries.begin());
+}
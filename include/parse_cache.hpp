@@ -0,0 +1,37 @@
+#ifndef PARSE_CACHE_HPP
+#define PARSE_CACHE_HPP
+
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../sql/parser.hpp"
+
+// Statements of recently parsed query texts, least recently used evicted
+// first, so a session running the same query again skips the tokenizer and
+// the parser. Parsed statements are never modified, so they can be shared.
+class ParseCache {
+public:
+    // Longer query texts (bulk loads, scripts) are not worth keeping
+    static const size_t DEFAULT_CAPACITY = 256;
+    static const size_t MAX_QUERY_LENGTH = 4096;
+
+    explicit ParseCache(size_t capacity = DEFAULT_CAPACITY) : capacity(capacity) {}
+
+    // Statements of a cached query, or nullptr
+    const std::vector<std::shared_ptr<Statement>>* find(const std::string& query);
+
+    // Remember the statements of a query, if it qualifies
+    void insert(const std::string& query, const std::vector<std::shared_ptr<Statement>>& statements);
+
+private:
+    using Entry = std::pair<std::string, std::vector<std::shared_ptr<Statement>>>;
+
+    size_t capacity;
+    std::list<Entry> entries;  // Most recently used first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> byQuery;  // Keys point into entries
+};
+
+#endif // PARSE_CACHE_HPP
@@ -0,0 +1,86 @@
+#include "./query_control.hpp"
+
+static int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+QueryControl::QueryControl(const std::atomic<uint64_t>* interrupts, uint64_t interruptsSeen,
+                           const std::atomic<uint64_t>* sessionInterrupts)
+    : interrupts(interrupts), interruptsAtStart(interruptsSeen),
+      sessionInterrupts(sessionInterrupts),
+      sessionInterruptsAtStart(sessionInterrupts != nullptr ? sessionInterrupts->load() : 0) {}
+
+void QueryControl::startStatement(std::chrono::milliseconds timeout) {
+    timeoutMs.store(timeout.count());
+    if (timeout.count() <= 0) {
+        deadline.store(0);
+        return;
+    }
+    int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+    deadline.store(steadyNowNs() + nanos);
+}
+
+bool QueryControl::stopped() const {
+    if (cancelled.load(std::memory_order_relaxed) || expired.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    if ((interrupts != nullptr &&
+         interrupts->load(std::memory_order_relaxed) != interruptsAtStart) ||
+        (sessionInterrupts != nullptr &&
+         sessionInterrupts->load(std::memory_order_relaxed) != sessionInterruptsAtStart)) {
+        cancelled.store(true);
+        return true;
+    }
+
+    // Reading the clock is the costly part, and only timed statements pay
+    int64_t due = deadline.load(std::memory_order_relaxed);
+    if (due != 0 && steadyNowNs() >= due) {
+        expired.store(true);
+        return true;
+    }
+    return false;
+}
+
+std::string QueryControl::errorMessage() const {
+    if (timedOut()) {
+        return "Statement timed out after " + std::to_string(timeoutMs.load()) + " ms";
+    }
+    return "Query cancelled";
+}
+
+uint64_t QueryRegistry::add(QueryControl& control, const std::string& query) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t id = nextId++;
+    queries.emplace(id, Entry{&control, query, std::chrono::steady_clock::now()});
+    return id;
+}
+
+void QueryRegistry::remove(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    queries.erase(id);
+}
+
+bool QueryRegistry::cancel(uint64_t id) {
+    // The query stays registered, so its control stays alive, while the
+    // lock is held
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = queries.find(id);
+    if (found == queries.end()) {
+        return false;
+    }
+    found->second.control->cancel();
+    return true;
+}
+
+std::vector<RunningQuery> QueryRegistry::running() const {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<RunningQuery> result;
+    result.reserve(queries.size());
+    for (const auto& entry : queries) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - entry.second.started);
+        result.push_back({entry.first, entry.second.query, static_cast<uint64_t>(elapsed.count())});
+    }
+    return result;
+}
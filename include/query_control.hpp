@@ -0,0 +1,135 @@
+#ifndef QUERY_CONTROL_HPP
+#define QUERY_CONTROL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Lets a running query be stopped before it finishes: cancelled from
+ * another thread, or timed out when a statement runs past its deadline.
+ * Loops over rows poll stopped() once per block or batch and give up;
+ * the session then fails and rolls back the statement like any other.
+ */
+class QueryControl {
+public:
+    // The query is also cancelled whenever an interrupt counter, if
+    // given, moves on: the database's, which stops every query, from
+    // interruptsSeen, and the session's, which stops only the session's,
+    // from its value now. Reading the database's counter before the query
+    // is set up keeps an interrupt made meanwhile from being lost.
+    QueryControl(const std::atomic<uint64_t>* interrupts, uint64_t interruptsSeen,
+                 const std::atomic<uint64_t>* sessionInterrupts = nullptr);
+    QueryControl() : QueryControl(nullptr, 0) {}
+
+    QueryControl(const QueryControl&) = delete;
+    QueryControl& operator=(const QueryControl&) = delete;
+
+    // Thread-safe, and safe to call from a signal handler
+    void cancel() { cancelled.store(true); }
+
+    // Give the next statement this long to run; 0 means no limit
+    void startStatement(std::chrono::milliseconds timeout);
+
+    // Whether the query should stop; cheap enough to call per block, and
+    // true from then on
+    bool stopped() const;
+
+    // Whether a stop was requested or seen, without looking at the clock
+    bool wasStopped() const { return cancelled.load() || expired.load(); }
+
+    bool timedOut() const { return expired.load() && !cancelled.load(); }
+
+    // "Query cancelled" or "Statement timed out after N ms"
+    std::string errorMessage() const;
+
+private:
+    const std::atomic<uint64_t>* interrupts;
+    uint64_t interruptsAtStart = 0;
+    const std::atomic<uint64_t>* sessionInterrupts;
+    uint64_t sessionInterruptsAtStart = 0;
+    mutable std::atomic<bool> cancelled{false};
+    mutable std::atomic<bool> expired{false};
+
+    // Steady clock nanoseconds; 0 while there is no deadline
+    std::atomic<int64_t> deadline{0};
+    std::atomic<int64_t> timeoutMs{0};
+};
+
+// A query shown by QueryRegistry::running
+struct RunningQuery {
+    uint64_t id;
+    std::string query;
+    uint64_t elapsedMs;
+};
+
+/**
+ * The queries running on a database, by id, so any thread can list and
+ * cancel them. Also holds the statement timeout sessions apply.
+ */
+class QueryRegistry {
+public:
+    // Register a query while it runs; ids start at 1
+    uint64_t add(QueryControl& control, const std::string& query);
+    void remove(uint64_t id);
+
+    // Cancel a running query; false if no query has this id
+    bool cancel(uint64_t id);
+
+    // Cancel every query running now. Only moves a counter, so it is safe
+    // to call from a signal handler.
+    void interrupt() { interrupts.fetch_add(1); }
+    const std::atomic<uint64_t>* interruptCounter() const { return &interrupts; }
+    uint64_t interruptCount() const { return interrupts.load(); }
+
+    std::vector<RunningQuery> running() const;
+
+    // Time each statement may run for; 0 (the default) means no limit
+    void setStatementTimeout(std::chrono::milliseconds timeout) {
+        statementTimeoutMs.store(timeout.count());
+    }
+    std::chrono::milliseconds getStatementTimeout() const {
+        return std::chrono::milliseconds(statementTimeoutMs.load());
+    }
+
+private:
+    struct Entry {
+        QueryControl* control;
+        std::string query;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    mutable std::mutex mutex;
+    std::map<uint64_t, Entry> queries;
+    uint64_t nextId = 1;
+    std::atomic<uint64_t> interrupts{0};
+    std::atomic<int64_t> statementTimeoutMs{0};
+};
+
+/**
+ * Keeps a query registered for as long as it is in scope; without a
+ * registry it does nothing
+ */
+class RegisteredQuery {
+public:
+    RegisteredQuery(QueryRegistry* registry, QueryControl& control, const std::string& query)
+        : registry(registry), id(registry != nullptr ? registry->add(control, query) : 0) {}
+    ~RegisteredQuery() {
+        if (registry != nullptr) {
+            registry->remove(id);
+        }
+    }
+
+    RegisteredQuery(const RegisteredQuery&) = delete;
+    RegisteredQuery& operator=(const RegisteredQuery&) = delete;
+
+private:
+    QueryRegistry* registry;
+    uint64_t id;
+};
+
+#endif // QUERY_CONTROL_HPP
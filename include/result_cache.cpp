@@ -0,0 +1,140 @@
+#include "./result_cache.hpp"
+#include "../sql/tokenizer.hpp"
+#include <iterator>
+
+static size_t rowBytes(const std::vector<Value>& values) {
+    size_t bytes = sizeof(std::vector<Value>) + values.size() * sizeof(Value);
+    for (const auto& value : values) {
+        bytes += value.heapBytes();
+    }
+    return bytes;
+}
+
+void ResultCache::setCapacity(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity.store(bytes, std::memory_order_relaxed);
+    evictTo(bytes);
+}
+
+std::string ResultCache::normalize(const std::string& query) {
+    if (query.size() > MAX_QUERY_LENGTH) {
+        return "";
+    }
+    Tokenizer tokenizer(query);
+    std::pmr::vector<Token> tokens = tokenizer.scanTokens();
+    size_t end = tokens.size();
+    if (end > 0 && tokens[end - 1].type == TokenType::EOF_TOKEN) {
+        end--;
+    }
+    if (end == 0 || tokens[0].type != TokenType::SELECT) {
+        return "";
+    }
+    std::string key;
+    key.reserve(query.size());
+    for (size_t i = 0; i < end; i++) {
+        const Token& token = tokens[i];
+        // A script of several statements is not cached as a whole. The
+        // final semicolon stays in the key: without it the query is an error.
+        if (token.type == TokenType::INVALID ||
+            (token.type == TokenType::SEMICOLON && i + 1 != end)) {
+            return "";
+        }
+        if (i > 0) {
+            key += ' ';
+        }
+        // Identifiers and literals as written, keywords in upper case
+        bool verbatim = token.type == TokenType::IDENTIFIER ||
+                        token.type == TokenType::STRING_LITERAL ||
+                        token.type == TokenType::INTEGER_LITERAL ||
+                        token.type == TokenType::FLOAT_LITERAL;
+        for (char c : token.lexeme) {
+            key += !verbatim && c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+        }
+    }
+    return key;
+}
+
+std::shared_ptr<const CachedResult> ResultCache::find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = byKey.find(key);
+    if (it == byKey.end()) {
+        return nullptr;
+    }
+    // A result of a table that was written to or dropped is never valid again
+    const CachedResult& result = *it->second->result;
+    std::shared_ptr<const Table> table = result.table.lock();
+    if (table == nullptr || table->getVersion() != result.tableVersion) {
+        erase(it->second);
+        return nullptr;
+    }
+    // Move to the front; list iterators and keys stay valid
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->result;
+}
+
+void ResultCache::insert(const std::string& key, std::shared_ptr<const CachedResult> result,
+                         size_t bytes) {
+    bytes += sizeof(Entry) + 2 * key.size();
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t limit = capacity.load(std::memory_order_relaxed);
+    if (bytes > limit) {
+        return;
+    }
+    // Another session may have cached the same query meanwhile; the newer
+    // result replaces it
+    auto it = byKey.find(key);
+    if (it != byKey.end()) {
+        erase(it->second);
+    }
+    evictTo(limit - bytes);
+    entries.push_front(Entry{key, std::move(result), bytes});
+    byKey.emplace(entries.front().key, entries.begin());
+    usedBytes += bytes;
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    byKey.clear();
+    entries.clear();
+    usedBytes = 0;
+}
+
+size_t ResultCache::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usedBytes;
+}
+
+void ResultCache::evictTo(size_t limit) {
+    while (usedBytes > limit && !entries.empty()) {
+        erase(std::prev(entries.end()));
+    }
+}
+
+void ResultCache::erase(std::list<Entry>::iterator entry) {
+    usedBytes -= entry->bytes;
+    byKey.erase(entry->key);
+    entries.erase(entry);
+}
+
+void RecordingSink::beginResult(const std::vector<std::string>& columnNames) {
+    target.beginResult(columnNames);
+    results++;
+    result.columnNames = columnNames;
+    for (const auto& name : columnNames) {
+        bytes += sizeof(std::string) + name.capacity();
+    }
+}
+
+void RecordingSink::addRow(const std::vector<Value>& values) {
+    target.addRow(values);
+    if (bytes > maxBytes) {
+        return;
+    }
+    bytes += rowBytes(values);
+    if (bytes > maxBytes) {
+        // Too big to cache; free what was copied
+        result.rows = {};
+        return;
+    }
+    result.rows.push_back(values);
+}
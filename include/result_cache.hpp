@@ -0,0 +1,105 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../executor/result_sink.hpp"
+#include "../storage/table.hpp"
+
+// Result set of a SELECT, computed while its table was at tableVersion
+struct CachedResult {
+    std::vector<std::string> columnNames;
+    std::vector<std::vector<Value>> rows;
+    std::weak_ptr<const Table> table;
+    uint64_t tableVersion = 0;
+};
+
+/**
+ * Results of recent SELECTs, shared by all sessions and keyed by the
+ * normalized query text. A result is returned only while its table is at
+ * the version it was computed at; every commit that writes to the table
+ * moves the version on, so a stale result is dropped when next looked up
+ * rather than returned. Once the results take more than the byte limit,
+ * the least recently used are evicted. A limit of 0, the default, turns
+ * the cache off. Thread-safe.
+ */
+class ResultCache {
+public:
+    // Longer query texts (bulk loads, scripts) are not worth normalizing
+    static const size_t MAX_QUERY_LENGTH = 4096;
+
+    ResultCache() = default;
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Change the byte limit, evicting down to it
+    void setCapacity(size_t bytes);
+    size_t getCapacity() const { return capacity.load(std::memory_order_relaxed); }
+    bool isEnabled() const { return getCapacity() > 0; }
+
+    // Key of a query: its tokens separated by single spaces, keywords in
+    // upper case and comments left out, so layout and keyword case do not
+    // matter. Empty for anything but a SELECT.
+    static std::string normalize(const std::string& query);
+
+    // The result cached under the key, if its table has not changed since
+    std::shared_ptr<const CachedResult> find(const std::string& key);
+
+    // Remember a result of the given size, unless it exceeds the limit
+    void insert(const std::string& key, std::shared_ptr<const CachedResult> result, size_t bytes);
+
+    void clear();
+
+    // Bytes held by the cached results, as counted against the limit
+    size_t memoryBytes() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const CachedResult> result;
+        size_t bytes;
+    };
+
+    std::atomic<size_t> capacity{0};
+    mutable std::mutex mutex;
+    size_t usedBytes = 0;
+    std::list<Entry> entries;  // Most recently used first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> byKey;  // Keys point into entries
+
+    // Drop the least recently used entries until at most limit bytes are
+    // used; mutex must be held
+    void evictTo(size_t limit);
+    void erase(std::list<Entry>::iterator entry);
+};
+
+// Passes a result set on to another sink and keeps a copy of it for the
+// result cache, until the copy grows past maxBytes
+class RecordingSink : public ResultSink {
+public:
+    RecordingSink(ResultSink& target, size_t maxBytes) : target(target), maxBytes(maxBytes) {}
+
+    void beginResult(const std::vector<std::string>& columnNames) override;
+    void addRow(const std::vector<Value>& values) override;
+    void endResult(size_t rowCount) override { target.endResult(rowCount); }
+    void message(const std::string& text) override { target.message(text); }
+    void flush() override { target.flush(); }
+
+    // Whether exactly one result set was copied in full
+    bool isComplete() const { return results == 1 && bytes <= maxBytes; }
+
+    CachedResult result;
+    size_t bytes = 0;  // Estimated memory of the copy
+
+private:
+    ResultSink& target;
+    size_t maxBytes;
+    size_t results = 0;
+};
+
+#endif // RESULT_CACHE_HPP
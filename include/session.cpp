@@ -0,0 +1,412 @@
+#include "./session.hpp"
+#include "./appender.hpp"
+
+Session::Session(Catalog& catalog, TransactionManager& transactionManager,
+                 Metrics* metrics, ResultCache* resultCache, ThreadPool* workers,
+                 MemoryBudget* memoryBudget, QueryRegistry* queries)
+    : catalog(catalog), transactionManager(transactionManager), metrics(metrics),
+      resultCache(resultCache), memoryBudget(memoryBudget), queries(queries) {
+    executor.setWorkers(workers);
+}
+
+Session::~Session() {
+    // Discard changes of a transaction that was never committed
+    if (currentTransaction) {
+        transactionManager.rollback(*currentTransaction);
+    }
+}
+
+ExecutionResult Session::executeQuery(const std::string& query) {
+    // The collected rows count against the query's memory
+    MemoryReservation memory(memoryBudget);
+    CollectingSink sink;
+    sink.setMemory(&memory);
+    ExecutionResult result = run(query, sink, memory, std::nullopt);
+    if (result.success) {
+        result.columnNames = std::move(sink.columnNames);
+        result.rows = std::move(sink.rows);
+    }
+    return result;
+}
+
+ExecutionResult Session::executeQuery(const std::string& query, ResultSink& sink,
+                                      std::optional<uint64_t> interruptsSeen) {
+    MemoryReservation memory(memoryBudget);
+    return run(query, sink, memory, interruptsSeen);
+}
+
+ExecutionResult Session::run(const std::string& query, ResultSink& sink, MemoryReservation& memory,
+                             std::optional<uint64_t> interruptsSeen) {
+    if (metrics) {
+        metrics->add(Counter::QUERIES);
+    }
+
+    // A transaction reads its own changes, so only SELECTs outside one
+    // use the result cache
+    std::string cacheKey;
+    if (resultCache != nullptr && resultCache->isEnabled() && !currentTransaction) {
+        cacheKey = ResultCache::normalize(query);
+        ExecutionResult result;
+        if (!cacheKey.empty() && replayCachedResult(cacheKey, sink, result)) {
+            if (memory.exhausted()) {
+                return ExecutionResult{false, memory.errorMessage(), {}, {}};
+            }
+            return result;
+        }
+    }
+
+    // A query is turned away before it starts while the database has no
+    // memory left for it
+    if (!memory.admit()) {
+        if (metrics) {
+            metrics->add(Counter::MEMORY_LIMIT_ERRORS);
+        }
+        return ExecutionResult{false, memory.errorMessage(), {}, {}};
+    }
+
+    // Scratch memory of this query, released in one go when it finishes
+    QueryArena arena;
+
+    // Listed as running, so another thread can cancel it, until it returns
+    QueryControl control(queries != nullptr ? queries->interruptCounter() : nullptr,
+                         interruptsSeen.value_or(queries != nullptr ? queries->interruptCount() : 0),
+                         &interrupts);
+    RegisteredQuery registered(queries, control, query);
+
+    // Parse every statement up front so a syntax error runs nothing;
+    // repeated query texts come from the cache
+    std::vector<std::shared_ptr<Statement>> statements;
+    if (const auto* cached = parseCache.find(query)) {
+        statements = *cached;
+        if (metrics) {
+            metrics->add(Counter::PARSE_CACHE_HITS);
+        }
+    } else {
+        ScriptParseResult parseResult = parser.parseScript(query, arena.get());
+        if (metrics) {
+            metrics->add(Counter::PARSE_CACHE_MISSES);
+        }
+        if (!parseResult.success) {
+            if (metrics) {
+                metrics->add(Counter::PARSE_ERRORS);
+            }
+            return ExecutionResult{false, parseResult.errorMessage, {}, {}};
+        }
+        statements = std::move(parseResult.statements);
+        parseCache.insert(query, statements);
+    }
+
+    // Record the result of a lone SELECT for the cache, with the version
+    // its table had before the statement took its snapshot
+    std::shared_ptr<Table> cachedTable;
+    uint64_t cachedVersion = 0;
+    std::unique_ptr<RecordingSink> recorder;
+    if (!cacheKey.empty() && statements.size() == 1 &&
+        statements[0]->type == Statement::Type::SELECT) {
+        cachedTable = catalog.find(static_cast<const SelectStatement&>(*statements[0]).tableName);
+        if (cachedTable) {
+            cachedVersion = cachedTable->getVersion();
+            recorder = std::make_unique<RecordingSink>(sink, resultCache->getCapacity());
+        }
+    }
+    ResultSink& target = recorder ? *recorder : sink;
+
+    // Run statements in order, stopping at the first failure
+    ExecutionResult result = {true, "", {}, {}};
+    for (const auto& statement : statements) {
+        Stopwatch timer;
+        result = executeStatement(statement, target, arena.get(), memory, control);
+        if (metrics) {
+            metrics->recordStatement(statement->type, timer.elapsedNs(), result);
+        }
+        if (!result.success) {
+            break;
+        }
+    }
+    sink.flush();
+    if (metrics) {
+        metrics->add(Counter::ROWS_SPILLED, memory.spilledRows());
+        if (memory.exhausted()) {
+            metrics->add(Counter::MEMORY_LIMIT_ERRORS);
+        }
+    }
+
+    if (recorder && result.success && recorder->isComplete()) {
+        auto cached = std::make_shared<CachedResult>(std::move(recorder->result));
+        cached->table = cachedTable;
+        cached->tableVersion = cachedVersion;
+        resultCache->insert(cacheKey, std::move(cached), recorder->bytes);
+    }
+
+    return result;
+}
+
+bool Session::replayCachedResult(const std::string& key, ResultSink& sink, ExecutionResult& result) {
+    Stopwatch timer;
+    std::shared_ptr<const CachedResult> cached = resultCache->find(key);
+    if (metrics) {
+        metrics->add(cached ? Counter::RESULT_CACHE_HITS : Counter::RESULT_CACHE_MISSES);
+    }
+    if (!cached) {
+        return false;
+    }
+    sink.beginResult(cached->columnNames);
+    for (const auto& row : cached->rows) {
+        sink.addRow(row);
+    }
+    sink.endResult(cached->rows.size());
+    sink.flush();
+    result = {true, "", {}, {}};
+    result.rowCount = cached->rows.size();
+    if (metrics) {
+        metrics->recordStatement(Statement::Type::SELECT, timer.elapsedNs(), result);
+    }
+    return true;
+}
+
+ExecutionResult Session::executeStatement(const std::shared_ptr<Statement>& statement,
+                                          ResultSink& sink,
+                                          std::pmr::memory_resource* arena,
+                                          MemoryReservation& memory,
+                                          QueryControl& control) {
+    switch (statement->type) {
+        case Statement::Type::BEGIN_TRANSACTION:
+        case Statement::Type::COMMIT:
+        case Statement::Type::ROLLBACK:
+            return executeTransactionControl(*statement);
+        default:
+            break;
+    }
+
+    // A view filled in by a transaction that then rolls back would be
+    // missing the groups it had
+    if (statement->type == Statement::Type::CREATE_VIEW && currentTransaction) {
+        return {false, "CREATE MATERIALIZED VIEW cannot run inside a transaction", {}, {}};
+    }
+
+    // Execute the parsed statement
+    control.startStatement(queries != nullptr ? queries->getStatementTimeout()
+                                              : std::chrono::milliseconds(0));
+    return runInTransaction([&](Transaction& txn) {
+        return executor.execute(statement, catalog, txn, sink, arena, &memory);
+    }, &control);
+}
+
+ExecutionResult Session::executeScript(std::istream& input, ResultSink& sink,
+                                       std::optional<uint64_t> interruptsSeen) {
+    if (metrics) {
+        metrics->add(Counter::QUERIES);
+    }
+
+    QueryControl control(queries != nullptr ? queries->interruptCounter() : nullptr,
+                         interruptsSeen.value_or(queries != nullptr ? queries->interruptCount() : 0),
+                         &interrupts);
+    RegisteredQuery registered(queries, control, "(script)");
+
+    ScriptReader reader(input);
+    std::pmr::vector<Token> tokens;
+    ExecutionResult result = {true, "", {}, {}};
+    while (result.success && reader.nextStatement(tokens)) {
+        if (tokens.front().type == TokenType::INSERT) {
+            Stopwatch timer;
+            result = streamInsert(reader, tokens, sink, control);
+            if (metrics) {
+                metrics->recordStatement(Statement::Type::INSERT, timer.elapsedNs(), result);
+            }
+            continue;
+        }
+
+        // Other statements are small, so they are parsed and run whole
+        ParseResult parsed = parser.parseTokens(tokens);
+        if (!parsed.success) {
+            if (metrics) {
+                metrics->add(Counter::PARSE_ERRORS);
+            }
+            result = {false, parsed.errorMessage, {}, {}};
+            break;
+        }
+        QueryArena arena;
+        MemoryReservation memory(memoryBudget);
+        Stopwatch timer;
+        result = executeStatement(parsed.statement, sink, arena.get(), memory, control);
+        if (metrics) {
+            metrics->recordStatement(parsed.statement->type, timer.elapsedNs(), result);
+        }
+    }
+    if (result.success && reader.failed()) {
+        result = {false, "Failed to read script", {}, {}};
+    }
+    sink.flush();
+    return result;
+}
+
+ExecutionResult Session::streamInsert(ScriptReader& reader, const std::pmr::vector<Token>& header,
+                                      ResultSink& sink, QueryControl& control) {
+    ParseResult parsed = parser.parseInsertHeader(header);
+    if (!parsed.success) {
+        if (metrics) {
+            metrics->add(Counter::PARSE_ERRORS);
+        }
+        return {false, parsed.errorMessage, {}, {}};
+    }
+    const auto& insert = static_cast<const InsertStatement&>(*parsed.statement);
+    std::shared_ptr<Table> table = catalog.find(insert.tableName);
+    if (table == nullptr) {
+        return {false, "Table not found: " + insert.tableName, {}, {}};
+    }
+
+    // Where each listed column goes in a row, found as INSERT finds them;
+    // columns left out are NULL
+    const std::vector<ColumnDefinition>& columns = table->getColumns();
+    std::vector<size_t> positions;
+    for (const auto& name : insert.columnNames) {
+        int position = table->findColumnIndex(name);
+        if (position < 0) {
+            return {false, "Failed to insert row into table " + insert.tableName +
+                           ": Column not found: " + name, {}, {}};
+        }
+        positions.push_back(static_cast<size_t>(position));
+    }
+
+    // Rows are parsed one at a time and appended in batches like an
+    // Appender's, so memory does not grow with the statement. It is still
+    // one statement: its own transaction, or one savepoint of the open
+    // one, that a failure or stop anywhere rolls back whole. The timeout
+    // covers all of it.
+    control.startStatement(queries != nullptr ? queries->getStatementTimeout()
+                                              : std::chrono::milliseconds(0));
+    size_t inserted = 0;
+    ExecutionResult result = runInTransaction([&](Transaction& txn) -> ExecutionResult {
+        std::pmr::vector<Token> tokens;
+        std::vector<std::vector<Value>> batch;
+        std::vector<Value> values;
+        bool last = false;
+        while (!last) {
+            reader.nextRow(tokens);
+            std::string errorMessage;
+            if (!parser.parseRow(tokens, values, last, errorMessage)) {
+                if (metrics) {
+                    metrics->add(Counter::PARSE_ERRORS);
+                }
+                return {false, errorMessage, {}, {}};
+            }
+            if (positions.empty()) {
+                batch.push_back(std::move(values));
+            } else {
+                if (values.size() != positions.size()) {
+                    return {false, "Failed to insert row into table " + insert.tableName + ": " +
+                                   std::to_string(positions.size()) + " columns but " +
+                                   std::to_string(values.size()) + " values were supplied", {}, {}};
+                }
+                std::vector<Value> row(columns.size());
+                for (size_t i = 0; i < positions.size(); i++) {
+                    row[positions[i]] = std::move(values[i]);
+                }
+                batch.push_back(std::move(row));
+            }
+
+            if (batch.size() >= Appender::BATCH_ROWS || last) {
+                if (control.stopped()) {
+                    return {false, control.errorMessage(), {}, {}};
+                }
+                size_t count = batch.size();
+                ExecutionResult appended = executor.append(insert.tableName, batch, catalog, txn);
+                if (!appended.success) {
+                    return appended;
+                }
+                inserted += count;
+                batch.clear();
+            }
+        }
+        return {true, "", {}, {}};
+    }, &control);
+    if (!result.success) {
+        return result;
+    }
+
+    sink.message(std::to_string(inserted) + " row(s) inserted into " + insert.tableName);
+    result.rowCount = inserted;
+    return result;
+}
+
+ExecutionResult Session::append(const std::string& tableName, std::vector<std::vector<Value>>& rows) {
+    Stopwatch timer;
+    ExecutionResult result = runInTransaction([&](Transaction& txn) {
+        return executor.append(tableName, rows, catalog, txn);
+    });
+    if (metrics) {
+        metrics->recordStatement(Statement::Type::INSERT, timer.elapsedNs(), result);
+    }
+    return result;
+}
+
+ExecutionResult Session::runInTransaction(const std::function<ExecutionResult(Transaction&)>& work,
+                                          const QueryControl* control) {
+    // Outside BEGIN ... COMMIT each statement is its own transaction
+    std::unique_ptr<Transaction> autocommit;
+    if (!currentTransaction) {
+        autocommit = transactionManager.begin();
+    }
+    Transaction& txn = autocommit ? *autocommit : *currentTransaction;
+    size_t savepoint = txn.undoLog.size();
+
+    txn.control = control;
+    ExecutionResult result = work(txn);
+    txn.control = nullptr;
+
+    // A statement stopped part way fails, whatever it got done
+    if (control != nullptr && control->wasStopped()) {
+        result = stoppedResult(*control);
+    }
+
+    if (autocommit) {
+        if (result.success) {
+            if (!transactionManager.commit(txn)) {
+                result = {false, "Failed to write transaction log", {}, {}};
+            }
+        } else {
+            transactionManager.rollback(txn);
+        }
+        catalog.collectGarbage(transactionManager.oldestActiveSnapshot());
+    } else if (!result.success) {
+        // A failed statement leaves no partial changes behind
+        transactionManager.rollbackTo(txn, savepoint);
+    }
+
+    return result;
+}
+
+ExecutionResult Session::stoppedResult(const QueryControl& control) {
+    if (metrics) {
+        metrics->add(control.timedOut() ? Counter::STATEMENT_TIMEOUTS : Counter::QUERIES_CANCELLED);
+    }
+    return {false, control.errorMessage(), {}, {}};
+}
+
+ExecutionResult Session::executeTransactionControl(const Statement& statement) {
+    if (statement.type == Statement::Type::BEGIN_TRANSACTION) {
+        if (currentTransaction) {
+            return {false, "A transaction is already active", {}, {}};
+        }
+        currentTransaction = transactionManager.begin();
+        return {true, "", {}, {}};
+    }
+
+    if (!currentTransaction) {
+        return {false, "No transaction is active", {}, {}};
+    }
+
+    ExecutionResult result = {true, "", {}, {}};
+    if (statement.type == Statement::Type::COMMIT) {
+        // All changes of the transaction are logged and synced once here
+        if (!transactionManager.commit(*currentTransaction)) {
+            result = {false, "Failed to write transaction log; transaction rolled back", {}, {}};
+        }
+    } else {
+        transactionManager.rollback(*currentTransaction);
+    }
+    currentTransaction.reset();
+    catalog.collectGarbage(transactionManager.oldestActiveSnapshot());
+
+    return result;
+}
@@ -0,0 +1,126 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include <atomic>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include "../sql/parser.hpp"
+#include "../sql/script_reader.hpp"
+#include "../executor/executor.hpp"
+#include "../storage/catalog.hpp"
+#include "../storage/transaction.hpp"
+#include "./arena.hpp"
+#include "./memory_budget.hpp"
+#include "./metrics.hpp"
+#include "./parse_cache.hpp"
+#include "./query_control.hpp"
+#include "./result_cache.hpp"
+
+/**
+ * One client's connection to the database. A session owns the parser,
+ * executor and open transaction, so each thread should use its own.
+ */
+class Session {
+public:
+    // Statements are recorded in metrics, if given; SELECTs outside a
+    // transaction are answered from the result cache, if given and
+    // enabled. Partitions are scanned in parallel on workers, if given.
+    // Each query takes the rows it buffers from the memory budget, if
+    // given. Queries are listed in the registry, if given, while they
+    // run, so they can be cancelled, and each statement gets its timeout.
+    Session(Catalog& catalog, TransactionManager& transactionManager,
+            Metrics* metrics = nullptr, ResultCache* resultCache = nullptr,
+            ThreadPool* workers = nullptr, MemoryBudget* memoryBudget = nullptr,
+            QueryRegistry* queries = nullptr);
+    ~Session();
+
+    // Execute one or more semicolon-separated statements in this session.
+    // Stops at the first failing statement and returns its result,
+    // otherwise the result of the last statement, including the rows of
+    // the last result set. Fails if those rows exceed the query's memory
+    // limit. A statement that is cancelled or times out fails and leaves
+    // no changes behind.
+    ExecutionResult executeQuery(const std::string& query);
+
+    // Same, but stream all output into the sink; rows are not collected.
+    // Interrupts of the database count from interruptsSeen, a value of
+    // QueryRegistry::interruptCount read before, if given, and otherwise
+    // from when the query starts.
+    ExecutionResult executeQuery(const std::string& query, ResultSink& sink,
+                                 std::optional<uint64_t> interruptsSeen = std::nullopt);
+
+    // Execute a script read from a stream, statement by statement, in
+    // memory that does not grow with its size. Rows of an INSERT go into
+    // the table in batches as they are parsed, but an INSERT that fails
+    // leaves none of its rows behind, like any statement. Stops at the
+    // first failing statement.
+    ExecutionResult executeScript(std::istream& input, ResultSink& sink,
+                                  std::optional<uint64_t> interruptsSeen = std::nullopt);
+
+    // Insert rows of values in column order into a table, as one
+    // statement of this session: its own transaction unless one is open.
+    // The values are moved from. See Executor::append.
+    ExecutionResult append(const std::string& tableName, std::vector<std::vector<Value>>& rows);
+
+    // Stop the statements running in this session, which then fail and
+    // leave no changes behind. Safe to call from another thread or a
+    // signal handler.
+    void interrupt() { interrupts.fetch_add(1); }
+
+    // Whether BEGIN has been issued without a matching COMMIT/ROLLBACK
+    bool inTransaction() const { return currentTransaction != nullptr; }
+
+private:
+    Catalog& catalog;
+    TransactionManager& transactionManager;
+    Metrics* metrics;
+    ResultCache* resultCache;
+    MemoryBudget* memoryBudget;
+    QueryRegistry* queries;
+    Parser parser;
+    ParseCache parseCache;
+    Executor executor;
+
+    // Moved on by interrupt
+    std::atomic<uint64_t> interrupts{0};
+
+    // Transaction opened by BEGIN; statements outside of one autocommit
+    std::unique_ptr<Transaction> currentTransaction;
+
+    // Run a query with its memory reservation
+    ExecutionResult run(const std::string& query, ResultSink& sink, MemoryReservation& memory,
+                        std::optional<uint64_t> interruptsSeen);
+
+    // Execute a single parsed statement with the query's arena, memory
+    // and control, starting the statement's timeout
+    ExecutionResult executeStatement(const std::shared_ptr<Statement>& statement,
+                                     ResultSink& sink,
+                                     std::pmr::memory_resource* arena,
+                                     MemoryReservation& memory,
+                                     QueryControl& control);
+
+    // Insert the rows of a streamed INSERT whose header the reader
+    // returned, a batch at a time
+    ExecutionResult streamInsert(ScriptReader& reader, const std::pmr::vector<Token>& header,
+                                 ResultSink& sink, QueryControl& control);
+
+    // Run a statement's work in the open transaction, or in one of its
+    // own that commits if it succeeds; a failure leaves no changes behind.
+    // With a control, the work fails if it is stopped part way.
+    ExecutionResult runInTransaction(const std::function<ExecutionResult(Transaction&)>& work,
+                                     const QueryControl* control = nullptr);
+
+    // Failure of a cancelled or timed out statement, counted in metrics
+    ExecutionResult stoppedResult(const QueryControl& control);
+
+    // Answer a SELECT from the result cache; false on a miss
+    bool replayCachedResult(const std::string& key, ResultSink& sink, ExecutionResult& result);
+
+    // Handle BEGIN, COMMIT and ROLLBACK
+    ExecutionResult executeTransactionControl(const Statement& statement);
+};
+
+#endif // SESSION_HPP
@@ -21,4 +21,36 @@ inline std::string toLower(const std::string& str){
     return result;
 }
 
+// Text on one line: backslashes and line breaks become \\, \n and \r
+inline std::string escapeLineBreaks(const std::string& str){
+    std::string result;
+    result.reserve(str.size());
+    for (char c : str) {
+        if (c == '\\') {
+            result += "\\\\";
+        } else if (c == '\n') {
+            result += "\\n";
+        } else if (c == '\r') {
+            result += "\\r";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+inline std::string unescapeLineBreaks(const std::string& str){
+    std::string result;
+    result.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] != '\\' || i + 1 == str.size()) {
+            result += str[i];
+            continue;
+        }
+        char c = str[++i];
+        result += c == 'n' ? '\n' : (c == 'r' ? '\r' : c);
+    }
+    return result;
+}
+
 #endif
\ No newline at end of file
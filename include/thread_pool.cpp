@@ -0,0 +1,87 @@
+#include "./thread_pool.hpp"
+
+ThreadPool::ThreadPool(size_t threadCount) : stopping(false) {
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+
+    // Workers finish the queued tasks before exiting
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    wakeup.notify_one();
+}
+
+// Shared by the threads of one parallelFor. Workers that start after all
+// indices were taken touch nothing else, so the caller may return then.
+struct ParallelJob {
+    const std::function<void(size_t)>* task;
+    size_t count;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    void drain() {
+        for (size_t i = next++; i < count; i = next++) {
+            (*task)(i);
+            if (++done == count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+
+    auto job = std::make_shared<ParallelJob>();
+    job->task = &task;
+    job->count = count;
+    for (size_t i = 1; i < count && i <= workers.size(); i++) {
+        submit([job] { job->drain(); });
+    }
+    job->drain();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job, count] { return job->done == count; });
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;  // Stopping and nothing left to do
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted tasks in FIFO order
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task for execution on one of the workers
+    void submit(std::function<void()> task);
+
+    // Run task(0) ... task(count - 1) on the workers and the calling
+    // thread, and return when all have finished. The caller never waits
+    // for a queued task, so this may be called from a worker.
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    // Number of worker threads
+    size_t size() const { return workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping;
+
+    void workerLoop();
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,51 @@
+#include "./protocol.hpp"
+
+void appendU32(std::string& out, uint32_t value) {
+    out.push_back(static_cast<char>((value >> 24) & 0xFF));
+    out.push_back(static_cast<char>((value >> 16) & 0xFF));
+    out.push_back(static_cast<char>((value >> 8) & 0xFF));
+    out.push_back(static_cast<char>(value & 0xFF));
+}
+
+void appendU64(std::string& out, uint64_t value) {
+    appendU32(out, static_cast<uint32_t>(value >> 32));
+    appendU32(out, static_cast<uint32_t>(value & 0xFFFFFFFF));
+}
+
+void appendString(std::string& out, const std::string& value) {
+    appendU32(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+void appendFrame(std::string& out, MessageType type, const std::string& payload) {
+    appendU32(out, static_cast<uint32_t>(payload.size() + 1));
+    out.push_back(static_cast<char>(type));
+    out.append(payload);
+}
+
+bool decodeFrame(const std::string& in, size_t& offset, Frame& frame, bool& invalid) {
+    invalid = false;
+    if (in.size() - offset < 4) {
+        return false;
+    }
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in.data() + offset);
+    uint32_t length = (static_cast<uint32_t>(bytes[0]) << 24) |
+                      (static_cast<uint32_t>(bytes[1]) << 16) |
+                      (static_cast<uint32_t>(bytes[2]) << 8) |
+                      static_cast<uint32_t>(bytes[3]);
+
+    // A frame always carries at least its type byte
+    if (length == 0 || length > MAX_FRAME_SIZE) {
+        invalid = true;
+        return false;
+    }
+    if (in.size() - offset - 4 < length) {
+        return false;
+    }
+
+    frame.type = static_cast<MessageType>(bytes[4]);
+    frame.payload.assign(in, offset + 5, length - 1);
+    offset += 4 + length;
+    return true;
+}
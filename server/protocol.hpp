@@ -0,0 +1,59 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Wire protocol used by server mode. Every message is a frame:
+ *
+ *   u32 length    big-endian, size of type + payload
+ *   u8  type      MessageType
+ *   ... payload
+ *
+ * Strings inside payloads are a big-endian u32 length followed by bytes.
+ * Row values are strings in display form; NULL is the length NULL_LENGTH
+ * with no bytes.
+ * The client sends QUERY frames; the server answers each one, in order.
+ * Every result set of the query is sent as COLUMNS followed by zero or
+ * more ROWS batches while the query runs; the answer ends with DONE, or
+ * with ERROR if a statement failed. Result sets of statements that ran
+ * before the failing one may precede the ERROR.
+ */
+enum class MessageType : uint8_t {
+    QUERY = 0x01,    // payload: SQL text (may hold several statements)
+
+    COLUMNS = 0x10,  // payload: u32 count, then count strings
+    ROWS = 0x11,     // payload: u32 rowCount, then rowCount * columnCount strings
+    DONE = 0x12,     // payload: u64 total rows sent for this query
+    ERROR = 0x13     // payload: error message text
+};
+
+// Length that marks a NULL value in a ROWS frame
+constexpr uint32_t NULL_LENGTH = 0xFFFFFFFF;
+
+// Largest frame accepted from a client
+constexpr uint32_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+// Rows sent per ROWS frame
+constexpr size_t ROWS_PER_BATCH = 1024;
+
+struct Frame {
+    MessageType type;
+    std::string payload;
+};
+
+// Append a complete frame to out
+void appendFrame(std::string& out, MessageType type, const std::string& payload);
+
+// Append primitive values in wire format
+void appendU32(std::string& out, uint32_t value);
+void appendU64(std::string& out, uint64_t value);
+void appendString(std::string& out, const std::string& value);
+
+// Try to decode one frame starting at offset. Returns false if more bytes
+// are needed; sets `invalid` if the frame can never be valid.
+bool decodeFrame(const std::string& in, size_t& offset, Frame& frame, bool& invalid);
+
+#endif // PROTOCOL_HPP
@@ -0,0 +1,580 @@
+#include "./server.hpp"
+#include "./protocol.hpp"
+#include "../executor/result_sink.hpp"
+#include <functional>
+#include <iostream>
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Per-client state
+struct Server::Connection {
+    int fd;
+    std::unique_ptr<Session> session;
+
+    // Event loop only
+    std::string input;                       // Bytes read but not yet decoded
+    std::deque<std::string> pendingQueries;  // Queries waiting for a worker
+    std::string output;                      // Encoded responses not yet written
+    size_t outputOffset = 0;
+    bool busy = false;                       // A worker is running a query
+    bool closed = false;
+    bool readClosed = false;                 // The client sends no more
+    bool wantRead = true;                    // EPOLLIN is registered
+    bool wantWrite = false;                  // EPOLLOUT is registered
+
+    // Shared with the worker running the connection's query: bytes it
+    // handed over that are not written yet, and whether they ever will be
+    std::mutex flowMutex;
+    std::condition_variable drained;
+    size_t unsentBytes = 0;
+    bool abandoned = false;
+
+    Connection(int fd, std::unique_ptr<Session> session)
+        : fd(fd), session(std::move(session)) {}
+};
+
+// Encodes result sets as COLUMNS and ROWS frames and passes them on one
+// batch at a time, so a large result is never held in memory as a whole
+class FrameSink : public ResultSink {
+public:
+    explicit FrameSink(std::function<void(std::string&)> send)
+        : send(std::move(send)) {}
+
+    void beginResult(const std::vector<std::string>& columnNames) override {
+        std::string payload;
+        appendU32(payload, static_cast<uint32_t>(columnNames.size()));
+        for (const auto& name : columnNames) {
+            appendString(payload, name);
+        }
+        appendFrame(pending, MessageType::COLUMNS, payload);
+    }
+
+    void addRow(const std::vector<Value>& values) override {
+        for (const auto& value : values) {
+            if (value.isNull()) {
+                appendU32(batch, NULL_LENGTH);
+                continue;
+            }
+            text.clear();
+            value.appendTo(text);
+            appendString(batch, text);
+        }
+        rowsSent++;
+        if (++batchRows == ROWS_PER_BATCH) {
+            finishBatch();
+            flush();
+        }
+    }
+
+    void endResult(size_t) override {
+        finishBatch();
+    }
+
+    void flush() override {
+        if (!pending.empty()) {
+            send(pending);
+            pending.clear();
+        }
+    }
+
+    uint64_t getRowsSent() const { return rowsSent; }
+
+private:
+    std::function<void(std::string&)> send;
+    std::string pending;  // Complete frames not yet passed on
+    std::string batch;    // Encoded rows of the open ROWS frame
+    std::string text;     // Display form of one value
+    size_t batchRows = 0;
+    uint64_t rowsSent = 0;
+
+    void finishBatch() {
+        if (batchRows == 0) {
+            return;
+        }
+        std::string payload;
+        payload.reserve(4 + batch.size());
+        appendU32(payload, static_cast<uint32_t>(batchRows));
+        payload += batch;
+        appendFrame(pending, MessageType::ROWS, payload);
+        batch.clear();
+        batchRows = 0;
+    }
+};
+
+Server::Server(DBEngine& engine, const ServerOptions& options)
+    : engine(engine), options(options), listenFd(-1), epollFd(-1), wakeFd(-1),
+      stopping(false) {}
+
+Server::~Server() {
+    // Let running queries finish before tearing connections down; those
+    // still sending output are stopped
+    for (auto& entry : connections) {
+        abandonQuery(entry.second);
+    }
+    workers.reset();
+
+    for (auto& entry : connections) {
+        close(entry.first);
+    }
+    connections.clear();
+
+    if (listenFd >= 0) {
+        close(listenFd);
+        if (options.address.compare(0, 5, "unix:") == 0) {
+            unlink(options.address.substr(5).c_str());
+        }
+    }
+    if (wakeFd >= 0) {
+        close(wakeFd);
+    }
+    if (epollFd >= 0) {
+        close(epollFd);
+    }
+}
+
+bool Server::start(std::string& errorMessage) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        errorMessage = std::string("Failed to create event loop: ") + std::strerror(errno);
+        return false;
+    }
+
+    if (!listenOn(options.address, errorMessage)) {
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    workers = std::make_unique<ThreadPool>(options.workerThreads);
+    return true;
+}
+
+bool Server::listenOn(const std::string& address, std::string& errorMessage) {
+    if (address.compare(0, 5, "unix:") == 0) {
+        // Unix domain socket
+        std::string path = address.substr(5);
+        sockaddr_un addr{};
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            errorMessage = "Invalid unix socket path: " + path;
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        unlink(path.c_str());
+        if (listenFd < 0 ||
+            bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            listen(listenFd, SOMAXCONN) < 0) {
+            errorMessage = "Failed to listen on " + address + ": " + std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // TCP, HOST:PORT with a numeric host; resolving names would need the
+    // shared NSS libraries at runtime, which the static build avoids
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        errorMessage = "Expected HOST:PORT or unix:PATH, got " + address;
+        return false;
+    }
+    std::string host = address.substr(0, colon);
+    int port = std::atoi(address.c_str() + colon + 1);
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);  // [::1]:5433
+    }
+    if (host.empty() || host == "*") {
+        host = "0.0.0.0";
+    } else if (host == "localhost") {
+        host = "127.0.0.1";
+    }
+    if (port <= 0 || port > 65535) {
+        errorMessage = "Invalid port in " + address;
+        return false;
+    }
+
+    sockaddr_storage storage{};
+    socklen_t length = 0;
+    auto* ipv4 = reinterpret_cast<sockaddr_in*>(&storage);
+    auto* ipv6 = reinterpret_cast<sockaddr_in6*>(&storage);
+    if (inet_pton(AF_INET, host.c_str(), &ipv4->sin_addr) == 1) {
+        ipv4->sin_family = AF_INET;
+        ipv4->sin_port = htons(static_cast<uint16_t>(port));
+        length = sizeof(sockaddr_in);
+    } else if (inet_pton(AF_INET6, host.c_str(), &ipv6->sin6_addr) == 1) {
+        ipv6->sin6_family = AF_INET6;
+        ipv6->sin6_port = htons(static_cast<uint16_t>(port));
+        length = sizeof(sockaddr_in6);
+    } else {
+        errorMessage = "Expected a numeric host address, got " + host;
+        return false;
+    }
+
+    listenFd = socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int yes = 1;
+    if (listenFd >= 0) {
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    }
+    if (listenFd < 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr*>(&storage), length) < 0 ||
+        listen(listenFd, SOMAXCONN) < 0) {
+        errorMessage = "Failed to listen on " + address + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void Server::run() {
+    std::vector<epoll_event> events(256);
+
+    while (!stopping.load()) {
+        int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            uint32_t flags = events[i].events;
+
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+            if (fd == wakeFd) {
+                uint64_t ignored;
+                while (read(wakeFd, &ignored, sizeof(ignored)) > 0) {
+                }
+                handleDeliveries();
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            std::shared_ptr<Connection> connection = it->second;
+
+            if (flags & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(connection);
+                continue;
+            }
+            if (flags & EPOLLIN) {
+                readFromConnection(connection);
+            }
+            if (!connection->closed && (flags & EPOLLOUT)) {
+                writeToConnection(connection);
+            }
+        }
+    }
+}
+
+void Server::stop() {
+    stopping.store(true);
+
+    // Only async-signal-safe calls here
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void Server::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        // Results are already batched, so send them right away
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+        auto connection = std::make_shared<Connection>(fd, engine.createSession());
+        connections[fd] = connection;
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void Server::readFromConnection(const std::shared_ptr<Connection>& connection) {
+    char buffer[64 * 1024];
+
+    // Read until enough queries wait; the rest stays in the socket, which
+    // slows the client down
+    while (!connection->readClosed &&
+           connection->pendingQueries.size() < options.maxPendingQueries) {
+        ssize_t n = read(connection->fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            connection->input.append(buffer, static_cast<size_t>(n));
+            if (!decodeQueries(connection)) {
+                return;
+            }
+            continue;
+        }
+        if (n == 0) {
+            // The client shut down its side, but still gets the results of
+            // the queries it sent
+            connection->readClosed = true;
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            closeConnection(connection);
+            return;
+        }
+        break;
+    }
+
+    dispatchNextQuery(connection);
+    updateInterest(connection);
+    closeWhenAnswered(connection);
+}
+
+bool Server::decodeQueries(const std::shared_ptr<Connection>& connection) {
+    // Decode complete frames while there is room in the queue
+    size_t offset = 0;
+    Frame frame;
+    bool invalid = false;
+    while (connection->pendingQueries.size() < options.maxPendingQueries &&
+           decodeFrame(connection->input, offset, frame, invalid)) {
+        if (frame.type != MessageType::QUERY) {
+            invalid = true;
+            break;
+        }
+        connection->pendingQueries.push_back(std::move(frame.payload));
+    }
+    if (invalid) {
+        closeConnection(connection);
+        return false;
+    }
+    connection->input.erase(0, offset);
+    return true;
+}
+
+void Server::dispatchNextQuery(const std::shared_ptr<Connection>& connection) {
+    // Queries of one connection run one at a time, in order
+    if (connection->busy || connection->pendingQueries.empty()) {
+        return;
+    }
+
+    connection->busy = true;
+    std::string query = std::move(connection->pendingQueries.front());
+    connection->pendingQueries.pop_front();
+
+    workers->submit([this, connection, query]() {
+        // Result batches go out while the query is still running
+        FrameSink sink([this, connection](std::string& bytes) {
+            deliver(connection, std::move(bytes), false);
+        });
+        ExecutionResult result = connection->session->executeQuery(query, sink);
+
+        std::string payload;
+        std::string tail;
+        if (result.success) {
+            appendU64(payload, sink.getRowsSent());
+            appendFrame(tail, MessageType::DONE, payload);
+        } else {
+            appendFrame(tail, MessageType::ERROR, result.errorMessage);
+        }
+        deliver(connection, std::move(tail), true);
+    });
+}
+
+void Server::deliver(const std::shared_ptr<Connection>& connection, std::string bytes,
+                     bool finished) {
+    {
+        // Wait while the client has too much output unsent. A query whose
+        // client has gone stops at its next block instead.
+        std::unique_lock<std::mutex> lock(connection->flowMutex);
+        if (!finished) {
+            connection->drained.wait(lock, [&] {
+                return connection->unsentBytes < options.maxUnsentBytes || connection->abandoned;
+            });
+            if (connection->abandoned) {
+                connection->session->interrupt();
+                return;
+            }
+        }
+        connection->unsentBytes += bytes.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(deliveriesMutex);
+        deliveries.push_back(Delivery{connection, std::move(bytes), finished});
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void Server::handleDeliveries() {
+    std::vector<Delivery> ready;
+    {
+        std::lock_guard<std::mutex> lock(deliveriesMutex);
+        ready.swap(deliveries);
+    }
+
+    for (auto& delivery : ready) {
+        const std::shared_ptr<Connection>& connection = delivery.connection;
+        if (delivery.finished) {
+            connection->busy = false;
+        }
+        if (connection->closed) {
+            continue;
+        }
+
+        connection->output.append(delivery.bytes);
+        writeToConnection(connection);
+
+        // The queue has room again, for queries already read and then for
+        // more input
+        if (delivery.finished && !connection->closed) {
+            dispatchNextQuery(connection);
+            if (decodeQueries(connection)) {
+                updateInterest(connection);
+                closeWhenAnswered(connection);
+            }
+        }
+    }
+}
+
+void Server::writeToConnection(const std::shared_ptr<Connection>& connection) {
+    size_t written = 0;
+    while (connection->outputOffset < connection->output.size()) {
+        ssize_t n = write(connection->fd,
+                          connection->output.data() + connection->outputOffset,
+                          connection->output.size() - connection->outputOffset);
+        if (n > 0) {
+            connection->outputOffset += static_cast<size_t>(n);
+            written += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        closeConnection(connection);
+        return;
+    }
+
+    if (connection->outputOffset == connection->output.size()) {
+        connection->output.clear();
+        connection->outputOffset = 0;
+    }
+    if (written > 0) {
+        // Let the query send more
+        std::lock_guard<std::mutex> lock(connection->flowMutex);
+        connection->unsentBytes -= written;
+        connection->drained.notify_all();
+    }
+    updateInterest(connection);
+    closeWhenAnswered(connection);
+}
+
+void Server::updateInterest(const std::shared_ptr<Connection>& connection) {
+    // Only ask for EPOLLOUT while there is unsent output, and for EPOLLIN
+    // while more queries may wait
+    bool wantRead = !connection->readClosed &&
+                    connection->pendingQueries.size() < options.maxPendingQueries;
+    bool wantWrite = !connection->output.empty();
+    if (wantRead == connection->wantRead && wantWrite == connection->wantWrite) {
+        return;
+    }
+
+    epoll_event event{};
+    if (wantRead) {
+        event.events |= EPOLLIN;
+    }
+    if (wantWrite) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.fd = connection->fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+    connection->wantRead = wantRead;
+    connection->wantWrite = wantWrite;
+}
+
+void Server::closeConnection(const std::shared_ptr<Connection>& connection) {
+    if (connection->closed) {
+        return;
+    }
+
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+    close(connection->fd);
+    connection->closed = true;
+    abandonQuery(connection);
+
+    // A worker may still hold the connection; its session goes away with
+    // the last reference
+    connections.erase(connection->fd);
+}
+
+void Server::closeWhenAnswered(const std::shared_ptr<Connection>& connection) {
+    if (!connection->closed && connection->readClosed && !connection->busy &&
+        connection->pendingQueries.empty() && connection->output.empty()) {
+        closeConnection(connection);
+    }
+}
+
+void Server::abandonQuery(const std::shared_ptr<Connection>& connection) {
+    std::lock_guard<std::mutex> lock(connection->flowMutex);
+    connection->abandoned = true;
+    connection->drained.notify_all();
+}
+
+#else
+
+// Server mode relies on epoll and is only available on Linux
+struct Server::Connection {};
+
+Server::Server(DBEngine& engine, const ServerOptions& options)
+    : engine(engine), options(options), listenFd(-1), epollFd(-1), wakeFd(-1),
+      stopping(false) {}
+
+Server::~Server() = default;
+
+bool Server::start(std::string& errorMessage) {
+    errorMessage = "Server mode is only supported on Linux";
+    return false;
+}
+
+void Server::run() {}
+
+void Server::stop() {
+    stopping.store(true);
+}
+
+#endif
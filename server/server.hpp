@@ -0,0 +1,91 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../include/db_engine.hpp"
+#include "../include/thread_pool.hpp"
+
+// Settings for server mode
+struct ServerOptions {
+    std::string address = "127.0.0.1:5433";  // HOST:PORT or unix:PATH
+    size_t workerThreads = 4;
+
+    // Flow control per connection: a query waits to send more while this
+    // much of its output is unsent, and the connection's input is not
+    // read while this many queries wait to run
+    size_t maxUnsentBytes = 4 * 1024 * 1024;
+    size_t maxPendingQueries = 64;
+};
+
+/**
+ * Multi-client front end. One thread multiplexes all connections on an
+ * epoll event loop; queries are executed on a worker pool, each
+ * connection with its own session. A client that does not read its
+ * results holds up its own query, not the server's memory. See
+ * protocol.hpp for the wire format.
+ */
+class Server {
+public:
+    Server(DBEngine& engine, const ServerOptions& options);
+    ~Server();
+
+    // Bind and listen on the configured address
+    bool start(std::string& errorMessage);
+
+    // Run the event loop until stop() is called
+    void run();
+
+    // Ask the event loop to exit; safe to call from a signal handler
+    void stop();
+
+private:
+    struct Connection;
+
+    DBEngine& engine;
+    ServerOptions options;
+    int listenFd;
+    int epollFd;
+    int wakeFd;  // eventfd used by workers and stop() to wake the loop
+    std::atomic<bool> stopping;
+    std::unique_ptr<ThreadPool> workers;
+
+    // Owned by the event loop thread
+    std::unordered_map<int, std::shared_ptr<Connection>> connections;
+
+    // Encoded output of a running query, handed from a worker to the loop
+    struct Delivery {
+        std::shared_ptr<Connection> connection;
+        std::string bytes;
+        bool finished;  // Last part of the response; the query is done
+    };
+    std::mutex deliveriesMutex;
+    std::vector<Delivery> deliveries;
+
+    bool listenOn(const std::string& address, std::string& errorMessage);
+    void acceptConnections();
+    void readFromConnection(const std::shared_ptr<Connection>& connection);
+    bool decodeQueries(const std::shared_ptr<Connection>& connection);
+    void writeToConnection(const std::shared_ptr<Connection>& connection);
+    void dispatchNextQuery(const std::shared_ptr<Connection>& connection);
+    void deliver(const std::shared_ptr<Connection>& connection, std::string bytes, bool finished);
+    void handleDeliveries();
+    void closeConnection(const std::shared_ptr<Connection>& connection);
+
+    // Close a connection whose client shut down its side once every query
+    // it sent is answered and written
+    void closeWhenAnswered(const std::shared_ptr<Connection>& connection);
+    void updateInterest(const std::shared_ptr<Connection>& connection);
+
+    // The connection's output will not be sent: its query stops when it
+    // next sends any, waking up if it waits to
+    void abandonQuery(const std::shared_ptr<Connection>& connection);
+};
+
+#endif // SERVER_HPP
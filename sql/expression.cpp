@@ -0,0 +1,153 @@
+#include "./expression.hpp"
+#include "../include/arena.hpp"
+
+// Binding strength of an operator; higher binds tighter
+static int precedence(ExprOp op) {
+    switch (op) {
+        case ExprOp::OR: return 1;
+        case ExprOp::AND: return 2;
+        case ExprOp::NOT: return 3;
+        case ExprOp::EQUAL:
+        case ExprOp::NOT_EQUAL:
+        case ExprOp::LESS:
+        case ExprOp::LESS_EQUAL:
+        case ExprOp::GREATER:
+        case ExprOp::GREATER_EQUAL:
+        case ExprOp::LIKE:
+        case ExprOp::ILIKE:
+        case ExprOp::IS_NULL:
+        case ExprOp::IS_NOT_NULL: return 4;
+        case ExprOp::ADD:
+        case ExprOp::SUBTRACT: return 5;
+        case ExprOp::MULTIPLY:
+        case ExprOp::DIVIDE:
+        case ExprOp::MODULO: return 6;
+        case ExprOp::NEGATE: return 7;
+    }
+    return 8;
+}
+
+static const char* typeName(TokenType type) {
+    switch (type) {
+        case TokenType::INTEGER: return "INTEGER";
+        case TokenType::REAL: return "REAL";
+        default: return "TEXT";
+    }
+}
+
+const char* operatorName(ExprOp op) {
+    switch (op) {
+        case ExprOp::ADD: return "+";
+        case ExprOp::SUBTRACT: return "-";
+        case ExprOp::MULTIPLY: return "*";
+        case ExprOp::DIVIDE: return "/";
+        case ExprOp::MODULO: return "%";
+        case ExprOp::EQUAL: return "=";
+        case ExprOp::NOT_EQUAL: return "!=";
+        case ExprOp::LESS: return "<";
+        case ExprOp::LESS_EQUAL: return "<=";
+        case ExprOp::GREATER: return ">";
+        case ExprOp::GREATER_EQUAL: return ">=";
+        case ExprOp::LIKE: return "LIKE";
+        case ExprOp::ILIKE: return "ILIKE";
+        case ExprOp::AND: return "AND";
+        case ExprOp::OR: return "OR";
+        case ExprOp::NEGATE: return "-";
+        case ExprOp::NOT: return "NOT";
+        case ExprOp::IS_NULL: return "IS NULL";
+        case ExprOp::IS_NOT_NULL: return "IS NOT NULL";
+    }
+    return "?";
+}
+
+std::shared_ptr<Expression> Expression::literal(Value value) {
+    auto node = makePooled<Expression>(Kind::LITERAL);
+    node->value = std::move(value);
+    return node;
+}
+
+std::shared_ptr<Expression> Expression::column(const std::string& name) {
+    auto node = makePooled<Expression>(Kind::COLUMN);
+    node->name = name;
+    return node;
+}
+
+std::shared_ptr<Expression> Expression::unary(ExprOp op, std::shared_ptr<Expression> operand) {
+    auto node = makePooled<Expression>(Kind::UNARY);
+    node->op = op;
+    node->operands.push_back(std::move(operand));
+    return node;
+}
+
+std::shared_ptr<Expression> Expression::binary(ExprOp op, std::shared_ptr<Expression> left,
+                                               std::shared_ptr<Expression> right) {
+    auto node = makePooled<Expression>(Kind::BINARY);
+    node->op = op;
+    node->operands.push_back(std::move(left));
+    node->operands.push_back(std::move(right));
+    return node;
+}
+
+std::shared_ptr<Expression> Expression::cast(std::shared_ptr<Expression> operand, TokenType type) {
+    auto node = makePooled<Expression>(Kind::CAST);
+    node->castType = type;
+    node->operands.push_back(std::move(operand));
+    return node;
+}
+
+std::shared_ptr<Expression> Expression::function(const std::string& name,
+                                                 std::vector<std::shared_ptr<Expression>> arguments) {
+    auto node = makePooled<Expression>(Kind::FUNCTION);
+    node->name = name;
+    node->operands = std::move(arguments);
+    return node;
+}
+
+std::string Expression::toString() const {
+    return toString(0);
+}
+
+std::string Expression::toString(int parentPrecedence) const {
+    switch (kind) {
+        case Kind::LITERAL:
+            // Negative numbers read like a negation
+            if (value.isNumeric() && value.asReal() < 0 && parentPrecedence >= precedence(ExprOp::NEGATE)) {
+                return "(" + value.toLiteral() + ")";
+            }
+            return value.toLiteral();
+
+        case Kind::COLUMN:
+            return name;
+
+        case Kind::CAST:
+            return "CAST(" + operands[0]->toString() + " AS " + typeName(castType) + ")";
+
+        case Kind::FUNCTION: {
+            std::string text = name + "(";
+            for (size_t i = 0; i < operands.size(); i++) {
+                text += (i > 0 ? ", " : "") + operands[i]->toString();
+            }
+            return text + ")";
+        }
+
+        case Kind::UNARY:
+        case Kind::BINARY:
+            break;
+    }
+
+    int own = precedence(op);
+    std::string text;
+    if (op == ExprOp::NEGATE) {
+        text = "-" + operands[0]->toString(own);
+    } else if (op == ExprOp::NOT) {
+        text = "NOT " + operands[0]->toString(own);
+    } else if (kind == Kind::UNARY) {
+        text = operands[0]->toString(own) + " " + operatorName(op);
+    } else {
+        // Operators are left-associative, so the right side of a - (b - c)
+        // needs parentheses at equal precedence
+        text = operands[0]->toString(own) + " " + operatorName(op) + " " +
+               operands[1]->toString(own + 1);
+    }
+    return own < parentPrecedence ? "(" + text + ")" : text;
+}
@@ -0,0 +1,77 @@
+#ifndef EXPRESSION_HPP
+#define EXPRESSION_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "./token.hpp"
+#include "./value.hpp"
+
+// Operators of unary and binary expressions
+enum class ExprOp {
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    MODULO,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    LIKE,
+    ILIKE,
+    AND,
+    OR,
+    NEGATE,
+    NOT,
+    IS_NULL,
+    IS_NOT_NULL
+};
+
+/**
+ * Node of a scalar expression as written in a SELECT list, a WHERE clause
+ * or a SET assignment. The parser builds the tree; CompiledExpression
+ * turns it into closures bound to one table before it runs.
+ */
+struct Expression {
+    enum class Kind {
+        LITERAL,
+        COLUMN,
+        UNARY,
+        BINARY,
+        CAST,
+        FUNCTION
+    };
+
+    Kind kind;
+    Value value;                              // LITERAL
+    std::string name;                         // COLUMN, or FUNCTION in upper case
+    ExprOp op = ExprOp::ADD;                  // UNARY and BINARY
+    TokenType castType = TokenType::INVALID;  // CAST target: INTEGER, REAL or TEXT
+    std::vector<std::shared_ptr<Expression>> operands;
+
+    explicit Expression(Kind kind) : kind(kind) {}
+
+    // Nodes come from the long-lived pool, like the statements holding them
+    static std::shared_ptr<Expression> literal(Value value);
+    static std::shared_ptr<Expression> column(const std::string& name);
+    static std::shared_ptr<Expression> unary(ExprOp op, std::shared_ptr<Expression> operand);
+    static std::shared_ptr<Expression> binary(ExprOp op, std::shared_ptr<Expression> left,
+                                              std::shared_ptr<Expression> right);
+    static std::shared_ptr<Expression> cast(std::shared_ptr<Expression> operand, TokenType type);
+    static std::shared_ptr<Expression> function(const std::string& name,
+                                                std::vector<std::shared_ptr<Expression>> arguments);
+
+    // SQL text, with parentheses only where precedence needs them
+    std::string toString() const;
+
+private:
+    std::string toString(int parentPrecedence) const;
+};
+
+// SQL spelling of an operator, e.g. "<=" or "IS NOT NULL"
+const char* operatorName(ExprOp op);
+
+#endif // EXPRESSION_HPP
@@ -0,0 +1,125 @@
+#include "./like_pattern.hpp"
+#include <cstring>
+
+static char foldCase(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+LikePattern::LikePattern(std::string_view pattern, bool ignoreCase) : ignoreCase(ignoreCase) {
+    segments.emplace_back();
+    std::string run;
+    auto endRun = [this, &run]() {
+        if (!run.empty()) {
+            runs.push_back(std::move(run));
+            run.clear();
+        }
+    };
+
+    for (size_t i = 0; i < pattern.size(); i++) {
+        char c = pattern[i];
+        bool escaped = c == '\\' && i + 1 < pattern.size();
+        if (escaped) {
+            c = pattern[++i];
+        }
+        if (!escaped && c == '%') {
+            anchored = false;
+            segments.emplace_back();
+            endRun();
+            continue;
+        }
+
+        Segment& segment = segments.back();
+        bool wildcard = !escaped && c == '_';
+        segment.text += ignoreCase ? foldCase(c) : c;
+        segment.wildcards.push_back(wildcard);
+        if (wildcard) {
+            segment.plain = false;
+            endRun();
+        } else {
+            run += c;
+        }
+    }
+    endRun();
+
+    for (Segment& segment : segments) {
+        segment.anchor = 0;
+        while (segment.anchor < segment.text.size() && segment.wildcards[segment.anchor]) {
+            segment.anchor++;
+        }
+    }
+}
+
+bool LikePattern::matches(std::string_view text) const {
+    if (ignoreCase) {
+        folded.assign(text.data(), text.size());
+        for (char& c : folded) {
+            c = foldCase(c);
+        }
+        text = folded;
+    }
+
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    const Segment& first = segments.front();
+    if (anchored) {
+        return text.size() == first.text.size() && matchesAt(first, begin);
+    }
+
+    // The ends are fixed; the segments between take the leftmost place
+    // that leaves the most room for the rest
+    const Segment& last = segments.back();
+    if (text.size() < first.text.size() + last.text.size() ||
+        !matchesAt(first, begin) || !matchesAt(last, end - last.text.size())) {
+        return false;
+    }
+    begin += first.text.size();
+    end -= last.text.size();
+    for (size_t i = 1; i + 1 < segments.size(); i++) {
+        const char* found = find(segments[i], begin, end);
+        if (found == nullptr) {
+            return false;
+        }
+        begin = found + segments[i].text.size();
+    }
+    return true;
+}
+
+bool LikePattern::matchesAt(const Segment& segment, const char* text) const {
+    if (segment.plain) {
+        return segment.text.empty() || std::memcmp(text, segment.text.data(), segment.text.size()) == 0;
+    }
+    for (size_t i = 0; i < segment.text.size(); i++) {
+        if (!segment.wildcards[i] && text[i] != segment.text[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* LikePattern::find(const Segment& segment, const char* begin, const char* end) const {
+    size_t size = segment.text.size();
+    if (static_cast<size_t>(end - begin) < size) {
+        return nullptr;
+    }
+    if (segment.anchor == size) {
+        return begin;  // Only '_', so any place fits
+    }
+
+    // Candidates are where the first literal byte occurs; memchr skips
+    // to them many bytes at a time
+    char wanted = segment.text[segment.anchor];
+    const char* from = begin + segment.anchor;
+    const char* limit = end - size + segment.anchor + 1;
+    while (from < limit) {
+        const char* hit = static_cast<const char*>(std::memchr(from, wanted, static_cast<size_t>(limit - from)));
+        if (hit == nullptr) {
+            return nullptr;
+        }
+        const char* start = hit - segment.anchor;
+        if (matchesAt(segment, start)) {
+            return start;
+        }
+        from = hit + 1;
+    }
+    return nullptr;
+}
@@ -0,0 +1,51 @@
+#ifndef LIKE_PATTERN_HPP
+#define LIKE_PATTERN_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Pattern of LIKE and ILIKE, compiled once. '%' matches any run of
+ * characters, '_' any single one, and a backslash makes the character
+ * after it literal. Characters are bytes; ILIKE folds ASCII letters only.
+ *
+ * The pattern is split at '%' into segments: the first must start the
+ * text, the last must end it, and the ones between are found leftmost
+ * first, a memchr on a segment byte at a time. So prefix, suffix and
+ * contains patterns cost one compare or one search, and no pattern
+ * backtracks. Not thread-safe: ILIKE folds the text into a buffer.
+ */
+class LikePattern {
+public:
+    LikePattern(std::string_view pattern, bool ignoreCase);
+
+    bool matches(std::string_view text) const;
+
+    // Runs of literal characters in the pattern, as written; a matching
+    // text contains every one of them
+    const std::vector<std::string>& literals() const { return runs; }
+
+private:
+    // Text between two '%'. wildcards[i] is true where text[i] was '_'.
+    struct Segment {
+        std::string text;
+        std::vector<bool> wildcards;
+        bool plain = true;  // No '_'
+        size_t anchor = 0;  // First literal position, text.size() if none
+    };
+
+    bool ignoreCase;
+    bool anchored = true;  // No '%' at all: the one segment is the whole text
+    std::vector<Segment> segments;
+    std::vector<std::string> runs;
+    mutable std::string folded;
+
+    bool matchesAt(const Segment& segment, const char* text) const;
+
+    // Leftmost position in [begin, end) where the segment matches, or
+    // nullptr
+    const char* find(const Segment& segment, const char* begin, const char* end) const;
+};
+
+#endif // LIKE_PATTERN_HPP
@@ -1,11 +1,46 @@
 #include "./parser.hpp"
+#include "../include/arena.hpp"
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 
+// Nanoseconds since `start`
+static uint64_t elapsedSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+// Value of a quoted string literal, with doubled quotes ('it''s') collapsed
+static Value stringValue(std::string_view lexeme) {
+    char quote = lexeme.front();
+    std::string_view body = lexeme.substr(1, lexeme.size() - 2);
+    if (body.find(quote) == std::string_view::npos) {
+        return Value::text(body);
+    }
+    
+    std::string text;
+    text.reserve(body.size());
+    for (size_t i = 0; i < body.size(); i++) {
+        text += body[i];
+        if (body[i] == quote) {
+            i++;
+        }
+    }
+    return Value::text(text);
+}
+
+// EXPLAIN ANALYZE reports how long its query took to parse
+static void recordParseTime(const std::shared_ptr<Statement>& statement, uint64_t parseNs) {
+    if (statement->type == Statement::Type::EXPLAIN) {
+        std::static_pointer_cast<ExplainStatement>(statement)->parseNs = parseNs;
+    }
+}
 
-ParseResult Parser::parse(const std::string& query) {
+ParseResult Parser::parse(const std::string& query, std::pmr::memory_resource* arena) {
+    auto start = std::chrono::steady_clock::now();
     Tokenizer tokenizer(query);
-    tokens = tokenizer.scanTokens();
+    std::pmr::vector<Token> scanned = tokenizer.scanTokens(arena);
+    tokens = &scanned;
     current = 0;
     
     try {
@@ -16,10 +51,104 @@ ParseResult Parser::parse(const std::string& query) {
             return {false, nullptr, "Unexpected tokens after statement"};
         }
         
+        recordParseTime(stmt, elapsedSince(start));
         return {true, stmt, ""};
     } catch (const std::string& error) {
         return {false, nullptr, error};
+    } catch (const char* error) {
+        return {false, nullptr, error};
+    }
+}
+
+ScriptParseResult Parser::parseScript(const std::string& script,
+                                      std::pmr::memory_resource* arena) {
+    auto start = std::chrono::steady_clock::now();
+    Tokenizer tokenizer(script);
+    std::pmr::vector<Token> scanned = tokenizer.scanTokens(arena);
+    tokens = &scanned;
+    current = 0;
+    
+    ScriptParseResult result = {true, {}, ""};
+    
+    try {
+        while (true) {
+            // Skip empty statements
+            while (match({TokenType::SEMICOLON})) {
+            }
+            if (isAtEnd()) {
+                break;
+            }
+            
+            result.statements.push_back(statement());
+        }
+    } catch (const std::string& error) {
+        return {false, {}, scriptError(error)};
+    } catch (const char* error) {
+        return {false, {}, scriptError(error)};
+    }
+    
+    uint64_t parseNs = elapsedSince(start);
+    for (const auto& statement : result.statements) {
+        recordParseTime(statement, parseNs);
     }
+    return result;
+}
+
+ParseResult Parser::parseTokens(const std::pmr::vector<Token>& scanned) {
+    auto start = std::chrono::steady_clock::now();
+    tokens = &scanned;
+    current = 0;
+    
+    try {
+        // The statement's ';' comes with its tokens
+        std::shared_ptr<Statement> stmt = statement();
+        if (!isAtEnd()) {
+            return {false, nullptr, scriptError("Unexpected tokens after statement")};
+        }
+        
+        recordParseTime(stmt, elapsedSince(start));
+        return {true, stmt, ""};
+    } catch (const std::string& error) {
+        return {false, nullptr, scriptError(error)};
+    } catch (const char* error) {
+        return {false, nullptr, scriptError(error)};
+    }
+}
+
+ParseResult Parser::parseInsertHeader(const std::pmr::vector<Token>& scanned) {
+    tokens = &scanned;
+    current = 0;
+    
+    try {
+        consume(TokenType::INSERT, "Expected 'INSERT'");
+        auto stmt = makePooled<InsertStatement>();
+        insertHeader(*stmt);
+        return {true, stmt, ""};
+    } catch (const std::string& error) {
+        return {false, nullptr, scriptError(error)};
+    } catch (const char* error) {
+        return {false, nullptr, scriptError(error)};
+    }
+}
+
+bool Parser::parseRow(const std::pmr::vector<Token>& scanned, std::vector<Value>& values,
+                      bool& last, std::string& errorMessage) {
+    tokens = &scanned;
+    current = 0;
+    
+    try {
+        values = valuesRow();
+        if (!match({TokenType::COMMA})) {
+            consume(TokenType::SEMICOLON, "Expected ';' after INSERT statement");
+            last = true;
+        }
+        return true;
+    } catch (const std::string& error) {
+        errorMessage = scriptError(error);
+    } catch (const char* error) {
+        errorMessage = scriptError(error);
+    }
+    return false;
 }
 
 bool Parser::isAtEnd() const {
@@ -27,11 +156,11 @@ bool Parser::isAtEnd() const {
 }
 
 Token Parser::peek() const {
-    return tokens[current];
+    return (*tokens)[current];
 }
 
 Token Parser::previous() const {
-    return tokens[current - 1];
+    return (*tokens)[current - 1];
 }
 
 Token Parser::advance() {
@@ -48,7 +177,7 @@ bool Parser::check(TokenType type) const {
     return peek().type == type;
 }
 
-bool Parser::match(const std::vector<TokenType>& types) {
+bool Parser::match(std::initializer_list<TokenType> types) {
     for (TokenType type : types) {
         if (check(type)) {
             advance();
@@ -58,6 +187,20 @@ bool Parser::match(const std::vector<TokenType>& types) {
     return false;
 }
 
+bool Parser::matchWord(const char* word) {
+    if (!check(TokenType::IDENTIFIER)) {
+        return false;
+    }
+    
+    std::string text(peek().lexeme);
+    std::transform(text.begin(), text.end(), text.begin(), ::toupper);
+    if (text != word) {
+        return false;
+    }
+    advance();
+    return true;
+}
+
 bool Parser::consume(TokenType type, const std::string& message) {
     if (check(type)) {
         advance();
@@ -70,24 +213,218 @@ ParseResult Parser::error(const std::string& message) {
     return {false, nullptr, message};
 }
 
+Value Parser::literal(const std::string& message) {
+    if (match({TokenType::STRING_LITERAL})) {
+        return stringValue(previous().lexeme);
+    }
+    if (match({TokenType::NULL_LITERAL})) {
+        return Value::null();
+    }
+    
+    // Numbers, with an optional sign
+    bool negative = match({TokenType::MINUS});
+    if (!match({TokenType::INTEGER_LITERAL, TokenType::FLOAT_LITERAL})) {
+        throw message;
+    }
+    TokenType type = previous().type == TokenType::INTEGER_LITERAL ? TokenType::INTEGER
+                                                                   : TokenType::REAL;
+    
+    // Integers too large for 64 bits become reals
+    if (!negative) {
+        return Value::parse(previous().lexeme, type);
+    }
+    std::string digits = "-" + std::string(previous().lexeme);
+    return Value::parse(digits, type);
+}
+
+std::shared_ptr<Expression> Parser::expression() {
+    return logicOr();
+}
+
+std::shared_ptr<Expression> Parser::logicOr() {
+    std::shared_ptr<Expression> left = logicAnd();
+    while (match({TokenType::OR})) {
+        left = Expression::binary(ExprOp::OR, left, logicAnd());
+    }
+    return left;
+}
+
+std::shared_ptr<Expression> Parser::logicAnd() {
+    std::shared_ptr<Expression> left = logicNot();
+    while (match({TokenType::AND})) {
+        left = Expression::binary(ExprOp::AND, left, logicNot());
+    }
+    return left;
+}
+
+std::shared_ptr<Expression> Parser::logicNot() {
+    if (match({TokenType::NOT})) {
+        return Expression::unary(ExprOp::NOT, logicNot());
+    }
+    return comparison();
+}
+
+std::shared_ptr<Expression> Parser::comparison() {
+    std::shared_ptr<Expression> left = term();
+    while (true) {
+        ExprOp op;
+        if (match({TokenType::EQUALS})) {
+            op = ExprOp::EQUAL;
+        } else if (match({TokenType::NOT_EQUALS})) {
+            op = ExprOp::NOT_EQUAL;
+        } else if (match({TokenType::LESS})) {
+            op = ExprOp::LESS;
+        } else if (match({TokenType::LESS_EQUAL})) {
+            op = ExprOp::LESS_EQUAL;
+        } else if (match({TokenType::GREATER})) {
+            op = ExprOp::GREATER;
+        } else if (match({TokenType::GREATER_EQUAL})) {
+            op = ExprOp::GREATER_EQUAL;
+        } else if (match({TokenType::LIKE, TokenType::ILIKE})) {
+            op = previous().type == TokenType::LIKE ? ExprOp::LIKE : ExprOp::ILIKE;
+        } else if (check(TokenType::NOT) && ((*tokens)[current + 1].type == TokenType::LIKE ||
+                                             (*tokens)[current + 1].type == TokenType::ILIKE)) {
+            // x NOT LIKE pattern is NOT (x LIKE pattern)
+            advance();
+            op = advance().type == TokenType::LIKE ? ExprOp::LIKE : ExprOp::ILIKE;
+            left = Expression::unary(ExprOp::NOT, Expression::binary(op, left, term()));
+            continue;
+        } else if (match({TokenType::IS})) {
+            // x IS NULL, x IS NOT NULL
+            bool negated = match({TokenType::NOT});
+            consume(TokenType::NULL_LITERAL, "Expected 'NULL' after 'IS'");
+            left = Expression::unary(negated ? ExprOp::IS_NOT_NULL : ExprOp::IS_NULL, left);
+            continue;
+        } else {
+            return left;
+        }
+        left = Expression::binary(op, left, term());
+    }
+}
+
+std::shared_ptr<Expression> Parser::term() {
+    std::shared_ptr<Expression> left = factor();
+    while (match({TokenType::PLUS, TokenType::MINUS})) {
+        ExprOp op = previous().type == TokenType::PLUS ? ExprOp::ADD : ExprOp::SUBTRACT;
+        left = Expression::binary(op, left, factor());
+    }
+    return left;
+}
+
+std::shared_ptr<Expression> Parser::factor() {
+    std::shared_ptr<Expression> left = unary();
+    while (match({TokenType::STAR, TokenType::SLASH, TokenType::PERCENT})) {
+        ExprOp op = previous().type == TokenType::STAR ? ExprOp::MULTIPLY
+                  : previous().type == TokenType::SLASH ? ExprOp::DIVIDE
+                                                        : ExprOp::MODULO;
+        left = Expression::binary(op, left, unary());
+    }
+    return left;
+}
+
+std::shared_ptr<Expression> Parser::unary() {
+    if (check(TokenType::MINUS)) {
+        // A signed number is one literal, so the smallest integer fits
+        TokenType next = (*tokens)[current + 1].type;
+        if (next == TokenType::INTEGER_LITERAL || next == TokenType::FLOAT_LITERAL) {
+            return Expression::literal(literal("Expected number"));
+        }
+        advance();
+        return Expression::unary(ExprOp::NEGATE, unary());
+    }
+    return primary();
+}
+
+std::shared_ptr<Expression> Parser::primary() {
+    if (check(TokenType::STRING_LITERAL) || check(TokenType::NULL_LITERAL) ||
+        check(TokenType::INTEGER_LITERAL) || check(TokenType::FLOAT_LITERAL)) {
+        return Expression::literal(literal("Expected value"));
+    }
+    
+    // CAST(expression AS type)
+    if (match({TokenType::CAST})) {
+        consume(TokenType::LEFT_PAREN, "Expected '(' after 'CAST'");
+        std::shared_ptr<Expression> operand = expression();
+        consume(TokenType::AS, "Expected 'AS' in CAST");
+        if (!match({TokenType::INTEGER, TokenType::TEXT, TokenType::REAL})) {
+            throw "Expected type (INTEGER, TEXT, REAL) in CAST";
+        }
+        TokenType type = previous().type;
+        consume(TokenType::RIGHT_PAREN, "Expected ')' after CAST");
+        return Expression::cast(operand, type);
+    }
+    
+    // A column, or a function call such as ROUND(score, 1)
+    if (match({TokenType::IDENTIFIER})) {
+        std::string name(previous().lexeme);
+        if (!match({TokenType::LEFT_PAREN})) {
+            return Expression::column(name);
+        }
+        
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        std::vector<std::shared_ptr<Expression>> arguments;
+        if (!check(TokenType::RIGHT_PAREN)) {
+            do {
+                arguments.push_back(expression());
+            } while (match({TokenType::COMMA}));
+        }
+        consume(TokenType::RIGHT_PAREN, "Expected ')' after arguments to " + name);
+        return Expression::function(name, std::move(arguments));
+    }
+    
+    if (match({TokenType::LEFT_PAREN})) {
+        std::shared_ptr<Expression> inner = expression();
+        consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
+        return inner;
+    }
+    
+    throw "Expected expression but found: " + std::string(peek().lexeme);
+}
+
+std::string Parser::scriptError(const std::string& message) const {
+    // Point at the failing line when the script has more than one
+    if (tokens->back().line > 1) {
+        return "Line " + std::to_string(peek().line) + ": " + message;
+    }
+    return message;
+}
+
 std::shared_ptr<Statement> Parser::statement() {
     if (match({TokenType::CREATE})) {
+        if (matchWord("INDEX")) {
+            return createIndex();
+        }
+        if (matchWord("MATERIALIZED")) {
+            return createView();
+        }
         return createTable();
+    } else if (matchWord("ALTER")) {
+        return alterTable();
     } else if (match({TokenType::INSERT})) {
         return insertStatement();
     } else if (match({TokenType::SELECT})) {
         return selectStatement();
     } else if (match({TokenType::DELETE})) {
         return deleteStatement();
+    } else if (match({TokenType::UPDATE})) {
+        return updateStatement();
+    } else if (match({TokenType::EXPLAIN})) {
+        return explainStatement();
+    } else if (match({TokenType::BEGIN})) {
+        return transactionStatement(Statement::Type::BEGIN_TRANSACTION);
+    } else if (match({TokenType::COMMIT})) {
+        return transactionStatement(Statement::Type::COMMIT);
+    } else if (match({TokenType::ROLLBACK})) {
+        return transactionStatement(Statement::Type::ROLLBACK);
     }
     
-    throw "Unexpected token: " + peek().lexeme;
+    throw "Unexpected token: " + std::string(peek().lexeme);
 }
 
 std::shared_ptr<CreateTableStatement> Parser::createTable() {
     consume(TokenType::TABLE, "Expected 'TABLE' after 'CREATE'");
     
-    auto stmt = std::make_shared<CreateTableStatement>();
+    auto stmt = makePooled<CreateTableStatement>();
     
     // Parse table name
     consume(TokenType::IDENTIFIER, "Expected table name");
@@ -98,7 +435,7 @@ std::shared_ptr<CreateTableStatement> Parser::createTable() {
     
     // Parse first column
     consume(TokenType::IDENTIFIER, "Expected column name");
-    std::string colName = previous().lexeme;
+    std::string colName(previous().lexeme);
     
     // Parse column type
     if (!match({TokenType::INTEGER, TokenType::TEXT, TokenType::REAL})) {
@@ -110,26 +447,21 @@ std::shared_ptr<CreateTableStatement> Parser::createTable() {
     bool isNotNull = false;
     
     // Check for column constraints
-    while (match({TokenType::IDENTIFIER})) {
-        std::string constraint = previous().lexeme;
+    while (match({TokenType::IDENTIFIER, TokenType::NOT})) {
+        std::string constraint(previous().lexeme);
         std::transform(constraint.begin(), constraint.end(), constraint.begin(), ::toupper);
         
         if (constraint == "PRIMARY" && match({TokenType::IDENTIFIER})) {
-            std::string keyWord = previous().lexeme;
+            std::string keyWord(previous().lexeme);
             std::transform(keyWord.begin(), keyWord.end(), keyWord.begin(), ::toupper);
             if (keyWord == "KEY") {
                 isPrimary = true;
             } else {
                 throw "Expected 'KEY' after 'PRIMARY'";
             }
-        } else if (constraint == "NOT" && match({TokenType::IDENTIFIER})) {
-            std::string nullWord = previous().lexeme;
-            std::transform(nullWord.begin(), nullWord.end(), nullWord.begin(), ::toupper);
-            if (nullWord == "NULL") {
-                isNotNull = true;
-            } else {
-                throw "Expected 'NULL' after 'NOT'";
-            }
+        } else if (constraint == "NOT") {
+            consume(TokenType::NULL_LITERAL, "Expected 'NULL' after 'NOT'");
+            isNotNull = true;
         }
     }
     
@@ -150,26 +482,21 @@ std::shared_ptr<CreateTableStatement> Parser::createTable() {
         isNotNull = false;
         
         // Check for column constraints
-        while (match({TokenType::IDENTIFIER})) {
-            std::string constraint = previous().lexeme;
+        while (match({TokenType::IDENTIFIER, TokenType::NOT})) {
+            std::string constraint(previous().lexeme);
             std::transform(constraint.begin(), constraint.end(), constraint.begin(), ::toupper);
             
             if (constraint == "PRIMARY" && match({TokenType::IDENTIFIER})) {
-                std::string keyWord = previous().lexeme;
+                std::string keyWord(previous().lexeme);
                 std::transform(keyWord.begin(), keyWord.end(), keyWord.begin(), ::toupper);
                 if (keyWord == "KEY") {
                     isPrimary = true;
                 } else {
                     throw "Expected 'KEY' after 'PRIMARY'";
                 }
-            } else if (constraint == "NOT" && match({TokenType::IDENTIFIER})) {
-                std::string nullWord = previous().lexeme;
-                std::transform(nullWord.begin(), nullWord.end(), nullWord.begin(), ::toupper);
-                if (nullWord == "NULL") {
-                    isNotNull = true;
-                } else {
-                    throw "Expected 'NULL' after 'NOT'";
-                }
+            } else if (constraint == "NOT") {
+                consume(TokenType::NULL_LITERAL, "Expected 'NULL' after 'NOT'");
+                isNotNull = true;
             }
         }
         
@@ -178,96 +505,290 @@ std::shared_ptr<CreateTableStatement> Parser::createTable() {
     }
     
     consume(TokenType::RIGHT_PAREN, "Expected ')' after column definitions");
+    
+    if (matchWord("PARTITION")) {
+        partitionBy(stmt->partitioning);
+    } else if (matchWord("WITH")) {
+        timeSeriesOptions(stmt->partitioning);
+    }
     consume(TokenType::SEMICOLON, "Expected ';' after CREATE TABLE statement");
     
     return stmt;
 }
 
-std::shared_ptr<InsertStatement> Parser::insertStatement() {
-    consume(TokenType::INTO, "Expected 'INTO' after 'INSERT'");
+void Parser::partitionBy(PartitionSpec& spec) {
+    if (!matchWord("BY")) {
+        throw "Expected 'BY' after 'PARTITION'";
+    }
+    if (matchWord("RANGE")) {
+        spec.method = PartitionSpec::Method::RANGE;
+    } else if (matchWord("HASH")) {
+        spec.method = PartitionSpec::Method::HASH;
+    } else {
+        throw "Expected 'RANGE' or 'HASH' after 'PARTITION BY'";
+    }
+    consume(TokenType::LEFT_PAREN, "Expected '(' before partition key");
+    consume(TokenType::IDENTIFIER, "Expected partition key column");
+    spec.column = previous().lexeme;
+    consume(TokenType::RIGHT_PAREN, "Expected ')' after partition key");
+    
+    // HASH (column) PARTITIONS <count>
+    if (spec.method == PartitionSpec::Method::HASH) {
+        if (!matchWord("PARTITIONS")) {
+            throw "Expected 'PARTITIONS' after hash partition key";
+        }
+        consume(TokenType::INTEGER_LITERAL, "Expected number of partitions");
+        int64_t count = Value::parse(previous().lexeme, TokenType::INTEGER).asInteger();
+        if (count < 1 || count > 1024) {
+            throw "Number of partitions must be between 1 and 1024";
+        }
+        spec.count = static_cast<size_t>(count);
+        return;
+    }
     
-    auto stmt = std::make_shared<InsertStatement>();
+    // RANGE (column) (PARTITION <name> VALUES LESS THAN (...), ...)
+    consume(TokenType::LEFT_PAREN, "Expected '(' before partition list");
+    do {
+        if (!matchWord("PARTITION")) {
+            throw "Expected 'PARTITION' in partition list";
+        }
+        spec.partitions.push_back(rangePartition());
+    } while (match({TokenType::COMMA}));
+    consume(TokenType::RIGHT_PAREN, "Expected ')' after partition list");
+}
+
+int64_t Parser::optionAmount() {
+    consume(TokenType::EQUALS, "Expected '=' after option name");
+    consume(TokenType::INTEGER_LITERAL, "Expected a whole number after '='");
+    return Value::parse(previous().lexeme, TokenType::INTEGER).asInteger();
+}
+
+void Parser::timeSeriesOptions(PartitionSpec& spec) {
+    // WITH (timeseries = <column>, segment_interval = <n>, retention = <n>)
+    consume(TokenType::LEFT_PAREN, "Expected '(' after 'WITH'");
+    do {
+        if (matchWord("TIMESERIES")) {
+            consume(TokenType::EQUALS, "Expected '=' after option name");
+            consume(TokenType::IDENTIFIER, "Expected time column after 'timeseries ='");
+            spec.method = PartitionSpec::Method::TIMESERIES;
+            spec.column = previous().lexeme;
+        } else if (matchWord("SEGMENT_INTERVAL")) {
+            spec.interval = optionAmount();
+            if (spec.interval < 1) {
+                throw "segment_interval must be positive";
+            }
+        } else if (matchWord("RETENTION")) {
+            spec.retention = optionAmount();
+        } else {
+            throw "Unsupported table option: " + std::string(peek().lexeme);
+        }
+    } while (match({TokenType::COMMA}));
+    consume(TokenType::RIGHT_PAREN, "Expected ')' after table options");
     
-    // Parse table name
+    if (spec.method != PartitionSpec::Method::TIMESERIES) {
+        throw "Expected 'timeseries = <column>' in table options";
+    }
+}
+
+PartitionBound Parser::rangePartition() {
+    PartitionBound partition;
+    consume(TokenType::IDENTIFIER, "Expected partition name");
+    partition.name = previous().lexeme;
+    consume(TokenType::VALUES, "Expected 'VALUES LESS THAN' after partition name");
+    if (!matchWord("LESS") || !matchWord("THAN")) {
+        throw "Expected 'VALUES LESS THAN' after partition name";
+    }
+    consume(TokenType::LEFT_PAREN, "Expected '(' before partition bound");
+    if (!matchWord("MAXVALUE")) {
+        partition.upper = literal("Expected partition bound or MAXVALUE");
+        if (partition.upper.isNull()) {
+            throw "Partition bound cannot be NULL";
+        }
+    }
+    consume(TokenType::RIGHT_PAREN, "Expected ')' after partition bound");
+    return partition;
+}
+
+std::shared_ptr<AlterTableStatement> Parser::alterTable() {
+    consume(TokenType::TABLE, "Expected 'TABLE' after 'ALTER'");
+    
+    auto stmt = makePooled<AlterTableStatement>();
     consume(TokenType::IDENTIFIER, "Expected table name");
     stmt->tableName = previous().lexeme;
     
-    // Check if column names are specified
-    if (match({TokenType::LEFT_PAREN})) {
-        // Parse column names
-        consume(TokenType::IDENTIFIER, "Expected column name");
-        stmt->columnNames.push_back(previous().lexeme);
-        
-        while (match({TokenType::COMMA})) {
-            consume(TokenType::IDENTIFIER, "Expected column name");
-            stmt->columnNames.push_back(previous().lexeme);
+    if (matchWord("ADD")) {
+        stmt->action = AlterTableStatement::Action::ADD_PARTITION;
+        if (!matchWord("PARTITION")) {
+            throw "Expected 'PARTITION' after 'ADD'";
         }
-        
-        consume(TokenType::RIGHT_PAREN, "Expected ')' after column names");
+        stmt->partition = rangePartition();
+    } else if (match({TokenType::DROP})) {
+        stmt->action = AlterTableStatement::Action::DROP_PARTITION;
+        if (!matchWord("PARTITION")) {
+            throw "Expected 'PARTITION' after 'DROP'";
+        }
+        consume(TokenType::IDENTIFIER, "Expected partition name");
+        stmt->partition.name = previous().lexeme;
+    } else {
+        throw "Expected 'ADD PARTITION' or 'DROP PARTITION' after table name";
     }
+    consume(TokenType::SEMICOLON, "Expected ';' after ALTER TABLE statement");
     
-    consume(TokenType::VALUES, "Expected 'VALUES' keyword");
+    return stmt;
+}
+
+std::shared_ptr<CreateIndexStatement> Parser::createIndex() {
+    auto stmt = makePooled<CreateIndexStatement>();
     
-    // Parse values
-    consume(TokenType::LEFT_PAREN, "Expected '(' after VALUES");
+    consume(TokenType::IDENTIFIER, "Expected index name");
+    stmt->indexName = previous().lexeme;
     
-    std::vector<std::string> rowValues;
+    if (!matchWord("ON")) {
+        throw "Expected 'ON' after index name";
+    }
+    consume(TokenType::IDENTIFIER, "Expected table name");
+    stmt->tableName = previous().lexeme;
     
-    // Parse first value
-    if (match({TokenType::INTEGER_LITERAL, TokenType::FLOAT_LITERAL})) {
-        rowValues.push_back(previous().lexeme);
-    } else if (match({TokenType::STRING_LITERAL})) {
-        rowValues.push_back("'" + previous().lexeme + "'");
+    if (!matchWord("USING")) {
+        throw "Expected 'USING' after table name";
+    }
+    if (matchWord("TRIGRAM")) {
+        stmt->method = "trigram";
+    } else if (matchWord("BLOOM")) {
+        stmt->method = "bloom";
+        stmt->falsePositiveRate = 0.01;
     } else {
-        throw "Expected value";
+        throw "Unsupported index method: " + std::string(peek().lexeme);
     }
     
-    // Parse additional values
-    while (match({TokenType::COMMA})) {
-        if (match({TokenType::INTEGER_LITERAL, TokenType::FLOAT_LITERAL})) {
-            rowValues.push_back(previous().lexeme);
-        } else if (match({TokenType::STRING_LITERAL})) {
-            rowValues.push_back("'" + previous().lexeme + "'");
-        } else {
-            throw "Expected value";
+    consume(TokenType::LEFT_PAREN, "Expected '(' after index method");
+    consume(TokenType::IDENTIFIER, "Expected column name");
+    stmt->columnName = previous().lexeme;
+    consume(TokenType::RIGHT_PAREN, "Expected ')' after column name");
+    
+    // Bloom filters take their false positive rate
+    if (matchWord("WITH")) {
+        consume(TokenType::LEFT_PAREN, "Expected '(' after 'WITH'");
+        if (stmt->method != "bloom" || !matchWord("FALSE_POSITIVE_RATE")) {
+            throw "Unsupported index option: " + std::string(peek().lexeme);
+        }
+        consume(TokenType::EQUALS, "Expected '=' after option name");
+        Value rate = literal("Expected a number for false_positive_rate");
+        if (!rate.isNumeric()) {
+            throw "Expected a number for false_positive_rate";
         }
+        stmt->falsePositiveRate = rate.asReal();
+        consume(TokenType::RIGHT_PAREN, "Expected ')' after index options");
     }
+    consume(TokenType::SEMICOLON, "Expected ';' after CREATE INDEX statement");
     
-    consume(TokenType::RIGHT_PAREN, "Expected ')' after values");
+    return stmt;
+}
+
+std::shared_ptr<CreateViewStatement> Parser::createView() {
+    if (!matchWord("VIEW")) {
+        throw "Expected 'VIEW' after 'MATERIALIZED'";
+    }
+    
+    auto stmt = makePooled<CreateViewStatement>();
+    consume(TokenType::IDENTIFIER, "Expected view name");
+    stmt->viewName = previous().lexeme;
+    consume(TokenType::AS, "Expected 'AS' after view name");
+    consume(TokenType::SELECT, "Expected 'SELECT' after 'AS'");
+    
+    // Columns, COUNT(*) and SUM(column), each with an optional alias
+    do {
+        consume(TokenType::IDENTIFIER, "Expected a column, COUNT(*) or SUM(column)");
+        ViewColumn column{ViewColumn::Kind::GROUP_KEY, std::string(previous().lexeme), ""};
+        if (match({TokenType::LEFT_PAREN})) {
+            std::string function = column.column;
+            std::transform(function.begin(), function.end(), function.begin(), ::toupper);
+            if (function == "COUNT") {
+                consume(TokenType::STAR, "Expected '*' after 'COUNT('");
+                column = {ViewColumn::Kind::COUNT, "", ""};
+            } else if (function == "SUM") {
+                consume(TokenType::IDENTIFIER, "Expected column name after 'SUM('");
+                column = {ViewColumn::Kind::SUM, std::string(previous().lexeme), ""};
+            } else {
+                throw "Unsupported function in materialized view: " + function;
+            }
+            consume(TokenType::RIGHT_PAREN, "Expected ')' after " + function + " argument");
+        }
+        if (match({TokenType::AS})) {
+            consume(TokenType::IDENTIFIER, "Expected alias after 'AS'");
+            column.alias = previous().lexeme;
+        }
+        stmt->columns.push_back(std::move(column));
+    } while (match({TokenType::COMMA}));
     
-    // Add the row values
-    stmt->values.push_back(rowValues);
+    consume(TokenType::FROM, "Expected 'FROM' after view columns");
+    consume(TokenType::IDENTIFIER, "Expected table name");
+    stmt->tableName = previous().lexeme;
+    if (match({TokenType::WHERE})) {
+        stmt->where = expression();
+    }
     
-    // Check for additional value rows
-    while (match({TokenType::COMMA})) {
-        consume(TokenType::LEFT_PAREN, "Expected '(' for values");
-        
-        rowValues.clear();
-        
-        // Parse first value
-        if (match({TokenType::INTEGER_LITERAL, TokenType::FLOAT_LITERAL})) {
-            rowValues.push_back(previous().lexeme);
-        } else if (match({TokenType::STRING_LITERAL})) {
-            rowValues.push_back("'" + previous().lexeme + "'");
+    if (!matchWord("GROUP") || !matchWord("BY")) {
+        throw "Expected 'GROUP BY' in materialized view";
+    }
+    do {
+        consume(TokenType::IDENTIFIER, "Expected column name in GROUP BY");
+        stmt->groupBy.emplace_back(previous().lexeme);
+    } while (match({TokenType::COMMA}));
+    consume(TokenType::SEMICOLON, "Expected ';' after CREATE MATERIALIZED VIEW statement");
+    
+    return stmt;
+}
+
+std::string ViewColumn::name() const {
+    if (!alias.empty()) {
+        return alias;
+    }
+    switch (kind) {
+        case Kind::COUNT:
+            return "count";
+        case Kind::SUM:
+            return "sum_" + column;
+        default:
+            return column;
+    }
+}
+
+std::string CreateViewStatement::toString() const {
+    std::string sql = "CREATE MATERIALIZED VIEW " + viewName + " AS SELECT ";
+    for (size_t i = 0; i < columns.size(); i++) {
+        const ViewColumn& column = columns[i];
+        sql += i > 0 ? ", " : "";
+        if (column.kind == ViewColumn::Kind::COUNT) {
+            sql += "COUNT(*)";
+        } else if (column.kind == ViewColumn::Kind::SUM) {
+            sql += "SUM(" + column.column + ")";
         } else {
-            throw "Expected value";
+            sql += column.column;
         }
-        
-        // Parse additional values
-        while (match({TokenType::COMMA})) {
-            if (match({TokenType::INTEGER_LITERAL, TokenType::FLOAT_LITERAL})) {
-                rowValues.push_back(previous().lexeme);
-            } else if (match({TokenType::STRING_LITERAL})) {
-                rowValues.push_back("'" + previous().lexeme + "'");
-            } else {
-                throw "Expected value";
-            }
+        if (!column.alias.empty()) {
+            sql += " AS " + column.alias;
         }
-        
-        consume(TokenType::RIGHT_PAREN, "Expected ')' after values");
-        
-        // Add the row values
-        stmt->values.push_back(rowValues);
+    }
+    sql += " FROM " + tableName;
+    if (where) {
+        sql += " WHERE " + where->toString();
+    }
+    sql += " GROUP BY ";
+    for (size_t i = 0; i < groupBy.size(); i++) {
+        sql += (i > 0 ? ", " : "") + groupBy[i];
+    }
+    return sql + ";";
+}
+
+std::shared_ptr<InsertStatement> Parser::insertStatement() {
+    auto stmt = makePooled<InsertStatement>();
+    insertHeader(*stmt);
+    
+    // Parse the first row and any further ones
+    stmt->values.push_back(valuesRow());
+    while (match({TokenType::COMMA})) {
+        stmt->values.push_back(valuesRow());
     }
     
     consume(TokenType::SEMICOLON, "Expected ';' after INSERT statement");
@@ -275,20 +796,59 @@ std::shared_ptr<InsertStatement> Parser::insertStatement() {
     return stmt;
 }
 
-std::shared_ptr<SelectStatement> Parser::selectStatement() {
-    auto stmt = std::make_shared<SelectStatement>();
+void Parser::insertHeader(InsertStatement& stmt) {
+    consume(TokenType::INTO, "Expected 'INTO' after 'INSERT'");
     
-    // Parse columns
-    if (match({TokenType::STAR})) {
-        stmt->columns.push_back("*");
-    } else {
-        consume(TokenType::IDENTIFIER, "Expected column name or '*'");
-        stmt->columns.push_back(previous().lexeme);
+    // Parse table name
+    consume(TokenType::IDENTIFIER, "Expected table name");
+    stmt.tableName = previous().lexeme;
+    
+    // Check if column names are specified
+    if (match({TokenType::LEFT_PAREN})) {
+        // Parse column names
+        consume(TokenType::IDENTIFIER, "Expected column name");
+        stmt.columnNames.emplace_back(previous().lexeme);
         
         while (match({TokenType::COMMA})) {
             consume(TokenType::IDENTIFIER, "Expected column name");
-            stmt->columns.push_back(previous().lexeme);
+            stmt.columnNames.emplace_back(previous().lexeme);
         }
+        
+        consume(TokenType::RIGHT_PAREN, "Expected ')' after column names");
+    }
+    
+    consume(TokenType::VALUES, "Expected 'VALUES' keyword");
+}
+
+std::vector<Value> Parser::valuesRow() {
+    consume(TokenType::LEFT_PAREN, "Expected '(' for values");
+    
+    std::vector<Value> rowValues;
+    rowValues.push_back(literal("Expected value"));
+    while (match({TokenType::COMMA})) {
+        rowValues.push_back(literal("Expected value"));
+    }
+    
+    consume(TokenType::RIGHT_PAREN, "Expected ')' after values");
+    return rowValues;
+}
+
+std::shared_ptr<SelectStatement> Parser::selectStatement() {
+    auto stmt = makePooled<SelectStatement>();
+    
+    // Parse the select list: * or expressions, each with an optional alias
+    if (match({TokenType::STAR})) {
+        stmt->items.push_back({nullptr, ""});
+    } else {
+        do {
+            SelectItem item;
+            item.expression = expression();
+            if (match({TokenType::AS})) {
+                consume(TokenType::IDENTIFIER, "Expected alias after 'AS'");
+                item.alias = previous().lexeme;
+            }
+            stmt->items.push_back(std::move(item));
+        } while (match({TokenType::COMMA}));
     }
     
     consume(TokenType::FROM, "Expected 'FROM' after SELECT columns");
@@ -299,31 +859,7 @@ std::shared_ptr<SelectStatement> Parser::selectStatement() {
     
     // Parse WHERE clause if present
     if (match({TokenType::WHERE})) {
-        stmt->hasWhere = true;
-        
-        // Parse column name
-        consume(TokenType::IDENTIFIER, "Expected column name in WHERE clause");
-        stmt->whereColumn = previous().lexeme;
-        
-        // Parse operator
-        if (match({TokenType::EQUALS})) {
-            stmt->whereOperator = "=";
-        } else if (match({TokenType::GREATER})) {
-            stmt->whereOperator = ">";
-        } else if (match({TokenType::LESS})) {
-            stmt->whereOperator = "<";
-        } else {
-            throw "Expected operator in WHERE clause";
-        }
-        
-        // Parse value
-        if (match({TokenType::INTEGER_LITERAL, TokenType::FLOAT_LITERAL})) {
-            stmt->whereValue = previous().lexeme;
-        } else if (match({TokenType::STRING_LITERAL})) {
-            stmt->whereValue = "'" + previous().lexeme + "'";
-        } else {
-            throw "Expected value in WHERE clause";
-        }
+        stmt->where = expression();
     }
     
     consume(TokenType::SEMICOLON, "Expected ';' after SELECT statement");
@@ -334,7 +870,7 @@ std::shared_ptr<SelectStatement> Parser::selectStatement() {
 std::shared_ptr<DeleteStatement> Parser::deleteStatement() {
     consume(TokenType::FROM, "Expected 'FROM' after DELETE");
     
-    auto stmt = std::make_shared<DeleteStatement>();
+    auto stmt = makePooled<DeleteStatement>();
     
     // Parse table name
     consume(TokenType::IDENTIFIER, "Expected table name");
@@ -342,38 +878,68 @@ std::shared_ptr<DeleteStatement> Parser::deleteStatement() {
     
     // Parse WHERE clause if present
     if (match({TokenType::WHERE})) {
-        stmt->hasWhere = true;
-        
-        // Parse column name
-        consume(TokenType::IDENTIFIER, "Expected column name in WHERE clause");
-        stmt->whereColumn = previous().lexeme;
-        
-        // Parse operator
-        if (match({TokenType::EQUALS})) {
-            stmt->whereOperator = "=";
-        } else if (match({TokenType::GREATER}))
-        // Parse operator
-        if (match({TokenType::EQUALS})) {
-            stmt->whereOperator = "=";
-        } else if (match({TokenType::GREATER})) {
-            stmt->whereOperator = ">";
-        } else if (match({TokenType::LESS})) {
-            stmt->whereOperator = "<";
-        } else {
-            throw "Expected operator in WHERE clause";
-        }
+        stmt->where = expression();
+    }
+    
+    consume(TokenType::SEMICOLON, "Expected ';' after DELETE statement");
+    
+    return stmt;
+}
+
+std::shared_ptr<UpdateStatement> Parser::updateStatement() {
+    auto stmt = makePooled<UpdateStatement>();
+    
+    // Parse table name
+    consume(TokenType::IDENTIFIER, "Expected table name");
+    stmt->tableName = previous().lexeme;
+    
+    consume(TokenType::SET, "Expected 'SET' after table name");
+    
+    // Parse assignments
+    do {
+        Assignment assignment;
+        consume(TokenType::IDENTIFIER, "Expected column name in SET clause");
+        assignment.column = previous().lexeme;
+        consume(TokenType::EQUALS, "Expected '=' after column name");
+        assignment.expression = expression();
         
-        // Parse value
-        if (match({TokenType::INTEGER_LITERAL, TokenType::FLOAT_LITERAL})) {
-            stmt->whereValue = previous().lexeme;
-        } else if (match({TokenType::STRING_LITERAL})) {
-            stmt->whereValue = "'" + previous().lexeme + "'";
-        } else {
-            throw "Expected value in WHERE clause";
+        stmt->assignments.push_back(std::move(assignment));
+    } while (match({TokenType::COMMA}));
+    
+    // Parse WHERE clause if present
+    if (match({TokenType::WHERE})) {
+        stmt->where = expression();
+    }
+    
+    consume(TokenType::SEMICOLON, "Expected ';' after UPDATE statement");
+    
+    return stmt;
+}
+
+std::shared_ptr<ExplainStatement> Parser::explainStatement() {
+    auto stmt = makePooled<ExplainStatement>();
+    stmt->analyze = match({TokenType::ANALYZE});
+    
+    if (check(TokenType::EXPLAIN)) {
+        throw std::string("EXPLAIN cannot be nested");
+    }
+    stmt->statement = statement();
+    return stmt;
+}
+
+std::shared_ptr<TransactionStatement> Parser::transactionStatement(Statement::Type type) {
+    auto stmt = makePooled<TransactionStatement>(type);
+    
+    // Optional TRANSACTION keyword, as in "BEGIN TRANSACTION;"
+    if (check(TokenType::IDENTIFIER)) {
+        std::string word(peek().lexeme);
+        std::transform(word.begin(), word.end(), word.begin(), ::toupper);
+        if (word == "TRANSACTION") {
+            advance();
         }
     }
     
-    consume(TokenType::SEMICOLON, "Expected ';' after DELETE statement");
+    consume(TokenType::SEMICOLON, "Expected ';' after transaction statement");
     
     return stmt;
 }
\ No newline at end of file
@@ -1,18 +1,29 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <cstdint>
+#include <initializer_list>
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include <memory>
 #include "token.hpp"
 #include "tokenizer.hpp"
+#include "value.hpp"
+#include "expression.hpp"
 
 // Forward declarations for statement types
 struct Statement;
 struct CreateTableStatement;
+struct CreateIndexStatement;
 struct InsertStatement;
 struct SelectStatement;
 struct DeleteStatement;
+struct UpdateStatement;
+struct TransactionStatement;
+struct ExplainStatement;
+struct CreateViewStatement;
+struct AlterTableStatement;
 
 // Result of parsing
 struct ParseResult {
@@ -21,6 +32,13 @@ struct ParseResult {
     std::string errorMessage;
 };
 
+// Result of parsing a script of one or more statements
+struct ScriptParseResult {
+    bool success;
+    std::vector<std::shared_ptr<Statement>> statements;
+    std::string errorMessage;
+};
+
 // Column definition
 struct ColumnDefinition {
     std::string name;
@@ -41,7 +59,14 @@ struct Statement {
         SELECT,
         DELETE,
         UPDATE,
-        DROP_TABLE
+        DROP_TABLE,
+        BEGIN_TRANSACTION,
+        COMMIT,
+        ROLLBACK,
+        EXPLAIN,
+        CREATE_INDEX,
+        CREATE_VIEW,
+        ALTER_TABLE
     };
     
     Type type;
@@ -50,46 +75,161 @@ struct Statement {
     virtual ~Statement() = default;
 };
 
+// One partition of a RANGE partitioned table: the rows whose key is
+// below its bound and not below the bound of the partition before it
+struct PartitionBound {
+    std::string name;
+    Value upper;  // NULL for MAXVALUE
+};
+
+// PARTITION BY clause of CREATE TABLE, or the WITH (timeseries = ...)
+// options that split a table into segments of a time column's values
+struct PartitionSpec {
+    enum class Method {
+        NONE,
+        RANGE,
+        HASH,
+        TIMESERIES
+    };
+    
+    Method method = Method::NONE;
+    std::string column;
+    std::vector<PartitionBound> partitions;  // RANGE, in ascending order
+    size_t count = 0;                        // HASH
+    int64_t interval = 86400;                // TIMESERIES: time each segment spans
+    int64_t retention = 0;                   // TIMESERIES: time segments are kept; 0 for ever
+};
+
 // CREATE TABLE statement
 struct CreateTableStatement : public Statement {
     std::string tableName;
     std::vector<ColumnDefinition> columns;
+    PartitionSpec partitioning;
     
     CreateTableStatement() : Statement(Type::CREATE_TABLE) {}
 };
 
+// CREATE INDEX <name> ON <table> USING trigram (<column>) statement
+struct CreateIndexStatement : public Statement {
+    std::string indexName;
+    std::string tableName;
+    std::string columnName;
+    std::string method;              // "trigram" or "bloom"
+    double falsePositiveRate = 0;    // WITH (false_positive_rate = ...) of bloom
+    
+    CreateIndexStatement() : Statement(Type::CREATE_INDEX) {}
+};
+
+// One column of a materialized view: a GROUP BY column, COUNT(*) or
+// SUM(column)
+struct ViewColumn {
+    enum class Kind {
+        GROUP_KEY,
+        COUNT,
+        SUM
+    };
+    
+    Kind kind;
+    std::string column;  // Column of the base table; empty for COUNT(*)
+    std::string alias;   // Empty without AS
+    
+    // The alias, else the column itself, "count" or "sum_<column>"
+    std::string name() const;
+};
+
+// CREATE MATERIALIZED VIEW <name> AS SELECT ... FROM <table> [WHERE ...]
+// GROUP BY ... statement
+struct CreateViewStatement : public Statement {
+    std::string viewName;
+    std::vector<ViewColumn> columns;
+    std::string tableName;
+    std::shared_ptr<Expression> where;  // nullptr without WHERE
+    std::vector<std::string> groupBy;
+    
+    CreateViewStatement() : Statement(Type::CREATE_VIEW) {}
+    
+    // SQL text that parses back to this statement
+    std::string toString() const;
+};
+
+// ALTER TABLE <table> ADD PARTITION <name> VALUES LESS THAN (...) and
+// ALTER TABLE <table> DROP PARTITION <name> statements
+struct AlterTableStatement : public Statement {
+    enum class Action {
+        ADD_PARTITION,
+        DROP_PARTITION
+    };
+    
+    std::string tableName;
+    Action action = Action::ADD_PARTITION;
+    PartitionBound partition;  // Only the name for DROP PARTITION
+    
+    AlterTableStatement() : Statement(Type::ALTER_TABLE) {}
+};
+
 // INSERT statement
 struct InsertStatement : public Statement {
     std::string tableName;
     std::vector<std::string> columnNames;
-    std::vector<std::vector<std::string>> values;  // For multi-row insert
+    std::vector<std::vector<Value>> values;  // For multi-row insert
     
     InsertStatement() : Statement(Type::INSERT) {}
 };
 
+// One entry of a SELECT list: an expression with an optional alias
+struct SelectItem {
+    std::shared_ptr<Expression> expression;  // nullptr for *
+    std::string alias;                       // Empty without AS
+};
+
 // SELECT statement
 struct SelectStatement : public Statement {
-    std::vector<std::string> columns;
+    std::vector<SelectItem> items;
     std::string tableName;
-    std::string whereColumn;
-    std::string whereOperator;
-    std::string whereValue;
-    bool hasWhere;
+    std::shared_ptr<Expression> where;  // nullptr without WHERE
     
     SelectStatement() 
-        : Statement(Type::SELECT), hasWhere(false) {}
+        : Statement(Type::SELECT) {}
 };
 
 // DELETE statement
 struct DeleteStatement : public Statement {
     std::string tableName;
-    std::string whereColumn;
-    std::string whereOperator;
-    std::string whereValue;
-    bool hasWhere;
+    std::shared_ptr<Expression> where;  // nullptr without WHERE
     
     DeleteStatement() 
-        : Statement(Type::DELETE), hasWhere(false) {}
+        : Statement(Type::DELETE) {}
+};
+
+// One "column = expression" of an UPDATE, e.g. hits = hits + 1
+struct Assignment {
+    std::string column;
+    std::shared_ptr<Expression> expression;
+};
+
+// UPDATE statement
+struct UpdateStatement : public Statement {
+    std::string tableName;
+    std::vector<Assignment> assignments;
+    std::shared_ptr<Expression> where;  // nullptr without WHERE
+    
+    UpdateStatement()
+        : Statement(Type::UPDATE) {}
+};
+
+// BEGIN, COMMIT and ROLLBACK statements
+struct TransactionStatement : public Statement {
+    explicit TransactionStatement(Type type) : Statement(type) {}
+};
+
+// EXPLAIN [ANALYZE] statement
+struct ExplainStatement : public Statement {
+    std::shared_ptr<Statement> statement;  // Statement to explain
+    bool analyze;                          // Run it and report measurements
+    uint64_t parseNs;                      // Time to tokenize and parse the query text
+    
+    ExplainStatement()
+        : Statement(Type::EXPLAIN), analyze(false), parseNs(0) {}
 };
 
 // Parser class
@@ -97,11 +237,28 @@ class Parser {
 public:
     Parser() = default;
     
-    // Parse a SQL query
-    ParseResult parse(const std::string& query);
+    // Parse a SQL query. Tokens are scratch memory taken from the arena;
+    // statements come from the long-lived pool, as they may be cached.
+    ParseResult parse(const std::string& query,
+                      std::pmr::memory_resource* arena = std::pmr::get_default_resource());
+    
+    // Parse any number of semicolon-terminated statements
+    ScriptParseResult parseScript(const std::string& script,
+                                  std::pmr::memory_resource* arena = std::pmr::get_default_resource());
+    
+    // Parse one statement from tokens scanned already, ending with
+    // EOF_TOKEN, as a ScriptReader hands them out
+    ParseResult parseTokens(const std::pmr::vector<Token>& tokens);
+    
+    // The same for an INSERT read row by row: "INSERT INTO t [(columns)]
+    // VALUES" gives a statement without rows, then each "(values)" with
+    // the ',' or ';' after it gives one row; last is set after the ';'.
+    ParseResult parseInsertHeader(const std::pmr::vector<Token>& tokens);
+    bool parseRow(const std::pmr::vector<Token>& tokens, std::vector<Value>& values,
+                  bool& last, std::string& errorMessage);
     
 private:
-    std::vector<Token> tokens;
+    const std::pmr::vector<Token>* tokens = nullptr;  // Tokens of the text being parsed
     size_t current;  // Current token index
     
     // Helper methods
@@ -110,16 +267,43 @@ private:
     Token previous() const;
     Token advance();
     bool check(TokenType type) const;
-    bool match(const std::vector<TokenType>& types);
+    bool match(std::initializer_list<TokenType> types);
+    bool matchWord(const char* word);  // An identifier spelled as word, in any case
     bool consume(TokenType type, const std::string& message);
     
     // Parsing methods
     ParseResult error(const std::string& message);
+    Value literal(const std::string& message);
+    
+    // Expressions, from the loosest binding operator to the tightest
+    std::shared_ptr<Expression> expression();
+    std::shared_ptr<Expression> logicOr();
+    std::shared_ptr<Expression> logicAnd();
+    std::shared_ptr<Expression> logicNot();
+    std::shared_ptr<Expression> comparison();
+    std::shared_ptr<Expression> term();
+    std::shared_ptr<Expression> factor();
+    std::shared_ptr<Expression> unary();
+    std::shared_ptr<Expression> primary();
+    
+    std::string scriptError(const std::string& message) const;
     std::shared_ptr<Statement> statement();
     std::shared_ptr<CreateTableStatement> createTable();
+    std::shared_ptr<CreateIndexStatement> createIndex();
+    std::shared_ptr<CreateViewStatement> createView();
+    std::shared_ptr<AlterTableStatement> alterTable();
+    void partitionBy(PartitionSpec& spec);
+    void timeSeriesOptions(PartitionSpec& spec);
+    int64_t optionAmount();
+    PartitionBound rangePartition();
     std::shared_ptr<InsertStatement> insertStatement();
+    void insertHeader(InsertStatement& stmt);
+    std::vector<Value> valuesRow();
     std::shared_ptr<SelectStatement> selectStatement();
     std::shared_ptr<DeleteStatement> deleteStatement();
+    std::shared_ptr<UpdateStatement> updateStatement();
+    std::shared_ptr<ExplainStatement> explainStatement();
+    std::shared_ptr<TransactionStatement> transactionStatement(Statement::Type type);
 };
 
 #endif // PARSER_HPP
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "./script_reader.hpp"
+
+// Characters the tokenizer may look at past the end of a token; a token
+// ending closer than this to the end of the input read so far may
+// continue in the next chunk
+static const size_t LOOKAHEAD = 3;
+
+// Chunks read ahead of the tokenizer
+static const size_t READ_AHEAD = 2;
+
+ScriptReader::ScriptReader(std::istream& input, size_t chunkBytes)
+    : input(input), chunkBytes(chunkBytes) {
+    readerThread = std::thread([this]() { readChunks(); });
+}
+
+ScriptReader::~ScriptReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    readerThread.join();
+}
+
+bool ScriptReader::failed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return readError;
+}
+
+void ScriptReader::readChunks() {
+    while (true) {
+        std::string chunk(chunkBytes, '\0');
+        input.read(&chunk[0], static_cast<std::streamsize>(chunk.size()));
+        chunk.resize(static_cast<size_t>(input.gcount()));
+
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return chunks.size() < READ_AHEAD || stopping; });
+        if (stopping) {
+            return;
+        }
+        if (chunk.empty()) {
+            readerDone = true;
+            readError = input.bad();
+            changed.notify_all();
+            return;
+        }
+        chunks.push_back(std::move(chunk));
+        changed.notify_all();
+    }
+}
+
+bool ScriptReader::refill() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return !chunks.empty() || readerDone; });
+    if (chunks.empty()) {
+        return false;
+    }
+    buffer += chunks.front();
+    chunks.pop_front();
+    changed.notify_all();
+    return true;
+}
+
+bool ScriptReader::nextStatement(std::pmr::vector<Token>& tokens) {
+    scan(Unit::STATEMENT, tokens);
+    return tokens.size() > 1;
+}
+
+void ScriptReader::nextRow(std::pmr::vector<Token>& tokens) {
+    scan(Unit::ROW, tokens);
+}
+
+void ScriptReader::scan(Unit unit, std::pmr::vector<Token>& tokens) {
+    while (true) {
+        size_t start = tokenizer.position();
+        int startLine = tokenizer.lineNumber();
+        Unit scanning = unit;
+        int depth = 0;
+        bool complete = false;
+        tokens.clear();
+
+        while (!complete) {
+            Token token = tokenizer.nextToken();
+            if (!inputDone && tokenizer.position() + LOOKAHEAD >= buffer.size()) {
+                break;
+            }
+            if (token.type == TokenType::EOF_TOKEN) {
+                complete = true;
+                break;
+            }
+            if (token.type == TokenType::INVALID) {
+                // Skipped, as Tokenizer::scanTokens does
+                continue;
+            }
+
+            switch (scanning) {
+                case Unit::STATEMENT:
+                    if (token.type == TokenType::SEMICOLON && tokens.empty()) {
+                        // An empty statement
+                        continue;
+                    }
+                    if (token.type == TokenType::INSERT && tokens.empty()) {
+                        scanning = Unit::INSERT_HEADER;
+                    }
+                    complete = token.type == TokenType::SEMICOLON;
+                    break;
+                case Unit::INSERT_HEADER:
+                    complete = token.type == TokenType::VALUES || token.type == TokenType::SEMICOLON;
+                    break;
+                case Unit::ROW:
+                    if (token.type == TokenType::LEFT_PAREN) {
+                        depth++;
+                    } else if (token.type == TokenType::RIGHT_PAREN) {
+                        depth--;
+                    }
+                    complete = token.type == TokenType::SEMICOLON ||
+                               (token.type == TokenType::COMMA && depth <= 0);
+                    break;
+            }
+            tokens.push_back(token);
+        }
+
+        if (complete) {
+            tokens.push_back(Token(TokenType::EOF_TOKEN, "", tokenizer.lineNumber()));
+            return;
+        }
+
+        // Drop the input before the unit, read more and scan it again
+        buffer.erase(0, start);
+        tokenizer.seek(0, startLine);
+        if (!refill()) {
+            inputDone = true;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef SCRIPT_READER_HPP
+#define SCRIPT_READER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "./token.hpp"
+#include "./tokenizer.hpp"
+
+/**
+ * Tokens of a SQL script read from a stream a statement at a time, so
+ * that a script of any size is parsed in constant memory. A background
+ * thread reads the input in chunks ahead of the tokenizer. INSERT
+ * statements are handed out row by row, so a dump with millions of rows
+ * in one statement never holds more than one of them.
+ */
+class ScriptReader {
+public:
+    static const size_t CHUNK_BYTES = 1 << 20;
+
+    explicit ScriptReader(std::istream& input, size_t chunkBytes = CHUNK_BYTES);
+    ~ScriptReader();
+
+    ScriptReader(const ScriptReader&) = delete;
+    ScriptReader& operator=(const ScriptReader&) = delete;
+
+    // Tokens of the next statement through its ';', followed by an
+    // EOF_TOKEN; of an INSERT only through VALUES, its rows come from
+    // nextRow. False at the end of the script. The tokens are valid
+    // until the next call.
+    bool nextStatement(std::pmr::vector<Token>& tokens);
+
+    // Tokens of the next "(values)" of the INSERT and the ',' or ';'
+    // after it, followed by an EOF_TOKEN
+    void nextRow(std::pmr::vector<Token>& tokens);
+
+    // Whether reading the input failed, as opposed to ending
+    bool failed() const;
+
+private:
+    enum class Unit {
+        STATEMENT,
+        INSERT_HEADER,
+        ROW
+    };
+
+    std::istream& input;
+    size_t chunkBytes;
+
+    // Read but not yet tokenized input; it starts at or before the
+    // unit being scanned
+    std::string buffer;
+    Tokenizer tokenizer{buffer};
+    bool inputDone = false;
+
+    // Chunks read ahead by the reader thread
+    std::thread readerThread;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> chunks;
+    bool readerDone = false;
+    bool readError = false;
+    bool stopping = false;
+
+    void readChunks();
+
+    // Append the next chunk to the buffer; false at the end of the input
+    bool refill();
+
+    // Scan one unit into tokens, rescanning it from its start whenever it
+    // runs into the end of the input read so far
+    void scan(Unit unit, std::pmr::vector<Token>& tokens);
+};
+
+#endif // SCRIPT_READER_HPP
@@ -2,6 +2,7 @@
 #define TOKEN_HPP
 
 #include <string>
+#include <string_view>
 
 enum class TokenType {
     // Keywords
@@ -17,6 +18,19 @@ enum class TokenType {
     INTO,
     VALUES,
     SET,
+    BEGIN,
+    COMMIT,
+    ROLLBACK,
+    EXPLAIN,
+    ANALYZE,
+    AND,
+    OR,
+    NOT,
+    IS,
+    AS,
+    CAST,
+    LIKE,
+    ILIKE,
     
     // Data types
     INTEGER,
@@ -32,26 +46,34 @@ enum class TokenType {
     RIGHT_PAREN,
     PLUS,
     MINUS,
+    SLASH,
+    PERCENT,
     GREATER,
     LESS,
+    GREATER_EQUAL,
+    LESS_EQUAL,
+    NOT_EQUALS,
     
     // Literals
     IDENTIFIER,
     STRING_LITERAL,
     INTEGER_LITERAL,
     FLOAT_LITERAL,
+    NULL_LITERAL,
     
     // Special
     EOF_TOKEN,
     INVALID
 };
 
+// The lexeme points into the tokenized text (or a string literal), so a
+// token is only valid while that text is
 struct Token {
     TokenType type;
-    std::string lexeme;
+    std::string_view lexeme;
     int line;
     
-    Token(TokenType type, const std::string& lexeme, int line)
+    Token(TokenType type, std::string_view lexeme, int line)
         : type(type), lexeme(lexeme), line(line) {}
         
     std::string toString() const;
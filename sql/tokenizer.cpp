@@ -1,11 +1,10 @@
 #include "./tokenizer.hpp"
-#include "../include/string_utils.hpp"
 #include <cctype>
 #include <unordered_map>
 #include <iostream>
 
 // Keyword map
-static const std::unordered_map<std::string, TokenType> keywords = {
+static const std::unordered_map<std::string_view, TokenType> keywords = {
     {"select", TokenType::SELECT},
     {"insert", TokenType::INSERT},
     {"update", TokenType::UPDATE},
@@ -18,24 +17,38 @@ static const std::unordered_map<std::string, TokenType> keywords = {
     {"into", TokenType::INTO},
     {"values", TokenType::VALUES},
     {"set", TokenType::SET},
+    {"begin", TokenType::BEGIN},
+    {"commit", TokenType::COMMIT},
+    {"rollback", TokenType::ROLLBACK},
+    {"explain", TokenType::EXPLAIN},
+    {"analyze", TokenType::ANALYZE},
+    {"and", TokenType::AND},
+    {"or", TokenType::OR},
+    {"not", TokenType::NOT},
+    {"is", TokenType::IS},
+    {"as", TokenType::AS},
+    {"cast", TokenType::CAST},
+    {"like", TokenType::LIKE},
+    {"ilike", TokenType::ILIKE},
     {"integer", TokenType::INTEGER},
     {"text", TokenType::TEXT},
-    {"real", TokenType::REAL}
+    {"real", TokenType::REAL},
+    {"null", TokenType::NULL_LITERAL}
 };
 
 Tokenizer::Tokenizer(const std::string& source)
     : source(source), start(0), current(0), line(1) {}
 
-std::vector<Token> Tokenizer::scanTokens() {
-    std::vector<Token> tokens;
+std::pmr::vector<Token> Tokenizer::scanTokens(std::pmr::memory_resource* memory) {
+    std::pmr::vector<Token> tokens(memory);
     
     while (!isAtEnd()) {
         // Beginning of the next lexeme
         start = current;
         Token token = scanToken();
         
-        // Only add valid tokens
-        if (token.type != TokenType::INVALID) {
+        // Only add valid tokens (trailing whitespace yields an early EOF)
+        if (token.type != TokenType::INVALID && token.type != TokenType::EOF_TOKEN) {
             tokens.push_back(token);
         }
     }
@@ -45,6 +58,15 @@ std::vector<Token> Tokenizer::scanTokens() {
     return tokens;
 }
 
+Token Tokenizer::nextToken() {
+    return scanToken();
+}
+
+void Tokenizer::seek(size_t position, int line) {
+    start = current = position;
+    this->line = line;
+}
+
 bool Tokenizer::isAtEnd() const {
     return current >= source.length();
 }
@@ -103,8 +125,9 @@ void Tokenizer::skipWhitespace() {
 
 
 Token Tokenizer::scanToken() {
-    // Add this at the start of the function
+    // Skip whitespace so the lexeme starts at the token itself
     skipWhitespace();
+    start = current;
     
     if (isAtEnd()) {
         return Token(TokenType::EOF_TOKEN, "", line);
@@ -118,12 +141,18 @@ Token Tokenizer::scanToken() {
             advance();
         }
         
-        std::string text = source.substr(start, current - start);
-        std::string lowercase = toLower(trim(text));
+        std::string_view text(source.data() + start, current - start);
         
-        auto it = keywords.find(lowercase);
-        if (it != keywords.end()) {
-            return Token(it->second, text, line);
+        // Lowercase into a small buffer; no keyword is longer than it
+        char lowercase[16];
+        if (text.size() <= sizeof(lowercase)) {
+            for (size_t i = 0; i < text.size(); i++) {
+                lowercase[i] = static_cast<char>(tolower(static_cast<unsigned char>(text[i])));
+            }
+            auto it = keywords.find(std::string_view(lowercase, text.size()));
+            if (it != keywords.end()) {
+                return Token(it->second, text, line);
+            }
         }
         
         // Not a keyword, so it's an identifier
@@ -136,7 +165,8 @@ Token Tokenizer::scanToken() {
             advance();
         }
         
-        // Look for a decimal part
+        // Look for a decimal part and an exponent
+        bool isFloat = false;
         if (peek() == '.' && isdigit(peekNext())) {
             // Consume the "."
             advance();
@@ -144,19 +174,42 @@ Token Tokenizer::scanToken() {
             while (isdigit(peek())) {
                 advance();
             }
-            
+            isFloat = true;
+        }
+        if ((peek() == 'e' || peek() == 'E') &&
+            (isdigit(peekNext()) ||
+             ((peekNext() == '+' || peekNext() == '-') && current + 2 < source.length() &&
+              isdigit(source[current + 2])))) {
+            advance();
+            if (peek() == '+' || peek() == '-') {
+                advance();
+            }
+            while (isdigit(peek())) {
+                advance();
+            }
+            isFloat = true;
+        }
+        
+        if (isFloat) {
             return Token(TokenType::FLOAT_LITERAL, 
-                         source.substr(start, current - start), line);
+                         std::string_view(source.data() + start, current - start), line);
         }
         
         return Token(TokenType::INTEGER_LITERAL, 
-                     source.substr(start, current - start), line);
+                     std::string_view(source.data() + start, current - start), line);
     }
     
     // Handle strings
     if (c == '"' || c == '\'') {
         char quote = c;
-        while (peek() != quote && !isAtEnd()) {
+        while (!isAtEnd()) {
+            // A doubled quote stands for the quote itself
+            if (peek() == quote) {
+                if (peekNext() != quote) {
+                    break;
+                }
+                advance();
+            }
             if (peek() == '\n') line++;
             advance();
         }
@@ -170,8 +223,8 @@ Token Tokenizer::scanToken() {
         // Consume the closing quote
         advance();
         
-        // Extract the string value (without the quotes)
-        std::string value = source.substr(start + 1, current - start - 2);
+        // The lexeme keeps the quotes; the parser unescapes it
+        std::string_view value(source.data() + start, current - start);
         return Token(TokenType::STRING_LITERAL, value, line);
     }
     
@@ -184,14 +237,32 @@ Token Tokenizer::scanToken() {
         case '*': return Token(TokenType::STAR, "*", line);
         case '+': return Token(TokenType::PLUS, "+", line);
         case '-': return Token(TokenType::MINUS, "-", line);
+        case '/': return Token(TokenType::SLASH, "/", line);
+        case '%': return Token(TokenType::PERCENT, "%", line);
         case '=': return Token(TokenType::EQUALS, "=", line);
-        case '>': return Token(TokenType::GREATER, ">", line);
-        case '<': return Token(TokenType::LESS, "<", line);
+        case '>':
+            if (match('=')) {
+                return Token(TokenType::GREATER_EQUAL, ">=", line);
+            }
+            return Token(TokenType::GREATER, ">", line);
+        case '<':
+            if (match('=')) {
+                return Token(TokenType::LESS_EQUAL, "<=", line);
+            }
+            if (match('>')) {
+                return Token(TokenType::NOT_EQUALS, "<>", line);
+            }
+            return Token(TokenType::LESS, "<", line);
+        case '!':
+            if (match('=')) {
+                return Token(TokenType::NOT_EQUALS, "!=", line);
+            }
+            break;
     }
     
     // If we got here, we encountered an unexpected character
     return Token(TokenType::INVALID, 
-                 "Unexpected character: " + std::string(1, c), line);
+                 std::string_view(source.data() + start, 1), line);
 }
 
 std::string Token::toString() const {
@@ -211,6 +282,19 @@ std::string Token::toString() const {
         case TokenType::INTO: typeStr = "INTO"; break;
         case TokenType::VALUES: typeStr = "VALUES"; break;
         case TokenType::SET: typeStr = "SET"; break;
+        case TokenType::BEGIN: typeStr = "BEGIN"; break;
+        case TokenType::COMMIT: typeStr = "COMMIT"; break;
+        case TokenType::ROLLBACK: typeStr = "ROLLBACK"; break;
+        case TokenType::EXPLAIN: typeStr = "EXPLAIN"; break;
+        case TokenType::ANALYZE: typeStr = "ANALYZE"; break;
+        case TokenType::AND: typeStr = "AND"; break;
+        case TokenType::OR: typeStr = "OR"; break;
+        case TokenType::NOT: typeStr = "NOT"; break;
+        case TokenType::IS: typeStr = "IS"; break;
+        case TokenType::AS: typeStr = "AS"; break;
+        case TokenType::CAST: typeStr = "CAST"; break;
+        case TokenType::LIKE: typeStr = "LIKE"; break;
+        case TokenType::ILIKE: typeStr = "ILIKE"; break;
         case TokenType::INTEGER: typeStr = "INTEGER"; break;
         case TokenType::TEXT: typeStr = "TEXT"; break;
         case TokenType::REAL: typeStr = "REAL"; break;
@@ -218,6 +302,7 @@ std::string Token::toString() const {
         case TokenType::STRING_LITERAL: typeStr = "STRING"; break;
         case TokenType::INTEGER_LITERAL: typeStr = "INTEGER_LIT"; break;
         case TokenType::FLOAT_LITERAL: typeStr = "FLOAT_LIT"; break;
+        case TokenType::NULL_LITERAL: typeStr = "NULL"; break;
         case TokenType::LEFT_PAREN: typeStr = "LEFT_PAREN"; break;
         case TokenType::RIGHT_PAREN: typeStr = "RIGHT_PAREN"; break;
         case TokenType::COMMA: typeStr = "COMMA"; break;
@@ -225,12 +310,17 @@ std::string Token::toString() const {
         case TokenType::STAR: typeStr = "STAR"; break;
         case TokenType::PLUS: typeStr = "PLUS"; break;
         case TokenType::MINUS: typeStr = "MINUS"; break;
+        case TokenType::SLASH: typeStr = "SLASH"; break;
+        case TokenType::PERCENT: typeStr = "PERCENT"; break;
         case TokenType::EQUALS: typeStr = "EQUALS"; break;
         case TokenType::GREATER: typeStr = "GREATER"; break;
         case TokenType::LESS: typeStr = "LESS"; break;
+        case TokenType::GREATER_EQUAL: typeStr = "GREATER_EQUAL"; break;
+        case TokenType::LESS_EQUAL: typeStr = "LESS_EQUAL"; break;
+        case TokenType::NOT_EQUALS: typeStr = "NOT_EQUALS"; break;
         case TokenType::EOF_TOKEN: typeStr = "EOF"; break;
         default: typeStr = "OTHER";
     }
     
-    return typeStr + " " + lexeme;
+    return typeStr + " " + std::string(lexeme);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef TOKENIZER_HPP
 #define TOKENIZER_HPP
 
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include "./token.hpp"
@@ -9,8 +10,18 @@ class Tokenizer {
 public:
     Tokenizer(const std::string& source);
     
-    // Scan all tokens from the source
-    std::vector<Token> scanTokens();
+    // Scan all tokens from the source; the vector is allocated from the
+    // given memory resource, typically the query's arena
+    std::pmr::vector<Token> scanTokens(
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    
+    // Scan only the next token (EOF_TOKEN at the end), for sources that
+    // arrive in pieces. The source may grow or drop a prefix between
+    // calls; seek then moves to where scanning continues.
+    Token nextToken();
+    size_t position() const { return current; }
+    int lineNumber() const { return line; }
+    void seek(size_t position, int line);
     
 private:
     const std::string& source;
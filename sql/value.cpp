@@ -0,0 +1,345 @@
+#include "./value.hpp"
+#include "../include/arena.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+// Whole text parses as an integer or a double
+static bool parseInteger(std::string_view text, int64_t& out) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, out);
+    return result.ec == std::errc() && result.ptr == end && !text.empty();
+}
+
+static bool parseReal(std::string_view text, double& out) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, out);
+    return result.ec == std::errc() && result.ptr == end && !text.empty();
+}
+
+// Doubles that convert to int64_t without loss
+static bool isIntegral(double value) {
+    return std::isfinite(value) && std::trunc(value) == value &&
+           value >= -9223372036854775808.0 && value < 9223372036854775808.0;
+}
+
+// Shortest fixed-point form with up to 9 decimals that reads back as
+// exactly this double, e.g. 523.17 or 2.0; false if there is none. Both
+// m and 10^p are exact doubles below 2^53, so m / 10^p is correctly
+// rounded and equals the double the decimal parses to.
+static bool appendFixed(std::string& out, double value) {
+    static const double POWERS[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    const double EXACT_LIMIT = 9007199254740992.0;  // 2^53
+
+    if (!std::isfinite(value) || std::fabs(value) >= 1e15) {
+        return false;
+    }
+    for (int decimals = 0; decimals < 10; decimals++) {
+        double scaled = std::nearbyint(value * POWERS[decimals]);
+        if (std::fabs(scaled) >= EXACT_LIMIT) {
+            return false;
+        }
+        if (scaled / POWERS[decimals] != value) {
+            continue;
+        }
+
+        char digits[24];
+        int64_t mantissa = static_cast<int64_t>(std::fabs(scaled));
+        auto result = std::to_chars(digits, digits + sizeof(digits), mantissa);
+        int length = static_cast<int>(result.ptr - digits);
+
+        if (std::signbit(value) && mantissa != 0) {
+            out += '-';
+        }
+        if (decimals == 0) {
+            out.append(digits, length);
+            out += ".0";
+        } else if (length > decimals) {
+            out.append(digits, length - decimals);
+            out += '.';
+            out.append(digits + length - decimals, decimals);
+        } else {
+            out += "0.";
+            out.append(decimals - length, '0');
+            out.append(digits, length);
+        }
+        return true;
+    }
+    return false;
+}
+
+Value Value::text(std::string_view value) {
+    Value result;
+    result.valueType = ValueType::TEXT;
+    if (value.size() <= INLINE_CAPACITY) {
+        std::memcpy(result.storage, value.data(), value.size());
+        result.length = static_cast<uint8_t>(value.size());
+        return result;
+    }
+
+    char* data = static_cast<char*>(longLivedPool()->allocate(value.size(), 1));
+    std::memcpy(data, value.data(), value.size());
+    uint32_t size = static_cast<uint32_t>(value.size());
+    std::memcpy(result.storage, &data, sizeof(data));
+    std::memcpy(result.storage + sizeof(data), &size, sizeof(size));
+    result.length = HEAP_TEXT;
+    return result;
+}
+
+void Value::release() {
+    std::string_view text = asText();
+    longLivedPool()->deallocate(const_cast<char*>(text.data()), text.size(), 1);
+    length = 0;
+    valueType = ValueType::NULL_VALUE;
+}
+
+void Value::copyFrom(const Value& other) {
+    std::string_view source = other.asText();
+    char* data = static_cast<char*>(longLivedPool()->allocate(source.size(), 1));
+    std::memcpy(data, source.data(), source.size());
+    std::memcpy(storage, &data, sizeof(data));
+}
+
+std::string_view Value::asText() const {
+    if (length != HEAP_TEXT) {
+        return std::string_view(storage, length);
+    }
+    const char* data;
+    uint32_t size;
+    std::memcpy(&data, storage, sizeof(data));
+    std::memcpy(&size, storage + sizeof(data), sizeof(size));
+    return std::string_view(data, size);
+}
+
+void Value::appendTo(std::string& out) const {
+    char buffer[32];
+    switch (valueType) {
+        case ValueType::NULL_VALUE:
+            out += "NULL";
+            break;
+        case ValueType::INTEGER: {
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), asInteger());
+            out.append(buffer, result.ptr);
+            break;
+        }
+        case ValueType::REAL: {
+            if (appendFixed(out, asReal())) {
+                break;
+            }
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), asReal());
+            out.append(buffer, result.ptr);
+            // Keep reals recognizable: 75.0, not 75
+            if (std::string_view(buffer, result.ptr - buffer).find_first_of(".eEn") == std::string_view::npos) {
+                out += ".0";
+            }
+            break;
+        }
+        case ValueType::TEXT:
+            out += asText();
+            break;
+    }
+}
+
+std::string Value::toString() const {
+    std::string out;
+    appendTo(out);
+    return out;
+}
+
+std::string Value::toLiteral() const {
+    if (valueType != ValueType::TEXT) {
+        return toString();
+    }
+    std::string out = "'";
+    for (char c : asText()) {
+        if (c == '\'') {
+            out += '\'';
+        }
+        out += c;
+    }
+    out += '\'';
+    return out;
+}
+
+Value Value::parse(std::string_view text, TokenType columnType) {
+    int64_t integerValue;
+    double realValue;
+    switch (columnType) {
+        case TokenType::INTEGER:
+            if (parseInteger(text, integerValue)) {
+                return integer(integerValue);
+            }
+            if (parseReal(text, realValue)) {
+                return real(realValue);
+            }
+            break;
+        case TokenType::REAL:
+            if (parseReal(text, realValue)) {
+                return real(realValue);
+            }
+            break;
+        default:
+            break;
+    }
+    return Value::text(text);
+}
+
+bool Value::castTo(TokenType columnType, Value& out) const {
+    if (isNull()) {
+        out = Value();
+        return true;
+    }
+
+    switch (columnType) {
+        case TokenType::INTEGER: {
+            if (valueType == ValueType::INTEGER) {
+                out = *this;
+                return true;
+            }
+            double number;
+            if (valueType == ValueType::REAL) {
+                number = asReal();
+            } else {
+                int64_t integerValue;
+                if (parseInteger(asText(), integerValue)) {
+                    out = integer(integerValue);
+                    return true;
+                }
+                if (!parseReal(asText(), number)) {
+                    return false;
+                }
+            }
+            if (!isIntegral(number)) {
+                return false;
+            }
+            out = integer(static_cast<int64_t>(number));
+            return true;
+        }
+
+        case TokenType::REAL: {
+            if (isNumeric()) {
+                out = real(asReal());
+                return true;
+            }
+            double number;
+            if (!parseReal(asText(), number)) {
+                return false;
+            }
+            out = real(number);
+            return true;
+        }
+
+        case TokenType::TEXT:
+            out = valueType == ValueType::TEXT ? *this : text(toString());
+            return true;
+
+        default:
+            out = *this;
+            return true;
+    }
+}
+
+bool Value::arithmetic(const Value& left, char op, const Value& right, Value& out) {
+    if (left.isNull() || right.isNull()) {
+        out = Value();
+        return true;
+    }
+    if (!left.isNumeric() || !right.isNumeric()) {
+        return false;
+    }
+
+    if (left.valueType == ValueType::INTEGER && right.valueType == ValueType::INTEGER) {
+        int64_t x = left.asInteger();
+        int64_t y = right.asInteger();
+        int64_t result;
+        bool exact = false;
+        switch (op) {
+            case '+': exact = checkedAdd(x, y, result); break;
+            case '-': exact = checkedSubtract(x, y, result); break;
+            case '*': exact = checkedMultiply(x, y, result); break;
+            case '/':
+            case '%':
+                if (y == 0) {
+                    out = Value();
+                    return true;
+                }
+                // x / -1 overflows for MIN, and x % -1 is always 0
+                if (y == -1 && op == '%') {
+                    result = 0;
+                    exact = true;
+                } else if (y == -1) {
+                    exact = checkedSubtract(0, x, result);
+                } else {
+                    result = op == '/' ? x / y : x % y;
+                    exact = true;
+                }
+                break;
+        }
+        if (exact) {
+            out = integer(result);
+            return true;
+        }
+    }
+
+    double x = left.asReal();
+    double y = right.asReal();
+    switch (op) {
+        case '+': out = real(x + y); break;
+        case '-': out = real(x - y); break;
+        case '*': out = real(x * y); break;
+        case '/': out = y == 0.0 ? Value() : real(x / y); break;
+        case '%': out = y == 0.0 ? Value() : real(std::fmod(x, y)); break;
+        default: return false;
+    }
+    return true;
+}
+
+int Value::compare(const Value& a, const Value& b) {
+    if (a.valueType == ValueType::INTEGER && b.valueType == ValueType::INTEGER) {
+        int64_t x = a.asInteger();
+        int64_t y = b.asInteger();
+        return x < y ? -1 : (x > y ? 1 : 0);
+    }
+    if (a.isNumeric() && b.isNumeric()) {
+        double x = a.asReal();
+        double y = b.asReal();
+        return x < y ? -1 : (x > y ? 1 : 0);
+    }
+    if (a.isNumeric() != b.isNumeric()) {
+        return a.isNumeric() ? -1 : 1;
+    }
+    int order = a.asText().compare(b.asText());
+    return order < 0 ? -1 : (order > 0 ? 1 : 0);
+}
+
+bool Value::operator==(const Value& other) const {
+    if (valueType != other.valueType) {
+        return false;
+    }
+    switch (valueType) {
+        case ValueType::NULL_VALUE:
+            return true;
+        case ValueType::INTEGER:
+            return asInteger() == other.asInteger();
+        case ValueType::REAL:
+            return asReal() == other.asReal();
+        case ValueType::TEXT:
+            return asText() == other.asText();
+    }
+    return false;
+}
+
+size_t Value::payloadBytes() const {
+    switch (valueType) {
+        case ValueType::NULL_VALUE:
+            return 0;
+        case ValueType::TEXT:
+            return asText().size();
+        default:
+            return sizeof(int64_t);
+    }
+}
+
+size_t Value::heapBytes() const {
+    return valueType == ValueType::TEXT && length == HEAP_TEXT ? asText().size() : 0;
+}
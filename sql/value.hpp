@@ -0,0 +1,210 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include "./token.hpp"
+
+enum class ValueType : uint8_t {
+    NULL_VALUE,
+    INTEGER,
+    REAL,
+    TEXT
+};
+
+/**
+ * One SQL value in 16 bytes: NULL, a 64-bit integer, a double or text.
+ * Text of up to 14 bytes is stored inline; longer text is allocated from
+ * the long-lived pool and owned, and deep-copied, by the value.
+ */
+class Value {
+public:
+    static constexpr size_t INLINE_CAPACITY = 14;
+
+    Value() : length(0), valueType(ValueType::NULL_VALUE) {}
+
+    static Value null() { return Value(); }
+    static Value integer(int64_t value);
+    static Value real(double value);
+    static Value text(std::string_view value);
+
+    Value(const Value& other);
+    Value(Value&& other) noexcept;
+    Value& operator=(const Value& other);
+    Value& operator=(Value&& other) noexcept;
+    ~Value() {
+        if (ownsHeap()) {
+            release();
+        }
+    }
+
+    ValueType type() const { return valueType; }
+    bool isNull() const { return valueType == ValueType::NULL_VALUE; }
+    bool isNumeric() const { return valueType == ValueType::INTEGER || valueType == ValueType::REAL; }
+
+    int64_t asInteger() const;        // INTEGER only
+    double asReal() const;            // INTEGER or REAL
+    std::string_view asText() const;  // TEXT only
+
+    // Display form: numbers in shortest round-trip notation, text as is,
+    // NULL as "NULL"
+    void appendTo(std::string& out) const;
+    std::string toString() const;
+
+    // SQL literal form, e.g. 42, 1.5, 'it''s' or NULL
+    std::string toLiteral() const;
+
+    // Value of a column type from its display form, as stored in files.
+    // Text that does not fit a numeric column is kept as text.
+    static Value parse(std::string_view text, TokenType columnType);
+
+    // Convert to the type of a column: between INTEGER and REAL when no
+    // precision is lost, numeric text to numbers, anything to TEXT. NULL
+    // stays NULL. Returns false if the value does not fit.
+    bool castTo(TokenType columnType, Value& out) const;
+
+    // left op right for op one of + - * / %. NULL if either side is NULL
+    // or when dividing by zero; integer division truncates, and integer
+    // results that overflow become reals. Returns false for text.
+    static bool arithmetic(const Value& left, char op, const Value& right, Value& out);
+    
+    // Order of two non-NULL values: numbers by value, text bytewise, and
+    // numbers before text
+    static int compare(const Value& a, const Value& b);
+
+    // Same type and contents; unlike SQL comparison, NULL equals NULL
+    bool operator==(const Value& other) const;
+    bool operator!=(const Value& other) const { return !(*this == other); }
+
+    // Bytes of the payload (8 for numbers) and of the out-of-line part
+    size_t payloadBytes() const;
+    size_t heapBytes() const;
+
+private:
+    static constexpr uint8_t HEAP_TEXT = 0xFF;  // `length` of text stored out of line
+
+    // Integer, double, inline text, or pointer and u32 length of heap text
+    alignas(8) char storage[INLINE_CAPACITY];
+    uint8_t length;  // Inline text length, or HEAP_TEXT
+    ValueType valueType;
+
+    bool ownsHeap() const { return valueType == ValueType::TEXT && length == HEAP_TEXT; }
+    void release();                      // Free heap text and become NULL
+    void copyFrom(const Value& other);  // Give copied heap text its own allocation
+};
+
+static_assert(sizeof(Value) == 16, "Value must stay 16 bytes");
+
+// Numbers and moves are inline, as expression evaluation creates and
+// reads values in its inner loops; only heap text goes out of line
+inline Value Value::integer(int64_t value) {
+    Value result;
+    std::memcpy(result.storage, &value, sizeof(value));
+    result.valueType = ValueType::INTEGER;
+    return result;
+}
+
+inline Value Value::real(double value) {
+    Value result;
+    std::memcpy(result.storage, &value, sizeof(value));
+    result.valueType = ValueType::REAL;
+    return result;
+}
+
+inline Value::Value(const Value& other) {
+    std::memcpy(static_cast<void*>(this), &other, sizeof(Value));
+    if (other.ownsHeap()) {
+        copyFrom(other);
+    }
+}
+
+inline Value::Value(Value&& other) noexcept {
+    std::memcpy(static_cast<void*>(this), &other, sizeof(Value));
+    other.length = 0;
+    other.valueType = ValueType::NULL_VALUE;
+}
+
+inline Value& Value::operator=(const Value& other) {
+    if (this != &other) {
+        if (ownsHeap()) {
+            release();
+        }
+        std::memcpy(static_cast<void*>(this), &other, sizeof(Value));
+        if (other.ownsHeap()) {
+            copyFrom(other);
+        }
+    }
+    return *this;
+}
+
+inline Value& Value::operator=(Value&& other) noexcept {
+    if (this != &other) {
+        if (ownsHeap()) {
+            release();
+        }
+        std::memcpy(static_cast<void*>(this), &other, sizeof(Value));
+        other.length = 0;
+        other.valueType = ValueType::NULL_VALUE;
+    }
+    return *this;
+}
+
+inline int64_t Value::asInteger() const {
+    int64_t value;
+    std::memcpy(&value, storage, sizeof(value));
+    return value;
+}
+
+inline double Value::asReal() const {
+    if (valueType == ValueType::INTEGER) {
+        return static_cast<double>(asInteger());
+    }
+    double value;
+    std::memcpy(&value, storage, sizeof(value));
+    return value;
+}
+
+// 64-bit integer arithmetic that reports overflow instead of wrapping
+inline bool checkedAdd(int64_t x, int64_t y, int64_t& out) {
+    const int64_t MAX = std::numeric_limits<int64_t>::max();
+    const int64_t MIN = std::numeric_limits<int64_t>::min();
+    if ((y > 0 && x > MAX - y) || (y < 0 && x < MIN - y)) {
+        return false;
+    }
+    out = x + y;
+    return true;
+}
+
+inline bool checkedSubtract(int64_t x, int64_t y, int64_t& out) {
+    const int64_t MAX = std::numeric_limits<int64_t>::max();
+    const int64_t MIN = std::numeric_limits<int64_t>::min();
+    if ((y < 0 && x > MAX + y) || (y > 0 && x < MIN + y)) {
+        return false;
+    }
+    out = x - y;
+    return true;
+}
+
+inline bool checkedMultiply(int64_t x, int64_t y, int64_t& out) {
+    const int64_t MIN = std::numeric_limits<int64_t>::min();
+    if (x == 0 || y == 0) {
+        out = 0;
+        return true;
+    }
+    if ((x == -1 && y == MIN) || (y == -1 && x == MIN)) {
+        return false;
+    }
+    // Multiply with wraparound, then check that dividing undoes it
+    int64_t product = static_cast<int64_t>(static_cast<uint64_t>(x) * static_cast<uint64_t>(y));
+    if (product / y != x) {
+        return false;
+    }
+    out = product;
+    return true;
+}
+
+#endif // VALUE_HPP
@@ -1,18 +1,221 @@
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <csignal>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
 #include "../include/db_engine.hpp"
 #include "../include/string_utils.hpp"
+#include "../executor/result_sink.hpp"
+#include "../server/server.hpp"
+
+// Server instance that SIGINT/SIGTERM should stop
+static Server* runningServer = nullptr;
+
+static void handleStopSignal(int) {
+    if (runningServer != nullptr) {
+        runningServer->stop();
+    }
+}
+
+// Database whose running query Ctrl-C cancels; read by the handler
+static std::atomic<DBEngine*> interruptibleDb{nullptr};
+
+static void handleInterruptSignal(int) {
+    DBEngine* db = interruptibleDb.load();
+    if (db != nullptr) {
+        db->interrupt();
+    }
+}
+
+// While a query runs, Ctrl-C cancels it instead of ending the shell. The
+// query counts interrupts from when the handler is installed, so one that
+// comes before the query is set up is not lost.
+class InterruptScope {
+public:
+    explicit InterruptScope(DBEngine& db) : seen(db.interruptCount()) {
+        interruptibleDb.store(&db);
+        std::signal(SIGINT, handleInterruptSignal);
+    }
+    ~InterruptScope() {
+        std::signal(SIGINT, SIG_DFL);
+        interruptibleDb.store(nullptr);
+    }
+
+    uint64_t interruptsSeen() const { return seen; }
+
+private:
+    uint64_t seen;
+};
+
+// Serve the database to network clients until interrupted
+static int runServer(DBEngine& db, const ServerOptions& options) {
+    Server server(db, options);
+    
+    std::string errorMessage;
+    if (!server.start(errorMessage)) {
+        std::cerr << errorMessage << std::endl;
+        return 1;
+    }
+    
+    std::cerr << "Listening on " << options.address 
+              << " with " << options.workerThreads << " worker(s)" << std::endl;
+    
+    runningServer = &server;
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+    
+    server.run();
+    
+    runningServer = nullptr;
+    std::cerr << "Server stopped" << std::endl;
+    return 0;
+}
+
+// Read the whole number an option takes, from min to max; prints what is
+// wrong with it otherwise
+static bool parseNumber(const std::string& option, const char* text,
+                        uint64_t min, uint64_t max, uint64_t& value) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (!std::isdigit(static_cast<unsigned char>(text[0])) || *end != '\0' ||
+        errno == ERANGE || parsed < min || parsed > max) {
+        std::cerr << "Invalid value for " << option << ": " << text
+                  << " (expected " << min << " to " << max << ")\n";
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Largest size in MB whose bytes fit in 64 bits
+static const uint64_t MAX_MEGABYTES = std::numeric_limits<uint64_t>::max() >> 20;
+
+static void printUsage() {
+    std::cerr << "Usage: minidb [OPTIONS] [FILE]\n"
+              << "       minidb --serve [--listen HOST:PORT|unix:PATH] [--workers N] [OPTIONS] FILE\n"
+              << "Options:\n"
+              << "  --metrics-file PATH       Write Prometheus metrics to PATH periodically\n"
+              << "  --metrics-interval SECS   Seconds between metrics writes (default 10)\n"
+              << "  --checkpoint-size MB      Checkpoint in the background once the log exceeds MB\n"
+              << "  --preload                 Load all tables at startup instead of on first use\n"
+              << "  --result-cache MB         Cache results of repeated SELECTs, up to MB\n"
+              << "  --memory-limit MB         Memory all queries may buffer rows in at once\n"
+              << "  --query-memory-limit MB   Memory one query may buffer rows in\n"
+              << "  --statement-timeout MS    Cancel statements running longer than MS\n";
+}
 
 int main(int argc, char* argv[]) {
-    std::cout << "Welcome to MiniDB - A Simple SQLite Clone\n";
-    std::cout << "Enter .help for usage hints.\n";
+    // Parse command line arguments
+    std::string filename;
+    bool serve = false;
+    ServerOptions serverOptions;
+    std::string metricsFile;
+    uint64_t metricsInterval = 10;
+    uint64_t checkpointSize = 0;
+    bool preload = false;
+    uint64_t resultCacheSize = 0;
+    uint64_t memoryLimit = 0;
+    uint64_t queryMemoryLimit = 0;
+    uint64_t statementTimeout = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--serve") {
+            serve = true;
+        } else if (arg == "--listen" && i + 1 < argc) {
+            serverOptions.address = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            uint64_t workers = 0;
+            if (!parseNumber(arg, argv[++i], 1, 1024, workers)) {
+                printUsage();
+                return 1;
+            }
+            serverOptions.workerThreads = static_cast<size_t>(workers);
+        } else if (arg == "--metrics-file" && i + 1 < argc) {
+            metricsFile = argv[++i];
+        } else if (arg == "--metrics-interval" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 1, 24 * 60 * 60, metricsInterval)) {
+                printUsage();
+                return 1;
+            }
+        } else if (arg == "--preload") {
+            preload = true;
+        } else if (arg == "--checkpoint-size" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0, MAX_MEGABYTES, checkpointSize)) {
+                printUsage();
+                return 1;
+            }
+            checkpointSize <<= 20;
+        } else if (arg == "--result-cache" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0, std::numeric_limits<size_t>::max() >> 20,
+                             resultCacheSize)) {
+                printUsage();
+                return 1;
+            }
+            resultCacheSize <<= 20;
+        } else if (arg == "--memory-limit" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0, MAX_MEGABYTES, memoryLimit)) {
+                printUsage();
+                return 1;
+            }
+            memoryLimit <<= 20;
+        } else if (arg == "--query-memory-limit" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0, MAX_MEGABYTES, queryMemoryLimit)) {
+                printUsage();
+                return 1;
+            }
+            queryMemoryLimit <<= 20;
+        } else if (arg == "--statement-timeout" && i + 1 < argc) {
+            if (!parseNumber(arg, argv[++i], 0, 365ULL * 24 * 60 * 60 * 1000, statementTimeout)) {
+                printUsage();
+                return 1;
+            }
+        } else if (!arg.empty() && arg[0] != '-' && filename.empty()) {
+            filename = arg;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
     
     // Create database instance
     DBEngine db;
+    db.setAutoCheckpoint(checkpointSize);
+    db.setPreload(preload);
+    db.setResultCache(static_cast<size_t>(resultCacheSize));
+    db.setMemoryLimit(memoryLimit);
+    db.setQueryMemoryLimit(queryMemoryLimit);
+    db.setStatementTimeout(std::chrono::milliseconds(statementTimeout));
+    
+    if (!metricsFile.empty() &&
+        !db.startMetricsDump(metricsFile, std::chrono::seconds(metricsInterval))) {
+        std::cerr << "Failed to write metrics file: " << metricsFile << std::endl;
+        return 1;
+    }
+    
+    if (serve) {
+        if (filename.empty()) {
+            printUsage();
+            return 1;
+        }
+        if (!db.openDatabase(filename)) {
+            std::cerr << "Failed to open database file: " << filename << std::endl;
+            return 1;
+        }
+        return runServer(db, serverOptions);
+    }
+    
+    std::cout << "Welcome to MiniDB - A Simple SQLite Clone\n";
+    std::cout << "Enter .help for usage hints.\n";
     
     // If a database file is provided as argument, open it
-    if (argc > 1) {
-        std::string filename = argv[1];
+    if (!filename.empty()) {
         if (!db.openDatabase(filename)) {
             std::cerr << "Failed to open database file: " << filename << std::endl;
             return 1;
@@ -20,11 +223,16 @@ int main(int argc, char* argv[]) {
         std::cout << "Opened database: " << filename << std::endl;
     }
     
+    // Results are rendered into a buffer and written in large chunks
+    RenderFormat outputFormat = RenderFormat::TABLE;
+    
     // Read-Evaluate-Print Loop (REPL)
     std::string input;
     while (true) {
         std::cout << "db > ";
-        std::getline(std::cin, input);
+        if (!std::getline(std::cin, input)) {
+            break;  // End of input
+        }
         // Handle meta-commands (commands that start with a dot)
         if (!input.empty() && input[0] == '.') {
             if (input == ".exit") {
@@ -33,7 +241,11 @@ int main(int argc, char* argv[]) {
                 std::cout << "Special commands:\n"
                           << "  .exit      Exit the program\n"
                           << "  .help      Show this message\n"
+                          << "  .mode MODE Output mode: table, csv, json or quiet\n"
                           << "  .open FILE Open a database file\n"
+                          << "  .read FILE Execute the SQL statements in FILE\n"
+                          << "  .save      Write all changes to the database file\n"
+                          << "  .stats     Show engine metrics and table memory usage\n"
                           << "  .tables    Show all tables\n";
                 continue;
             } else if (input.substr(0, 5) == ".open" && input.length() > 6) {
@@ -44,6 +256,38 @@ int main(int argc, char* argv[]) {
                 }
                 std::cout << "Opened database: " << filename << std::endl;
                 continue;
+            } else if (input.substr(0, 5) == ".mode" && input.length() > 6) {
+                std::string mode = trim(input.substr(6));
+                if (!RenderingSink::parseFormat(mode, outputFormat)) {
+                    std::cout << "Unknown mode: " << mode << std::endl;
+                }
+                continue;
+            } else if (input.substr(0, 5) == ".read" && input.length() > 6) {
+                std::string scriptFile = trim(input.substr(6));
+                std::ifstream script(scriptFile, std::ios::binary);
+                if (!script.is_open()) {
+                    std::cerr << "Failed to open script file: " << scriptFile << std::endl;
+                    continue;
+                }
+                
+                // The script is read and run a statement at a time, so
+                // dumps of any size load in constant memory; BEGIN ...
+                // COMMIT in it are committed (and synced) once
+                RenderingSink sink(std::cout, outputFormat);
+                InterruptScope interruptible(db);
+                ExecutionResult result = db.executeScript(script, sink, interruptible.interruptsSeen());
+                if (!result.success) {
+                    std::cout << "Error: " << result.errorMessage << std::endl;
+                }
+                continue;
+            } else if (input == ".save") {
+                if (!db.saveDatabase()) {
+                    std::cerr << "Failed to save database" << std::endl;
+                }
+                continue;
+            } else if (input == ".stats") {
+                db.writeStats(std::cout);
+                continue;
             } else if (input == ".tables") {
                 db.listTables();
                 continue;
@@ -55,7 +299,9 @@ int main(int argc, char* argv[]) {
         
         // Process SQL query
         if (!input.empty()) {
-            ExecutionResult result = db.executeQuery(input);
+            RenderingSink sink(std::cout, outputFormat);
+            InterruptScope interruptible(db);
+            ExecutionResult result = db.executeQuery(input, sink, interruptible.interruptsSeen());
             if (!result.success) {
                 std::cout << "Error: " << result.errorMessage << std::endl;
             }
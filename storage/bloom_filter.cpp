@@ -0,0 +1,78 @@
+#include "./bloom_filter.hpp"
+#include <cmath>
+#include <cstring>
+
+// Odd constants that spread a key over the bits of each word
+static const uint32_t SALTS[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+// Finalizer of splitmix64: every input bit affects every output bit
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+BloomFilter::BloomFilter(size_t expectedKeys, double falsePositiveRate) {
+    // With eight bits set per key in one block, the bits per key for a
+    // rate p are -8 / ln(1 - p^(1/8))
+    double bitsPerKey = -8.0 / std::log(1.0 - std::pow(falsePositiveRate, 1.0 / 8.0));
+    double bits = bitsPerKey * static_cast<double>(expectedKeys == 0 ? 1 : expectedKeys);
+    size_t count = static_cast<size_t>(std::ceil(bits / (8 * sizeof(Block))));
+    blocks.assign(count == 0 ? 1 : count, Block{});
+}
+
+void BloomFilter::add(uint64_t hash) {
+    Block& block = blocks[blockOf(hash)];
+    uint32_t key = static_cast<uint32_t>(hash);
+    for (int i = 0; i < 8; i++) {
+        block.words[i] |= 1U << ((key * SALTS[i]) >> 27);
+    }
+}
+
+bool BloomFilter::mayContain(uint64_t hash) const {
+    const Block& block = blocks[blockOf(hash)];
+    uint32_t key = static_cast<uint32_t>(hash);
+    bool found = true;
+    for (int i = 0; i < 8; i++) {
+        found &= (block.words[i] >> ((key * SALTS[i]) >> 27)) & 1U;
+    }
+    return found;
+}
+
+uint64_t BloomFilter::hash(const Value& value) {
+    if (value.isNumeric()) {
+        if (value.type() == ValueType::INTEGER) {
+            return mix(static_cast<uint64_t>(value.asInteger()));
+        }
+
+        // Reals with an integer value hash as that integer
+        double real = value.asReal();
+        if (real >= -9.2e18 && real <= 9.2e18 && std::floor(real) == real) {
+            return mix(static_cast<uint64_t>(static_cast<int64_t>(real)));
+        }
+        uint64_t bits;
+        std::memcpy(&bits, &real, sizeof(bits));
+        return mix(bits ^ 0x9e3779b97f4a7c15ULL);
+    }
+
+    // Text, eight bytes at a time, then the rest and the length
+    std::string_view text = value.asText();
+    uint64_t hash = 0x2545f4914f6cdd1dULL;
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + i, sizeof(word));
+        hash = mix(hash ^ word);
+    }
+    uint64_t tail = 0;
+    if (i < text.size()) {
+        std::memcpy(&tail, text.data() + i, text.size() - i);
+    }
+    return mix(hash ^ tail ^ (static_cast<uint64_t>(text.size()) << 56));
+}
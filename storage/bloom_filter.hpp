@@ -0,0 +1,46 @@
+#ifndef BLOOM_FILTER_HPP
+#define BLOOM_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../sql/value.hpp"
+
+/**
+ * Split-block Bloom filter: the bits are grouped in 32-byte blocks, one
+ * cache line or less, and a key sets one bit in each of the eight words of
+ * a single block. A lookup so touches one block, and its eight probes are
+ * independent. Needs a few more bits per key than a classic Bloom filter
+ * for the same false positive rate. Not thread-safe.
+ */
+class BloomFilter {
+public:
+    // Sized for expectedKeys distinct keys at the given false positive rate
+    BloomFilter(size_t expectedKeys, double falsePositiveRate);
+
+    void add(uint64_t hash);
+
+    // False if the key was never added; true for every key added and for
+    // others at about the false positive rate
+    bool mayContain(uint64_t hash) const;
+
+    size_t memoryBytes() const { return blocks.capacity() * sizeof(Block); }
+
+    // Hash of a value consistent with how values compare: numbers equal
+    // as integers and reals hash alike. Not for NULL.
+    static uint64_t hash(const Value& value);
+
+private:
+    struct Block {
+        uint32_t words[8];
+    };
+
+    std::vector<Block> blocks;
+
+    // The block a key falls in
+    size_t blockOf(uint64_t hash) const {
+        return static_cast<size_t>(((hash >> 32) * blocks.size()) >> 32);
+    }
+};
+
+#endif // BLOOM_FILTER_HPP
@@ -0,0 +1,419 @@
+#include "./catalog.hpp"
+#include <algorithm>
+#include <mutex>
+#include "../include/string_utils.hpp"
+
+std::shared_ptr<Table> Catalog::find(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(latch);
+
+    auto it = byName.find(name);
+    if (it == byName.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+bool Catalog::add(std::shared_ptr<Table> table, std::string& errorMessage) {
+    // Lock order is log, then catalog: a checkpoint holds the log while
+    // it lists the tables
+    std::shared_lock<std::shared_mutex> logGuard;
+    if (log != nullptr) {
+        logGuard = log->beginCommit();
+    }
+    std::unique_lock<std::shared_mutex> lock(latch);
+
+    if (byName.count(table->getName()) != 0) {
+        errorMessage = "Table already exists: " + table->getName();
+        return false;
+    }
+
+    // Log the definition before the table becomes visible
+    if (log != nullptr && !log->commit("T " + table->encodeSchema() + "\n")) {
+        errorMessage = "Failed to write transaction log";
+        return false;
+    }
+
+    byName.emplace(table->getName(), table);
+    tables.push_back(std::move(table));
+    return true;
+}
+
+bool Catalog::addPartitioned(std::shared_ptr<Table> parent,
+                             std::shared_ptr<const PartitionScheme> scheme,
+                             std::string& errorMessage) {
+    std::shared_lock<std::shared_mutex> logGuard;
+    if (log != nullptr) {
+        logGuard = log->beginCommit();
+    }
+    std::unique_lock<std::shared_mutex> lock(latch);
+
+    if (byName.count(parent->getName()) != 0) {
+        errorMessage = "Table already exists: " + parent->getName();
+        return false;
+    }
+
+    // The tables, then the scheme that ties them together
+    std::string records = "T " + parent->encodeSchema() + "\n";
+    for (const Partition& partition : scheme->partitions) {
+        records += "T " + partition.table->encodeSchema() + "\n";
+    }
+    records += "P " + scheme->encode() + "\n";
+    if (log != nullptr && !log->commit(records)) {
+        errorMessage = "Failed to write transaction log";
+        return false;
+    }
+
+    byName.emplace(parent->getName(), parent);
+    tables.push_back(std::move(parent));
+    for (const Partition& partition : scheme->partitions) {
+        byName.emplace(partition.table->getName(), partition.table);
+        tables.push_back(partition.table);
+    }
+    schemes.push_back(std::move(scheme));
+    return true;
+}
+
+bool Catalog::addPartition(const std::string& tableName, const PartitionBound& bound,
+                           std::string& errorMessage) {
+    // The index lock keeps the partitioned table's indexes as they are
+    // while the new partition copies them
+    std::shared_lock<std::shared_mutex> logGuard;
+    if (log != nullptr) {
+        logGuard = log->beginCommit();
+    }
+    std::lock_guard<std::mutex> indexLock(indexMutex);
+    std::unique_lock<std::shared_mutex> lock(latch);
+
+    auto found = std::find_if(schemes.begin(), schemes.end(),
+                              [&tableName](const std::shared_ptr<const PartitionScheme>& scheme) {
+                                  return scheme->tableName == tableName;
+                              });
+    if (found == schemes.end()) {
+        errorMessage = "Table is not partitioned: " + tableName;
+        return false;
+    }
+    std::shared_ptr<Table> parent = byName[tableName];
+    std::shared_ptr<const PartitionScheme> scheme = (*found)->withPartition(parent, bound, errorMessage);
+    if (scheme == nullptr) {
+        return false;
+    }
+    std::shared_ptr<Table> table = scheme->partitions.back().table;
+    return publishWith(std::move(scheme), std::move(table), errorMessage);
+}
+
+bool Catalog::addSegment(const std::string& tableName, const Value& time, std::string& errorMessage) {
+    std::shared_lock<std::shared_mutex> logGuard;
+    if (log != nullptr) {
+        logGuard = log->beginCommit();
+    }
+    std::lock_guard<std::mutex> indexLock(indexMutex);
+    std::unique_lock<std::shared_mutex> lock(latch);
+
+    auto found = std::find_if(schemes.begin(), schemes.end(),
+                              [&tableName](const std::shared_ptr<const PartitionScheme>& scheme) {
+                                  return scheme->tableName == tableName;
+                              });
+    if (found == schemes.end() || (*found)->method != PartitionScheme::Method::TIMESERIES) {
+        errorMessage = "Table is not a time-series table: " + tableName;
+        return false;
+    }
+
+    // Another statement may have added it in the meantime
+    if ((*found)->route(time) >= 0) {
+        return true;
+    }
+    std::shared_ptr<const PartitionScheme> scheme = (*found)->withSegment(byName[tableName], time, errorMessage);
+    if (scheme == nullptr) {
+        return false;
+    }
+    std::shared_ptr<Table> table = scheme->partitions[scheme->route(time)].table;
+    return publishWith(std::move(scheme), std::move(table), errorMessage);
+}
+
+bool Catalog::publishWith(std::shared_ptr<const PartitionScheme> scheme, std::shared_ptr<Table> table,
+                          std::string& errorMessage) {
+    if (byName.count(table->getName()) != 0) {
+        errorMessage = "Table already exists: " + table->getName();
+        return false;
+    }
+
+    std::string records = "T " + table->encodeSchema() + "\n";
+    for (const IndexDefinition& index : table->indexDefinitions()) {
+        records += "X " + table->getName() + " " + index.encode() + "\n";
+    }
+    records += "P " + scheme->encode() + "\n";
+    if (log != nullptr && !log->commit(records)) {
+        errorMessage = "Failed to write transaction log";
+        return false;
+    }
+
+    byName.emplace(table->getName(), table);
+    tables.push_back(std::move(table));
+    publish(std::move(scheme));
+    return true;
+}
+
+bool Catalog::dropPartition(const std::string& tableName, const std::string& partitionName,
+                            std::string& errorMessage) {
+    std::shared_lock<std::shared_mutex> logGuard;
+    if (log != nullptr) {
+        logGuard = log->beginCommit();
+    }
+    std::unique_lock<std::shared_mutex> lock(latch);
+
+    auto found = std::find_if(schemes.begin(), schemes.end(),
+                              [&tableName](const std::shared_ptr<const PartitionScheme>& scheme) {
+                                  return scheme->tableName == tableName;
+                              });
+    if (found == schemes.end()) {
+        errorMessage = "Table is not partitioned: " + tableName;
+        return false;
+    }
+    std::shared_ptr<const PartitionScheme> scheme = (*found)->withoutPartition(partitionName, errorMessage);
+    if (scheme == nullptr) {
+        return false;
+    }
+
+    // One record however many rows the partition has
+    if (log != nullptr && !log->commit("P " + scheme->encode() + "\n")) {
+        errorMessage = "Failed to write transaction log";
+        return false;
+    }
+    publish(std::move(scheme));
+    return true;
+}
+
+bool Catalog::restorePartitioning(const std::string& encoded, std::string& errorMessage) {
+    std::string tableName = encoded.substr(0, encoded.find(' '));
+    std::shared_ptr<Table> parent = find(tableName);
+    std::shared_ptr<const PartitionScheme> scheme;
+    if (parent != nullptr) {
+        scheme = PartitionScheme::decode(encoded, parent, [this](const std::string& name) {
+            return find(name);
+        });
+    }
+    if (scheme == nullptr) {
+        errorMessage = "Invalid partitioning of table " + tableName;
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(latch);
+    publish(std::move(scheme));
+    return true;
+}
+
+std::shared_ptr<const PartitionScheme> Catalog::partitioning(const std::string& tableName) const {
+    std::shared_lock<std::shared_mutex> lock(latch);
+
+    for (const auto& scheme : schemes) {
+        if (scheme->tableName == tableName) {
+            return scheme;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<std::shared_ptr<const PartitionScheme>> Catalog::listPartitioned() const {
+    std::shared_lock<std::shared_mutex> lock(latch);
+    return schemes;
+}
+
+void Catalog::publish(std::shared_ptr<const PartitionScheme> scheme) {
+    // Rows arrive for the newest segment of a time-series table; the
+    // others are packed once they are quiet
+    if (scheme->method == PartitionScheme::Method::TIMESERIES) {
+        for (size_t i = 0; i < scheme->partitions.size(); i++) {
+            scheme->partitions[i].table->setSealed(i + 1 < scheme->partitions.size());
+        }
+    }
+
+    auto found = std::find_if(schemes.begin(), schemes.end(),
+                              [&scheme](const std::shared_ptr<const PartitionScheme>& existing) {
+                                  return existing->tableName == scheme->tableName;
+                              });
+    if (found == schemes.end()) {
+        schemes.push_back(std::move(scheme));
+        return;
+    }
+
+    // Unlist the partitions the new scheme lacks. A running transaction
+    // may still have rows in one, so its table is kept for now.
+    for (const Partition& partition : (*found)->partitions) {
+        bool kept = std::any_of(scheme->partitions.begin(), scheme->partitions.end(),
+                                [&partition](const Partition& other) {
+                                    return other.table == partition.table;
+                                });
+        if (kept) {
+            continue;
+        }
+        byName.erase(partition.table->getName());
+        tables.erase(std::remove(tables.begin(), tables.end(), partition.table), tables.end());
+        uint64_t retiredAt = transactions != nullptr ? transactions->lastCommitted() : 0;
+        retired.push_back({partition.table, retiredAt});
+    }
+
+    // Results cached before the change are out of date
+    byName[scheme->tableName]->bumpVersion();
+    *found = std::move(scheme);
+}
+
+bool Catalog::addIndex(const std::string& tableName, const IndexDefinition& index,
+                       std::string& errorMessage) {
+    // Holding the log while the rows are indexed keeps a checkpoint from
+    // starting in between: its catalog either has the index or its log
+    // has the record
+    std::shared_lock<std::shared_mutex> logGuard;
+    if (log != nullptr) {
+        logGuard = log->beginCommit();
+    }
+    std::lock_guard<std::mutex> indexLock(indexMutex);
+
+    std::shared_ptr<Table> table = find(tableName);
+    if (table == nullptr) {
+        errorMessage = "Table not found: " + tableName;
+        return false;
+    }
+    if (!table->checkIndex(index, errorMessage)) {
+        return false;
+    }
+
+    // A partitioned table keeps the definition for partitions added
+    // later. One record covers them all, as replay finds the same
+    // partitions.
+    std::vector<std::shared_ptr<Table>> indexed = {table};
+    std::shared_ptr<const PartitionScheme> scheme = partitioning(tableName);
+    if (scheme != nullptr) {
+        for (const Partition& partition : scheme->partitions) {
+            indexed.push_back(partition.table);
+        }
+    }
+
+    if (log != nullptr && !log->commit("X " + tableName + " " + index.encode() + "\n")) {
+        errorMessage = "Failed to write transaction log";
+        return false;
+    }
+    for (const auto& target : indexed) {
+        if (!target->createIndex(index, errorMessage)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Catalog::addView(std::shared_ptr<MaterializedView> view, std::string& errorMessage) {
+    std::shared_lock<std::shared_mutex> logGuard;
+    if (log != nullptr) {
+        logGuard = log->beginCommit();
+    }
+    std::unique_lock<std::shared_mutex> lock(latch);
+
+    if (log != nullptr &&
+        !log->commit("V " + escapeLineBreaks(view->definition->toString()) + "\n")) {
+        errorMessage = "Failed to write transaction log";
+        return false;
+    }
+    views.push_back(std::move(view));
+    return true;
+}
+
+bool Catalog::createView(std::shared_ptr<MaterializedView> view, std::string& errorMessage) {
+    std::shared_lock<std::shared_mutex> logGuard;
+    if (log != nullptr) {
+        logGuard = log->beginCommit();
+    }
+    std::unique_lock<std::shared_mutex> lock(latch);
+
+    const std::shared_ptr<Table>& table = view->table;
+    if (byName.count(table->getName()) != 0) {
+        errorMessage = "Table already exists: " + table->getName();
+        return false;
+    }
+
+    // The table, then the definition that makes it the view
+    std::string records = "T " + table->encodeSchema() + "\n" +
+                          "V " + escapeLineBreaks(view->definition->toString()) + "\n";
+    if (log != nullptr && !log->commit(records)) {
+        errorMessage = "Failed to write transaction log";
+        return false;
+    }
+
+    byName.emplace(table->getName(), table);
+    tables.push_back(table);
+    views.push_back(std::move(view));
+    return true;
+}
+
+std::vector<std::shared_ptr<MaterializedView>> Catalog::viewsOn(const std::string& tableName) const {
+    std::shared_lock<std::shared_mutex> lock(latch);
+
+    std::vector<std::shared_ptr<MaterializedView>> found;
+    for (const auto& view : views) {
+        if (view->definition->tableName == tableName) {
+            found.push_back(view);
+        }
+    }
+    return found;
+}
+
+bool Catalog::isView(const std::string& tableName) const {
+    std::shared_lock<std::shared_mutex> lock(latch);
+
+    for (const auto& view : views) {
+        if (view->definition->viewName == tableName) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::shared_ptr<MaterializedView>> Catalog::listViews() const {
+    std::shared_lock<std::shared_mutex> lock(latch);
+    return views;
+}
+
+std::vector<std::shared_ptr<Table>> Catalog::list() const {
+    std::shared_lock<std::shared_mutex> lock(latch);
+    return tables;
+}
+
+void Catalog::clear() {
+    std::unique_lock<std::shared_mutex> lock(latch);
+    byName.clear();
+    tables.clear();
+    views.clear();
+    schemes.clear();
+    retired.clear();
+}
+
+void Catalog::collectGarbage(uint64_t oldestSnapshot) {
+    for (const auto& table : list()) {
+        if (table->hasGarbage()) {
+            table->collectGarbage(oldestSnapshot);
+        }
+        if (table->canPack(oldestSnapshot)) {
+            table->pack(oldestSnapshot);
+        }
+    }
+
+    // Every transaction running when a partition was dropped started at or
+    // before the latest commit then, so none is left once the oldest
+    // snapshot is newer
+    {
+        std::shared_lock<std::shared_mutex> lock(latch);
+        if (retired.empty()) {
+            return;
+        }
+    }
+    std::vector<std::shared_ptr<Table>> released;  // Freed after unlocking
+    {
+        std::unique_lock<std::shared_mutex> lock(latch);
+        auto unused = std::partition(retired.begin(), retired.end(),
+                                     [oldestSnapshot](const RetiredTable& entry) {
+                                         return entry.retiredAt >= oldestSnapshot;
+                                     });
+        for (auto it = unused; it != retired.end(); ++it) {
+            released.push_back(std::move(it->table));
+        }
+        retired.erase(unused, retired.end());
+    }
+}
@@ -0,0 +1,139 @@
+#ifndef CATALOG_HPP
+#define CATALOG_HPP
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "./partitioning.hpp"
+#include "./table.hpp"
+#include "./wal.hpp"
+
+// A materialized view: a table of per-group counts and sums over another
+// table, kept up to date by the statements that write to that table
+struct MaterializedView {
+    std::shared_ptr<const CreateViewStatement> definition;
+    std::shared_ptr<Table> table;  // One row per group, in the catalog too
+
+    // Held while a statement writes its changes to the groups, so two
+    // transactions cannot both add a row for the same new group
+    std::mutex maintenanceMutex;
+};
+
+// Thread-safe registry of the tables in a database. Tables are shared so a
+// query keeps its table alive even if it is removed from the catalog.
+class Catalog {
+public:
+    Catalog() = default;
+
+    // Find a table by name, or nullptr if it does not exist
+    std::shared_ptr<Table> find(const std::string& name) const;
+
+    // Register a new table. DDL is not transactional: the table is
+    // logged and visible right away. Fails if the name is already taken.
+    bool add(std::shared_ptr<Table> table, std::string& errorMessage);
+
+    // Register a partitioned table and the tables of its partitions, all
+    // logged at once
+    bool addPartitioned(std::shared_ptr<Table> parent,
+                        std::shared_ptr<const PartitionScheme> scheme,
+                        std::string& errorMessage);
+
+    // Add a RANGE partition above the others, or drop one. Dropping only
+    // unlists the partition's table: its rows are neither deleted nor
+    // logged, and its memory is released once no transaction that could
+    // have written to it is running.
+    bool addPartition(const std::string& tableName, const PartitionBound& bound,
+                      std::string& errorMessage);
+    bool dropPartition(const std::string& tableName, const std::string& partitionName,
+                       std::string& errorMessage);
+
+    // Add the segment of a time, of the time column's type, to a
+    // time-series table unless one holds it already. Segments past the
+    // retention are dropped in the same step (see withSegment).
+    bool addSegment(const std::string& tableName, const Value& time, std::string& errorMessage);
+
+    // Install a scheme read from the database file or the WAL, whose
+    // partitions' tables were already added; partitions it no longer has
+    // are dropped
+    bool restorePartitioning(const std::string& encoded, std::string& errorMessage);
+
+    // The partitions of a table, or nullptr if it is not partitioned
+    std::shared_ptr<const PartitionScheme> partitioning(const std::string& tableName) const;
+
+    // All partitioned tables' schemes in creation order
+    std::vector<std::shared_ptr<const PartitionScheme>> listPartitioned() const;
+
+    // Create an index on a column of a table. Like a table it is logged
+    // and in use at once; the rows are indexed before this returns, and a
+    // checkpoint waits for that. On a partitioned table every partition
+    // gets the index. Fails if the table does not exist or
+    // Table::checkIndex rejects the index.
+    bool addIndex(const std::string& tableName, const IndexDefinition& index,
+                  std::string& errorMessage);
+
+    // Make a table, already added, the materialized view of its
+    // definition. Logged and maintained right away; the caller fills in
+    // the groups the base table has so far first.
+    bool addView(std::shared_ptr<MaterializedView> view, std::string& errorMessage);
+
+    // Add a new materialized view together with the table of its groups,
+    // in one log record, so a failure leaves neither behind. The caller
+    // fills in the groups first.
+    bool createView(std::shared_ptr<MaterializedView> view, std::string& errorMessage);
+
+    // The materialized views over a table, and whether a table is one
+    std::vector<std::shared_ptr<MaterializedView>> viewsOn(const std::string& tableName) const;
+    bool isView(const std::string& tableName) const;
+
+    // All materialized views in creation order
+    std::vector<std::shared_ptr<MaterializedView>> listViews() const;
+
+    // Log that new table definitions are written to
+    void setLog(WriteAheadLog* log) { this->log = log; }
+
+    // Transactions whose progress tells when a dropped partition is unused
+    void setTransactions(const TransactionManager* transactions) { this->transactions = transactions; }
+
+    // All tables in creation order
+    std::vector<std::shared_ptr<Table>> list() const;
+
+    // Remove all tables, views and partitioning
+    void clear();
+
+    // Drop row versions no running snapshot can see anymore, pack sealed
+    // tables, and release dropped partitions no running transaction can
+    // have written to
+    void collectGarbage(uint64_t oldestSnapshot);
+
+private:
+    // A dropped partition's table, kept while an undo log may point to it
+    struct RetiredTable {
+        std::shared_ptr<Table> table;
+        uint64_t retiredAt;  // Latest commit when it was dropped
+    };
+
+    WriteAheadLog* log = nullptr;
+    const TransactionManager* transactions = nullptr;
+
+    mutable std::shared_mutex latch;
+    std::mutex indexMutex;  // Creates one index at a time
+    std::unordered_map<std::string, std::shared_ptr<Table>> byName;
+    std::vector<std::shared_ptr<Table>> tables;
+    std::vector<std::shared_ptr<MaterializedView>> views;
+    std::vector<std::shared_ptr<const PartitionScheme>> schemes;
+    std::vector<RetiredTable> retired;
+
+    // Replace a table's scheme and unlist the partitions the new one
+    // lacks; latch held exclusively
+    void publish(std::shared_ptr<const PartitionScheme> scheme);
+
+    // Log and list the table of a partition the scheme adds, then publish
+    // the scheme; latch held exclusively
+    bool publishWith(std::shared_ptr<const PartitionScheme> scheme, std::shared_ptr<Table> table,
+                     std::string& errorMessage);
+};
+
+#endif // CATALOG_HPP
@@ -0,0 +1,123 @@
+#include "./crc32c.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#define CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+// Reflected polynomial
+static const uint32_t POLYNOMIAL = 0x82f63b78;
+
+// Slicing-by-8 tables: tables[k][b] is the CRC of byte b followed by k
+// zero bytes
+struct Tables {
+    uint32_t entries[8][256];
+
+    Tables() {
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (crc & 1 ? POLYNOMIAL : 0);
+            }
+            entries[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; b++) {
+            for (int k = 1; k < 8; k++) {
+                entries[k][b] = (entries[k - 1][b] >> 8) ^ entries[0][entries[k - 1][b] & 0xff];
+            }
+        }
+    }
+};
+
+static uint32_t crc32cSoftware(uint32_t crc, const unsigned char* data, size_t size) {
+    static const Tables tables;
+    const auto& t = tables.entries;
+
+    while (size >= 8) {
+        uint32_t low, high;
+        std::memcpy(&low, data, 4);
+        std::memcpy(&high, data + 4, 4);
+        low ^= crc;  // Little-endian byte order assumed, as everywhere else
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^
+              t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+              t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^
+              t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef CRC32C_X86
+static bool hasHardwareCrc() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+#endif
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t crc32cHardware(uint32_t crc, const unsigned char* data, size_t size) {
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        size -= 8;
+    }
+    crc = static_cast<uint32_t>(crc64);
+    while (size-- > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+#ifdef CRC32C_ARM
+static uint32_t crc32cHardware(uint32_t crc, const unsigned char* data, size_t size) {
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = __crc32cb(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+uint32_t crc32c(const char* data, size_t size, uint32_t crc) {
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data);
+    crc = ~crc;
+#if defined(CRC32C_X86)
+    static const bool hardware = hasHardwareCrc();
+    crc = hardware ? crc32cHardware(crc, bytes, size) : crc32cSoftware(crc, bytes, size);
+#elif defined(CRC32C_ARM)
+    crc = crc32cHardware(crc, bytes, size);
+#else
+    crc = crc32cSoftware(crc, bytes, size);
+#endif
+    return ~crc;
+}
@@ -0,0 +1,12 @@
+#ifndef CRC32C_HPP
+#define CRC32C_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli) of data, continuing from an earlier result. Uses
+// the CPU's crc32 instruction where it has one (SSE4.2 on x86, the CRC
+// extension on ARM) and a table otherwise.
+uint32_t crc32c(const char* data, size_t size, uint32_t crc = 0);
+
+#endif // CRC32C_HPP
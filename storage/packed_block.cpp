@@ -0,0 +1,301 @@
+#include "./packed_block.hpp"
+#include "./table.hpp"
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+// How a column of a packed block is stored
+enum class ColumnEncoding : uint8_t {
+    NULLS,     // Every value NULL; nothing follows
+    INTEGERS,  // NULL bitmap, then zigzag varint deltas
+    REALS,     // NULL bitmap, then each value XOR the one before
+    TEXTS,     // NULL bitmap, the dictionary, then varint indexes into it
+    MIXED      // A type byte and the payload per value
+};
+
+static void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static uint64_t getVarint(const char*& in) {
+    uint64_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = static_cast<uint8_t>(*in++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+// Small differences of either sign become small numbers
+static uint64_t zigzag(uint64_t value) {
+    return (value << 1) ^ (0 - (value >> 63));
+}
+
+static uint64_t unzigzag(uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+static uint64_t realBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double bitsReal(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// The bits of a real that differ from the one before: a byte counting the
+// zero bytes above and below them, then the bytes in between. A repeated
+// value is one zero byte; slowly changing measurements differ in a few
+// bytes of the mantissa.
+static void putReal(std::string& out, uint64_t bits, uint64_t previous) {
+    uint64_t changed = bits ^ previous;
+    if (changed == 0) {
+        out += '\0';
+        return;
+    }
+    int high = 0;
+    while (((changed >> (56 - 8 * high)) & 0xFF) == 0) {
+        high++;
+    }
+    int low = 0;
+    while (((changed >> (8 * low)) & 0xFF) == 0) {
+        low++;
+    }
+    out += static_cast<char>(0x80 | (high << 3) | low);
+    for (int i = low; i < 8 - high; i++) {
+        out += static_cast<char>((changed >> (8 * i)) & 0xFF);
+    }
+}
+
+static uint64_t getReal(const char*& in, uint64_t previous) {
+    uint8_t header = static_cast<uint8_t>(*in++);
+    if (header == 0) {
+        return previous;
+    }
+    int high = (header >> 3) & 7;
+    int low = header & 7;
+    uint64_t changed = 0;
+    for (int i = low; i < 8 - high; i++) {
+        changed |= static_cast<uint64_t>(static_cast<uint8_t>(*in++)) << (8 * i);
+    }
+    return previous ^ changed;
+}
+
+static void putMixed(std::string& out, const Value& value) {
+    out += static_cast<char>(value.type());
+    switch (value.type()) {
+        case ValueType::INTEGER:
+            putVarint(out, zigzag(static_cast<uint64_t>(value.asInteger())));
+            break;
+        case ValueType::REAL: {
+            uint64_t bits = realBits(value.asReal());
+            out.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+            break;
+        }
+        case ValueType::TEXT:
+            putVarint(out, value.asText().size());
+            out.append(value.asText());
+            break;
+        default:
+            break;
+    }
+}
+
+static Value getMixed(const char*& in) {
+    ValueType type = static_cast<ValueType>(*in++);
+    switch (type) {
+        case ValueType::INTEGER:
+            return Value::integer(static_cast<int64_t>(unzigzag(getVarint(in))));
+        case ValueType::REAL: {
+            uint64_t bits;
+            std::memcpy(&bits, in, sizeof(bits));
+            in += sizeof(bits);
+            return Value::real(bitsReal(bits));
+        }
+        case ValueType::TEXT: {
+            size_t length = static_cast<size_t>(getVarint(in));
+            Value value = Value::text(std::string_view(in, length));
+            in += length;
+            return value;
+        }
+        default:
+            return Value();
+    }
+}
+
+static void packColumn(const std::vector<Row>& rows, size_t column, std::string& out) {
+    // Columns whose values share a type get that type's encoding
+    ValueType shared = ValueType::NULL_VALUE;
+    bool mixed = false;
+    bool hasNulls = false;
+    for (const Row& row : rows) {
+        ValueType type = row.values[column].type();
+        if (type == ValueType::NULL_VALUE) {
+            hasNulls = true;
+        } else if (shared == ValueType::NULL_VALUE) {
+            shared = type;
+        } else if (type != shared) {
+            mixed = true;
+        }
+    }
+    if (mixed) {
+        out += static_cast<char>(ColumnEncoding::MIXED);
+        for (const Row& row : rows) {
+            putMixed(out, row.values[column]);
+        }
+        return;
+    }
+    if (shared == ValueType::NULL_VALUE) {
+        out += static_cast<char>(ColumnEncoding::NULLS);
+        return;
+    }
+
+    ColumnEncoding encoding = shared == ValueType::INTEGER ? ColumnEncoding::INTEGERS :
+                              shared == ValueType::REAL ? ColumnEncoding::REALS : ColumnEncoding::TEXTS;
+    out += static_cast<char>(encoding);
+    out += static_cast<char>(hasNulls ? 1 : 0);
+    if (hasNulls) {
+        std::string bitmap((rows.size() + 7) / 8, '\0');
+        for (size_t r = 0; r < rows.size(); r++) {
+            if (rows[r].values[column].isNull()) {
+                bitmap[r / 8] = static_cast<char>(bitmap[r / 8] | (1 << (r % 8)));
+            }
+        }
+        out += bitmap;
+    }
+
+    if (encoding == ColumnEncoding::INTEGERS) {
+        uint64_t previous = 0;
+        for (const Row& row : rows) {
+            const Value& value = row.values[column];
+            if (!value.isNull()) {
+                uint64_t current = static_cast<uint64_t>(value.asInteger());
+                putVarint(out, zigzag(current - previous));
+                previous = current;
+            }
+        }
+    } else if (encoding == ColumnEncoding::REALS) {
+        uint64_t previous = 0;
+        for (const Row& row : rows) {
+            const Value& value = row.values[column];
+            if (!value.isNull()) {
+                uint64_t current = realBits(value.asReal());
+                putReal(out, current, previous);
+                previous = current;
+            }
+        }
+    } else {
+        // Strings in order of first use, then the index of each value's
+        // string
+        std::unordered_map<std::string_view, uint32_t> dictionary;
+        std::string strings;
+        std::vector<uint32_t> codes;
+        codes.reserve(rows.size());
+        for (const Row& row : rows) {
+            const Value& value = row.values[column];
+            if (value.isNull()) {
+                continue;
+            }
+            auto entry = dictionary.emplace(value.asText(), static_cast<uint32_t>(dictionary.size()));
+            if (entry.second) {
+                putVarint(strings, value.asText().size());
+                strings.append(value.asText());
+            }
+            codes.push_back(entry.first->second);
+        }
+        putVarint(out, dictionary.size());
+        out += strings;
+        for (uint32_t code : codes) {
+            putVarint(out, code);
+        }
+    }
+}
+
+static void unpackColumn(const char*& in, size_t column, std::vector<Row>& rows) {
+    ColumnEncoding encoding = static_cast<ColumnEncoding>(*in++);
+    if (encoding == ColumnEncoding::NULLS || encoding == ColumnEncoding::MIXED) {
+        for (Row& row : rows) {
+            row.values[column] = encoding == ColumnEncoding::NULLS ? Value() : getMixed(in);
+        }
+        return;
+    }
+
+    const uint8_t* nulls = nullptr;
+    if (*in++ != 0) {
+        nulls = reinterpret_cast<const uint8_t*>(in);
+        in += (rows.size() + 7) / 8;
+    }
+    auto isNull = [nulls](size_t r) { return nulls != nullptr && ((nulls[r / 8] >> (r % 8)) & 1) != 0; };
+
+    if (encoding == ColumnEncoding::INTEGERS) {
+        uint64_t previous = 0;
+        for (size_t r = 0; r < rows.size(); r++) {
+            if (isNull(r)) {
+                rows[r].values[column] = Value();
+                continue;
+            }
+            previous += unzigzag(getVarint(in));
+            rows[r].values[column] = Value::integer(static_cast<int64_t>(previous));
+        }
+    } else if (encoding == ColumnEncoding::REALS) {
+        uint64_t previous = 0;
+        for (size_t r = 0; r < rows.size(); r++) {
+            if (isNull(r)) {
+                rows[r].values[column] = Value();
+                continue;
+            }
+            previous = getReal(in, previous);
+            rows[r].values[column] = Value::real(bitsReal(previous));
+        }
+    } else {
+        std::vector<std::string_view> dictionary(static_cast<size_t>(getVarint(in)));
+        for (std::string_view& entry : dictionary) {
+            size_t length = static_cast<size_t>(getVarint(in));
+            entry = std::string_view(in, length);
+            in += length;
+        }
+        for (size_t r = 0; r < rows.size(); r++) {
+            if (isNull(r)) {
+                rows[r].values[column] = Value();
+                continue;
+            }
+            rows[r].values[column] = Value::text(dictionary[static_cast<size_t>(getVarint(in))]);
+        }
+    }
+}
+
+std::unique_ptr<const PackedBlock> PackedBlock::pack(const std::vector<Row>& rows, size_t columnCount) {
+    auto block = std::make_unique<PackedBlock>();
+    block->rowCount = static_cast<uint32_t>(rows.size());
+    block->columnCount = static_cast<uint32_t>(columnCount);
+    for (size_t column = 0; column < columnCount; column++) {
+        packColumn(rows, column, block->data);
+    }
+    block->data.shrink_to_fit();
+    return block;
+}
+
+void PackedBlock::unpack(std::vector<Row>& out) const {
+    out.resize(rowCount);
+    for (Row& row : out) {
+        row.values.resize(columnCount);
+        row.beginTs = 0;
+        row.endTs = INFINITY_TS;
+        row.before.reset();
+    }
+    const char* in = data.data();
+    for (size_t column = 0; column < columnCount; column++) {
+        unpackColumn(in, column, out);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef PACKED_BLOCK_HPP
+#define PACKED_BLOCK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../sql/value.hpp"
+
+struct Row;
+
+/**
+ * The rows of one block compressed column by column: integers as
+ * zigzag varints of the difference to the value before, reals as the
+ * bytes in which they differ from the value before, and text as indexes
+ * into a dictionary of the block's distinct strings. Timestamps of
+ * sequential metrics so take a byte or two each, and repeated tags one.
+ * Only rows every snapshot sees are packed, so no version stamps are
+ * kept. Immutable once built.
+ */
+class PackedBlock {
+public:
+    // Pack rows of columnCount values each
+    static std::unique_ptr<const PackedBlock> pack(const std::vector<Row>& rows, size_t columnCount);
+
+    size_t size() const { return rowCount; }
+
+    // Decode the rows into out, reusing the storage of the rows it holds.
+    // They are versions that every snapshot sees.
+    void unpack(std::vector<Row>& out) const;
+
+    size_t memoryBytes() const { return sizeof(PackedBlock) + data.capacity(); }
+
+private:
+    uint32_t rowCount = 0;
+    uint32_t columnCount = 0;
+    std::string data;  // The columns in order
+};
+
+#endif // PACKED_BLOCK_HPP
@@ -0,0 +1,380 @@
+#include "./partitioning.hpp"
+#include "./bloom_filter.hpp"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+// Whether a range partition can hold a key k with "k op value", comparing
+// as a WHERE clause does
+static bool rangeMayHold(const Partition& partition, ExprOp op, const Value& value) {
+    bool aboveLower = partition.lower.isNull();
+    bool belowUpper = partition.upper.isNull();
+    switch (op) {
+        case ExprOp::EQUAL:
+            return (aboveLower || Value::compare(partition.lower, value) <= 0) &&
+                   (belowUpper || Value::compare(value, partition.upper) < 0);
+        case ExprOp::LESS:
+            return aboveLower || Value::compare(partition.lower, value) < 0;
+        case ExprOp::LESS_EQUAL:
+            return aboveLower || Value::compare(partition.lower, value) <= 0;
+        case ExprOp::GREATER:
+        case ExprOp::GREATER_EQUAL:
+            return belowUpper || Value::compare(value, partition.upper) < 0;
+        default:
+            return true;
+    }
+}
+
+// Where a time-series segment ends; a segment reaching the largest
+// integer has no upper bound
+static int64_t segmentEnd(const Partition& segment) {
+    return segment.upper.isNull() ? std::numeric_limits<int64_t>::max() : segment.upper.asInteger();
+}
+
+// Whether a segment ending at end is older than the retention, counted
+// back from where the newest segment ends
+static bool pastRetention(int64_t end, int64_t newestEnd, int64_t retention) {
+    return retention > 0 && end <= newestEnd &&
+           static_cast<uint64_t>(newestEnd) - static_cast<uint64_t>(end) >= static_cast<uint64_t>(retention);
+}
+
+std::shared_ptr<PartitionScheme> PartitionScheme::create(std::shared_ptr<Table> parent,
+                                                         const PartitionSpec& spec,
+                                                         std::string& errorMessage) {
+    auto scheme = std::make_shared<PartitionScheme>();
+    scheme->tableName = parent->getName();
+    scheme->method = spec.method;
+    scheme->column = spec.column;
+    if (!scheme->bindColumn(*parent, errorMessage)) {
+        return nullptr;
+    }
+
+    // Segments are added by the rows that need them
+    if (spec.method == Method::TIMESERIES) {
+        if (scheme->columnType != TokenType::INTEGER) {
+            errorMessage = "Time column " + spec.column + " must be INTEGER";
+            return nullptr;
+        }
+        scheme->interval = spec.interval;
+        scheme->retention = spec.retention;
+        return scheme;
+    }
+
+    if (spec.method == Method::HASH) {
+        for (size_t i = 0; i < spec.count; i++) {
+            Partition partition;
+            partition.name = "p" + std::to_string(i);
+            partition.table = scheme->makePartition(parent, partition.name, errorMessage);
+            if (partition.table == nullptr) {
+                return nullptr;
+            }
+            scheme->partitions.push_back(std::move(partition));
+        }
+        return scheme;
+    }
+
+    // Each range starts where the one before it ends
+    for (const PartitionBound& bound : spec.partitions) {
+        scheme = scheme->withPartition(parent, bound, errorMessage);
+        if (scheme == nullptr) {
+            return nullptr;
+        }
+    }
+    return scheme;
+}
+
+std::shared_ptr<PartitionScheme> PartitionScheme::withPartition(std::shared_ptr<Table> parent,
+                                                                const PartitionBound& bound,
+                                                                std::string& errorMessage) const {
+    if (method == Method::TIMESERIES) {
+        errorMessage = "Segments of time-series table " + tableName + " are added as rows arrive";
+        return nullptr;
+    }
+    if (method != Method::RANGE) {
+        errorMessage = "Partitions can only be added to a RANGE partitioned table";
+        return nullptr;
+    }
+    for (const Partition& partition : partitions) {
+        if (partition.name == bound.name) {
+            errorMessage = "Partition already exists: " + bound.name;
+            return nullptr;
+        }
+    }
+
+    Partition partition;
+    partition.name = bound.name;
+    if (!bound.upper.isNull() && !bound.upper.castTo(columnType, partition.upper)) {
+        errorMessage = "Partition bound does not fit column " + column + ": " + bound.upper.toLiteral();
+        return nullptr;
+    }
+    if (!partitions.empty()) {
+        const Partition& last = partitions.back();
+        if (last.upper.isNull()) {
+            errorMessage = "Partition " + last.name + " already holds every key up to MAXVALUE";
+            return nullptr;
+        }
+        if (!partition.upper.isNull() && Value::compare(partition.upper, last.upper) <= 0) {
+            errorMessage = "Partition bounds must ascend: " + partition.upper.toLiteral() +
+                           " is not above " + last.upper.toLiteral();
+            return nullptr;
+        }
+        partition.lower = last.upper;
+    }
+    partition.table = makePartition(parent, partition.name, errorMessage);
+    if (partition.table == nullptr) {
+        return nullptr;
+    }
+
+    auto scheme = std::make_shared<PartitionScheme>(*this);
+    scheme->partitions.push_back(std::move(partition));
+    return scheme;
+}
+
+std::shared_ptr<PartitionScheme> PartitionScheme::withoutPartition(const std::string& name,
+                                                                   std::string& errorMessage) const {
+    if (method == Method::HASH) {
+        errorMessage = "Partitions can only be dropped from a RANGE partitioned table";
+        return nullptr;
+    }
+    auto found = std::find_if(partitions.begin(), partitions.end(),
+                              [&name](const Partition& partition) { return partition.name == name; });
+    if (found == partitions.end()) {
+        errorMessage = "Partition not found: " + name;
+        return nullptr;
+    }
+    if (partitions.size() == 1 && method == Method::RANGE) {
+        errorMessage = "Cannot drop the last partition of " + tableName;
+        return nullptr;
+    }
+
+    auto scheme = std::make_shared<PartitionScheme>(*this);
+    scheme->partitions.erase(scheme->partitions.begin() + (found - partitions.begin()));
+    return scheme;
+}
+
+std::shared_ptr<PartitionScheme> PartitionScheme::withSegment(std::shared_ptr<Table> parent,
+                                                              const Value& time,
+                                                              std::string& errorMessage) const {
+    Value key;
+    if (time.isNull() || !time.castTo(TokenType::INTEGER, key)) {
+        errorMessage = "Time-series table " + tableName + " needs an INTEGER time in " + column +
+                       ", not " + time.toLiteral();
+        return nullptr;
+    }
+
+    // The segment starts at the multiple of the interval at or below the
+    // time, for times before zero too
+    int64_t value = key.asInteger();
+    int64_t start = value - value % interval;
+    if (value % interval < 0) {
+        if (start < std::numeric_limits<int64_t>::min() + interval) {
+            errorMessage = "Time " + key.toLiteral() + " of table " + tableName + " is out of range";
+            return nullptr;
+        }
+        start -= interval;
+    }
+    Partition segment;
+    segment.name = "s" + std::to_string(start);
+    std::replace(segment.name.begin(), segment.name.end(), '-', '_');
+    segment.lower = Value::integer(start);
+    if (start <= std::numeric_limits<int64_t>::max() - interval) {
+        segment.upper = Value::integer(start + interval);
+    }
+
+    int64_t newestEnd = segmentEnd(segment);
+    if (!partitions.empty()) {
+        newestEnd = std::max(newestEnd, segmentEnd(partitions.back()));
+    }
+    if (pastRetention(segmentEnd(segment), newestEnd, retention)) {
+        errorMessage = "Time " + key.toLiteral() + " of table " + tableName +
+                       " is older than its retention of " + std::to_string(retention);
+        return nullptr;
+    }
+    segment.table = makePartition(parent, segment.name, errorMessage);
+    if (segment.table == nullptr) {
+        return nullptr;
+    }
+
+    // Keep the segments in order, without those the new one pushes past
+    // the retention
+    auto scheme = std::make_shared<PartitionScheme>(*this);
+    auto& segments = scheme->partitions;
+    auto position = std::partition_point(segments.begin(), segments.end(), [start](const Partition& other) {
+        return other.lower.asInteger() < start;
+    });
+    segments.insert(position, std::move(segment));
+    segments.erase(std::remove_if(segments.begin(), segments.end(),
+                                  [this, newestEnd](const Partition& other) {
+                                      return pastRetention(segmentEnd(other), newestEnd, retention);
+                                  }),
+                   segments.end());
+    return scheme;
+}
+
+std::string PartitionScheme::storageName(const std::string& tableName, const std::string& partition) {
+    return tableName + "#" + partition;
+}
+
+int PartitionScheme::route(const Value& key) const {
+    if (method == Method::HASH) {
+        if (key.isNull()) {
+            return 0;
+        }
+        return static_cast<int>(BloomFilter::hash(key) % partitions.size());
+    }
+    if (key.isNull()) {
+        return -1;
+    }
+
+    // The first range ending above the key holds it, unless the key falls
+    // in the gap a dropped partition left before it
+    auto found = std::partition_point(partitions.begin(), partitions.end(),
+                                      [&key](const Partition& partition) {
+                                          return !partition.upper.isNull() &&
+                                                 Value::compare(partition.upper, key) <= 0;
+                                      });
+    if (found == partitions.end() ||
+        (!found->lower.isNull() && Value::compare(key, found->lower) < 0)) {
+        return -1;
+    }
+    return static_cast<int>(found - partitions.begin());
+}
+
+int PartitionScheme::route(const Value& key, int hint) const {
+    if (method != Method::HASH && !key.isNull() && hint >= 0 &&
+        static_cast<size_t>(hint) < partitions.size()) {
+        const Partition& partition = partitions[hint];
+        if ((partition.lower.isNull() || Value::compare(partition.lower, key) <= 0) &&
+            (partition.upper.isNull() || Value::compare(key, partition.upper) < 0)) {
+            return hint;
+        }
+    }
+    return route(key);
+}
+
+void PartitionScheme::prune(ExprOp op, const Value& value, std::vector<bool>& candidates) const {
+    if (value.isNull()) {
+        return;
+    }
+
+    // The filter compares with the literal converted to the column's
+    // type, where it fits
+    Value key;
+    if (!value.castTo(columnType, key)) {
+        key = value;
+    }
+    if (method == Method::HASH) {
+        if (op != ExprOp::EQUAL) {
+            return;
+        }
+        int bucket = route(key);
+        for (size_t i = 0; i < candidates.size(); i++) {
+            candidates[i] = candidates[i] && static_cast<int>(i) == bucket;
+        }
+        return;
+    }
+    for (size_t i = 0; i < partitions.size(); i++) {
+        candidates[i] = candidates[i] && rangeMayHold(partitions[i], op, key);
+    }
+}
+
+std::string PartitionScheme::encode() const {
+    std::string line = tableName;
+    if (method == Method::TIMESERIES) {
+        line += " timeseries " + column + " " + std::to_string(interval) + " " + std::to_string(retention);
+    } else {
+        line += (method == Method::RANGE ? " range " : " hash ") + column;
+    }
+    line += " " + std::to_string(partitions.size());
+    std::vector<Value> bounds;
+    for (const Partition& partition : partitions) {
+        line += " " + partition.name;
+        bounds.push_back(partition.lower);
+        bounds.push_back(partition.upper);
+    }
+    if (method != Method::HASH && !partitions.empty()) {
+        line += " " + Table::encodeRow(bounds);
+    }
+    return line;
+}
+
+std::shared_ptr<PartitionScheme> PartitionScheme::decode(
+    const std::string& line, std::shared_ptr<Table> parent,
+    const std::function<std::shared_ptr<Table>(const std::string&)>& find) {
+
+    std::istringstream fields(line);
+    auto scheme = std::make_shared<PartitionScheme>();
+    std::string method;
+    size_t count = 0;
+    std::string errorMessage;
+    if (!(fields >> scheme->tableName >> method >> scheme->column)) {
+        return nullptr;
+    }
+    if (method == "timeseries" &&
+        (!(fields >> scheme->interval >> scheme->retention) || scheme->interval < 1)) {
+        return nullptr;
+    }
+    if (!(fields >> count) || scheme->tableName != parent->getName() ||
+        !scheme->bindColumn(*parent, errorMessage)) {
+        return nullptr;
+    }
+    scheme->method = method == "range" ? Method::RANGE :
+                     method == "timeseries" ? Method::TIMESERIES : Method::HASH;
+    for (size_t i = 0; i < count; i++) {
+        Partition partition;
+        if (!(fields >> partition.name)) {
+            return nullptr;
+        }
+        partition.table = find(storageName(scheme->tableName, partition.name));
+        if (partition.table == nullptr) {
+            return nullptr;
+        }
+        partition.table->setPartitionOf(parent);
+        scheme->partitions.push_back(std::move(partition));
+    }
+
+    // RANGE bounds follow as one row: lower and upper of each partition
+    if (scheme->method != Method::HASH && count > 0) {
+        std::string encoded;
+        fields.get();  // Skip the space
+        std::getline(fields, encoded);
+        std::vector<Value> bounds = Table::decodeValues(encoded, scheme->columnType);
+        if (bounds.size() != 2 * count) {
+            return nullptr;
+        }
+        for (size_t i = 0; i < count; i++) {
+            scheme->partitions[i].lower = bounds[2 * i];
+            scheme->partitions[i].upper = bounds[2 * i + 1];
+        }
+    }
+    if (scheme->partitions.empty() && scheme->method != Method::TIMESERIES) {
+        return nullptr;
+    }
+    return scheme;
+}
+
+bool PartitionScheme::bindColumn(const Table& parent, std::string& errorMessage) {
+    const auto& columns = parent.getColumns();
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].name == column) {
+            columnIndex = i;
+            columnType = columns[i].dataType;
+            return true;
+        }
+    }
+    errorMessage = "Partition key column not found: " + column;
+    return false;
+}
+
+std::shared_ptr<Table> PartitionScheme::makePartition(const std::shared_ptr<Table>& parent,
+                                                      const std::string& name,
+                                                      std::string& errorMessage) const {
+    auto table = std::make_shared<Table>(storageName(tableName, name), parent->getColumns());
+    for (const IndexDefinition& index : parent->indexDefinitions()) {
+        if (!table->createIndex(index, errorMessage)) {
+            return nullptr;
+        }
+    }
+    table->setPartitionOf(parent);
+    return table;
+}
@@ -0,0 +1,108 @@
+#ifndef PARTITIONING_HPP
+#define PARTITIONING_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../sql/parser.hpp"
+#include "./table.hpp"
+
+// One partition of a partitioned table: a table of its own, listed in the
+// catalog under a name no query can spell
+struct Partition {
+    std::string name;
+    Value lower;  // RANGE: smallest key it holds; NULL if unbounded
+    Value upper;  // RANGE: smallest key past it; NULL for MAXVALUE
+    std::shared_ptr<Table> table;
+};
+
+/**
+ * How the rows of a partitioned table are spread over its partitions, by
+ * ranges of a key column or by the hash of its value. The partitioned
+ * table holds no rows itself; it keeps the columns and the indexes every
+ * partition gets. A scheme does not change once the catalog publishes it:
+ * adding or dropping a partition publishes a new one, so a statement sees
+ * the partitions that existed when it started.
+ *
+ * A time-series table is range partitioned by an INTEGER time column
+ * into segments of a fixed interval, [k * interval, (k + 1) * interval),
+ * each named "s<start>". Segments are added as rows arrive for them and
+ * dropped once older than the retention.
+ */
+class PartitionScheme {
+public:
+    using Method = PartitionSpec::Method;
+
+    std::string tableName;
+    Method method = Method::RANGE;
+    std::string column;
+    size_t columnIndex = 0;
+    TokenType columnType = TokenType::INTEGER;
+    std::vector<Partition> partitions;  // RANGE by ascending key, HASH by bucket
+    int64_t interval = 0;               // TIMESERIES: time each segment spans
+    int64_t retention = 0;              // TIMESERIES: time segments are kept; 0 for ever
+
+    // The scheme of CREATE TABLE ... PARTITION BY, with an empty table for
+    // each partition, or of a time-series table, with no segments yet.
+    // Fails on an unknown key column, bounds that do not fit it or do not
+    // ascend, a repeated partition name, or a time column that is not
+    // INTEGER.
+    static std::shared_ptr<PartitionScheme> create(std::shared_ptr<Table> parent,
+                                                   const PartitionSpec& spec,
+                                                   std::string& errorMessage);
+
+    // A copy with a RANGE partition added above the others; its table has
+    // the partitioned table's indexes
+    std::shared_ptr<PartitionScheme> withPartition(std::shared_ptr<Table> parent,
+                                                   const PartitionBound& bound,
+                                                   std::string& errorMessage) const;
+
+    // A copy without a RANGE partition. Its keys are then in no partition,
+    // so rows with them cannot be inserted; the last partition stays.
+    // Time-series segments can all be dropped.
+    std::shared_ptr<PartitionScheme> withoutPartition(const std::string& name,
+                                                      std::string& errorMessage) const;
+    
+    // A copy of a time-series scheme with the segment of a time no
+    // segment holds yet, less the segments that are then older than the
+    // retention. Fails for NULL and for a time that is itself too old.
+    std::shared_ptr<PartitionScheme> withSegment(std::shared_ptr<Table> parent, const Value& time,
+                                                 std::string& errorMessage) const;
+
+    // Name of a partition's table in the catalog: "<table>#<partition>"
+    static std::string storageName(const std::string& tableName, const std::string& partition);
+
+    // The partition of a key of the column's type, or -1 if no range
+    // holds it. NULL keys go to the first hash partition and to no range.
+    int route(const Value& key) const;
+    
+    // Same, trying the partition at hint first: rows loaded together,
+    // such as a batch of metrics, mostly go where the row before went
+    int route(const Value& key, int hint) const;
+
+    // Clear the candidates of the partitions that cannot hold a row where
+    // "column op value" holds. Keeps them all for operators and values it
+    // cannot reason about, so the result is always safe to scan.
+    void prune(ExprOp op, const Value& value, std::vector<bool>& candidates) const;
+
+    // One line, as the catalog and the WAL store it
+    std::string encode() const;
+
+    // Read a line of encode(), finding the partitions' tables by name
+    static std::shared_ptr<PartitionScheme> decode(
+        const std::string& line, std::shared_ptr<Table> parent,
+        const std::function<std::shared_ptr<Table>(const std::string&)>& find);
+
+private:
+    // The key column of a table, or false if it has none by that name
+    bool bindColumn(const Table& parent, std::string& errorMessage);
+
+    // An empty table for a new partition, with the partitioned table's
+    // columns and indexes
+    std::shared_ptr<Table> makePartition(const std::shared_ptr<Table>& parent,
+                                         const std::string& name,
+                                         std::string& errorMessage) const;
+};
+
+#endif // PARTITIONING_HPP
@@ -0,0 +1,152 @@
+#include "./snapshot_writer.hpp"
+#include <algorithm>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+SnapshotWriter::SnapshotWriter(const std::string& path) {
+#ifdef _WIN32
+    file = std::fopen(path.c_str(), "wb");
+    open = file != nullptr;
+#else
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    open = fd >= 0;
+#endif
+    if (!open) {
+        return;
+    }
+
+    current.reserve(BUFFER_BYTES);
+    pending.reserve(BUFFER_BYTES);
+    ioThread = std::thread([this]() { ioLoop(); });
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (ioThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        ioThread.join();
+    }
+    closeFile();
+}
+
+void SnapshotWriter::write(const char* data, size_t size) {
+    if (!open) {
+        return;
+    }
+    while (size > 0) {
+        size_t count = std::min(size, BUFFER_BYTES - current.size());
+        current.append(data, count);
+        data += count;
+        size -= count;
+        if (current.size() == BUFFER_BYTES) {
+            submit();
+        }
+    }
+}
+
+bool SnapshotWriter::finish() {
+    if (!open) {
+        return false;
+    }
+    if (!current.empty()) {
+        submit();
+    }
+
+    // The I/O thread exits once the last buffer is written
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this]() { return !hasPending; });
+        stopping = true;
+    }
+    wakeup.notify_all();
+    ioThread.join();
+
+#ifdef _WIN32
+    bool synced = std::fflush(file) == 0 && _commit(_fileno(file)) == 0;
+#else
+    bool synced = fsync(fd) == 0;
+#endif
+    closeFile();
+    return synced && !failed;
+}
+
+void SnapshotWriter::submit() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this]() { return !hasPending; });
+        std::swap(current, pending);
+        pendingOffset = offset;
+        offset += pending.size();
+        hasPending = true;
+    }
+    wakeup.notify_all();
+
+    // Now the buffer the I/O thread finished with; keeps its capacity
+    current.clear();
+}
+
+void SnapshotWriter::ioLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeup.wait(lock, [this]() { return hasPending || stopping; });
+        if (!hasPending) {
+            return;
+        }
+
+        uint64_t position = pendingOffset;
+        lock.unlock();
+        bool ok = writeAt(pending, position);
+        lock.lock();
+
+        if (!ok) {
+            failed = true;
+        }
+        hasPending = false;
+        wakeup.notify_all();
+    }
+}
+
+bool SnapshotWriter::writeAt(const std::string& data, uint64_t position) {
+#ifdef _WIN32
+    // Buffers are written in order, so the file position is already right
+    (void)position;
+    return std::fwrite(data.data(), 1, data.size(), file) == data.size();
+#else
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t count = pwrite(fd, data.data() + written, data.size() - written,
+                               static_cast<off_t>(position + written));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(count);
+    }
+    return true;
+#endif
+}
+
+void SnapshotWriter::closeFile() {
+#ifdef _WIN32
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+#else
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+#endif
+}
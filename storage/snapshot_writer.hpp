@@ -0,0 +1,70 @@
+#ifndef SNAPSHOT_WRITER_HPP
+#define SNAPSHOT_WRITER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Sequential file writer for checkpoints. Data is collected in one of two
+ * buffers while an I/O thread writes the other, so formatting rows and
+ * writing them overlap. Every write but the last is a full buffer at an
+ * offset that is a multiple of the buffer size. Uses pwrite where
+ * available and stdio elsewhere. Not thread-safe: one producer only.
+ */
+class SnapshotWriter {
+public:
+    // Size of each buffer and of every write but the last; a multiple of
+    // common page and sector sizes
+    static const size_t BUFFER_BYTES = 1 << 20;
+
+    // Create or truncate the file
+    explicit SnapshotWriter(const std::string& path);
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    bool isOpen() const { return open; }
+
+    void write(const char* data, size_t size);
+    void write(const std::string& data) { write(data.data(), data.size()); }
+
+    // Write what is left, wait for the I/O thread and sync the file to
+    // disk. False if any write failed.
+    bool finish();
+
+    // Bytes handed to write so far
+    uint64_t size() const { return offset + current.size(); }
+
+private:
+    bool open = false;
+#ifdef _WIN32
+    FILE* file = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    std::string current;    // Being filled by write
+    std::string pending;    // Being written by the I/O thread
+    uint64_t offset = 0;    // File offset of current
+
+    std::thread ioThread;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool hasPending = false;
+    uint64_t pendingOffset = 0;
+    bool stopping = false;
+    bool failed = false;
+
+    // Hand current to the I/O thread once the previous buffer is written
+    void submit();
+    void ioLoop();
+    bool writeAt(const std::string& data, uint64_t position);
+    void closeFile();
+};
+
+#endif // SNAPSHOT_WRITER_HPP
@@ -1,156 +1,1157 @@
 #include "./table.hpp"
 #include "../include/string_utils.hpp"
+#include "../include/arena.hpp"
+#include "../include/thread_pool.hpp"
+#include "./crc32c.hpp"
 #include <iostream>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
 #include <sstream>
 
+// Column type names used in the database file and the WAL
+static std::string typeName(TokenType type) {
+    switch (type) {
+        case TokenType::INTEGER: return "INTEGER";
+        case TokenType::TEXT: return "TEXT";
+        case TokenType::REAL: return "REAL";
+        default: return "UNKNOWN";
+    }
+}
+
+static TokenType parseTypeName(const std::string& name) {
+    if (name == "INTEGER") {
+        return TokenType::INTEGER;
+    } else if (name == "TEXT") {
+        return TokenType::TEXT;
+    } else if (name == "REAL") {
+        return TokenType::REAL;
+    }
+    return TokenType::INVALID;
+}
+
+// Whether a value is stored as it is in a column of the type
+static bool hasColumnType(const Value& value, TokenType columnType) {
+    switch (value.type()) {
+        case ValueType::INTEGER: return columnType == TokenType::INTEGER;
+        case ValueType::REAL: return columnType == TokenType::REAL;
+        case ValueType::TEXT: return columnType == TokenType::TEXT;
+        default: return false;
+    }
+}
+
+// NULL equals nothing, so filters leave it out
+static void addToFilter(BloomFilter& filter, const Value& value) {
+    if (!value.isNull()) {
+        filter.add(BloomFilter::hash(value));
+    }
+}
+
+std::string IndexDefinition::encode() const {
+    return name + " " + column + " " + method + " " + Value::real(falsePositiveRate).toString();
+}
+
 Table::Table(const std::string& name, const std::vector<ColumnDefinition>& columns)
     : name(name), columns(columns) {}
 
-bool Table::insertRow(const std::vector<std::string>& values) {
+bool Table::insertRow(Transaction& txn, const std::vector<Value>& values,
+                      std::string& errorMessage) {
     // Check if the number of values matches the number of columns
     if (values.size() != columns.size()) {
+        errorMessage = "Table " + name + " has " + std::to_string(columns.size()) +
+                       " columns but " + std::to_string(values.size()) + " values were supplied";
         return false;
     }
     
-    // Create a new row
+    // Create a new row version owned by the transaction
     Row row;
-    row.values = values;
+    row.values.resize(columns.size());
+    row.beginTs = txn.id;
+    for (size_t i = 0; i < values.size(); i++) {
+        if (!bindValue(i, values[i], row.values[i], errorMessage)) {
+            return false;
+        }
+    }
     
-    // Add the row to the table
-    rows.push_back(row);
+    // Add the row to the table and remember it for commit/rollback
+    size_t rowIndex = appendVersion(std::move(row));
+    txn.undoLog.push_back({UndoEntry::Kind::INSERT, this, rowIndex});
     
     return true;
 }
 
-bool Table::insertRow(const std::vector<std::string>& columnNames, const std::vector<std::string>& values) {
+bool Table::insertRow(Transaction& txn, const std::vector<std::string>& columnNames, 
+                      const std::vector<Value>& values, std::string& errorMessage) {
     // Check if the number of column names matches the number of values
     if (columnNames.size() != values.size()) {
+        errorMessage = std::to_string(columnNames.size()) + " columns but " +
+                       std::to_string(values.size()) + " values were supplied";
         return false;
     }
     
-    // Create a new row with default values
+    // Create a new row; columns that are not given are NULL
     Row row;
     row.values.resize(columns.size());
+    row.beginTs = txn.id;
+    std::vector<bool> given(columns.size(), false);
     
     // Fill in the values for the specified columns
     for (size_t i = 0; i < columnNames.size(); i++) {
         int columnIndex = findColumnIndex(columnNames[i]);
         if (columnIndex == -1) {
-            return false;  // Column not found
+            errorMessage = "Column not found: " + columnNames[i];
+            return false;
         }
         
-        row.values[columnIndex] = values[i];
+        if (!bindValue(columnIndex, values[i], row.values[columnIndex], errorMessage)) {
+            return false;
+        }
+        given[columnIndex] = true;
+    }
+    
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (!given[i] && !bindValue(i, Value(), row.values[i], errorMessage)) {
+            return false;
+        }
     }
     
-    // Add the row to the table
-    rows.push_back(row);
+    // Add the row to the table and remember it for commit/rollback
+    size_t rowIndex = appendVersion(std::move(row));
+    txn.undoLog.push_back({UndoEntry::Kind::INSERT, this, rowIndex});
     
     return true;
 }
 
-std::vector<Row> Table::selectAll() const {
-    return rows;
+bool Table::insertRows(Transaction& txn, std::vector<std::vector<Value>>& rows,
+                       size_t& firstIndex, std::string& errorMessage) {
+    // Convert every row first, so a bad one leaves no rows behind
+    std::vector<Row> versions(rows.size());
+    for (size_t r = 0; r < rows.size(); r++) {
+        std::vector<Value>& values = rows[r];
+        if (values.size() != columns.size()) {
+            errorMessage = "Table " + name + " has " + std::to_string(columns.size()) +
+                           " columns but " + std::to_string(values.size()) + " values were supplied";
+            return false;
+        }
+        
+        // Values of the column's type are kept as they are, so a row of
+        // them becomes a version without converting
+        for (size_t i = 0; i < values.size(); i++) {
+            if (!hasColumnType(values[i], columns[i].dataType)) {
+                Value converted;
+                if (!bindValue(i, values[i], converted, errorMessage)) {
+                    return false;
+                }
+                values[i] = std::move(converted);
+            }
+        }
+        if (values.capacity() == values.size()) {
+            versions[r].values = std::move(values);
+        } else {
+            // Spare capacity would stay with the row for good
+            versions[r].values.assign(std::make_move_iterator(values.begin()),
+                                      std::make_move_iterator(values.end()));
+        }
+        versions[r].beginTs = txn.id;
+    }
+    
+    firstIndex = appendVersions(versions.data(), versions.size());
+    txn.undoLog.reserve(txn.undoLog.size() + versions.size());
+    for (size_t r = 0; r < versions.size(); r++) {
+        txn.undoLog.push_back({UndoEntry::Kind::INSERT, this, firstIndex + r});
+    }
+    
+    return true;
 }
 
-std::vector<Row> Table::selectWhere(const std::string& column, 
-                                const std::string& op, 
-                                const std::string& value) const {
-    std::vector<Row> result;
+bool Table::bindValue(size_t columnIndex, const Value& value, Value& out,
+                      std::string& errorMessage) const {
+    const ColumnDefinition& column = columns[columnIndex];
     
-    int columnIndex = findColumnIndex(column);
-    if (columnIndex == -1) {
-        return result;  // Column not found
+    if (value.isNull() && (column.notNull || column.primaryKey)) {
+        errorMessage = "NOT NULL constraint failed: " + name + "." + column.name;
+        return false;
     }
-    
-    for (const Row& row : rows) {
-        if (compareValues(row.values[columnIndex], op, value)) {
-            result.push_back(row);
-        }
+    if (!value.castTo(column.dataType, out)) {
+        errorMessage = "Type mismatch for column " + name + "." + column.name +
+                       ": " + value.toLiteral();
+        return false;
     }
-    
+    return true;
+}
+
+Value Table::bindOperand(int columnIndex, const Value& value) const {
+    // A literal that does not fit the column (age > 'abc') is compared
+    // as it is
+    Value operand;
+    if (!value.castTo(columns[columnIndex].dataType, operand)) {
+        operand = value;
+    }
+    return operand;
+}
+
+std::vector<Row> Table::selectAll(const Transaction& txn) const {
+    std::vector<Row> result;
+    scan(txn, [&result](const Row& row) { result.push_back(row); });
     return result;
 }
 
-int Table::deleteWhere(const std::string& column, 
+std::vector<Row> Table::selectWhere(const Transaction& txn,
+                                const std::string& column, 
+                                const std::string& op, 
+                                const Value& value) const {
+    std::vector<Row> result;
+    scanWhere(txn, column, op, value, [&result](const Row& row) { result.push_back(row); });
+    return result;
+}
+
+int Table::deleteWhere(Transaction& txn,
+                    const std::string& column, 
                     const std::string& op, 
-                    const std::string& value) {
+                    const Value& value) {
     int columnIndex = findColumnIndex(column);
     if (columnIndex == -1) {
         return 0;  // Column not found
     }
     
-    size_t originalSize = rows.size();
+    Value operand = bindOperand(columnIndex, value);
+    return deleteMatching(txn, [columnIndex, &op, &operand](const Row& row) {
+        return compareValues(row.values[columnIndex], op, operand);
+    });
+}
+
+int Table::deleteWhere(Transaction& txn, const RowFilter& filter) {
+    return deleteMatching(txn, filter);
+}
+
+int Table::deleteAll(Transaction& txn) {
+    return deleteMatching(txn, [](const Row&) { return true; });
+}
+
+template <typename Predicate, typename Writer>
+int Table::writeMatching(Transaction& txn, Predicate matches, Writer write) {
+    if (!ensureLoaded()) {
+        return -1;
+    }
+    
+    // Hold the rows unpacked, and the block list so garbage collection
+    // cannot move them
+    std::shared_lock<std::shared_mutex> packLock = unpacked();
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
     
-    // Remove rows that match the condition
-    rows.erase(
-        std::remove_if(rows.begin(), rows.end(),
-                    [this, columnIndex, op, value](const Row& row) {
-                        return compareValues(row.values[columnIndex], op, value);
-                    }),
-        rows.end()
-    );
+    auto canSee = [&txn](uint64_t beginTs, uint64_t endTs) { return txn.canSee(beginTs, endTs); };
+    Row older;
+    int written = 0;
     
-    return originalSize - rows.size();
+    for (size_t b = 0; b < blocks.size(); b++) {
+        // The rows written so far are rolled back with the statement
+        if (txn.interrupted()) {
+            return -1;
+        }
+        RowBlock& block = *blocks[b];
+        std::unique_lock<std::shared_mutex> lock(block.latch);
+        
+        for (size_t i = 0; i < block.rows.size(); i++) {
+            Row& row = block.rows[i];
+            if (!txn.canSee(row.beginTs, row.endTs)) {
+                // Another transaction updated the version we see after
+                // our snapshot
+                if (row.before && row.olderVersion(canSee, older) && matches(older)) {
+                    return -1;
+                }
+                continue;
+            }
+            if (!matches(row)) {
+                continue;
+            }
+            
+            // Another transaction deleted this version after our snapshot
+            if (row.endTs != INFINITY_TS) {
+                return -1;
+            }
+            
+            if (!write(row, b * BLOCK_SIZE + i)) {
+                return -1;
+            }
+            written++;
+        }
+    }
+    
+    return written;
 }
 
-bool Table::saveToFile(std::ofstream& file) const {
-    if (!file.is_open()) {
+template <typename Predicate>
+int Table::deleteMatching(Transaction& txn, Predicate matches) {
+    // Mark matching versions as deleted by this transaction; they stay in
+    // place until no snapshot can see them anymore
+    return writeMatching(txn, matches, [this, &txn](Row& row, size_t rowIndex) {
+        row.endTs = txn.id;
+        txn.undoLog.push_back({UndoEntry::Kind::DELETE, this, rowIndex});
+        pendingVersions++;
+        return true;
+    });
+}
+
+int Table::updateWhere(Transaction& txn,
+                       const std::vector<std::string>& columnNames,
+                       const RowUpdate& compute,
+                       const RowFilter& filter,
+                       std::string& errorMessage) {
+    // Resolve the assigned columns once
+    std::vector<size_t> targets;
+    std::vector<bool> assigned(columns.size(), false);
+    for (const auto& columnName : columnNames) {
+        int column = findColumnIndex(columnName);
+        if (column == -1) {
+            errorMessage = "Column not found: " + columnName;
+            return -1;
+        }
+        
+        // The old value of each column is saved once per update
+        if (assigned[column]) {
+            errorMessage = "Column assigned more than once: " + columnName;
+            return -1;
+        }
+        assigned[column] = true;
+        targets.push_back(static_cast<size_t>(column));
+    }
+    
+    std::vector<Value> computed(targets.size());
+    std::vector<Value> newValues(targets.size());
+    return writeMatching(txn, filter, [&](Row& row, size_t rowIndex) {
+        // Every value is computed from the old row, so SET a = b, b = a swaps
+        compute(row, computed);
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (!bindValue(targets[i], computed[i], newValues[i], errorMessage)) {
+                return false;
+            }
+        }
+        
+        // Rewrite only the assigned columns, keeping their old values
+        auto image = makePooled<RowImage>();
+        image->columns.reserve(targets.size());
+        for (size_t i = 0; i < targets.size(); i++) {
+            Value& slot = row.values[targets[i]];
+            image->columns.emplace_back(targets[i], std::move(slot));
+            slot = std::move(newValues[i]);
+        }
+        image->beginTs = row.beginTs;
+        image->endTs = txn.id;
+        image->older = std::move(row.before);
+        
+        row.before = std::move(image);
+        row.beginTs = txn.id;
+        for (const auto& index : indexes) {
+            if (assigned[index->getColumn()]) {
+                index->add(row.values[index->getColumn()], rowIndex);
+            }
+        }
+        addToFilters(*blocks[rowIndex / BLOCK_SIZE], row);
+        txn.undoLog.push_back({UndoEntry::Kind::UPDATE, this, rowIndex});
+        pendingVersions++;
+        return true;
+    });
+}
+
+bool Table::hasConcurrentMatch(const Transaction& txn, const RowFilter& filter) const {
+    if (!ensureLoaded()) {
         return false;
     }
     
-    // Write table name
-    file << name << std::endl;
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    for (const auto& block : blocks) {
+        // Packed blocks list no rows; every snapshot sees theirs
+        std::shared_lock<std::shared_mutex> lock(block->latch);
+        for (const Row& row : block->rows) {
+            // Rolled back inserts and versions deleted before the snapshot
+            // are no one's
+            bool goneBefore = row.endTs < TXN_ID_BASE && row.endTs <= txn.startTs;
+            if (txn.canSee(row.beginTs, row.endTs) || row.beginTs == INFINITY_TS || goneBefore) {
+                continue;
+            }
+            if (filter(row)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void Table::commitVersion(const UndoEntry& entry, uint64_t txnId, uint64_t commitTs) {
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    RowBlock& block = *blocks[entry.rowIndex / BLOCK_SIZE];
+    std::unique_lock<std::shared_mutex> lock(block.latch);
+    Row& row = block.rows[entry.rowIndex % BLOCK_SIZE];
+    
+    if (entry.kind == UndoEntry::Kind::INSERT) {
+        // A row inserted and deleted by the same transaction is dead at once
+        if (row.endTs == txnId) {
+            row.endTs = commitTs;
+            deadVersions++;
+        }
+        row.beginTs = commitTs;
+    } else if (entry.kind == UndoEntry::Kind::UPDATE) {
+        // The first entry of a row stamps every version the transaction
+        // replaced; they stay visible to older snapshots until collected
+        if (row.beginTs == txnId) {
+            row.beginTs = commitTs;
+        }
+        for (RowImage* image = row.before.get(); image != nullptr && image->endTs == txnId;
+             image = image->older.get()) {
+            image->endTs = commitTs;
+            if (image->beginTs == txnId) {
+                image->beginTs = commitTs;
+            }
+            deadVersions++;
+        }
+    } else if (row.endTs == txnId) {
+        row.endTs = commitTs;
+        deadVersions++;
+    }
+    
+    // Commits are serialized, so timestamps arrive in order
+    newestCommit.store(commitTs);
+    pendingVersions--;
+}
+
+void Table::revertVersion(const UndoEntry& entry) {
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    RowBlock& block = *blocks[entry.rowIndex / BLOCK_SIZE];
+    std::unique_lock<std::shared_mutex> lock(block.latch);
+    Row& row = block.rows[entry.rowIndex % BLOCK_SIZE];
     
-    // Write number of columns
-    file << columns.size() << std::endl;
+    if (entry.kind == UndoEntry::Kind::INSERT) {
+        // Never visible to anyone; garbage collection removes it
+        row.beginTs = INFINITY_TS;
+        deadVersions++;
+    } else if (entry.kind == UndoEntry::Kind::UPDATE) {
+        // Entries are reverted newest first, so the newest image is ours
+        std::shared_ptr<RowImage> image = std::move(row.before);
+        for (auto& column : image->columns) {
+            row.values[column.first] = std::move(column.second);
+        }
+        row.beginTs = image->beginTs;
+        row.before = std::move(image->older);
+    } else {
+        row.endTs = INFINITY_TS;
+    }
     
-    // Write column definitions
-    for (const auto& column : columns) {
-        file << column.name << " ";
+    pendingVersions--;
+}
+
+size_t Table::collectGarbage(uint64_t oldestSnapshot) {
+    std::lock_guard<std::mutex> appendLock(appendMutex);
+    std::unique_lock<std::shared_mutex> listLock(blocksLatch);
+    
+    // Re-check now that no writer can touch the table
+    if (!hasGarbage()) {
+        return 0;
+    }
+    
+    // Rolled back versions and versions deleted or replaced before every
+    // running snapshot started can be dropped
+    auto isDead = [oldestSnapshot](const Row& row) {
+        return row.beginTs == INFINITY_TS ||
+               (row.endTs < TXN_ID_BASE && row.endTs <= oldestSnapshot);
+    };
+    auto isDeadImage = [oldestSnapshot](const RowImage& image) {
+        return image.endTs < TXN_ID_BASE && image.endTs <= oldestSnapshot;
+    };
+    
+    // Images are ordered newest first, so the dead ones form the tail
+    auto deadImages = [&isDeadImage](const Row& row) {
+        const RowImage* image = row.before.get();
+        while (image != nullptr && !isDeadImage(*image)) {
+            image = image->older.get();
+        }
+        size_t count = 0;
+        for (; image != nullptr; image = image->older.get()) {
+            count++;
+        }
+        return count;
+    };
+    
+    // Drop the dead tail of a row's images. Images may be shared with
+    // copies of the row in blocks readers still scan, so the kept part of
+    // the chain is copied rather than cut.
+    auto pruneImages = [&isDeadImage](Row& row) {
+        std::shared_ptr<RowImage>* link = &row.before;
+        while (!isDeadImage(**link)) {
+            *link = makePooled<RowImage>(**link);
+            link = &(*link)->older;
+        }
+        link->reset();
+    };
+    
+    // Copy surviving versions into fresh blocks instead of compacting in
+    // place, so readers still scanning the old blocks are not disturbed
+    std::vector<std::shared_ptr<RowBlock>> compacted;
+    size_t sharedBlocks = 0;
+    size_t removedRows = 0;
+    size_t removed = 0;
+    
+    for (const auto& block : blocks) {
+        std::shared_lock<std::shared_mutex> lock(block->latch);
         
-        switch (column.dataType) {
-            case TokenType::INTEGER:
-                file << "INTEGER";
-                break;
-            case TokenType::TEXT:
-                file << "TEXT";
-                break;
-            case TokenType::REAL:
-                file << "REAL";
-                break;
-            default:
-                file << "UNKNOWN";
+        // Leading blocks without dead rows keep their place and are shared
+        // as they are; row positions do not change, so dead images are
+        // dropped in place. Only readers can hold the latch meanwhile.
+        if (removedRows == 0 && std::none_of(block->rows.begin(), block->rows.end(), isDead)) {
+            bool prune = std::any_of(block->rows.begin(), block->rows.end(),
+                                     [&deadImages](const Row& row) { return deadImages(row) > 0; });
+            lock.unlock();
+            if (prune) {
+                std::unique_lock<std::shared_mutex> writeLock(block->latch);
+                for (Row& row : block->rows) {
+                    size_t dead = deadImages(row);
+                    if (dead > 0) {
+                        pruneImages(row);
+                        removed += dead;
+                    }
+                }
+            }
+            compacted.push_back(block);
+            sharedBlocks++;
+            continue;
         }
         
-        file << " " << (column.primaryKey ? "1" : "0")
-             << " " << (column.notNull ? "1" : "0")
-             << std::endl;
+        for (const Row& row : block->rows) {
+            size_t dead = deadImages(row);
+            if (isDead(row)) {
+                removedRows++;
+                removed += 1 + dead;
+                continue;
+            }
+            if (compacted.empty() || compacted.back()->rows.size() >= BLOCK_SIZE) {
+                compacted.push_back(std::make_shared<RowBlock>());
+                compacted.back()->rows.reserve(BLOCK_SIZE);
+            }
+            compacted.back()->rows.push_back(row);
+            if (dead > 0) {
+                pruneImages(compacted.back()->rows.back());
+                removed += dead;
+            }
+        }
+    }
+    
+    // The copied blocks get filters of only the versions they kept
+    for (size_t b = sharedBlocks; b < compacted.size(); b++) {
+        buildFilters(*compacted[b]);
+    }
+    
+    blocks.swap(compacted);
+    deadVersions -= removed;
+    
+    // Rows after the shared blocks moved; list them again where they are
+    if (removedRows > 0) {
+        for (const auto& index : indexes) {
+            index->truncate(sharedBlocks * BLOCK_SIZE);
+            indexBlocks(*index, sharedBlocks);
+        }
+    }
+    return removed;
+}
+
+bool Table::canPack(uint64_t oldestSnapshot) const {
+    return sealed && !packed && loaded && pendingVersions == 0 && deadVersions == 0 &&
+           newestCommit <= oldestSnapshot;
+}
+
+bool Table::pack(uint64_t oldestSnapshot) {
+    // Writers are rare on a sealed table; rather than wait for one, the
+    // next collection tries again
+    std::unique_lock<std::shared_mutex> packLock(packLatch, std::try_to_lock);
+    if (!packLock.owns_lock() || !canPack(oldestSnapshot)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> appendLock(appendMutex);
+    
+    // Blocks keep their rows' positions and filters, so indexes stay
+    // valid. The old blocks stay intact for readers still scanning them.
+    std::vector<std::shared_ptr<RowBlock>> packedBlocks;
+    {
+        std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+        packedBlocks.reserve(blocks.size());
+        for (const auto& block : blocks) {
+            std::shared_lock<std::shared_mutex> lock(block->latch);
+            for (const Row& row : block->rows) {
+                if (row.beginTs > oldestSnapshot || row.endTs != INFINITY_TS || row.before) {
+                    return false;
+                }
+            }
+            packedBlocks.push_back(std::make_shared<RowBlock>());
+            packedBlocks.back()->packed = PackedBlock::pack(block->rows, columns.size());
+            packedBlocks.back()->filters = block->filters;
+        }
     }
     
-    // Write number of rows
-    file << rows.size() << std::endl;
+    std::unique_lock<std::shared_mutex> listLock(blocksLatch);
+    blocks.swap(packedBlocks);
+    packed = true;
+    return true;
+}
+
+std::shared_lock<std::shared_mutex> Table::unpacked() {
+    while (true) {
+        std::shared_lock<std::shared_mutex> packLock(packLatch);
+        if (!packed) {
+            return packLock;
+        }
+        packLock.unlock();
+        
+        // Decoded rows are versions every snapshot sees, in the positions
+        // they had
+        std::unique_lock<std::shared_mutex> unpackLock(packLatch);
+        if (!packed) {
+            continue;
+        }
+        std::lock_guard<std::mutex> appendLock(appendMutex);
+        std::vector<std::shared_ptr<RowBlock>> unpackedBlocks;
+        {
+            std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+            unpackedBlocks.reserve(blocks.size());
+            for (const auto& block : blocks) {
+                std::shared_lock<std::shared_mutex> lock(block->latch);
+                unpackedBlocks.push_back(std::make_shared<RowBlock>());
+                unpackedBlocks.back()->rows.reserve(BLOCK_SIZE);
+                block->packed->unpack(unpackedBlocks.back()->rows);
+                unpackedBlocks.back()->filters = block->filters;
+            }
+        }
+        std::unique_lock<std::shared_mutex> listLock(blocksLatch);
+        blocks.swap(unpackedBlocks);
+        packed = false;
+    }
+}
+
+size_t Table::appendVersion(Row row) {
+    return appendVersions(&row, 1);
+}
+
+size_t Table::appendVersions(Row* rows, size_t count) {
+    ensureLoaded();
+    std::shared_lock<std::shared_mutex> packLock = unpacked();
+    std::lock_guard<std::mutex> appendLock(appendMutex);
     
-    // Write row data
-    for (const auto& row : rows) {
-        for (size_t i = 0; i < row.values.size(); i++) {
-            if (i > 0) {
-                file << ",";
+    // Only the last block is partial, so the rows land at consecutive
+    // positions while appends are serialized
+    size_t firstIndex = 0;
+    size_t next = 0;
+    do {
+        // Start a new block when the last one is full
+        if (blocks.empty() || blocks.back()->rows.size() >= BLOCK_SIZE) {
+            std::unique_lock<std::shared_mutex> listLock(blocksLatch);
+            blocks.push_back(std::make_shared<RowBlock>());
+            blocks.back()->rows.reserve(BLOCK_SIZE);
+            buildFilters(*blocks.back());
+        }
+        
+        std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+        size_t blockIndex = blocks.size() - 1;
+        RowBlock& block = *blocks[blockIndex];
+        
+        std::unique_lock<std::shared_mutex> lock(block.latch);
+        if (next == 0) {
+            firstIndex = blockIndex * BLOCK_SIZE + block.rows.size();
+        }
+        size_t end = std::min(count, next + (BLOCK_SIZE - block.rows.size()));
+        for (; next < end; next++) {
+            Row& row = rows[next];
+            if (row.beginTs >= TXN_ID_BASE) {
+                pendingVersions++;
             }
+            block.rows.push_back(std::move(row));
             
-            // Escape commas in the data
-            std::string escapedValue = row.values[i];
-            std::replace(escapedValue.begin(), escapedValue.end(), ',', '\\');
+            size_t rowIndex = blockIndex * BLOCK_SIZE + block.rows.size() - 1;
+            for (const auto& index : indexes) {
+                indexRow(*index, block.rows.back(), rowIndex);
+            }
+            addToFilters(block, block.rows.back());
+        }
+    } while (next < count);
+    return firstIndex;
+}
+
+bool Table::checkIndex(const IndexDefinition& index, std::string& errorMessage) const {
+    int column = findColumnIndex(index.column);
+    if (column == -1) {
+        errorMessage = "Column not found: " + index.column;
+        return false;
+    }
+    if (index.method == "trigram") {
+        if (columns[column].dataType != TokenType::TEXT) {
+            errorMessage = "Trigram indexes need a TEXT column: " + name + "." + index.column;
+            return false;
+        }
+    } else if (index.method == "bloom") {
+        if (!(index.falsePositiveRate > 0 && index.falsePositiveRate < 1)) {
+            errorMessage = "False positive rate must be between 0 and 1: " +
+                           Value::real(index.falsePositiveRate).toString();
+            return false;
+        }
+    } else {
+        errorMessage = "Unsupported index method: " + index.method;
+        return false;
+    }
+    
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    bool taken = std::any_of(indexes.begin(), indexes.end(), [&index](const auto& existing) {
+        return existing->getName() == index.name;
+    }) || std::any_of(blooms.begin(), blooms.end(), [&index](const BloomIndex& existing) {
+        return existing.name == index.name;
+    });
+    if (taken) {
+        errorMessage = "Index already exists: " + index.name;
+        return false;
+    }
+    return true;
+}
+
+bool Table::createIndex(const IndexDefinition& definition, std::string& errorMessage) {
+    if (!checkIndex(definition, errorMessage)) {
+        return false;
+    }
+    size_t column = static_cast<size_t>(findColumnIndex(definition.column));
+    
+    // A table still in the file indexes its rows as they load; packed
+    // rows are indexed unpacked, in the positions they keep when packed
+    // again
+    std::shared_lock<std::shared_mutex> packLock = unpacked();
+    std::lock_guard<std::mutex> loadLock(loadMutex);
+    if (definition.method == "bloom") {
+        // Blocks created from now on start with the filter; updates in
+        // place add to a block's filter once it has one
+        std::lock_guard<std::mutex> appendLock(appendMutex);
+        {
+            std::unique_lock<std::shared_mutex> listLock(blocksLatch);
+            blooms.push_back({definition.name, column, definition.falsePositiveRate});
+        }
+        std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+        for (const auto& block : blocks) {
+            std::unique_lock<std::shared_mutex> lock(block->latch);
+            buildFilters(*block);
+        }
+        return true;
+    }
+    
+    auto index = std::make_shared<TrigramIndex>(definition.name, column);
+    if (!loaded) {
+        std::unique_lock<std::shared_mutex> listLock(blocksLatch);
+        indexes.push_back(index);
+        index->setReady();
+        return true;
+    }
+    
+    // Updates in place index their new values from now on; appends and
+    // garbage collection wait until the rows there are have been listed
+    std::lock_guard<std::mutex> appendLock(appendMutex);
+    {
+        std::unique_lock<std::shared_mutex> listLock(blocksLatch);
+        indexes.push_back(index);
+    }
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    indexBlocks(*index, 0);
+    index->setReady();
+    return true;
+}
+
+std::string Table::indexOn(size_t column) const {
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    for (const auto& index : indexes) {
+        if (index->getColumn() == column && index->isReady()) {
+            return index->getName();
+        }
+    }
+    return "";
+}
+
+std::string Table::bloomFilterOn(size_t column) const {
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    int slot = bloomSlot(column);
+    return slot == -1 ? "" : blooms[slot].name;
+}
+
+std::vector<IndexDefinition> Table::indexDefinitions() const {
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    std::vector<IndexDefinition> definitions;
+    for (const auto& index : indexes) {
+        definitions.push_back({index->getName(), columns[index->getColumn()].name});
+    }
+    for (const BloomIndex& bloom : blooms) {
+        definitions.push_back({bloom.name, columns[bloom.column].name, "bloom", bloom.falsePositiveRate});
+    }
+    return definitions;
+}
+
+void Table::indexRow(TrigramIndex& index, const Row& row, size_t position) {
+    // Older versions stay findable for the snapshots that see them
+    index.add(row.values[index.getColumn()], position);
+    for (const RowImage* image = row.before.get(); image != nullptr; image = image->older.get()) {
+        for (const auto& column : image->columns) {
+            if (column.first == index.getColumn()) {
+                index.add(column.second, position);
+            }
+        }
+    }
+}
+
+void Table::indexBlocks(TrigramIndex& index, size_t firstBlock) const {
+    for (size_t b = firstBlock; b < blocks.size(); b++) {
+        const RowBlock& block = *blocks[b];
+        std::shared_lock<std::shared_mutex> lock(block.latch);
+        for (size_t i = 0; i < block.rows.size(); i++) {
+            indexRow(index, block.rows[i], b * BLOCK_SIZE + i);
+        }
+    }
+}
+
+void Table::buildFilters(RowBlock& block) const {
+    for (size_t slot = block.filters.size(); slot < blooms.size(); slot++) {
+        // Sized for a full block of distinct values
+        size_t column = blooms[slot].column;
+        BloomFilter filter(BLOCK_SIZE, blooms[slot].falsePositiveRate);
+        for (const Row& row : block.rows) {
+            // Older versions stay findable for the snapshots that see them
+            addToFilter(filter, row.values[column]);
+            for (const RowImage* image = row.before.get(); image != nullptr; image = image->older.get()) {
+                for (const auto& old : image->columns) {
+                    if (old.first == column) {
+                        addToFilter(filter, old.second);
+                    }
+                }
+            }
+        }
+        block.filters.push_back(std::move(filter));
+    }
+}
+
+void Table::addToFilters(RowBlock& block, const Row& row) const {
+    for (size_t slot = 0; slot < block.filters.size(); slot++) {
+        addToFilter(block.filters[slot], row.values[blooms[slot].column]);
+    }
+}
+
+int Table::bloomSlot(size_t column) const {
+    for (size_t slot = 0; slot < blooms.size(); slot++) {
+        if (blooms[slot].column == column) {
+            return static_cast<int>(slot);
+        }
+    }
+    return -1;
+}
+
+size_t Table::versionCount() const {
+    if (!loaded) {
+        std::shared_lock<std::shared_mutex> fileLock(file->latch);
+        return stored.rowCount;
+    }
+    
+    size_t count = 0;
+    for (const auto& block : snapshotBlocks()) {
+        std::shared_lock<std::shared_mutex> lock(block->latch);
+        count += block->size();
+    }
+    return count;
+}
+
+TableMemoryUsage Table::memoryUsage() const {
+    TableMemoryUsage usage;
+    usage.table = name;
+    
+    // Rows still in the file hold no memory
+    if (!loaded) {
+        return usage;
+    }
+    
+    for (const auto& block : snapshotBlocks()) {
+        std::shared_lock<std::shared_mutex> lock(block->latch);
+        usage.overheadBytes += sizeof(RowBlock) + block->rows.capacity() * sizeof(Row);
+        usage.versions += block->size();
+        for (const BloomFilter& filter : block->filters) {
+            usage.indexBytes += filter.memoryBytes();
+        }
+        if (block->packed) {
+            usage.dataBytes += block->packed->memoryBytes();
+        }
+        
+        for (const Row& row : block->rows) {
+            // Numbers and short text live inside the 16-byte value itself
+            usage.overheadBytes += row.values.capacity() * sizeof(Value);
+            for (const Value& value : row.values) {
+                usage.dataBytes += value.payloadBytes();
+                usage.overheadBytes += value.heapBytes();
+                usage.overheadBytes -= value.payloadBytes();
+            }
             
-            file << escapedValue;
+            // Earlier versions of rows updated in place
+            for (const RowImage* image = row.before.get(); image != nullptr;
+                 image = image->older.get()) {
+                usage.versions++;
+                usage.overheadBytes += sizeof(RowImage) +
+                                       image->columns.capacity() * sizeof(image->columns[0]);
+                for (const auto& column : image->columns) {
+                    usage.dataBytes += column.second.payloadBytes();
+                    usage.overheadBytes += column.second.heapBytes();
+                    usage.overheadBytes -= column.second.payloadBytes();
+                }
+            }
+        }
+    }
+    
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    for (const auto& index : indexes) {
+        usage.indexBytes += index->memoryBytes();
+    }
+    return usage;
+}
+
+std::vector<std::shared_ptr<RowBlock>> Table::snapshotBlocks() const {
+    ensureLoaded();
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    return blocks;
+}
+
+bool Table::saveToFile(const Transaction& snapshot, SnapshotWriter& out,
+                       StoredSection& section) const {
+    if (!out.isOpen()) {
+        return false;
+    }
+    section.offset = out.size();
+    section.rowCount = 0;
+    
+    // Rows that were never loaded cannot have changed since the file was
+    // written; older sections are rewritten in chunks
+    if (!loaded && stored.chunked) {
+        if (!copyStored(out)) {
+            return false;
+        }
+        std::shared_lock<std::shared_mutex> fileLock(file->latch);
+        section.rowCount = stored.rowCount;
+        section.length = out.size() - section.offset;
+        return true;
+    }
+    if (!ensureLoaded()) {
+        return false;
+    }
+    
+    auto writeChunk = [&out](const std::string& rows, size_t rowCount) {
+        char header[64];
+        std::snprintf(header, sizeof(header), "%llu %llu %08x\n",
+                      static_cast<unsigned long long>(rowCount),
+                      static_cast<unsigned long long>(rows.size()),
+                      static_cast<unsigned int>(crc32c(rows.data(), rows.size())));
+        out.write(header, std::strlen(header));
+        out.write(rows);
+    };
+    
+    // Encode one block at a time with its latch held, and hand full
+    // chunks to the writer after releasing it, so writers to the block
+    // never wait for I/O
+    auto canSee = [&snapshot](uint64_t beginTs, uint64_t endTs) { return snapshot.canSee(beginTs, endTs); };
+    std::string chunk;
+    size_t chunkRows = 0;
+    std::vector<std::string> full;
+    Row older;
+    std::vector<Row> unpacked;
+    for (const auto& block : snapshotBlocks()) {
+        {
+            std::shared_lock<std::shared_mutex> lock(block->latch);
+            for (const Row& row : block->view(unpacked)) {
+                const Row* version = &row;
+                if (!canSee(row.beginTs, row.endTs)) {
+                    if (!row.before || !row.olderVersion(canSee, older)) {
+                        continue;
+                    }
+                    version = &older;
+                }
+                appendEncodedRow(chunk, version->values);
+                chunk += '\n';
+                section.rowCount++;
+                if (++chunkRows == CHUNK_ROWS) {
+                    full.push_back(std::move(chunk));
+                    chunk.clear();
+                    chunkRows = 0;
+                }
+            }
+        }
+        for (const std::string& rows : full) {
+            writeChunk(rows, CHUNK_ROWS);
+        }
+        full.clear();
+    }
+    if (chunkRows > 0) {
+        writeChunk(chunk, chunkRows);
+    }
+    
+    section.length = out.size() - section.offset;
+    return true;
+}
+
+void Table::setStored(std::shared_ptr<DatabaseFile> databaseFile, const StoredSection& section) {
+    file = std::move(databaseFile);
+    stored = section;
+    loaded = false;
+}
+
+bool Table::ensureLoaded() const {
+    if (!loaded.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        if (!loaded.load(std::memory_order_relaxed)) {
+            std::vector<std::shared_ptr<RowBlock>> loadedBlocks;
+            loadFailed = !readStored(loadedBlocks);
+            if (!loadFailed) {
+                // The rows were the table's all along; only now are they
+                // in memory
+                std::unique_lock<std::shared_mutex> listLock(blocksLatch);
+                const_cast<Table*>(this)->blocks = std::move(loadedBlocks);
+                for (const auto& index : indexes) {
+                    indexBlocks(*index, 0);
+                }
+            }
+            loaded.store(true, std::memory_order_release);
+        }
+    }
+    return !loadFailed;
+}
+
+bool Table::readStored(std::vector<std::shared_ptr<RowBlock>>& out) const {
+    std::string data;
+    StoredSection section;
+    std::shared_ptr<ThreadPool> decoders;
+    {
+        std::shared_lock<std::shared_mutex> fileLock(file->latch);
+        std::ifstream in(file->path, std::ios::binary);
+        section = stored;
+        decoders = file->decoders;
+        data.resize(section.length);
+        if (!in.seekg(static_cast<std::streamoff>(section.offset)) ||
+            !in.read(&data[0], static_cast<std::streamsize>(data.size()))) {
+            return false;
+        }
+    }
+    
+    // Find the chunks: offset, size and row count
+    struct Chunk {
+        size_t begin;
+        size_t size;
+        size_t rows;
+        uint32_t crc;
+    };
+    std::vector<Chunk> chunks;
+    if (!section.chunked) {
+        chunks.push_back({0, data.size(), section.rowCount, 0});
+    }
+    for (size_t position = 0; section.chunked && position < data.size(); ) {
+        size_t end = data.find('\n', position);
+        if (end == std::string::npos) {
+            return false;
+        }
+        std::istringstream header(data.substr(position, end - position));
+        Chunk chunk;
+        chunk.begin = end + 1;
+        if (!(header >> chunk.rows >> chunk.size >> std::hex >> chunk.crc) ||
+            chunk.size > data.size() - chunk.begin) {
+            return false;
+        }
+        chunks.push_back(chunk);
+        position = chunk.begin + chunk.size;
+    }
+    
+    // Every chunk but the last fills whole blocks
+    size_t rowCount = 0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (i + 1 < chunks.size() && chunks[i].rows % BLOCK_SIZE != 0) {
+            return false;
+        }
+        rowCount += chunks[i].rows;
+    }
+    if (rowCount != section.rowCount) {
+        return false;
+    }
+    
+    std::vector<std::vector<std::shared_ptr<RowBlock>>> decoded(chunks.size());
+    std::atomic<bool> ok{true};
+    auto decode = [&](size_t i) {
+        const Chunk& chunk = chunks[i];
+        const char* begin = data.data() + chunk.begin;
+        if ((section.chunked && crc32c(begin, chunk.size) != chunk.crc) ||
+            !decodeChunk(begin, chunk.size, chunk.rows, decoded[i])) {
+            ok = false;
+        }
+    };
+    if (decoders && chunks.size() > 1) {
+        decoders->parallelFor(chunks.size(), decode);
+    } else {
+        for (size_t i = 0; i < chunks.size(); i++) {
+            decode(i);
+        }
+    }
+    if (!ok) {
+        return false;
+    }
+    
+    for (auto& blocks : decoded) {
+        out.insert(out.end(), std::make_move_iterator(blocks.begin()),
+                   std::make_move_iterator(blocks.end()));
+    }
+    return true;
+}
+
+bool Table::decodeChunk(const char* data, size_t size, size_t expectedRows,
+                        std::vector<std::shared_ptr<RowBlock>>& out) const {
+    // Loaded rows count as committed before any transaction started
+    std::string line;
+    size_t rows = 0;
+    for (size_t start = 0; start < size; ) {
+        const char* end = static_cast<const char*>(std::memchr(data + start, '\n', size - start));
+        if (end == nullptr) {
+            return false;
+        }
+        line.assign(data + start, end);
+        start = static_cast<size_t>(end - data) + 1;
+        
+        Row row;
+        row.values = decodeRow(line);
+        if (row.values.size() != columns.size()) {
+            return false;
+        }
+        if (out.empty() || out.back()->rows.size() >= BLOCK_SIZE) {
+            out.push_back(std::make_shared<RowBlock>());
+            out.back()->rows.reserve(BLOCK_SIZE);
         }
-        file << std::endl;
+        out.back()->rows.push_back(std::move(row));
+        rows++;
     }
     
+    // Bloom filters are built here, a chunk per task, rather than stored
+    for (const auto& block : out) {
+        buildFilters(*block);
+    }
+    return rows == expectedRows;
+}
+
+bool Table::copyStored(SnapshotWriter& out) const {
+    std::shared_lock<std::shared_mutex> fileLock(file->latch);
+    std::ifstream in(file->path, std::ios::binary);
+    if (!in.seekg(static_cast<std::streamoff>(stored.offset))) {
+        return false;
+    }
+    
+    std::string buffer(SnapshotWriter::BUFFER_BYTES, '\0');
+    uint64_t remaining = stored.length;
+    while (remaining > 0) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+        if (!in.read(&buffer[0], static_cast<std::streamsize>(count))) {
+            return false;
+        }
+        out.write(buffer.data(), count);
+        remaining -= count;
+    }
     return true;
 }
 
-std::unique_ptr<Table> Table::loadFromFile(std::ifstream& file) {
+std::unique_ptr<Table> Table::loadFromFile(std::ifstream& file, int formatVersion) {
     if (!file.is_open()) {
         return nullptr;
     }
@@ -174,18 +1175,8 @@ std::unique_ptr<Table> Table::loadFromFile(std::ifstream& file) {
         
         iss >> columnName >> dataTypeStr >> primaryKeyFlag >> notNullFlag;
         
-        TokenType dataType;
-        if (dataTypeStr == "INTEGER") {
-            dataType = TokenType::INTEGER;
-        } else if (dataTypeStr == "TEXT") {
-            dataType = TokenType::TEXT;
-        } else if (dataTypeStr == "REAL") {
-            dataType = TokenType::REAL;
-        } else {
-            dataType = TokenType::INVALID;
-        }
-        
-        columns.emplace_back(columnName, dataType, primaryKeyFlag != 0, notNullFlag != 0);
+        columns.emplace_back(columnName, parseTypeName(dataTypeStr), 
+                             primaryKeyFlag != 0, notNullFlag != 0);
     }
     
     auto table = std::make_unique<Table>(name, columns);
@@ -198,30 +1189,239 @@ std::unique_ptr<Table> Table::loadFromFile(std::ifstream& file) {
         std::string line;
         std::getline(file, line);
         
-        std::vector<std::string> values;
-        std::string value;
-        bool escaped = false;
+        std::vector<Value> values = table->decodeRow(line, formatVersion);
         
-        for (char c : line) {
-            if (escaped) {
-                value += c;
-                escaped = false;
-            } else if (c == '\\') {
-                escaped = true;
-            } else if (c == ',') {
-                values.push_back(value);
-                value.clear();
+        // Loaded rows count as committed before any transaction started
+        if (values.size() == columns.size()) {
+            Row row;
+            row.values = std::move(values);
+            table->appendVersion(std::move(row));
+        }
+    }
+    
+    return table;
+}
+
+std::string Table::encodeRow(const std::vector<Value>& values) {
+    std::string line;
+    line.reserve(values.size() * sizeof(Value));
+    appendEncodedRow(line, values);
+    return line;
+}
+
+void Table::appendEncodedRow(std::string& line, const std::vector<Value>& values) {
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) {
+            line += ',';
+        }
+        
+        // Numbers never contain a separator
+        if (values[i].type() != ValueType::TEXT) {
+            if (values[i].isNull()) {
+                line += "\\N";
             } else {
-                value += c;
+                values[i].appendTo(line);
             }
+            continue;
+        }
+        
+        // Escape separators so any value round-trips
+        std::string_view text = values[i].asText();
+        if (text.find_first_of(",\\\n") == std::string_view::npos) {
+            line += text;
+            continue;
         }
+        for (char c : text) {
+            if (c == ',' || c == '\\') {
+                line += '\\';
+                line += c;
+            } else if (c == '\n') {
+                line += "\\n";
+            } else {
+                line += c;
+            }
+        }
+    }
+}
+
+// Split a line written by encodeRow into about `expected` values,
+// typeOf(i) giving the type of the i-th
+template <typename TypeOf>
+static std::vector<Value> decodeFields(const std::string& line, int formatVersion,
+                                       size_t expected, TypeOf typeOf) {
+    std::vector<Value> values;
+    values.reserve(expected);
+    std::string field;
+    bool isNull = false;
+    bool escaped = false;
+    
+    auto finishField = [&]() {
+        TokenType type = typeOf(values.size());
+        if (isNull) {
+            values.emplace_back();
+        } else if (formatVersion < 2 && type != TokenType::TEXT && field.empty()) {
+            // Version 1 stored columns left out of an INSERT as empty text
+            values.emplace_back();
+        } else if (formatVersion < 2 && field.size() >= 2 &&
+                   field.front() == '\'' && field.back() == '\'') {
+            values.push_back(Value::parse(std::string_view(field).substr(1, field.size() - 2), type));
+        } else {
+            values.push_back(Value::parse(field, type));
+        }
+        field.clear();
+        isNull = false;
+    };
+    
+    for (char c : line) {
+        if (escaped) {
+            if (c == 'N') {
+                isNull = true;
+            } else {
+                field += (c == 'n') ? '\n' : c;
+            }
+            escaped = false;
+        } else if (c == '\\') {
+            escaped = true;
+        } else if (c == ',') {
+            finishField();
+        } else {
+            field += c;
+        }
+    }
+    
+    finishField();  // Last value
+    return values;
+}
+
+std::vector<Value> Table::decodeRow(const std::string& line, int formatVersion) const {
+    return decodeFields(line, formatVersion, columns.size(), [this](size_t i) {
+        return i < columns.size() ? columns[i].dataType : TokenType::TEXT;
+    });
+}
+
+std::vector<Value> Table::decodeValues(const std::string& line, TokenType type) {
+    return decodeFields(line, FORMAT_VERSION, 0, [type](size_t) { return type; });
+}
+
+std::vector<Value> Table::decodeValues(const std::string& line, const std::vector<TokenType>& types) {
+    return decodeFields(line, FORMAT_VERSION, types.size(), [&types](size_t i) {
+        return i < types.size() ? types[i] : TokenType::TEXT;
+    });
+}
+
+std::string Table::encodeSchema() const {
+    std::string schema = name;
+    
+    for (const auto& column : columns) {
+        schema += " " + column.name + ":" + typeName(column.dataType) +
+                  ":" + (column.primaryKey ? "1" : "0") +
+                  ":" + (column.notNull ? "1" : "0");
+    }
+    
+    return schema;
+}
+
+std::unique_ptr<Table> Table::fromSchema(const std::string& schema) {
+    std::istringstream iss(schema);
+    std::string tableName, field;
+    iss >> tableName;
+    
+    std::vector<ColumnDefinition> columnDefs;
+    while (iss >> field) {
+        std::istringstream parts(field);
+        std::string columnName, dataTypeStr, primaryKeyFlag, notNullFlag;
+        std::getline(parts, columnName, ':');
+        std::getline(parts, dataTypeStr, ':');
+        std::getline(parts, primaryKeyFlag, ':');
+        std::getline(parts, notNullFlag, ':');
         
-        values.push_back(value);  // Last value
+        columnDefs.emplace_back(columnName, parseTypeName(dataTypeStr),
+                                primaryKeyFlag == "1", notNullFlag == "1");
+    }
+    
+    if (tableName.empty() || columnDefs.empty()) {
+        return nullptr;
+    }
+    return std::make_unique<Table>(tableName, columnDefs);
+}
+
+std::vector<Value> Table::versionValues(size_t rowIndex) const {
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    const RowBlock& block = *blocks[rowIndex / BLOCK_SIZE];
+    std::shared_lock<std::shared_mutex> lock(block.latch);
+    return block.rows[rowIndex % BLOCK_SIZE].values;
+}
+
+void Table::appendEncodedVersion(std::string& line, size_t rowIndex) const {
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    const RowBlock& block = *blocks[rowIndex / BLOCK_SIZE];
+    std::shared_lock<std::shared_mutex> lock(block.latch);
+    appendEncodedRow(line, block.rows[rowIndex % BLOCK_SIZE].values);
+}
+
+bool Table::updatedValues(size_t rowIndex, uint64_t txnId,
+                          std::vector<Value>& before, std::vector<Value>& after) const {
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    const RowBlock& block = *blocks[rowIndex / BLOCK_SIZE];
+    std::shared_lock<std::shared_mutex> lock(block.latch);
+    const Row& row = block.rows[rowIndex % BLOCK_SIZE];
+    
+    // The version the transaction started from is the only one it replaced
+    // that was committed before
+    Row original;
+    auto replacedCommitted = [txnId](uint64_t beginTs, uint64_t endTs) {
+        return endTs == txnId && beginTs < TXN_ID_BASE;
+    };
+    if (!row.olderVersion(replacedCommitted, original)) {
+        return false;
+    }
+    
+    before = std::move(original.values);
+    after = row.values;
+    return true;
+}
+
+bool Table::restoreRow(Transaction& txn, std::vector<Value> values) {
+    if (values.size() != columns.size() || !ensureLoaded()) {
+        return false;
+    }
+    
+    Row row;
+    row.values = std::move(values);
+    row.beginTs = txn.id;
+    
+    size_t rowIndex = appendVersion(std::move(row));
+    txn.undoLog.push_back({UndoEntry::Kind::INSERT, this, rowIndex});
+    return true;
+}
+
+bool Table::deleteRow(Transaction& txn, const std::vector<Value>& values) {
+    if (!ensureLoaded()) {
+        return false;
+    }
+    
+    // Hold the rows unpacked, and the block list so garbage collection
+    // cannot move them
+    std::shared_lock<std::shared_mutex> packLock = unpacked();
+    std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+    
+    for (size_t b = 0; b < blocks.size(); b++) {
+        RowBlock& block = *blocks[b];
+        std::unique_lock<std::shared_mutex> lock(block.latch);
         
-        table->insertRow(values);
+        for (size_t i = 0; i < block.rows.size(); i++) {
+            Row& row = block.rows[i];
+            if (row.endTs == INFINITY_TS && txn.canSee(row.beginTs, row.endTs) &&
+                row.values == values) {
+                row.endTs = txn.id;
+                txn.undoLog.push_back({UndoEntry::Kind::DELETE, this, b * BLOCK_SIZE + i});
+                pendingVersions++;
+                return true;
+            }
+        }
     }
     
-    return table;
+    return false;
 }
 
 int Table::findColumnIndex(const std::string& columnName) const {
@@ -235,50 +1435,20 @@ int Table::findColumnIndex(const std::string& columnName) const {
     return -1;  // Column not found
 }
 
-bool Table::compareValues(const std::string& value1, const std::string& op, const std::string& value2) const {
-    // Check if both values are numeric
-    bool isNumeric = true;
-    double num1 = 0.0, num2 = 0.0;
-    
-    try {
-        // Try to convert to numbers
-        num1 = std::stod(value1);
-        
-        // Remove quotes if present
-        std::string cleanValue2 = value2;
-        if (cleanValue2.size() >= 2 && cleanValue2.front() == '\'' && cleanValue2.back() == '\'') {
-            cleanValue2 = cleanValue2.substr(1, cleanValue2.size() - 2);
-        }
-        
-        num2 = std::stod(cleanValue2);
-    } catch (const std::exception&) {
-        isNumeric = false;
+bool Table::compareValues(const Value& value1, const std::string& op, const Value& value2) {
+    // NULL is neither equal to, smaller nor larger than anything
+    if (value1.isNull() || value2.isNull()) {
+        return false;
     }
     
-    if (isNumeric) {
-        if (op == "=") {
-            return num1 == num2;
-        } else if (op == ">") {
-            return num1 > num2;
-        } else if (op == "<") {
-            return num1 < num2;
-        }
-    } else {
-        // String comparison
-        // Remove quotes if present
-        std::string cleanValue2 = value2;
-        if (cleanValue2.size() >= 2 && cleanValue2.front() == '\'' && cleanValue2.back() == '\'') {
-            cleanValue2 = cleanValue2.substr(1, cleanValue2.size() - 2);
-        }
-        
-        if (op == "=") {
-            return value1 == cleanValue2;
-        } else if (op == ">") {
-            return value1 > cleanValue2;
-        } else if (op == "<") {
-            return value1 < cleanValue2;
-        }
+    int order = Value::compare(value1, value2);
+    if (op == "=") {
+        return order == 0;
+    } else if (op == ">") {
+        return order > 0;
+    } else if (op == "<") {
+        return order < 0;
     }
     
     return false;
-}
\ No newline at end of file
+}
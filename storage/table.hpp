@@ -1,22 +1,137 @@
 #ifndef TABLE_HPP
 #define TABLE_HPP
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <memory>
 #include <fstream>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
 #include "../sql/parser.hpp"
+#include "./transaction.hpp"
+#include "./snapshot_writer.hpp"
+#include "./trigram_index.hpp"
+#include "./bloom_filter.hpp"
+#include "./packed_block.hpp"
 
-// Structure to hold a single row in the table
+// Earlier version of a row that was updated in place: the old values of
+// the columns the update changed. Images form a chain from the newest to
+// the oldest version, so a snapshot that cannot see the row itself can
+// rebuild the version it does see.
+struct RowImage {
+    std::vector<std::pair<size_t, Value>> columns;  // Column index and old value
+    uint64_t beginTs;                               // As in Row
+    uint64_t endTs;                                 // When the update replaced this version
+    std::shared_ptr<RowImage> older;
+};
+
+// Structure to hold a single row version in the table
 struct Row {
-    std::vector<std::string> values;
+    std::vector<Value> values;       // One per column, NULL included
+    uint64_t beginTs = 0;            // Commit timestamp (or txn id) that created this version
+    uint64_t endTs = INFINITY_TS;    // Commit timestamp (or txn id) that deleted it
+    std::shared_ptr<RowImage> before;  // Version this one replaced in place, if any
+    
+    // The newest earlier version for which isVisible(beginTs, endTs)
+    // holds, rebuilt from the image chain; false if there is none
+    template <typename Visible>
+    bool olderVersion(Visible isVisible, Row& out) const;
+};
+
+// Rows of one block handed to an expression at once
+using RowBatch = std::vector<const Row*>;
+
+// Predicate over a row, and new values for the updated columns of a row
+using RowFilter = std::function<bool(const Row&)>;
+using RowUpdate = std::function<void(const Row&, std::vector<Value>&)>;
+
+// Memory held by a table, as reported by Table::memoryUsage
+struct TableMemoryUsage {
+    std::string table;
+    size_t versions = 0;       // Stored row versions, visible or not
+    size_t dataBytes = 0;      // Column values
+    size_t indexBytes = 0;     // Index structures
+    size_t overheadBytes = 0;  // Row headers, string and vector bookkeeping, spare capacity
+};
+
+// An index on a column, as recorded in the catalog and the WAL: a
+// trigram index, or Bloom filters of the column's values in every block
+struct IndexDefinition {
+    std::string name;
+    std::string column;
+    std::string method = "trigram";  // "trigram" or "bloom"
+    double falsePositiveRate = 0;    // Of each Bloom filter
+    
+    // "<name> <column> <method> <rate>", as the catalog and the WAL store it
+    std::string encode() const;
+};
+
+// Rows are stored in fixed-size blocks, each with its own latch, so
+// readers and writers only contend when they touch the same block
+constexpr size_t BLOCK_SIZE = 1024;
+
+struct RowBlock {
+    mutable std::shared_mutex latch;
+    std::vector<Row> rows;  // At most BLOCK_SIZE; only the last block is partial
+    
+    // One per Bloom filter index of the table, in creation order, listing
+    // the values of every version in the block; a block created before an
+    // index has none for it until the index is built
+    std::vector<BloomFilter> filters;
+    
+    // The rows of a packed table, compressed (see Table::pack); rows is
+    // then empty
+    std::unique_ptr<const PackedBlock> packed;
+    
+    // Number of row versions, packed or not
+    size_t size() const { return packed ? packed->size() : rows.size(); }
+    
+    // The rows to read: rows itself, or the packed rows decoded into
+    // scratch
+    const std::vector<Row>& view(std::vector<Row>& scratch) const {
+        if (!packed) {
+            return rows;
+        }
+        packed->unpack(scratch);
+        return scratch;
+    }
+};
+
+// Rows per chunk of a stored table. Each chunk has its own checksum and
+// decodes independently into whole blocks, so large tables load in
+// parallel.
+constexpr size_t CHUNK_ROWS = 16 * BLOCK_SIZE;
+
+class ThreadPool;
+
+// The database file of tables whose rows are loaded on first access. A
+// checkpoint replacing the file holds latch exclusively while it moves
+// the tables' sections; loads hold it shared.
+struct DatabaseFile {
+    std::string path;
+    mutable std::shared_mutex latch;
+    std::shared_ptr<ThreadPool> decoders;  // Decode chunks in parallel; may be null
+};
+
+// A table's rows in the database file: chunks of encoded row lines, each
+// behind a line with its row count, size and CRC-32C
+struct StoredSection {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    size_t rowCount = 0;
+    bool chunked = true;  // Version 3 files store plain row lines
 };
 
 // Table class to manage table data
 class Table {
 public:
     Table(const std::string& name, const std::vector<ColumnDefinition>& columns);
+    Table(const Table&) = delete;
+    Table& operator=(const Table&) = delete;
     
     // Get table name
     std::string getName() const { return name; }
@@ -24,37 +139,563 @@ public:
     // Get columns
     const std::vector<ColumnDefinition>& getColumns() const { return columns; }
     
-    // Insert a new row
-    bool insertRow(const std::vector<std::string>& values);
-    bool insertRow(const std::vector<std::string>& columnNames, const std::vector<std::string>& values);
+    // Position of a column by name; -1 if there is no such column
+    int findColumnIndex(const std::string& columnName) const;
+    
+    // Insert a new row version owned by the transaction. Values are
+    // converted to the column types; columns left out are NULL. Fails on
+    // a type mismatch or a NULL in a NOT NULL column.
+    bool insertRow(Transaction& txn, const std::vector<Value>& values,
+                   std::string& errorMessage);
+    bool insertRow(Transaction& txn, const std::vector<std::string>& columnNames, 
+                   const std::vector<Value>& values, std::string& errorMessage);
     
-    // Select rows
-    std::vector<Row> selectAll() const;
-    std::vector<Row> selectWhere(const std::string& column, 
+    // Insert whole rows at once, taking the append latch once per block
+    // instead of once per row. Every row is converted before any is
+    // added, so on failure the table is unchanged. The values are moved
+    // from. Returns the position of the first row; the others follow it.
+    bool insertRows(Transaction& txn, std::vector<std::vector<Value>>& rows,
+                    size_t& firstIndex, std::string& errorMessage);
+    
+    // Call visit(row) for each row visible in the transaction's snapshot,
+    // without copying it. The row's block stays latched during the call, so
+    // visit must not write to this table. Scans end early, at a block
+    // boundary, once the transaction's statement is interrupted.
+    template <typename Visitor>
+    void scan(const Transaction& txn, Visitor visit) const;
+    
+    // Same, calling visit(rows) once per block with all its visible rows
+    template <typename Visitor>
+    void scanBatches(const Transaction& txn, Visitor visit) const;
+    
+    // Same, for rows where "column op value" holds. Returns false if the
+    // column does not exist.
+    template <typename Visitor>
+    bool scanWhere(const Transaction& txn,
+                   const std::string& column,
+                   const std::string& op,
+                   const Value& value,
+                   Visitor visit) const;
+    
+    // Same as scanBatches, for only the rows whose column may contain
+    // every one of the strings (ignoring case) by the column's trigram
+    // index; candidates is set to the number of versions it lists. False,
+    // without calling visit, if the column has no index ready or the
+    // strings are too short for it.
+    template <typename Visitor>
+    bool scanContaining(const Transaction& txn, size_t column,
+                        const std::vector<std::string>& strings,
+                        size_t& candidates, Visitor visit) const;
+    
+    // Same as scanBatches, passing over the blocks whose Bloom filter on
+    // the column rules out "column = value"; skipped is set to the number
+    // of versions in them. False, without calling visit, if the column has
+    // no Bloom filters or the value is NULL.
+    template <typename Visitor>
+    bool scanEqual(const Transaction& txn, size_t column, const Value& value,
+                   size_t& skipped, Visitor visit) const;
+    
+    // Copies of the rows visible in the transaction's snapshot
+    std::vector<Row> selectAll(const Transaction& txn) const;
+    std::vector<Row> selectWhere(const Transaction& txn,
+                            const std::string& column, 
                             const std::string& op, 
-                            const std::string& value) const;
+                            const Value& value) const;
     
-    // Delete rows
-    int deleteWhere(const std::string& column, 
+    // Delete rows visible in the transaction's snapshot.
+    // Returns -1 if a row was changed by a concurrent transaction, or if
+    // the statement was interrupted part way.
+    int deleteWhere(Transaction& txn,
+                const std::string& column, 
                 const std::string& op, 
-                const std::string& value);
+                const Value& value);
+    int deleteWhere(Transaction& txn, const RowFilter& filter);
+    int deleteAll(Transaction& txn);
+    
+    // Update visible rows matching the filter in place: compute gives the
+    // new values of the named columns from the old row, only those are
+    // rewritten, and their old values are kept as an image for older
+    // snapshots. Returns -1 if a row was changed by a concurrent
+    // transaction or the statement was interrupted, or with errorMessage
+    // set if a value does not fit.
+    int updateWhere(Transaction& txn,
+                    const std::vector<std::string>& columnNames,
+                    const RowUpdate& compute,
+                    const RowFilter& filter,
+                    std::string& errorMessage);
+    
+    // Whether the filter accepts a version the transaction cannot see
+    // because another transaction wrote it after the snapshot, whether
+    // that one has committed yet or not; such a write conflicts with
+    // adding a row for the same key
+    bool hasConcurrentMatch(const Transaction& txn, const RowFilter& filter) const;
+    
+    // Index a column, starting with the rows already stored; rows still
+    // in the database file are indexed when they load. checkIndex reports
+    // why createIndex would fail: an unknown column, a trigram index on a
+    // column that is not TEXT, a false positive rate outside (0, 1), or an
+    // index of that name on this table.
+    bool checkIndex(const IndexDefinition& index, std::string& errorMessage) const;
+    bool createIndex(const IndexDefinition& index, std::string& errorMessage);
+    
+    // Name of the trigram index on a column, empty if none is ready
+    std::string indexOn(size_t column) const;
+    
+    // Name of the Bloom filter index on a column, empty if none
+    std::string bloomFilterOn(size_t column) const;
+    
+    std::vector<IndexDefinition> indexDefinitions() const;
+    
+    // Number of stored row versions, visible or not; a scan reads them all
+    size_t versionCount() const;
+    
+    // Memory held by the table's rows; walks every version
+    TableMemoryUsage memoryUsage() const;
+    
+    // Finish a change recorded in a transaction's undo log
+    void commitVersion(const UndoEntry& entry, uint64_t txnId, uint64_t commitTs);
+    void revertVersion(const UndoEntry& entry);
+    
+    // Count of committed transactions that wrote to the table, or to one
+    // of its partitions. Moved on after the commit is visible to new
+    // snapshots, so a snapshot taken after reading a version sees every
+    // write counted in it.
+    uint64_t getVersion() const { return version.load(); }
+    void bumpVersion() {
+        version.fetch_add(1);
+        if (partitionOf) {
+            partitionOf->bumpVersion();
+        }
+    }
+    
+    // Make this table a partition of a partitioned table, before it is
+    // in use
+    void setPartitionOf(std::shared_ptr<Table> parent) { partitionOf = std::move(parent); }
+    
+    // Remove versions that no snapshot newer than oldestSnapshot can see.
+    // Returns the number of versions removed.
+    bool hasGarbage() const { return deadVersions > 0 && pendingVersions == 0; }
+    size_t collectGarbage(uint64_t oldestSnapshot);
+    
+    // A sealed table expects no more writes, like a time-series segment
+    // other than the newest, and is packed once it is quiet
+    void setSealed(bool sealed) { this->sealed = sealed; }
+    
+    // Compress the rows of a sealed table block by block, once every
+    // snapshot newer than oldestSnapshot sees all of them and none was
+    // deleted or updated since. Scans decode a block at a time; the next
+    // write unpacks the table. canPack tells cheaply whether pack would.
+    bool canPack(uint64_t oldestSnapshot) const;
+    bool pack(uint64_t oldestSnapshot);
+    bool isPacked() const { return packed; }
+    
+    // Write the rows visible in the snapshot as one section of a
+    // checkpoint and report where it went. Rows never loaded are copied
+    // from the database file as they are. The snapshot must stay open
+    // until this returns, so that garbage collection keeps its versions.
+    bool saveToFile(const Transaction& snapshot, SnapshotWriter& out,
+                    StoredSection& section) const;
+    
+    // Leave the rows in the file until they are first needed
+    void setStored(std::shared_ptr<DatabaseFile> file, const StoredSection& section);
+    
+    // The section was moved by a checkpoint; file->latch must be held
+    // exclusively
+    void moveStored(const StoredSection& section) { stored = section; }
+    
+    // Read the rows from the database file unless they are in memory.
+    // Every access to the rows does this; false if they could not be
+    // read, in which case the table stays empty and checkpoints fail.
+    bool ensureLoaded() const;
+    bool isLoaded() const { return loaded; }
+    
+    // Load a table from a version 1 or 2 file, where each table comes
+    // with its definition and is read in full. Version 1 files stored
+    // text literals with their quotes and had no NULL.
+    static std::unique_ptr<Table> loadFromFile(std::ifstream& file, int formatVersion);
+    
+    // Serialize row values as one line (used by the file and the WAL).
+    // Values are written in display form, NULL as \N; decoding uses the
+    // column types.
+    static std::string encodeRow(const std::vector<Value>& values);
+    static void appendEncodedRow(std::string& line, const std::vector<Value>& values);
+    std::vector<Value> decodeRow(const std::string& line, int formatVersion = FORMAT_VERSION) const;
     
-    // Save table to file
-    bool saveToFile(std::ofstream& file) const;
+    // Decode a line of encodeRow whose values are all of one type, or of
+    // the given types
+    static std::vector<Value> decodeValues(const std::string& line, TokenType type);
+    static std::vector<Value> decodeValues(const std::string& line, const std::vector<TokenType>& types);
     
-    // Load table from file
-    static std::unique_ptr<Table> loadFromFile(std::ifstream& file);
+    // Version of the database file: 2 changed the row encoding written
+    // by encodeRow, 3 added the table catalog, 4 checksummed chunks, 5
+    // index definitions, 6 their method and options, 7 materialized
+    // views, 8 partitioned tables, 9 time-series tables
+    static const int FORMAT_VERSION = 9;
+    
+    // Serialize the table definition as one line
+    std::string encodeSchema() const;
+    static std::unique_ptr<Table> fromSchema(const std::string& schema);
+    
+    // Values of the version at a position recorded in an undo log
+    std::vector<Value> versionValues(size_t rowIndex) const;
+    
+    // Append them to a line as appendEncodedRow does, without a copy
+    void appendEncodedVersion(std::string& line, size_t rowIndex) const;
+    
+    // Values of a row before and after a transaction's updates to it;
+    // false if the transaction inserted the row itself
+    bool updatedValues(size_t rowIndex, uint64_t txnId,
+                       std::vector<Value>& before, std::vector<Value>& after) const;
+    
+    // Insert decoded values as they are, without conversions or checks
+    // (WAL replay)
+    bool restoreRow(Transaction& txn, std::vector<Value> values);
+    
+    // Delete one visible row with exactly these values (WAL replay)
+    bool deleteRow(Transaction& txn, const std::vector<Value>& values);
     
 private:
     std::string name;
     std::vector<ColumnDefinition> columns;
-    std::vector<Row> rows;
     
-    // Helper method to find column index
-    int findColumnIndex(const std::string& columnName) const;
+    // Row storage. A row's position is blockIndex * BLOCK_SIZE + slot.
+    // blocksLatch guards the block list: readers copy it and then only
+    // latch one block at a time, writers that stamp versions hold it shared
+    // so garbage collection cannot move rows under them.
+    mutable std::shared_mutex blocksLatch;
+    std::vector<std::shared_ptr<RowBlock>> blocks;
+    
+    // Serializes appends (and garbage collection) on the last block
+    std::mutex appendMutex;
+    
+    // Versions written by transactions that have not finished yet; row
+    // positions must stay stable while any exist
+    std::atomic<size_t> pendingVersions{0};
+    
+    // Deleted or rolled back versions waiting for garbage collection
+    std::atomic<size_t> deadVersions{0};
+    
+    // See getVersion
+    std::atomic<uint64_t> version{0};
+    
+    // Latest commit that stamped a version here
+    std::atomic<uint64_t> newestCommit{0};
+    
+    // See pack. Writers hold packLatch shared (see unpacked), so the rows
+    // are not packed under them; packing and unpacking hold it
+    // exclusively.
+    std::atomic<bool> sealed{false};
+    std::atomic<bool> packed{false};
+    std::shared_mutex packLatch;
+    std::shared_ptr<Table> partitionOf;
+    
+    // Trigram indexes; added with blocksLatch held exclusively, so holding
+    // it shared keeps their positions consistent with the block list
+    std::vector<std::shared_ptr<TrigramIndex>> indexes;
+    
+    // Bloom filter indexes; each block holds their filters in this order.
+    // Added under loadMutex, appendMutex and blocksLatch held exclusively.
+    struct BloomIndex {
+        std::string name;
+        size_t column;
+        double falsePositiveRate;
+    };
+    std::vector<BloomIndex> blooms;
+    
+    // Rows still in the database file (see ensureLoaded). stored is
+    // guarded by file->latch; loadFailed is set before loaded.
+    std::shared_ptr<DatabaseFile> file;
+    StoredSection stored;
+    mutable std::atomic<bool> loaded{true};
+    mutable bool loadFailed = false;
+    mutable std::mutex loadMutex;
+    
+    // Decode the stored rows into blocks, a chunk per task
+    bool readStored(std::vector<std::shared_ptr<RowBlock>>& out) const;
+    
+    // Check and decode one chunk of row lines; expectedRows of them
+    bool decodeChunk(const char* data, size_t size, size_t expectedRows,
+                     std::vector<std::shared_ptr<RowBlock>>& out) const;
+    
+    // Copy the stored rows to a checkpoint unchanged
+    bool copyStored(SnapshotWriter& out) const;
+    
+    // Hold packLatch shared with the rows unpacked, unpacking them first
+    // if they are packed
+    std::shared_lock<std::shared_mutex> unpacked();
+    
+    // Append a row version and return its position
+    size_t appendVersion(Row row);
+    
+    // Append row versions at consecutive positions and return the first
+    size_t appendVersions(Row* rows, size_t count);
+    
+    // List a row version's values, older ones included, in an index
+    static void indexRow(TrigramIndex& index, const Row& row, size_t position);
+    
+    // Index the rows of blocks from firstBlock on; the caller keeps them
+    // from moving
+    void indexBlocks(TrigramIndex& index, size_t firstBlock) const;
+    
+    // Build the block's filter for each Bloom index from filters.size()
+    // on; the caller keeps the block from changing
+    void buildFilters(RowBlock& block) const;
+    
+    // Add a version's values to the filters of its block
+    void addToFilters(RowBlock& block, const Row& row) const;
     
-    // Helper method to compare values
-    bool compareValues(const std::string& value1, const std::string& op, const std::string& value2) const;
+    // Position of the Bloom index on a column in blooms, -1 if none;
+    // blocksLatch must be held
+    int bloomSlot(size_t column) const;
+    
+    // Add the version a transaction sees of row to the batch, if any;
+    // older versions are rebuilt into older
+    template <typename Visible>
+    static void addVisible(const Transaction& txn, Visible canSee, const Row& row,
+                           RowBatch& batch, std::vector<Row>& older);
+    
+    // Copy of the block list for lock-free iteration by readers
+    std::vector<std::shared_ptr<RowBlock>> snapshotBlocks() const;
+    
+    // Call visit(rows) for each of the blocks with the rows visible in the
+    // transaction's snapshot, except blocks for which skip(block) holds
+    template <typename Skip, typename Visitor>
+    static void scanBlocks(const Transaction& txn,
+                           const std::vector<std::shared_ptr<RowBlock>>& listed,
+                           Skip skip, Visitor visit);
+    
+    // Call write(row, rowIndex) for each visible version matching the
+    // predicate, with its block latched exclusively. Returns the number of
+    // rows written, or -1 on a write conflict, when write fails or when
+    // the statement is interrupted.
+    template <typename Predicate, typename Writer>
+    int writeMatching(Transaction& txn, Predicate matches, Writer write);
+    
+    // Mark visible versions matching the predicate as deleted by txn
+    template <typename Predicate>
+    int deleteMatching(Transaction& txn, Predicate matches);
+    
+    // Convert a value to a column's type and check its constraints
+    bool bindValue(size_t columnIndex, const Value& value, Value& out,
+                   std::string& errorMessage) const;
+    
+    // The WHERE literal converted to the column's type, so rows compare
+    // without conversions
+    Value bindOperand(int columnIndex, const Value& value) const;
+    
+    // Helper method to compare values; comparisons with NULL are false
+    static bool compareValues(const Value& value1, const std::string& op, const Value& value2);
 };
 
+template <typename Visible>
+bool Row::olderVersion(Visible isVisible, Row& out) const {
+    const RowImage* found = before.get();
+    while (found != nullptr && !isVisible(found->beginTs, found->endTs)) {
+        found = found->older.get();
+    }
+    if (found == nullptr) {
+        return false;
+    }
+    
+    // Undo the updates from the newest down to the found version
+    out.values = values;
+    for (const RowImage* image = before.get(); ; image = image->older.get()) {
+        for (const auto& column : image->columns) {
+            out.values[column.first] = column.second;
+        }
+        if (image == found) {
+            break;
+        }
+    }
+    out.beginTs = found->beginTs;
+    out.endTs = found->endTs;
+    return true;
+}
+
+template <typename Visitor>
+void Table::scan(const Transaction& txn, Visitor visit) const {
+    auto canSee = [&txn](uint64_t beginTs, uint64_t endTs) { return txn.canSee(beginTs, endTs); };
+    Row older;
+    std::vector<Row> unpacked;
+    for (const auto& block : snapshotBlocks()) {
+        if (txn.interrupted()) {
+            return;
+        }
+        std::shared_lock<std::shared_mutex> lock(block->latch);
+        for (const Row& row : block->view(unpacked)) {
+            if (txn.canSee(row.beginTs, row.endTs)) {
+                visit(row);
+            } else if (row.before && row.olderVersion(canSee, older)) {
+                visit(static_cast<const Row&>(older));
+            }
+        }
+    }
+}
+
+template <typename Visitor>
+void Table::scanBatches(const Transaction& txn, Visitor visit) const {
+    scanBlocks(txn, snapshotBlocks(), [](const RowBlock&) { return false; }, visit);
+}
+
+template <typename Visitor>
+bool Table::scanEqual(const Transaction& txn, size_t column, const Value& value,
+                      size_t& skipped, Visitor visit) const {
+    // Converted as WHERE converts it, so it hashes like the stored values
+    // it equals
+    Value operand = bindOperand(static_cast<int>(column), value);
+    if (operand.isNull()) {
+        return false;
+    }
+    
+    ensureLoaded();
+    std::vector<std::shared_ptr<RowBlock>> listed;
+    int slot = -1;
+    {
+        std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+        slot = bloomSlot(column);
+        if (slot == -1) {
+            return false;
+        }
+        listed = blocks;
+    }
+    
+    uint64_t hash = BloomFilter::hash(operand);
+    size_t filter = static_cast<size_t>(slot);
+    skipped = 0;
+    scanBlocks(txn, listed, [hash, filter, &skipped](const RowBlock& block) {
+        if (filter < block.filters.size() && !block.filters[filter].mayContain(hash)) {
+            skipped += block.size();
+            return true;
+        }
+        return false;
+    }, visit);
+    return true;
+}
+
+template <typename Skip, typename Visitor>
+void Table::scanBlocks(const Transaction& txn,
+                       const std::vector<std::shared_ptr<RowBlock>>& listed,
+                       Skip skip, Visitor visit) {
+    auto canSee = [&txn](uint64_t beginTs, uint64_t endTs) { return txn.canSee(beginTs, endTs); };
+    RowBatch batch;
+    batch.reserve(BLOCK_SIZE);
+    
+    // Older versions are rebuilt here; the reserve keeps them in place
+    std::vector<Row> older;
+    older.reserve(BLOCK_SIZE);
+    std::vector<Row> unpacked;
+    
+    for (const auto& block : listed) {
+        if (txn.interrupted()) {
+            return;
+        }
+        std::shared_lock<std::shared_mutex> lock(block->latch);
+        if (skip(static_cast<const RowBlock&>(*block))) {
+            continue;
+        }
+        batch.clear();
+        older.clear();
+        for (const Row& row : block->view(unpacked)) {
+            addVisible(txn, canSee, row, batch, older);
+        }
+        if (!batch.empty()) {
+            visit(static_cast<const RowBatch&>(batch));
+        }
+    }
+}
+
+template <typename Visitor>
+bool Table::scanContaining(const Transaction& txn, size_t column,
+                           const std::vector<std::string>& strings,
+                           size_t& candidates, Visitor visit) const {
+    // The candidates' positions hold in the block list as it is now
+    ensureLoaded();
+    std::vector<uint32_t> positions;
+    std::vector<std::shared_ptr<RowBlock>> listed;
+    {
+        std::shared_lock<std::shared_mutex> listLock(blocksLatch);
+        auto index = std::find_if(indexes.begin(), indexes.end(), [column](const auto& index) {
+            return index->getColumn() == column && index->isReady();
+        });
+        if (index == indexes.end() || !(*index)->candidates(strings, positions)) {
+            return false;
+        }
+        listed = blocks;
+    }
+    candidates = positions.size();
+    
+    auto canSee = [&txn](uint64_t beginTs, uint64_t endTs) { return txn.canSee(beginTs, endTs); };
+    RowBatch batch;
+    std::vector<Row> older;
+    older.reserve(BLOCK_SIZE);
+    std::vector<Row> unpacked;
+    
+    // A batch per block holding candidates
+    for (size_t i = 0; i < positions.size(); ) {
+        if (txn.interrupted()) {
+            break;
+        }
+        size_t blockIndex = positions[i] / BLOCK_SIZE;
+        const RowBlock& block = *listed[blockIndex];
+        std::shared_lock<std::shared_mutex> lock(block.latch);
+        const std::vector<Row>& rows = block.view(unpacked);
+        batch.clear();
+        older.clear();
+        for (; i < positions.size() && positions[i] / BLOCK_SIZE == blockIndex; i++) {
+            addVisible(txn, canSee, rows[positions[i] % BLOCK_SIZE], batch, older);
+        }
+        if (!batch.empty()) {
+            visit(static_cast<const RowBatch&>(batch));
+        }
+    }
+    return true;
+}
+
+template <typename Visible>
+void Table::addVisible(const Transaction& txn, Visible canSee, const Row& row,
+                       RowBatch& batch, std::vector<Row>& older) {
+    if (txn.canSee(row.beginTs, row.endTs)) {
+        batch.push_back(&row);
+    } else if (row.before) {
+        // The reserve of older keeps the rows already batched in place
+        older.emplace_back();
+        if (row.olderVersion(canSee, older.back())) {
+            batch.push_back(&older.back());
+        } else {
+            older.pop_back();
+        }
+    }
+}
+
+template <typename Visitor>
+bool Table::scanWhere(const Transaction& txn,
+                      const std::string& column,
+                      const std::string& op,
+                      const Value& value,
+                      Visitor visit) const {
+    int columnIndex = findColumnIndex(column);
+    if (columnIndex == -1) {
+        return false;
+    }
+    
+    Value operand = bindOperand(columnIndex, value);
+    auto check = [&](const Row& row) {
+        if (compareValues(row.values[columnIndex], op, operand)) {
+            visit(row);
+        }
+    };
+    
+    // Blocks whose Bloom filter rules the value out cannot hold a match
+    auto checkBatch = [&check](const RowBatch& batch) {
+        for (const Row* row : batch) {
+            check(*row);
+        }
+    };
+    size_t skipped = 0;
+    if (op != "=" || !scanEqual(txn, columnIndex, value, skipped, checkBatch)) {
+        scan(txn, check);
+    }
+    return true;
+}
+
 #endif // TABLE_HPP
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "./transaction.hpp"
+#include "./table.hpp"
+#include "./wal.hpp"
+
+std::unique_ptr<Transaction> TransactionManager::begin() {
+    std::lock_guard<std::mutex> lock(activeMutex);
+
+    auto txn = std::make_unique<Transaction>(nextTxnId++, lastCommitTs.load());
+    activeSnapshots.insert(txn->startTs);
+    return txn;
+}
+
+bool TransactionManager::commit(Transaction& txn) {
+    if (txn.state != Transaction::State::ACTIVE) {
+        return false;
+    }
+
+    // Make the changes durable first; read-only transactions skip the log
+    std::shared_lock<std::shared_mutex> logGuard;
+    if (log != nullptr && !txn.undoLog.empty()) {
+        std::string records;
+        std::set<std::pair<const Table*, size_t>> updatedRows;
+        for (const UndoEntry& entry : txn.undoLog) {
+            // An updated row is logged once, as the delete of the version
+            // the transaction started from and the insert of its final one;
+            // rows the transaction inserted itself are logged by the insert
+            if (entry.kind == UndoEntry::Kind::UPDATE) {
+                std::vector<Value> before, after;
+                if (!updatedRows.insert({entry.table, entry.rowIndex}).second ||
+                    !entry.table->updatedValues(entry.rowIndex, txn.id, before, after)) {
+                    continue;
+                }
+                records += "D " + entry.table->getName() + ' ' + Table::encodeRow(before) + '\n';
+                records += "I " + entry.table->getName() + ' ' + Table::encodeRow(after) + '\n';
+                continue;
+            }
+
+            records += entry.kind == UndoEntry::Kind::INSERT ? "I " : "D ";
+            records += entry.table->getName();
+            records += ' ';
+            entry.table->appendEncodedVersion(records, entry.rowIndex);
+            records += '\n';
+        }
+
+        logGuard = log->beginCommit();
+        if (!log->commit(records)) {
+            logGuard.unlock();
+            rollback(txn);
+            return false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(commitMutex);
+        uint64_t commitTs = lastCommitTs.load() + 1;
+
+        // Stamp every version first, then publish the timestamp, so a
+        // snapshot taken at commitTs never sees a half-applied commit
+        for (const UndoEntry& entry : txn.undoLog) {
+            entry.table->commitVersion(entry, txn.id, commitTs);
+        }
+        lastCommitTs.store(commitTs);
+    }
+
+    // Results read from the written tables before now are out of date
+    const Table* bumped = nullptr;
+    for (const UndoEntry& entry : txn.undoLog) {
+        if (entry.table != bumped) {
+            entry.table->bumpVersion();
+            bumped = entry.table;
+        }
+    }
+
+    txn.undoLog.clear();
+    finish(txn, Transaction::State::COMMITTED);
+    return true;
+}
+
+void TransactionManager::rollback(Transaction& txn) {
+    if (txn.state != Transaction::State::ACTIVE) {
+        return;
+    }
+
+    rollbackTo(txn, 0);
+    finish(txn, Transaction::State::ABORTED);
+}
+
+void TransactionManager::rollbackTo(Transaction& txn, size_t savepoint) {
+    // Undo in reverse order so later changes are reverted first
+    while (txn.undoLog.size() > savepoint) {
+        const UndoEntry& entry = txn.undoLog.back();
+        entry.table->revertVersion(entry);
+        txn.undoLog.pop_back();
+    }
+}
+
+uint64_t TransactionManager::oldestActiveSnapshot() const {
+    std::lock_guard<std::mutex> lock(activeMutex);
+
+    if (activeSnapshots.empty()) {
+        return lastCommitTs.load();
+    }
+    return *activeSnapshots.begin();
+}
+
+void TransactionManager::finish(Transaction& txn, Transaction::State state) {
+    std::lock_guard<std::mutex> lock(activeMutex);
+
+    auto it = activeSnapshots.find(txn.startTs);
+    if (it != activeSnapshots.end()) {
+        activeSnapshots.erase(it);
+    }
+    txn.state = state;
+}
@@ -0,0 +1,113 @@
+#ifndef TRANSACTION_HPP
+#define TRANSACTION_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "../include/query_control.hpp"
+
+class Table;
+class WriteAheadLog;
+
+// Version timestamps below TXN_ID_BASE are commit timestamps. Values at or
+// above it are transaction ids and mark a version as not yet committed.
+constexpr uint64_t TXN_ID_BASE = 1ULL << 62;
+constexpr uint64_t INFINITY_TS = UINT64_MAX;
+
+// One change made by a transaction, kept so it can be committed or undone
+struct UndoEntry {
+    enum class Kind {
+        INSERT,
+        DELETE,
+        UPDATE   // In place; the old values are the row's newest image
+    };
+
+    Kind kind;
+    Table* table;
+    size_t rowIndex;
+};
+
+// A running transaction and the snapshot it reads from
+struct Transaction {
+    enum class State {
+        ACTIVE,
+        COMMITTED,
+        ABORTED
+    };
+
+    uint64_t id;        // Stamped on versions this transaction writes
+    uint64_t startTs;   // Sees versions committed at or before this timestamp
+    State state;
+    std::vector<UndoEntry> undoLog;
+
+    // Set while a statement that may be stopped runs in the transaction
+    const QueryControl* control = nullptr;
+
+    Transaction(uint64_t id, uint64_t startTs)
+        : id(id), startTs(startTs), state(State::ACTIVE) {}
+
+    // Check whether a version created at beginTs and deleted at endTs is
+    // part of this transaction's snapshot
+    bool canSee(uint64_t beginTs, uint64_t endTs) const {
+        bool created = beginTs == id || (beginTs < TXN_ID_BASE && beginTs <= startTs);
+        if (!created) {
+            return false;
+        }
+        bool deleted = endTs == id || (endTs < TXN_ID_BASE && endTs <= startTs);
+        return !deleted;
+    }
+
+    // Whether the running statement should stop; loops over rows check
+    // this once per block
+    bool interrupted() const { return control != nullptr && control->stopped(); }
+};
+
+// Hands out transaction ids and snapshots, and publishes commits
+class TransactionManager {
+public:
+    TransactionManager() = default;
+
+    // Start a transaction reading the latest committed state
+    std::unique_ptr<Transaction> begin();
+
+    // Write the transaction's changes to the log (if any), then make them
+    // visible atomically. Returns false, after rolling back, if the log
+    // write failed.
+    bool commit(Transaction& txn);
+
+    // Log that committed changes are written to before they become visible
+    void setLog(WriteAheadLog* log) { this->log = log; }
+
+    // Undo all changes of the transaction
+    void rollback(Transaction& txn);
+
+    // Undo the changes made after the undo log had `savepoint` entries
+    void rollbackTo(Transaction& txn, size_t savepoint);
+
+    // Oldest snapshot still in use; versions deleted at or before this
+    // timestamp can no longer be seen by anyone
+    uint64_t oldestActiveSnapshot() const;
+
+    // Timestamp of the latest commit
+    uint64_t lastCommitted() const { return lastCommitTs.load(); }
+
+private:
+    WriteAheadLog* log = nullptr;
+
+    std::atomic<uint64_t> lastCommitTs{0};
+    std::atomic<uint64_t> nextTxnId{TXN_ID_BASE};
+
+    // Serializes commits so timestamps are published in order
+    std::mutex commitMutex;
+
+    // Snapshots of all running transactions
+    mutable std::mutex activeMutex;
+    std::multiset<uint64_t> activeSnapshots;
+
+    void finish(Transaction& txn, Transaction::State state);
+};
+
+#endif // TRANSACTION_HPP
@@ -0,0 +1,124 @@
+#include "./trigram_index.hpp"
+#include <algorithm>
+#include <iterator>
+
+static uint32_t foldByte(char c) {
+    uint32_t byte = static_cast<unsigned char>(c);
+    return byte >= 'A' && byte <= 'Z' ? byte - 'A' + 'a' : byte;
+}
+
+// The three bytes at text, folded, in one 24-bit key
+static uint32_t trigramAt(const char* text) {
+    return foldByte(text[0]) << 16 | foldByte(text[1]) << 8 | foldByte(text[2]);
+}
+
+void TrigramIndex::add(const Value& value, size_t position) {
+    if (value.type() != ValueType::TEXT || value.asText().size() < 3) {
+        return;
+    }
+    std::string_view text = value.asText();
+    uint32_t row = static_cast<uint32_t>(position);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i + 3 <= text.size(); i++) {
+        Postings& list = postings[trigramAt(text.data() + i)];
+        if (!list.positions.empty() && list.positions.back() >= row) {
+            // The same trigram twice in one value
+            if (list.positions.back() == row) {
+                continue;
+            }
+            list.sorted = false;
+        }
+        list.positions.push_back(row);
+    }
+}
+
+bool TrigramIndex::candidates(const std::vector<std::string>& strings,
+                              std::vector<uint32_t>& out) const {
+    std::vector<uint32_t> keys;
+    for (const auto& text : strings) {
+        for (size_t i = 0; i + 3 <= text.size(); i++) {
+            keys.push_back(trigramAt(text.data() + i));
+        }
+    }
+    out.clear();
+    if (keys.empty()) {
+        return false;
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (uint32_t key : keys) {
+        auto it = postings.find(key);
+        if (it == postings.end()) {
+            return true;  // No row has this trigram
+        }
+        Postings& list = it->second;
+        if (!list.sorted) {
+            std::sort(list.positions.begin(), list.positions.end());
+            list.positions.erase(std::unique(list.positions.begin(), list.positions.end()),
+                                 list.positions.end());
+            list.sorted = true;
+        }
+        lists.push_back(&list.positions);
+    }
+
+    // Intersect from the shortest list up. A list much longer than the
+    // result so far is probed by binary search instead of walked.
+    std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+        return a->size() < b->size();
+    });
+    out = *lists[0];
+    std::vector<uint32_t> kept;
+    for (size_t i = 1; i < lists.size() && !out.empty(); i++) {
+        const std::vector<uint32_t>& list = *lists[i];
+        kept.clear();
+        if (list.size() / 16 > out.size()) {
+            auto from = list.begin();
+            for (uint32_t position : out) {
+                from = std::lower_bound(from, list.end(), position);
+                if (from == list.end()) {
+                    break;
+                }
+                if (*from == position) {
+                    kept.push_back(position);
+                }
+            }
+        } else {
+            std::set_intersection(out.begin(), out.end(), list.begin(), list.end(),
+                                  std::back_inserter(kept));
+        }
+        out.swap(kept);
+    }
+    return true;
+}
+
+void TrigramIndex::truncate(size_t position) {
+    uint32_t first = static_cast<uint32_t>(position);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = postings.begin(); it != postings.end(); ) {
+        std::vector<uint32_t>& positions = it->second.positions;
+        positions.erase(std::remove_if(positions.begin(), positions.end(),
+                                       [first](uint32_t row) { return row >= first; }),
+                        positions.end());
+        if (positions.empty()) {
+            it = postings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t TrigramIndex::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Buckets, plus a node per trigram with its key, list and next pointer
+    size_t bytes = postings.bucket_count() * sizeof(void*);
+    for (const auto& entry : postings) {
+        bytes += sizeof(entry) + sizeof(void*) + entry.second.positions.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
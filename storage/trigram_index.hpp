@@ -0,0 +1,69 @@
+#ifndef TRIGRAM_INDEX_HPP
+#define TRIGRAM_INDEX_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../sql/value.hpp"
+
+/**
+ * Index of the trigrams of a TEXT column: every three-byte substring of a
+ * value, with ASCII letters in lower case, maps to the positions of the
+ * row versions containing it. A LIKE or ILIKE pattern whose literal parts
+ * have trigrams then only needs to check the rows listed under all of
+ * them. Positions are only ever added, so rows updated or deleted since
+ * stay listed until garbage collection moves them; callers check every
+ * candidate against the pattern. Thread-safe.
+ */
+class TrigramIndex {
+public:
+    TrigramIndex(const std::string& name, size_t column) : name(name), column(column) {}
+
+    TrigramIndex(const TrigramIndex&) = delete;
+    TrigramIndex& operator=(const TrigramIndex&) = delete;
+
+    const std::string& getName() const { return name; }
+    size_t getColumn() const { return column; }
+
+    // False while the index is built; it is kept up to date meanwhile but
+    // does not list every row yet
+    bool isReady() const { return ready.load(std::memory_order_acquire); }
+    void setReady() { ready.store(true, std::memory_order_release); }
+
+    // List the row version at position under the trigrams of the value.
+    // Only text is indexed.
+    void add(const Value& value, size_t position);
+
+    // Positions, in increasing order, of the row versions that may contain
+    // every one of the strings, ignoring case. False if none of them is
+    // long enough to have a trigram, as then the index cannot narrow the
+    // search.
+    bool candidates(const std::vector<std::string>& strings, std::vector<uint32_t>& out) const;
+
+    // Forget every position from `position` on
+    void truncate(size_t position);
+
+    // Memory held by the posting lists and the map
+    size_t memoryBytes() const;
+
+private:
+    // Positions listed under one trigram. Rows are added in position
+    // order except for updates in place; those leave the list unsorted
+    // until the next lookup.
+    struct Postings {
+        std::vector<uint32_t> positions;
+        bool sorted = true;
+    };
+
+    std::string name;
+    size_t column;
+    std::atomic<bool> ready{false};
+
+    mutable std::mutex mutex;
+    mutable std::unordered_map<uint32_t, Postings> postings;
+};
+
+#endif // TRIGRAM_INDEX_HPP
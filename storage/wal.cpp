@@ -0,0 +1,221 @@
+#include "./wal.hpp"
+#include <fstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::open(const std::string& logPath) {
+    close();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    path = logPath;
+    file = std::fopen(path.c_str(), "ab");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    syncedLength = std::ftell(file);
+    failed = syncedLength < 0;
+    return !failed;
+}
+
+void WriteAheadLog::close() {
+    std::unique_lock<std::mutex> lock(mutex);
+    synced.wait(lock, [this] { return !syncing && !repairing; });
+
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+bool WriteAheadLog::commit(const std::string& records) {
+    std::unique_lock<std::mutex> lock(mutex);
+    synced.wait(lock, [this] { return !repairing; });
+    if (file == nullptr || failed) {
+        return false;
+    }
+
+    // Append the whole transaction at once, then the commit marker. Part
+    // of it left in the file would be completed by the next marker.
+    if (std::fwrite(records.data(), 1, records.size(), file) != records.size() ||
+        std::fputs("C\n", file) == EOF) {
+        dropUnsynced(lock);
+        return false;
+    }
+    uint64_t mine = ++appendedCount;
+
+    // Group commit: one committer syncs everything appended so far while
+    // the others wait for it instead of issuing their own fsync
+    while (syncedCount < mine) {
+        if (droppedCount >= mine) {
+            return false;
+        }
+        if (syncing || repairing) {
+            synced.wait(lock);
+            continue;
+        }
+
+        syncing = true;
+        uint64_t target = appendedCount;
+        long end = std::ftell(file);
+        bool flushed = end >= 0 && std::fflush(file) == 0;
+        lock.unlock();
+
+        bool ok = flushed && syncFile(file);
+
+        lock.lock();
+        syncing = false;
+        if (!ok) {
+            // The transactions of a failed sync were reported as failed,
+            // so they must not be replayed either
+            dropUnsynced(lock);
+            return false;
+        }
+        syncedCount = target;
+        syncedLength = end;
+        synced.notify_all();
+    }
+
+    return true;
+}
+
+void WriteAheadLog::dropUnsynced(std::unique_lock<std::mutex>& lock) {
+    // Nothing is appended or synced until the log is cut back; a sync
+    // already running finishes first
+    repairing = true;
+    synced.wait(lock, [this] { return !syncing; });
+
+    droppedCount = appendedCount;
+    if (!truncateTo(syncedLength)) {
+        failed = true;
+    }
+    repairing = false;
+    synced.notify_all();
+}
+
+bool WriteAheadLog::truncateTo(long length) {
+    // Closing writes out or discards what is buffered, so nothing lands
+    // past the cut later
+    std::fclose(file);
+    file = nullptr;
+
+    bool cut = false;
+    FILE* raw = std::fopen(path.c_str(), "rb+");
+    if (raw != nullptr) {
+#ifdef _WIN32
+        cut = _chsize_s(_fileno(raw), length) == 0;
+#else
+        cut = ftruncate(fileno(raw), length) == 0;
+#endif
+        cut = cut && syncFile(raw);
+        std::fclose(raw);
+    }
+
+    file = std::fopen(path.c_str(), "ab");
+    return cut && file != nullptr;
+}
+
+std::shared_lock<std::shared_mutex> WriteAheadLog::beginCommit() const {
+    return std::shared_lock<std::shared_mutex>(checkpointLatch);
+}
+
+std::unique_lock<std::shared_mutex> WriteAheadLog::pauseCommits() const {
+    return std::unique_lock<std::shared_mutex>(checkpointLatch);
+}
+
+bool WriteAheadLog::archive(const std::string& archivePath) {
+    std::unique_lock<std::mutex> lock(mutex);
+    synced.wait(lock, [this] { return !syncing && !repairing; });
+
+    if (file == nullptr) {
+        return false;
+    }
+    long length = std::ftell(file);
+    std::fclose(file);
+
+    // Every commit in the file is already synced. An empty log leaves
+    // the archive as it is.
+    bool moved = true;
+    if (length != 0) {
+        std::ifstream existing(archivePath, std::ios::binary);
+        if (existing.is_open()) {
+            existing.close();
+            {
+                std::ifstream in(path, std::ios::binary);
+                std::ofstream out(archivePath, std::ios::binary | std::ios::app);
+                out << in.rdbuf();
+                moved = static_cast<bool>(out);
+            }
+            moved = moved && syncPath(archivePath) && std::remove(path.c_str()) == 0;
+        } else {
+            moved = std::rename(path.c_str(), archivePath.c_str()) == 0;
+        }
+    }
+
+    // Keep logging either way; on failure the records stay in this file
+    file = std::fopen(path.c_str(), "ab");
+    if (file != nullptr) {
+        std::fseek(file, 0, SEEK_END);
+        syncedLength = std::ftell(file);
+    }
+    return moved && file != nullptr;
+}
+
+uint64_t WriteAheadLog::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == nullptr) {
+        return 0;
+    }
+
+    long position = std::ftell(file);
+    return position < 0 ? 0 : static_cast<uint64_t>(position);
+}
+
+bool WriteAheadLog::replay(const std::string& path,
+                           const std::function<bool(const std::vector<std::string>&)>& apply) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return true;  // No log, nothing to replay
+    }
+
+    std::vector<std::string> records;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line == "C") {
+            if (!apply(records)) {
+                return false;
+            }
+            records.clear();
+        } else {
+            records.push_back(line);
+        }
+    }
+
+    return true;
+}
+
+bool WriteAheadLog::syncPath(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "rb+");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = syncFile(file);
+    std::fclose(file);
+    return ok;
+}
+
+bool WriteAheadLog::syncFile(FILE* file) {
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
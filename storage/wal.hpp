@@ -0,0 +1,100 @@
+#ifndef WAL_HPP
+#define WAL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Write-ahead log of committed changes. Each transaction is appended as a
+ * group of text records followed by a commit marker and synced once, so
+ * a BEGIN ... COMMIT block costs a single fsync however many statements
+ * it contains. Concurrent commits share fsyncs (group commit).
+ *
+ * Record lines:
+ *   T <table> <column>:<TYPE>:<pk>:<notnull> ...   create table
+ *   X <table> <index> <column> <method> <rate>     create index
+ *   V CREATE MATERIALIZED VIEW ...;                make a table a view
+ *   P <table> range|hash <column> <n> <names> ...  partition a table
+ *   I <table> <row>                                insert
+ *   D <table> <row>                                delete
+ *   C                                              commit marker
+ * Rows use Table::encodeRow, indexes IndexDefinition::encode; X records
+ * written before Bloom filters have no method and are trigram. A view is
+ * its definition with line breaks escaped, and follows the T record of
+ * its table. A P record (PartitionScheme::encode) follows the T records
+ * of the partitions it lists; a partition it no longer lists is dropped,
+ * and later I and D records for it are ignored. An UPDATE is logged as
+ * the delete of the old row followed by the insert of the new one.
+ */
+class WriteAheadLog {
+public:
+    WriteAheadLog() = default;
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Open (or create) the log for appending
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    // Append the records of one transaction and wait until they are on
+    // disk. On failure the log is cut back to what is known to be on disk,
+    // so neither this transaction nor others failing with it are replayed;
+    // if it cannot be cut back, every later commit fails.
+    bool commit(const std::string& records);
+
+    // Held (shared) from appending a transaction until its changes are
+    // applied in memory, and (exclusive) by a checkpoint while it takes its
+    // snapshot, so the snapshot holds exactly the commits archived with it
+    std::shared_lock<std::shared_mutex> beginCommit() const;
+    std::unique_lock<std::shared_mutex> pauseCommits() const;
+
+    // Move the records logged so far to archivePath, appending them if a
+    // failed checkpoint left an archive there, and continue with an empty
+    // log. The archive is removed once a checkpoint covers it.
+    bool archive(const std::string& archivePath);
+
+    // Size of the log in bytes
+    uint64_t size() const;
+
+    // Call apply for the records of every complete transaction in the log.
+    // A torn transaction at the end (crash during append) is ignored.
+    static bool replay(const std::string& path,
+                       const std::function<bool(const std::vector<std::string>&)>& apply);
+
+    // Flush a file written through other means to disk
+    static bool syncPath(const std::string& path);
+
+private:
+    std::string path;
+    FILE* file = nullptr;
+
+    mutable std::mutex mutex;
+    std::condition_variable synced;
+    uint64_t appendedCount = 0;  // Transactions written to the file
+    uint64_t syncedCount = 0;    // Transactions known to be on disk
+    uint64_t droppedCount = 0;   // Transactions up to this one were cut off
+    long syncedLength = 0;       // Bytes of the file known to be on disk
+    bool syncing = false;        // A committer is running fsync
+    bool repairing = false;      // A failed commit is cutting the log back
+    bool failed = false;         // The log could not be cut back
+
+    // After a failed append or sync: fail every transaction not on disk
+    // yet and cut the log back to the bytes that are
+    void dropUnsynced(std::unique_lock<std::mutex>& lock);
+    bool truncateTo(long length);
+
+    mutable std::shared_mutex checkpointLatch;
+
+    static bool syncFile(FILE* file);
+};
+
+#endif // WAL_HPP